@@ -2,6 +2,22 @@ var editor;
 var changeGeneration;
 var forceDirty = false;
 
+/* Edit journal: while enabled, every change is reported to C++ with J_EVT_JOURNAL
+   so that unsaved changes survive a crash. journalSeq counts all changes made to
+   the document; backups record it so that the journal can be replayed on top of them.
+   journalPending collects the changes of the current operation. */
+var journalEnabled = false;
+var journalSeq = 0;
+var journalPending = [];
+
+/* Change deltas use the same entries as the journal, for extensions
+   that follow the document's changes (C_CMD_SET_CHANGE_DELTAS). */
+var changeDeltasEnabled = false;
+
+function journalActive() {
+    return journalEnabled || changeDeltasEnabled;
+}
+
 UiDriver.registerEventHandler("C_CMD_SET_VALUE", function(msg, data, prevReturn) {
     editor.setValue(data);
 });
@@ -22,7 +38,12 @@ function isCleanOrForced(generation) {
 UiDriver.registerEventHandler("C_CMD_MARK_CLEAN", function(msg, data, prevReturn) {
     forceDirty = false;
     changeGeneration = editor.changeGeneration(true);
+
     UiDriver.sendMessage("J_EVT_CLEAN_CHANGED", isCleanOrForced(changeGeneration));
+
+    // The document has been saved, so the journal can start over from the file.
+    if (journalActive())
+        UiDriver.sendMessage("J_EVT_JOURNAL", [{kind: "saved", seq: journalSeq}]);
 });
 
 UiDriver.registerEventHandler("C_CMD_MARK_DIRTY", function(msg, data, prevReturn) {
@@ -38,6 +59,38 @@ UiDriver.registerEventHandler("C_FUN_GET_HISTORY_GENERATION", function(msg, data
     return editor.getHistoryGeneration();
 });
 
+/* Returns everything needed to back up the document, so that autosave needs
+   only one message per editor.
+
+   data: history generation of the previous backup. The document's contents
+         are only included if the document is dirty and its generation differs.
+*/
+UiDriver.registerEventHandler("C_FUN_GET_BACKUP_STATE", function(msg, data, prevReturn) {
+    var scroll = editor.getScrollInfo();
+    var state = {
+        generation: editor.getHistoryGeneration(),
+        clean: isCleanOrForced(changeGeneration),
+        scrollX: scroll.left,
+        scrollY: scroll.top,
+        useTabs: editor.options.indentWithTabs,
+        indentSize: editor.options.indentUnit,
+        journalSeq: journalSeq
+    };
+
+    if (!state.clean && state.generation !== data)
+        state.value = editor.getValue("\n");
+
+    return state;
+});
+
+UiDriver.registerEventHandler("C_CMD_SET_JOURNALING", function(msg, data, prevReturn) {
+    journalEnabled = data;
+});
+
+UiDriver.registerEventHandler("C_CMD_SET_CHANGE_DELTAS", function(msg, data, prevReturn) {
+    changeDeltasEnabled = data;
+});
+
 UiDriver.registerEventHandler("C_CMD_SET_LANGUAGE", function(msg, data, prevReturn) {
     editor.setOption('mode', data);
 
@@ -135,6 +188,46 @@ UiDriver.registerEventHandler("C_FUN_GET_LINE_COUNT", function(msg, data, prevRe
     return editor.lineCount();
 });
 
+/* Returns the lines from data.from up to, but excluding, data.to.
+   Lines are only added while their total length is below data.maxLength,
+   but at least one line is returned.
+
+   Returns {lines: [...], next: first line not returned, or -1}
+*/
+UiDriver.registerEventHandler("C_FUN_GET_LINES", function(msg, data, prevReturn) {
+    return TextRanges.getLines(editor.getDoc(), data.from, data.to, data.maxLength);
+});
+
+/* Returns the text between data.from and data.to ([line, ch]),
+   at most data.maxLength characters of it.
+
+   Returns {text: ..., next: [line, ch] where the rest starts, or null}
+*/
+UiDriver.registerEventHandler("C_FUN_GET_RANGE", function(msg, data, prevReturn) {
+    return TextRanges.getRange(editor.getDoc(), data.from, data.to, data.maxLength);
+});
+
+/* Replaces several ranges in a single operation.
+
+   data.edits: [{from: [line, ch], to: [line, ch], text: ...}], all positions
+               refer to the document before the edits. Ranges must not overlap.
+   data.expectedSeq: if not negative, nothing is changed unless journalSeq
+                     has this value, i.e. the document wasn't changed meanwhile.
+
+   Returns {applied: true/false, seq: journalSeq after the edits}
+*/
+UiDriver.registerEventHandler("C_FUN_APPLY_EDITS", function(msg, data, prevReturn) {
+    if (data.expectedSeq >= 0 && data.expectedSeq !== journalSeq)
+        return {applied: false, seq: journalSeq};
+
+    var applied = false;
+    editor.operation(function() {
+        applied = TextRanges.applyEdits(editor.getDoc(), data.edits, "+extension");
+    });
+
+    return {applied: applied, seq: journalSeq};
+});
+
 UiDriver.registerEventHandler("C_FUN_GET_CURSOR", function(msg, data, prevReturn) {
     var cur = editor.getCursor();
     return [cur.line, cur.ch];
@@ -325,34 +418,54 @@ UiDriver.registerEventHandler("C_FUN_REPLACE", function(msg, data, prevReturn) {
     return Search(regexStr, regexModifiers, forward);
 });
 
-UiDriver.registerEventHandler("C_FUN_REPLACE_ALL", function(msg, data, prevReturn) {
-    var regexStr = data[0];
-    var regexModifiers = data[1];
-    var replacement = data[2];
-    var searchMode = Number(data[3]);
-    var searchCursor = editor.getSearchCursor(new RegExp(regexStr, regexModifiers), undefined, false);
+/* Replace a range of text as a single change, so that it can be undone in one
+   step and causes only one change event. Used by Replace All, which computes
+   the new text in C++.
 
-    var count = 0;
-    var id = Math.round(Math.random() * 1000000) + "/" + Date.now();
-    
-    var hasReuseTokens = hasGroupReuseTokens(replacement) && searchMode == SearchMode.Regex;
+   data.from, data.to: character offsets of the range to replace
+   data.text: the new text of the range
+   data.expectedLength: length of the document the offsets refer to
 
-    while (groups = searchCursor.findNext()) {
-        count++;
-        // Replace
-        if (hasReuseTokens){
-            searchCursor.replace(applyReusedGroups(replacement, groups), "*C_FUN_REPLACE_ALL" + id);
-        } else {
-            searchCursor.replace(replacement, "*C_FUN_REPLACE_ALL" + id);
-        }        
-    }
+   Returns false without changing anything if the document doesn't have the
+   expected length anymore, i.e. it was edited after the offsets were computed.
+*/
+UiDriver.registerEventHandler("C_FUN_REPLACE_TEXT_RANGE", function(msg, data, prevReturn) {
+    var doc = editor.getDoc();
+    var lastLine = doc.lastLine();
+    var length = doc.indexFromPos({line: lastLine, ch: doc.getLine(lastLine).length});
 
-    return count;
+    if (length !== data.expectedLength)
+        return false;
+
+    editor.operation(function() {
+        doc.replaceRange(data.text, doc.posFromIndex(data.from), doc.posFromIndex(data.to), "replaceAll");
+    });
+
+    return true;
+});
+
+/* Count and highlight all matches of a regex, updating them while the document changes.
+   See IncrementalSearch.js.
+
+   data[0]: contains the regex string. An empty string removes the highlights.
+   data[1]: contains the regex modifiers (e.g. "i")
+*/
+UiDriver.registerEventHandler("C_CMD_SEARCH_HIGHLIGHT_ALL", function(msg, data, prevReturn) {
+    IncrementalSearch.setQuery(data[0], data[1]);
 });
 
 UiDriver.registerEventHandler("C_FUN_SEARCH_SELECT_ALL", function(msg, data, prevReturn) {
     var regexStr = data[0];
     var regexModifiers = data[1];
+
+    // Reuse the matches of the live search if it's searching for the same thing
+    if (IncrementalSearch.isComplete(regexStr, regexModifiers)) {
+        var known = IncrementalSearch.selections();
+        if (known.length > 0)
+            editor.setSelections(known);
+        return known.length;
+    }
+
     var searchCursor = editor.getSearchCursor(new RegExp(regexStr, regexModifiers), undefined, false);
 
     var count = 0;
@@ -725,11 +838,39 @@ $(document).ready(function () {
 
     changeGeneration = editor.changeGeneration(true);
 
+    IncrementalSearch.init(editor);
+
     editor.on("change", function(instance, changeObj) {
+        journalSeq++;
+
+        if (journalActive()) {
+            if (changeObj.origin === "setValue") {
+                // Not worth journaling, the document is usually marked clean right after.
+                journalPending.push({kind: "reset", seq: journalSeq});
+            } else {
+                // The text before changeObj.from is unchanged, so its index is the same as before the change.
+                journalPending.push({
+                    kind: "change",
+                    seq: journalSeq,
+                    offset: editor.indexFromPos(changeObj.from),
+                    removed: changeObj.removed.join("\n").length,
+                    text: changeObj.text.join("\n")
+                });
+            }
+        }
+
         UiDriver.sendMessage("J_EVT_CONTENT_CHANGED");
         UiDriver.sendMessage("J_EVT_CLEAN_CHANGED", isCleanOrForced(changeGeneration));
     });
 
+    // Send the journal once per operation rather than once per change
+    editor.on("changes", function(instance, changes) {
+        if (journalPending.length > 0) {
+            UiDriver.sendMessage("J_EVT_JOURNAL", journalPending);
+            journalPending = [];
+        }
+    });
+
     editor.on("cursorActivity", function(instance) {
         UiDriver.sendMessage("J_EVT_CURSOR_ACTIVITY", getDocumentInfo());
     });
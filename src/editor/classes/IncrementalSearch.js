@@ -0,0 +1,237 @@
+/*
+   Counts and highlights all matches of a search in the current document.
+
+   The document is scanned line by line in small slices, one slice per
+   animation frame, so that scanning a multi-MB document never blocks
+   typing. Highlighting is done through an overlay, which CodeMirror only
+   evaluates for the visible lines.
+   After the initial scan, edits only cause the changed lines to be scanned
+   again.
+
+   Whenever the number of matches changes, J_EVT_SEARCH_MATCH_COUNT is sent
+   with {count: <number of matches>, complete: <true if the whole document
+   has been scanned>}. The count is -1 if the search can't be counted line
+   by line (e.g. because it contains line breaks).
+*/
+var IncrementalSearch = new function() {
+    // Maximum time in milliseconds spent scanning per frame
+    var FRAME_BUDGET_MS = 8;
+
+    var cm = null;
+    var query = null;           // {regexStr, regexModifiers} of the active search, or null
+    var regex = null;           // Global regex used for scanning
+    var overlay = null;
+
+    // lineMatches[i] is undefined if line i still needs to be scanned, null if
+    // it contains no matches, or a flat array of [from, to, from, to, ...] pairs.
+    var lineMatches = [];
+    var pending = [];           // [from, to) line ranges that may contain unscanned lines
+    var count = 0;
+    var countable = true;
+    var scheduled = false;
+    var lastReported = null;
+
+    this.init = function(editor) {
+        // Calling init again must not register the handler twice
+        if (cm !== null)
+            cm.off("change", onChange);
+
+        cm = editor;
+        cm.on("change", onChange);
+    }
+
+    /*
+       Starts counting and highlighting the matches of the given regex.
+       An empty regexStr stops the search and removes the highlights.
+    */
+    this.setQuery = function(regexStr, regexModifiers) {
+        if (query !== null && query.regexStr === regexStr && query.regexModifiers === regexModifiers)
+            return;
+
+        this.clear();
+
+        if (regexStr === "")
+            return;
+
+        try {
+            regex = new RegExp(regexStr, regexModifiers + "g");
+        } catch (e) {
+            // Happens while the user is still typing a regex
+            UiDriver.sendMessage("J_EVT_SEARCH_MATCH_COUNT", {count: -1, complete: true});
+            return;
+        }
+
+        query = {regexStr: regexStr, regexModifiers: regexModifiers};
+        countable = regexStr.indexOf("\n") === -1 && regexStr.indexOf("\\n") === -1;
+
+        overlay = makeOverlay(new RegExp(regexStr, regexModifiers + "g"));
+        cm.addOverlay(overlay);
+
+        if (countable) {
+            lineMatches = new Array(cm.lineCount());
+            pending = [[0, cm.lineCount()]];
+            schedule();
+        } else {
+            report(true);
+        }
+    }
+
+    this.clear = function() {
+        if (overlay !== null)
+            cm.removeOverlay(overlay);
+
+        query = null;
+        regex = null;
+        overlay = null;
+        lineMatches = [];
+        pending = [];
+        count = 0;
+        lastReported = null;
+    }
+
+    /*
+       Returns true if all matches of the given search are known.
+    */
+    this.isComplete = function(regexStr, regexModifiers) {
+        return query !== null && countable && pending.length === 0 &&
+               query.regexStr === regexStr && query.regexModifiers === regexModifiers;
+    }
+
+    /*
+       Returns the matches as an array of {anchor, head} selections.
+       Only valid if isComplete() returns true.
+    */
+    this.selections = function() {
+        var selections = [];
+        for (var i = 0; i < lineMatches.length; i++) {
+            var matches = lineMatches[i];
+            if (!matches)
+                continue;
+            for (var j = 0; j < matches.length; j += 2) {
+                selections.push({anchor: {line: i, ch: matches[j]}, head: {line: i, ch: matches[j+1]}});
+            }
+        }
+        return selections;
+    }
+
+    function makeOverlay(overlayRegex) {
+        return {
+            token: function(stream) {
+                overlayRegex.lastIndex = stream.pos;
+                var match = overlayRegex.exec(stream.string);
+                if (match && match.index === stream.pos && match[0].length > 0) {
+                    stream.pos += match[0].length;
+                    return "searchMatch";
+                } else if (match && match.index > stream.pos) {
+                    stream.pos = match.index;
+                } else {
+                    stream.skipToEnd();
+                }
+            }
+        };
+    }
+
+    function scanLine(i) {
+        var text = cm.getLine(i);
+        var matches = null;
+        var match;
+
+        regex.lastIndex = 0;
+        while ((match = regex.exec(text)) !== null) {
+            if (match[0].length === 0) {
+                // Empty matches can't be highlighted or selected
+                regex.lastIndex++;
+                continue;
+            }
+            if (matches === null)
+                matches = [];
+            matches.push(match.index, match.index + match[0].length);
+        }
+
+        lineMatches[i] = matches;
+        if (matches !== null)
+            count += matches.length / 2;
+    }
+
+    function step() {
+        scheduled = false;
+        if (query === null || !countable)
+            return;
+
+        var deadline = performance.now() + FRAME_BUDGET_MS;
+        var scanned = 0;
+
+        while (pending.length > 0) {
+            var range = pending[0];
+            while (range[0] < range[1]) {
+                if (lineMatches[range[0]] === undefined)
+                    scanLine(range[0]);
+                range[0]++;
+
+                // Checking the time is relatively expensive, don't do it for every line
+                if (++scanned % 64 === 0 && performance.now() > deadline) {
+                    report(false);
+                    schedule();
+                    return;
+                }
+            }
+            pending.shift();
+        }
+
+        report(true);
+    }
+
+    function schedule() {
+        if (!scheduled) {
+            scheduled = true;
+            window.requestAnimationFrame(step);
+        }
+    }
+
+    function report(complete) {
+        var current = countable ? count : -1;
+        if (lastReported !== null && lastReported.count === current && lastReported.complete === complete)
+            return;
+
+        lastReported = {count: current, complete: complete};
+        UiDriver.sendMessage("J_EVT_SEARCH_MATCH_COUNT", lastReported);
+    }
+
+    function onChange(instance, changeObj) {
+        if (query === null || !countable)
+            return;
+
+        var first = changeObj.from.line;
+        var removed = changeObj.to.line - first + 1;
+        var added = changeObj.text.length;
+        var delta = added - removed;
+
+        // Forget the matches of the replaced lines; the new lines are scanned again.
+        for (var i = first; i < first + removed; i++) {
+            if (lineMatches[i])
+                count -= lineMatches[i].length / 2;
+        }
+        if (delta === 0) {
+            for (var j = first; j < first + added; j++)
+                lineMatches[j] = undefined;
+        } else {
+            lineMatches = lineMatches.slice(0, first).concat(new Array(added), lineMatches.slice(first + removed));
+        }
+
+        // Move the pending ranges along with the lines they refer to
+        var adjust = function(line) {
+            if (line <= first)
+                return line;
+            if (line >= first + removed)
+                return line + delta;
+            return first + added;
+        };
+        for (var r = 0; r < pending.length; r++) {
+            pending[r][0] = adjust(pending[r][0]);
+            pending[r][1] = adjust(pending[r][1]);
+        }
+        pending.push([first, first + added]);
+
+        schedule();
+    }
+}
@@ -0,0 +1,77 @@
+/*
+   Reads and replaces ranges of a document, for C_FUN_GET_LINES,
+   C_FUN_GET_RANGE and C_FUN_APPLY_EDITS.
+
+   Only the CodeMirror.Doc API is used, so these functions can be run
+   against any object that implements it.
+*/
+var TextRanges = new function() {
+
+    /* Returns the lines from 'from' up to, but excluding, 'to'.
+       Lines are only added while their total length is below maxLength,
+       but at least one line is returned.
+
+       Returns {lines: [...], next: first line not returned, or -1}
+    */
+    this.getLines = function(doc, from, to, maxLength) {
+        to = Math.min(to, doc.lineCount());
+        var lines = [];
+        var length = 0;
+        var line = Math.max(0, from);
+
+        for (; line < to; line++) {
+            var text = doc.getLine(line);
+            if (lines.length > 0 && length + text.length > maxLength)
+                break;
+            lines.push(text);
+            length += text.length + 1;
+        }
+
+        return {lines: lines, next: line < to ? line : -1};
+    }
+
+    /* Returns the text between 'from' and 'to' ([line, ch]),
+       at most maxLength characters of it.
+
+       Returns {text: ..., next: [line, ch] where the rest starts, or null}
+    */
+    this.getRange = function(doc, from, to, maxLength) {
+        from = doc.clipPos({line: from[0], ch: from[1]});
+        to = doc.clipPos({line: to[0], ch: to[1]});
+        var start = doc.indexFromPos(from);
+
+        if (doc.indexFromPos(to) - start > maxLength) {
+            var next = doc.posFromIndex(start + maxLength);
+            return {text: doc.getRange(from, next, "\n"), next: [next.line, next.ch]};
+        }
+
+        return {text: doc.getRange(from, to, "\n"), next: null};
+    }
+
+    /* Replaces several ranges. 'edits' is [{from: [line, ch], to: [line, ch], text: ...}],
+       all positions refer to the document before the edits.
+
+       Returns false, without changing anything, if the ranges overlap.
+    */
+    this.applyEdits = function(doc, edits, origin) {
+        edits = edits.map(function(edit) {
+            var from = doc.clipPos({line: edit.from[0], ch: edit.from[1]});
+            var to = doc.clipPos({line: edit.to[0], ch: edit.to[1]});
+            return {from: from, to: to, start: doc.indexFromPos(from), end: doc.indexFromPos(to), text: edit.text};
+        });
+
+        // Apply from the end of the document, so that each edit leaves the positions of the next one intact
+        edits.sort(function(a, b) { return b.start - a.start; });
+
+        for (var i = 0; i < edits.length; i++) {
+            if (edits[i].end < edits[i].start || (i > 0 && edits[i].end > edits[i - 1].start))
+                return false;
+        }
+
+        for (var i = 0; i < edits.length; i++)
+            doc.replaceRange(edits[i].text, edits[i].from, edits[i].to, origin);
+
+        return true;
+    }
+
+}
@@ -3,6 +3,250 @@
 #include "include/notepadqq.h"
 #include "nqqsettings.cpp"
 #include "notepadqq.cpp"
+#include "Search/directorywalker.cpp"
+#include "Search/searchengine.cpp"
+#include "Search/searchobjects.cpp"
+#include "Search/searchresultcache.cpp"
+#include "Search/searchstring.cpp"
+#include "Extensions/Stubs/dispatchtable.cpp"
+#include "Extensions/extensionsconnections.cpp"
+#include "Extensions/extensionpackage.cpp"
+#include "Extensions/restartpolicy.cpp"
+#include "Extensions/activationevents.cpp"
+#include "Extensions/manifestcache.cpp"
+#include "Extensions/eventsubscriptions.cpp"
+#include "localcommunication.cpp"
+#include "Sessions/blobstore.cpp"
+#include "Sessions/editjournal.cpp"
+#include "Sessions/sessionsnapshot.cpp"
+#include "include/Extensions/stubregistry.h"
+
+#include <QJSEngine>
+#include <QLocalServer>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+    // Stand-in for Extensions::Stubs::Stub, which needs the whole application
+    struct FakeStub {
+        int object = 0;
+        bool alive = true;
+
+        Extensions::StubIdentity identity() const {
+            Extensions::StubIdentity identity;
+            identity.object = reinterpret_cast<const void *>(static_cast<quintptr>(object));
+            identity.stubName = "Fake";
+            return identity;
+        }
+        bool isAlive() { return alive; }
+    };
+
+    QSharedPointer<FakeStub> fakeStub(int object)
+    {
+        QSharedPointer<FakeStub> stub(new FakeStub());
+        stub->object = object;
+        return stub;
+    }
+
+    // qCompress() output is a 4 bytes size, a 2 bytes zlib header, the deflate stream and a 4 bytes checksum
+    QByteArray rawDeflate(const QByteArray &data)
+    {
+        const QByteArray compressed = qCompress(data, 9);
+        return compressed.mid(6, compressed.size() - 10);
+    }
+
+    // Builds a zip archive with deflated entries
+    QByteArray buildZip(const QList<QPair<QString, QByteArray>> &files)
+    {
+        QByteArray zip;
+        QByteArray directory;
+        QDataStream out(&zip, QIODevice::WriteOnly);
+        QDataStream dir(&directory, QIODevice::WriteOnly);
+        out.setByteOrder(QDataStream::LittleEndian);
+        dir.setByteOrder(QDataStream::LittleEndian);
+
+        for (const auto &file : files) {
+            const QByteArray name = file.first.toUtf8();
+            const QByteArray data = rawDeflate(file.second);
+            const quint32 crc = Extensions::ExtensionPackage::crc32(file.second);
+            const quint32 offset = zip.size();
+
+            out << quint32(0x04034b50) << quint16(20) << quint16(0) << quint16(8) << quint32(0)
+                << crc << quint32(data.size()) << quint32(file.second.size())
+                << quint16(name.size()) << quint16(0);
+            out.writeRawData(name.constData(), name.size());
+            out.writeRawData(data.constData(), data.size());
+
+            dir << quint32(0x02014b50) << quint16(20) << quint16(20) << quint16(0) << quint16(8) << quint32(0)
+                << crc << quint32(data.size()) << quint32(file.second.size())
+                << quint16(name.size()) << quint16(0) << quint16(0) << quint16(0) << quint16(0)
+                << quint32(0) << offset;
+            dir.writeRawData(name.constData(), name.size());
+        }
+
+        const quint32 directoryOffset = zip.size();
+        out.writeRawData(directory.constData(), directory.size());
+        out << quint32(0x06054b50) << quint16(0) << quint16(0) << quint16(files.size()) << quint16(files.size())
+            << quint32(directory.size()) << directoryOffset << quint16(0);
+
+        return zip;
+    }
+
+    bool writeFile(const QString &path, const QByteArray &data)
+    {
+        QFile file(path);
+        return file.open(QFile::WriteOnly) && file.write(data) == data.size();
+    }
+
+    // Two connected local sockets
+    struct SocketPair {
+        QLocalServer server;
+        QLocalSocket client;
+        QLocalSocket *accepted = nullptr;
+
+        bool connect()
+        {
+            const QString name = QString("nqq-test-%1-%2").arg(QCoreApplication::applicationPid()).arg(qrand());
+            if (!server.listen(name))
+                return false;
+
+            client.connectToServer(name);
+            if (!client.waitForConnected(5000) || !server.waitForNewConnection(5000))
+                return false;
+
+            accepted = server.nextPendingConnection();
+            return accepted != nullptr;
+        }
+    };
+
+    /**
+     * @brief Runs the event loop until 'count' messages have been received.
+     */
+    QList<QByteArray> receiveMessages(LocalCommunication &receiver, int count)
+    {
+        QList<QByteArray> messages;
+        QEventLoop loop;
+
+        const auto connection = QObject::connect(&receiver, &LocalCommunication::messageReceived, [&]() {
+            while (receiver.hasPendingMessages())
+                messages.append(receiver.nextRaw());
+            if (messages.size() >= count)
+                loop.quit();
+        });
+
+        while (receiver.hasPendingMessages())
+            messages.append(receiver.nextRaw());
+
+        if (messages.size() < count) {
+            QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+            loop.exec();
+        }
+
+        QObject::disconnect(connection);
+        return messages;
+    }
+
+    /**
+     * @brief Runs the event loop until 'condition' is true, or gives up after ten seconds.
+     */
+    bool waitUntil(const std::function<bool()> &condition)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (!condition()) {
+            if (timer.hasExpired(10000))
+                return false;
+            QTest::qWait(5);
+        }
+        return true;
+    }
+
+    // A client of Extensions::ExtensionsConnections. The server greets every client, and replies
+    // to every request with its method.
+    struct ExtensionsTestClient {
+        Extensions::ExtensionsConnections connections;
+        QLocalSocket socket;
+        quint64 clientId = 0;
+        int requests = 0;
+        QVector<int> batches;   // Size of every batch of requests
+
+        bool connect()
+        {
+            using Extensions::ExtensionsConnections;
+
+            QObject::connect(&connections, &ExtensionsConnections::clientConnected, [this](quint64 id) {
+                clientId = id;
+                connections.sendMessage({ id }, QJsonObject{ { "type", "greeting" } });
+            });
+
+            QObject::connect(&connections, &ExtensionsConnections::requestsReceived,
+                             [this](quint64 id, const QVector<QJsonObject> &batch) {
+                QVector<QJsonObject> replies;
+                for (const QJsonObject &request : batch)
+                    replies.append(QJsonObject{ { "result", request.value("method") } });
+                requests += batch.size();
+                batches.append(batch.size());
+                connections.sendReplies(id, replies);
+            });
+
+            const QString name = QString("nqq-test-%1-%2").arg(QCoreApplication::applicationPid()).arg(qrand());
+            if (!connections.listen(name))
+                return false;
+
+            socket.connectToServer(name);
+            return socket.waitForConnected(5000) && waitUntil([this] { return clientId != 0; });
+        }
+
+        QJsonObject readLine()
+        {
+            if (!waitUntil([this] { return socket.canReadLine(); }))
+                return QJsonObject();
+            return QJsonDocument::fromJson(socket.readLine()).object();
+        }
+
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+        static QByteArray frame(const QCborValue &value)
+        {
+            const QByteArray payload = value.toCbor();
+            QByteArray data(4, Qt::Uninitialized);
+            qToBigEndian(static_cast<quint32>(payload.size()), reinterpret_cast<uchar *>(data.data()));
+            return data + payload;
+        }
+
+        QCborValue readFrame()
+        {
+            uchar header[4];
+            if (!waitUntil([this] { return socket.bytesAvailable() >= 4; }))
+                return QCborValue();
+
+            socket.peek(reinterpret_cast<char *>(header), 4);
+            const qint64 size = qFromBigEndian<quint32>(header);
+            if (!waitUntil([&] { return socket.bytesAvailable() >= 4 + size; }))
+                return QCborValue();
+
+            socket.read(4);
+            return QCborValue::fromCbor(socket.read(size));
+        }
+#endif
+    };
+}
+
+// Object called through Extensions::Stubs::DispatchTable
+class DispatchTarget : public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE QString join(const QString &a, int b) const { return a + QString::number(b); }
+    Q_INVOKABLE int twice(int value) const { return value * 2; }
+    Q_INVOKABLE QString twice(const QStringList &values) const { return values.join(',').repeated(2); }
+    Q_INVOKABLE QVariant echo(const QVariant &value) const { return value; }
+    Q_INVOKABLE void setValue(int value, int step = 1) { m_value = value * step; }
+    int value() const { return m_value; }
+private:
+    Q_INVOKABLE void hidden() {}
+    int m_value = 0;
+};
 
 class NotepadqqTest : public QObject
 {
@@ -13,6 +257,40 @@ public:
 
 private Q_SLOTS:
     void editorPathIsHtml();
+    void searchEnginesAgree_data();
+    void searchEnginesAgree();
+    void searchEngineBenchmark_data();
+    void searchEngineBenchmark();
+    void multiPatternSearch();
+    void searchResultCacheLimit();
+    void regexRequiredLiteral_data();
+    void regexRequiredLiteral();
+    void directoryWalkerHonoursIgnoreRules();
+    void directoryWalkerDetectsBinaryData();
+    void sessionSnapshotRoundTrip();
+    void blobStoreDeduplicatesAndCollects();
+    void editJournalRecoversChanges();
+    void stubRegistryTracksClients();
+    void stubRegistryBenchmark();
+    void dispatchTableInvokesMethods();
+    void dispatchTableBenchmark();
+    void extensionPackageExtracts();
+    void restartPolicyBacksOff();
+    void manifestCacheInvalidates();
+    void activationEventsMatch();
+    void eventSubscriptionsFilterEvents();
+    void eventSubscriptionsCoalesceEvents();
+    void localCommunicationFramesMessages();
+    void localCommunicationBenchmark();
+    void extensionsConnectionsBinaryProtocol();
+    void extensionsConnectionsJsonProtocol();
+    void extensionsConnectionsRateLimit();
+    void extensionsConnectionsMetrics();
+    void extensionsConnectionsOnIoThread();
+    void editorTextRanges();
+
+private:
+    static QString searchBenchmarkText();
 };
 
 NotepadqqTest::NotepadqqTest()
@@ -25,6 +303,1314 @@ void NotepadqqTest::editorPathIsHtml()
     QVERIFY(Notepadqq::editorPath().endsWith(".html"));
 }
 
+QString NotepadqqTest::searchBenchmarkText()
+{
+    static QString text;
+    if (text.isEmpty()) {
+        // Roughly 4 million characters of source-code-like text
+        for (int i = 0; i < 50000; i++) {
+            text += QString("int function%1(int value) {\n"
+                            "\tif (value > %1) return value * 2; // Some comment\n"
+                            "}\n").arg(i);
+        }
+    }
+    return text;
+}
+
+void NotepadqqTest::searchEnginesAgree_data()
+{
+    QTest::addColumn<QString>("pattern");
+
+    QTest::newRow("literal") << "return";
+    QTest::newRow("captures") << "ret(u)rn\\s+(\\w+)";
+    QTest::newRow("anchored") << "^\\tif";
+    QTest::newRow("no match") << "zzz\\d+";
+}
+
+void NotepadqqTest::searchEnginesAgree()
+{
+    QFETCH(QString, pattern);
+
+    SearchConfig config;
+    config.searchString = pattern;
+    config.searchMode = SearchConfig::ModeRegex;
+
+    const QString text = searchBenchmarkText();
+    const DocResult plain = SearchEngine::create(config, SearchEngine::EngineRegex)->search(text);
+    const DocResult jit = SearchEngine::create(config, SearchEngine::EngineRegexJit)->search(text);
+
+    QCOMPARE(plain.results.size(), jit.results.size());
+    for (int i = 0; i < plain.results.size(); i++) {
+        QCOMPARE(plain.results[i].positionInFile, jit.results[i].positionInFile);
+        QCOMPARE(plain.results[i].matchLength, jit.results[i].matchLength);
+        QCOMPARE(plain.results[i].capturedStart(2), jit.results[i].capturedStart(2));
+    }
+}
+
+void NotepadqqTest::searchEngineBenchmark_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("engine");
+
+    QTest::newRow("plain text") << "return" << int(SearchConfig::ModePlainText)
+                                << int(SearchEngine::EnginePlainText);
+    QTest::newRow("special chars") << "\\treturn" << int(SearchConfig::ModePlainTextSpecialChars)
+                                   << int(SearchEngine::EnginePlainText);
+    QTest::newRow("regex") << "ret(u)rn\\s+\\w+" << int(SearchConfig::ModeRegex)
+                           << int(SearchEngine::EngineRegex);
+    QTest::newRow("regex jit") << "ret(u)rn\\s+\\w+" << int(SearchConfig::ModeRegex)
+                               << int(SearchEngine::EngineRegexJit);
+    QTest::newRow("regex, no match") << "zzz\\d+" << int(SearchConfig::ModeRegex)
+                                     << int(SearchEngine::EngineRegex);
+    QTest::newRow("regex jit, no match") << "zzz\\d+" << int(SearchConfig::ModeRegex)
+                                         << int(SearchEngine::EngineRegexJit);
+
+    // A few hundred identifiers, once as a pattern list and once as the equivalent alternation
+    QStringList identifiers;
+    QStringList escapedIdentifiers;
+    for (int i = 0; i < 300; i++) {
+        identifiers << QString("value%1x").arg(i * 7) << QString("function%1(").arg(i * 131);
+        escapedIdentifiers << QRegularExpression::escape(identifiers[identifiers.size()-2])
+                           << QRegularExpression::escape(identifiers.last());
+    }
+    QTest::newRow("multi-pattern") << identifiers.join(' ') << int(SearchConfig::ModeMultiPattern)
+                                   << int(SearchEngine::EngineMultiPattern);
+    QTest::newRow("regex jit alternation") << escapedIdentifiers.join('|')
+                                           << int(SearchConfig::ModeRegex) << int(SearchEngine::EngineRegexJit);
+}
+
+void NotepadqqTest::searchEngineBenchmark()
+{
+    QFETCH(QString, pattern);
+    QFETCH(int, mode);
+    QFETCH(int, engine);
+
+    SearchConfig config;
+    config.searchString = pattern;
+    config.searchMode = static_cast<SearchConfig::SearchMode>(mode);
+
+    const QString text = searchBenchmarkText();
+    const auto searchEngine = SearchEngine::create(config, static_cast<SearchEngine::EngineType>(engine));
+
+    QBENCHMARK {
+        if (searchEngine->mightMatch(text))
+            searchEngine->search(text);
+    }
+}
+
+void NotepadqqTest::multiPatternSearch()
+{
+    SearchConfig config;
+    config.searchString = "foo foobar  bar\tBAZ";
+    config.searchMode = SearchConfig::ModeMultiPattern;
+
+    const QString text = "xfoobarx foo bar baz";
+    DocResult result = SearchEngine::create(config)->search(text);
+
+    // Matches are leftmost-longest and don't overlap
+    QCOMPARE(result.results.size(), 4);
+    QCOMPARE(result.results[0].positionInFile, 1);
+    QCOMPARE(result.results[0].patternIndex, 1);
+    QCOMPARE(result.results[1].positionInFile, 9);
+    QCOMPARE(result.results[1].patternIndex, 0);
+    QCOMPARE(result.results[2].patternIndex, 2);
+    QCOMPARE(result.results[3].getMatchString(), QString("baz"));
+    QCOMPARE(result.results[3].patternIndex, 3);
+
+    config.matchCase = true;
+    config.matchWord = true;
+    result = SearchEngine::create(config)->search(text);
+    QCOMPARE(result.results.size(), 2);
+    QCOMPARE(result.results[0].positionInFile, 9);
+    QCOMPARE(result.results[1].positionInFile, 13);
+
+    // "cd" is only reachable through the dictionary link of "bcd", which overlaps "ab"
+    config.searchString = "ab bcd cd";
+    config.matchWord = false;
+    result = SearchEngine::create(config)->search("abcd");
+    QCOMPARE(result.results.size(), 2);
+    QCOMPARE(result.results[0].getMatchString(), QString("ab"));
+    QCOMPARE(result.results[1].positionInFile, 2);
+    QCOMPARE(result.results[1].patternIndex, 2);
+
+    // The scan stops at the result limit
+    result = SearchEngine::create(config)->search("abcd cd cd", 2);
+    QCOMPARE(result.results.size(), 2);
+    QVERIFY(result.limitReached);
+    result = SearchEngine::create(config)->search("abcd", 2);
+    QVERIFY(!result.limitReached);
+}
+
+void NotepadqqTest::searchResultCacheLimit()
+{
+    auto docResult = [](int count) {
+        DocResult result;
+        result.results.resize(count);
+        return result;
+    };
+
+    SearchConfig config;
+    config.searchString = "searchResultCacheLimit";
+    config.maxResultsTotal = 10;
+
+    SearchIndex::FileStamp stamp;
+    stamp.size = 1;
+    SearchIndex::FileStamp modified;
+    modified.size = 2;
+
+    DocResult cached;
+    QSharedPointer<SearchResultCache> cache = SearchResultCache::forConfig(config);
+
+    {
+        QMutexLocker locker(cache->mutex());
+
+        // Cached results count against the result limit of the search
+        cache->store("a", stamp, docResult(6));
+        cache->store("b", stamp, docResult(6));
+        QVERIFY(cache->lookup("a", stamp, 0, cached));
+        QCOMPARE(cached.results.size(), 6);
+        QVERIFY(!cache->lookup("b", stamp, 0, cached));
+
+        // Replacing an entry gives back its results, empty results always fit
+        cache->store("a", stamp, docResult(3));
+        cache->store("b", stamp, docResult(6));
+        cache->store("c", stamp, docResult(0));
+        QVERIFY(cache->lookup("b", stamp, 0, cached));
+        QVERIFY(cache->lookup("c", stamp, 0, cached));
+
+        // A new result that doesn't fit anymore drops the outdated one
+        cache->store("a", modified, docResult(5));
+        QVERIFY(!cache->lookup("a", stamp, 0, cached));
+        QVERIFY(!cache->lookup("a", modified, 0, cached));
+    }
+
+    // The limit is shared by all caches
+    SearchConfig otherConfig = config;
+    otherConfig.searchString += "2";
+    QSharedPointer<SearchResultCache> other = SearchResultCache::forConfig(otherConfig);
+    QMutexLocker otherLocker(other->mutex());
+
+    other->store("d", stamp, docResult(5));
+    QVERIFY(!other->lookup("d", stamp, 0, cached));
+
+    // The results of a cache are given back when it goes away
+    for (int i = 0; i < MAX_RECENT_CACHES; i++) {
+        SearchConfig newer = config;
+        newer.searchString += QString::number(i + 3);
+        SearchResultCache::forConfig(newer);
+    }
+    cache.clear();
+
+    other->store("d", stamp, docResult(5));
+    QVERIFY(other->lookup("d", stamp, 0, cached));
+}
+
+void NotepadqqTest::regexRequiredLiteral_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("subject");
+    QTest::addColumn<QString>("literal");
+
+    QTest::newRow("escaped punctuation") << "foo\\.bar\\(" << "foo.bar(" << "foo.bar(";
+    QTest::newRow("escaped backslash") << "a\\\\Qb" << "a\\Qb" << "a\\Qb";
+    QTest::newRow("group") << "long(er)?text" << "longtext" << "long";
+    QTest::newRow("hex escape") << "ab\\x41cdef" << "abAcdef" << "ab";
+    QTest::newRow("hex escape with braces") << "\\x{41}BCDEF" << "ABCDEF" << "";
+    QTest::newRow("control escape") << "xy\\cAzzz" << QString("xy") + QChar(1) + "zzz" << "xy";
+    QTest::newRow("octal escape") << "\\101BCDEF" << "ABCDEF" << "";
+    QTest::newRow("named back reference") << "(?<quote>['\"])ab\\k<quote>" << "'ab'" << "ab";
+    QTest::newRow("quoted") << "\\Qa.b\\E" << "a.b" << "";
+    QTest::newRow("extended") << "(?x) a b c # comment" << "abc" << "";
+    QTest::newRow("extended group") << "(?ix: a b c)" << "ABC" << "";
+}
+
+void NotepadqqTest::regexRequiredLiteral()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, subject);
+    QFETCH(QString, literal);
+
+    SearchConfig config;
+    config.searchString = pattern;
+    config.searchMode = SearchConfig::ModeRegex;
+
+    QCOMPARE(SearchEngine::requiredLiteral(config), literal);
+
+    // The prefilter must never rule out text that matches
+    const auto engine = SearchEngine::create(config, SearchEngine::EngineRegexJit);
+    QCOMPARE(engine->search(subject).results.size(), 1);
+    QVERIFY(engine->mightMatch(subject));
+}
+
+void NotepadqqTest::directoryWalkerHonoursIgnoreRules()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+
+    auto writeFile = [&](const QString& path, const QByteArray& contents) {
+        QDir(root.path()).mkpath(QFileInfo(root.path() + '/' + path).path());
+        QFile f(root.path() + '/' + path);
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(contents);
+    };
+
+    writeFile(".gitignore", "build/\n*.log\n!keep.log\n/top.txt\n");
+    writeFile("a.txt", "a");
+    writeFile("top.txt", "top");
+    writeFile("debug.log", "log");
+    writeFile("keep.log", "log");
+    writeFile("build/out.txt", "out");
+    writeFile("node_modules/dep/index.js", "js");
+    writeFile("sub/top.txt", "top");
+    writeFile("sub/.ignore", "*.tmp\n");
+    writeFile("sub/x.tmp", "tmp");
+    writeFile("sub/deep/y.txt", "y");
+
+    DirectoryWalker walker(root.path(), QStringList(), true);
+    walker.setExcludePatterns(QStringList() << "node_modules");
+    const std::atomic<bool> wantToStop(false);
+    QStringList files = walker.listFiles(wantToStop);
+    for (QString& f : files)
+        f = f.mid(root.path().length() + 1);
+    files.sort();
+
+    QCOMPARE(files, QStringList() << ".gitignore" << "a.txt" << "keep.log" << "sub/.ignore"
+                                  << "sub/deep/y.txt" << "sub/top.txt");
+    QCOMPARE(walker.getStatistics().dirsPruned, 2);
+    QCOMPARE(walker.getStatistics().filesIgnored, 3);
+}
+
+void NotepadqqTest::directoryWalkerDetectsBinaryData()
+{
+    QVERIFY(!DirectoryWalker::looksBinary("int main() {\n\treturn 0;\n}\n"));
+    QVERIFY(!DirectoryWalker::looksBinary(QString("Gr\u00FC\u00DFe").toUtf8()));
+    QVERIFY(!DirectoryWalker::looksBinary(QByteArray("\xFF\xFEh\0i\0", 6)));
+    QVERIFY(DirectoryWalker::looksBinary(QByteArray("\x7F" "ELF\x02\x01\x01\0", 8)));
+    QVERIFY(DirectoryWalker::looksBinary(QByteArray(64, '\x01')));
+}
+
+void NotepadqqTest::sessionSnapshotRoundTrip()
+{
+    SessionSnapshot snapshot;
+    snapshot.views.resize(2);
+
+    TabData tab;
+    tab.filePath = QString::fromUtf8("/tmp/f\u00e4ile.txt");
+    tab.cacheFilePath = "f\u00e4ile.txt.1234";
+    tab.scrollX = 12;
+    tab.scrollY = 3400;
+    tab.active = true;
+    tab.language = "cpp";
+    tab.lastModified = Q_INT64_C(1500000000000);
+    tab.customIndent = true;
+    tab.useTabs = true;
+    tab.tabSize = 8;
+    tab.contentHash = BlobStore::idForData("contents");
+    tab.journalId = EditJournal::newLogId();
+    tab.journalSeq = 42;
+    snapshot.views[0].tabs.push_back(tab);
+    snapshot.views[0].tabs.push_back(TabData());
+    snapshot.views[1].tabs.push_back(tab);
+
+    const QByteArray data = snapshot.toBinary();
+
+    SessionSnapshot restored;
+    QVERIFY(SessionSnapshot::fromBinary(data, restored));
+    QCOMPARE(restored.views.size(), size_t(2));
+    QCOMPARE(restored.views[0].tabs.size(), size_t(2));
+
+    const TabData& first = restored.views[0].tabs[0];
+    QCOMPARE(first.filePath, tab.filePath);
+    QCOMPARE(first.cacheFilePath, tab.cacheFilePath);
+    QCOMPARE(first.scrollX, tab.scrollX);
+    QCOMPARE(first.scrollY, tab.scrollY);
+    QCOMPARE(first.active, tab.active);
+    QCOMPARE(first.language, tab.language);
+    QCOMPARE(first.lastModified, tab.lastModified);
+    QCOMPARE(first.customIndent, tab.customIndent);
+    QCOMPARE(first.useTabs, tab.useTabs);
+    QCOMPARE(first.tabSize, tab.tabSize);
+    QCOMPARE(first.contentHash, tab.contentHash);
+    QCOMPARE(first.journalId, tab.journalId);
+    QCOMPARE(first.journalSeq, tab.journalSeq);
+    QVERIFY(restored.views[0].tabs[1].filePath.isEmpty());
+
+    // Truncated or corrupted snapshots must be rejected as a whole
+    QVERIFY(!SessionSnapshot::fromBinary(data.left(data.size() - 1), restored));
+    QByteArray corrupted = data;
+    corrupted[corrupted.size() / 2] = corrupted[corrupted.size() / 2] ^ 0x01;
+    QVERIFY(!SessionSnapshot::fromBinary(corrupted, restored));
+    QCOMPARE(restored.views.size(), size_t(2));
+}
+
 QTEST_GUILESS_MAIN(NotepadqqTest)
 
+void NotepadqqTest::blobStoreDeduplicatesAndCollects()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    BlobStore store(dir.path());
+
+    // Compressible and incompressible data must both survive the round trip
+    const QByteArray text = QByteArray("int main() { return 0; }\n").repeated(1000);
+    QByteArray noise;
+    for (int i = 0; i < 8192; i++)
+        noise.append(static_cast<char>(qrand() % 256));
+
+    QString textId, noiseId, emptyId;
+    qint64 written = 0;
+    QVERIFY(store.put(text, textId, true, &written));
+    QVERIFY(written > 0 && written < text.size());
+    QVERIFY(store.put(noise, noiseId, true, &written));
+    QVERIFY(written > noise.size());
+    QVERIFY(store.put(QByteArray(), emptyId, true));
+    QCOMPARE(textId, BlobStore::idForData(text));
+    QVERIFY(BlobStore::isValidId(textId));
+
+    // Storing the same data again costs nothing
+    QString id;
+    QVERIFY(store.put(text, id, false, &written));
+    QCOMPARE(id, textId);
+    QCOMPARE(written, qint64(0));
+
+    QByteArray data;
+    QVERIFY(store.get(textId, data));
+    QCOMPARE(data, text);
+    QVERIFY(store.get(noiseId, data));
+    QCOMPARE(data, noise);
+    QVERIFY(store.get(emptyId, data));
+    QVERIFY(data.isEmpty());
+    QVERIFY(!store.get(BlobStore::idForData("missing"), data));
+    QVERIFY(!store.get("../escape", data));
+
+    QCOMPARE(store.collectGarbage({ textId }), 2);
+    QVERIFY(store.contains(textId));
+    QVERIFY(!store.contains(noiseId));
+    QVERIFY(!store.contains(emptyId));
+}
+
+void NotepadqqTest::editJournalRecoversChanges()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString journalDir = dir.path() + "/journal";
+    EditJournal journal(journalDir);
+    const QString id = EditJournal::newLogId();
+    const QString path = EditJournal::logPath(journalDir, id);
+
+    auto change = [](qint64 seq, int offset, int removed, const QString& text) {
+        EditJournal::Entry entry;
+        entry.seq = seq;
+        entry.offset = offset;
+        entry.removed = removed;
+        entry.text = text;
+        return entry;
+    };
+
+    // The snapshot was taken after 10 changes
+    journal.append(id, { change(9, 0, 0, "ignored") });
+    journal.append(id, { change(11, 5, 0, ","), change(12, 6, 6, " there\n") });
+    journal.flush();
+    QVERIFY(journal.bytesWritten() > 0);
+
+    EditJournal::Recovery recovery = EditJournal::recover(path, 10);
+    QVERIFY(!recovery.saved);
+    QCOMPARE(recovery.changes.size(), 2);
+    QString text = "hello world";
+    QVERIFY(EditJournal::apply(recovery.changes, text));
+    QCOMPARE(text, QString("hello, there\n"));
+
+    // Changes that don't fit the document are rejected
+    QString shortText = "hi";
+    QVERIFY(!EditJournal::apply(recovery.changes, shortText));
+
+    // Only changes after a save apply to the saved file, and a gap ends the recovery
+    EditJournal::Entry saved;
+    saved.kind = EditJournal::Entry::Saved;
+    saved.seq = 12;
+    journal.append(id, { saved, change(13, 0, 1, "H"), change(15, 0, 0, "lost") });
+    journal.flush();
+    recovery = EditJournal::recover(path, 10);
+    QVERIFY(recovery.saved);
+    QCOMPARE(recovery.changes.size(), 1);
+    QCOMPARE(recovery.changes[0].text, QString("H"));
+
+    // A torn record ends the log, everything before it is intact
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::Append));
+    QVERIFY(file.write(QByteArray("\x00\x00\x01\x00\x12", 5)) == 5);
+    file.close();
+    QVector<EditJournal::Entry> entries;
+    QVERIFY(EditJournal::readLog(path, entries));
+    QCOMPARE(entries.size(), 6);
+
+    // A snapshot makes the entries it contains obsolete
+    journal.truncate(id, 12);
+    QVERIFY(EditJournal::readLog(path, entries));
+    QCOMPARE(entries.size(), 2);
+    QCOMPARE(entries[0].seq, qint64(13));
+    journal.truncate(id, 15);
+    QVERIFY(!QFileInfo(path).exists());
+}
+
+void NotepadqqTest::stubRegistryTracksClients()
+{
+    Extensions::StubRegistry<FakeStub> registry(100);
+    const quint64 clientA = 1, clientB = 2;
+    registry.pin(1, fakeStub(0));
+    registry.addClient(clientA);
+    registry.addClient(clientB);
+
+    // The same object always gets the same id
+    const qint64 first = registry.present(fakeStub(1), clientA);
+    QCOMPARE(first, qint64(101));
+    QCOMPARE(registry.present(fakeStub(1), clientB), first);
+    QCOMPARE(registry.find(fakeStub(1).data()), first);
+    QCOMPARE(registry.find(fakeStub(2).data()), qint64(-1));
+
+    // Objects are released when the last client using them disconnects
+    const qint64 second = registry.present(fakeStub(2), clientA);
+    registry.removeClient(clientA);
+    QVERIFY(!registry.value(first).isNull());
+    QVERIFY(registry.value(second).isNull());
+    registry.removeClient(clientB);
+    QVERIFY(registry.value(first).isNull());
+    QVERIFY(!registry.value(1).isNull());
+
+    // Stubs of destroyed objects are swept, and their address can be reused
+    const qint64 broadcast = registry.present(fakeStub(3), 0);
+    registry.value(broadcast)->alive = false;
+    const qint64 reused = registry.present(fakeStub(3), 0);
+    QVERIFY(reused != broadcast);
+    registry.value(reused)->alive = false;
+    QCOMPARE(registry.sweep(), 1);
+    QCOMPARE(registry.size(), 1);
+}
+
+void NotepadqqTest::stubRegistryBenchmark()
+{
+    const int count = 100000;
+    QVector<QSharedPointer<FakeStub>> stubs;
+    for (int i = 1; i <= count; i++)
+        stubs.append(fakeStub(i));
+
+    QBENCHMARK {
+        Extensions::StubRegistry<FakeStub> registry(100);
+        const quint64 client = 1;
+        registry.addClient(client);
+
+        for (const auto& stub : stubs)
+            registry.present(stub, client);
+
+        // What emitting an event from every object costs
+        for (const auto& stub : stubs)
+            QVERIFY(registry.find(stub.data()) != -1);
+
+        stubs[0]->alive = false;
+        QCOMPARE(registry.sweep(), 1);
+        stubs[0]->alive = true;
+
+        registry.removeClient(client);
+        QCOMPARE(registry.size(), 0);
+    }
+}
+
+void NotepadqqTest::dispatchTableInvokesMethods()
+{
+    using Extensions::Stubs::DispatchTable;
+
+    DispatchTarget target;
+    const auto table = DispatchTable::forMetaObject(target.metaObject());
+    QCOMPARE(DispatchTable::forMetaObject(target.metaObject()), table);
+
+    QVariant ret;
+    QVERIFY(table->invoke(&target, "join", QJsonArray({ "a", 4 }), ret));
+    QCOMPARE(ret.toString(), QString("a4"));
+
+    // Overloads are told apart by the arguments they accept
+    QVERIFY(table->invoke(&target, "twice", QJsonArray({ 21 }), ret));
+    QCOMPARE(ret.toInt(), 42);
+    QVERIFY(table->invoke(&target, "twice", QJsonArray({ QJsonArray({ "x", "y" }) }), ret));
+    QCOMPARE(ret.toString(), QString("x,yx,y"));
+
+    QVERIFY(table->invoke(&target, "echo", QJsonArray({ true }), ret));
+    QCOMPARE(ret, QVariant(true));
+
+    // Default arguments can be omitted, void methods return nothing
+    QVERIFY(table->invoke(&target, "setValue", QJsonArray({ 5 }), ret));
+    QCOMPARE(target.value(), 5);
+    QVERIFY(table->invoke(&target, "setValue", QJsonArray({ 5, 3 }), ret));
+    QCOMPARE(target.value(), 15);
+    QVERIFY(ret.isNull());
+
+    QVERIFY(!table->invoke(&target, "join", QJsonArray({ "a" }), ret));
+    QVERIFY(!table->invoke(&target, "hidden", QJsonArray(), ret));
+    QVERIFY(!table->invoke(&target, "missing", QJsonArray(), ret));
+}
+
+void NotepadqqTest::dispatchTableBenchmark()
+{
+    DispatchTarget target;
+    const QJsonArray args({ "line ", 42 });
+    QVariant ret;
+
+    QBENCHMARK {
+        for (int i = 0; i < 1000; i++) {
+            Extensions::Stubs::DispatchTable::forMetaObject(target.metaObject())
+                    ->invoke(&target, "join", args, ret);
+        }
+    }
+}
+
+void NotepadqqTest::extensionPackageExtracts()
+{
+    using Extensions::ExtensionPackage;
+
+    QByteArray noise;
+    for (int i = 0; i < 100000; i++)
+        noise.append(static_cast<char>(qrand() % 256));
+    const QByteArray text = QByteArray("module.exports = 42;\n").repeated(5000);
+
+    QCOMPARE(ExtensionPackage::inflate(rawDeflate(text)), text);
+    QCOMPARE(ExtensionPackage::inflate(rawDeflate(noise)), noise);
+    QVERIFY(ExtensionPackage::inflate(QByteArray("\xff\xff\xff")).isNull());
+
+    // Decompression stops as soon as the output is larger than declared
+    QCOMPARE(ExtensionPackage::inflate(rawDeflate(text), text.size()), text);
+    QVERIFY(ExtensionPackage::inflate(rawDeflate(text), text.size() - 1).isNull());
+    QVERIFY(ExtensionPackage::inflate(rawDeflate(QByteArray(16 * 1024 * 1024, '\0')), 1024).isNull());
+    QCOMPARE(ExtensionPackage::crc32("123456789"), quint32(0xCBF43926));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString packagePath = dir.path() + "/test.nqqext";
+    QVERIFY(writeFile(packagePath, buildZip({
+        { ExtensionPackage::MANIFEST_FILENAME, QByteArray(R"({"name": "Test", "unique_name": "com.test"})") },
+        { "test-1.0.0.tgz", noise },
+        { "lib/index.js", text }
+    })));
+
+    ExtensionPackage package(packagePath);
+    QVERIFY(package.open());
+    QCOMPARE(package.entries().size(), 3);
+    QCOMPARE(package.manifest().value("unique_name").toString(), QString("com.test"));
+    QCOMPARE(package.read("test-1.0.0.tgz"), noise);
+    QVERIFY(package.read("missing").isNull());
+
+    int extracted = 0;
+    QVERIFY(package.extractAll(dir.path() + "/out", [&](int done, int total) {
+        extracted = done;
+        QCOMPARE(total, 3);
+    }));
+    QCOMPARE(extracted, 3);
+    QFile js(dir.path() + "/out/lib/index.js");
+    QVERIFY(js.open(QFile::ReadOnly));
+    QCOMPARE(js.readAll(), text);
+
+    // Entries can't be extracted outside of the destination
+    const QString evilPath = dir.path() + "/evil.nqqext";
+    QVERIFY(writeFile(evilPath, buildZip({ { "../escaped", text } })));
+    ExtensionPackage evil(evilPath);
+    QVERIFY(evil.open());
+    QVERIFY(!evil.extractAll(dir.path() + "/evil"));
+    QVERIFY(!QFile::exists(dir.path() + "/escaped"));
+
+    // Damaged data is detected by the CRC
+    QByteArray damaged = buildZip({ { "file", text } });
+    damaged[40] = damaged[40] ^ 0x01;
+    const QString damagedPath = dir.path() + "/damaged.nqqext";
+    QVERIFY(writeFile(damagedPath, damaged));
+    ExtensionPackage damagedPackage(damagedPath);
+    QVERIFY(damagedPackage.open());
+    QVERIFY(damagedPackage.read("file").isNull());
+}
+
+void NotepadqqTest::restartPolicyBacksOff()
+{
+    using Extensions::RestartPolicy;
+    RestartPolicy policy;
+
+    // Quick crashes: the delay doubles, and the 5th crash in a row is the last one
+    QCOMPARE(policy.crashed(10), 1000);
+    QCOMPARE(policy.crashed(10), 2000);
+    QCOMPARE(policy.crashed(10), 4000);
+    QCOMPARE(policy.crashed(10), 8000);
+    QCOMPARE(policy.crashed(10), -1);
+    QCOMPARE(policy.consecutiveCrashes(), RestartPolicy::MAX_CONSECUTIVE_CRASHES);
+
+    // A host that ran long enough starts a new series
+    QCOMPARE(policy.crashed(RestartPolicy::STABLE_RUN_MS), 1000);
+    QCOMPARE(policy.consecutiveCrashes(), 1);
+
+    policy.reset();
+    QCOMPARE(policy.consecutiveCrashes(), 0);
+    QCOMPARE(policy.crashed(0), 1000);
+
+    // The delay never exceeds the maximum
+    RestartPolicy stable;
+    for (int i = 0; i < 100; i++)
+        QVERIFY(stable.crashed(RestartPolicy::STABLE_RUN_MS) <= RestartPolicy::MAX_DELAY_MS);
+}
+
+void NotepadqqTest::manifestCacheInvalidates()
+{
+    using Extensions::ManifestCache;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString extensionsPath = dir.path() + "/extensions";
+    const QString cachePath = dir.path() + "/cache/extensionManifests.json";
+
+    QVERIFY(QDir().mkpath(extensionsPath + "/first"));
+    QVERIFY(QDir().mkpath(extensionsPath + "/broken"));
+    QVERIFY(QDir().mkpath(extensionsPath + "/empty"));
+    QVERIFY(QDir().mkpath(extensionsPath + "/old%%BACKUP"));
+    QVERIFY(writeFile(extensionsPath + "/first/nqq-manifest.json", "{\"name\":\"First\"}"));
+    QVERIFY(writeFile(extensionsPath + "/broken/nqq-manifest.json", "{\"name\":"));
+    QVERIFY(writeFile(extensionsPath + "/old%%BACKUP/nqq-manifest.json", "{\"name\":\"Old\"}"));
+
+    // Name of every extension, and number of manifests parsed
+    int misses = -1;
+    auto scan = [&] {
+        ManifestCache cache(cachePath);
+        QMap<QString, QString> names;
+        for (const ManifestCache::Entry &entry : cache.scan(extensionsPath))
+            names.insert(QFileInfo(entry.path).fileName(), entry.manifest.value("name").toString());
+
+        misses = cache.misses();
+        return names;
+    };
+
+    // Backups are skipped, missing and invalid manifests give empty ones
+    QMap<QString, QString> expected;
+    expected.insert("first", "First");
+    expected.insert("broken", QString());
+    expected.insert("empty", QString());
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 2);
+    QVERIFY(QFile::exists(cachePath));
+
+    // Nothing changed: nothing is parsed, not even the invalid manifest
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 0);
+
+    // A modified manifest is parsed again
+    QVERIFY(writeFile(extensionsPath + "/first/nqq-manifest.json", "{\"name\":\"First, modified\"}"));
+    expected.insert("first", "First, modified");
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 1);
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 0);
+
+    // New and removed extensions
+    QVERIFY(QDir().mkpath(extensionsPath + "/second"));
+    QVERIFY(writeFile(extensionsPath + "/second/nqq-manifest.json", "{\"name\":\"Second\"}"));
+    QVERIFY(QDir(extensionsPath + "/broken").removeRecursively());
+    expected.insert("second", "Second");
+    expected.remove("broken");
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 1);
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 0);
+
+    // A cache of another version, or a damaged one, is ignored
+    QVERIFY(writeFile(cachePath, "{\"version\":0}"));
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 2);
+    QVERIFY(writeFile(cachePath, "garbage"));
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 2);
+    QCOMPARE(scan(), expected);
+    QCOMPARE(misses, 0);
+}
+
+void NotepadqqTest::activationEventsMatch()
+{
+    using Extensions::ActivationEvents;
+
+    // Manifests without activation events always start
+    const ActivationEvents legacy(QJsonObject{ { "name", "Legacy" } });
+    QVERIFY(legacy.contains(ActivationEvents::STARTUP_EVENT));
+    QVERIFY(!legacy.contains(ActivationEvents::languageEvent("python")));
+
+    const QJsonObject manifest = QJsonDocument::fromJson(R"({
+        "name": "Lazy",
+        "activationEvents": ["onLanguage:python", "onCommand:lazy.run"]
+    })").object();
+
+    const ActivationEvents lazy(manifest);
+    QVERIFY(!lazy.contains(ActivationEvents::STARTUP_EVENT));
+    QVERIFY(lazy.contains(ActivationEvents::languageEvent("python")));
+    QVERIFY(!lazy.contains(ActivationEvents::languageEvent("javascript")));
+    QVERIFY(lazy.contains(ActivationEvents::commandEvent("lazy.run")));
+    QVERIFY(!lazy.contains(ActivationEvents::commandEvent("lazy.other")));
+
+    // An empty list never activates, "*" always does
+    const ActivationEvents never(QJsonObject{ { "activationEvents", QJsonArray() } });
+    QVERIFY(!never.contains(ActivationEvents::STARTUP_EVENT));
+
+    const ActivationEvents always(QJsonObject{ { "activationEvents", QJsonArray{ "*" } } });
+    QVERIFY(always.contains(ActivationEvents::STARTUP_EVENT));
+    QVERIFY(always.contains(ActivationEvents::languageEvent("python")));
+    QVERIFY(always.contains(ActivationEvents::commandEvent("any")));
+}
+
+void NotepadqqTest::eventSubscriptionsFilterEvents()
+{
+    Extensions::EventSubscriptions subscriptions;
+    auto subscribers = [&](qint64 objectId, const QString &event) {
+        QVector<quint64> clients = subscriptions.subscribers(objectId, event);
+        std::sort(clients.begin(), clients.end());
+        return clients;
+    };
+
+    subscriptions.addClient(1);
+    subscriptions.addClient(2);
+    subscriptions.addClient(3);
+
+    // Clients that never subscribed receive everything
+    QCOMPARE(subscribers(5, "changes"), QVector<quint64>({ 1, 2, 3 }));
+
+    subscriptions.subscribe(1, 5, { "changes" });
+    subscriptions.subscribe(2, 5, { "triggered", "changes" });
+    subscriptions.subscribe(2, 5, { "changes" });
+    QCOMPARE(subscribers(5, "changes"), QVector<quint64>({ 1, 2, 3 }));
+    QCOMPARE(subscribers(5, "triggered"), QVector<quint64>({ 2, 3 }));
+    QCOMPARE(subscribers(6, "changes"), QVector<quint64>({ 3 }));
+
+    // Unsubscribing from everything doesn't bring back the other events
+    subscriptions.unsubscribe(1, 5, { "changes", "unknown" });
+    QCOMPARE(subscribers(5, "changes"), QVector<quint64>({ 2, 3 }));
+    QCOMPARE(subscribers(6, "changes"), QVector<quint64>({ 3 }));
+
+    subscriptions.removeClient(2);
+    subscriptions.removeClient(3);
+    QCOMPARE(subscribers(5, "changes"), QVector<quint64>());
+
+    // Unknown clients can't subscribe
+    subscriptions.subscribe(4, 5, { "changes" });
+    QCOMPARE(subscribers(5, "changes"), QVector<quint64>());
+
+    // Nothing is delivered when nobody listens
+    int deliveries = 0;
+    connect(&subscriptions, &Extensions::EventSubscriptions::deliver, [&]() { deliveries++; });
+    subscriptions.publish(5, "changes", QJsonObject());
+    QCOMPARE(deliveries, 0);
+}
+
+void NotepadqqTest::eventSubscriptionsCoalesceEvents()
+{
+    using Extensions::EventSubscriptions;
+    EventSubscriptions subscriptions;
+    QVector<QPair<QVector<quint64>, QJsonObject>> delivered;
+    connect(&subscriptions, &EventSubscriptions::deliver,
+            [&](const QVector<quint64> &clientIds, const QJsonObject &message) {
+        delivered.append(qMakePair(clientIds, message));
+    });
+
+    auto message = [](int value) { return QJsonObject{ { "value", value } }; };
+
+    subscriptions.addClient(1);
+    subscriptions.addClient(2);
+    subscriptions.subscribe(2, 5, { "scroll" });
+
+    subscriptions.publish(5, "scroll", message(1), true);
+    subscriptions.publish(5, "cursor", message(2), true);
+    subscriptions.publish(5, "scroll", message(3), true);
+    QVERIFY(delivered.isEmpty());
+
+    // Only the last instance of each event, in the order they were first published
+    QTRY_COMPARE_WITH_TIMEOUT(delivered.size(), 2, EventSubscriptions::COALESCE_INTERVAL_MS * 20);
+    QCOMPARE(delivered[0].second, message(3));
+    QCOMPARE(delivered[1].second, message(2));
+    QCOMPARE(delivered[1].first, QVector<quint64>({ 1 }));
+
+    QVector<quint64> bothClients = delivered[0].first;
+    std::sort(bothClients.begin(), bothClients.end());
+    QCOMPARE(bothClients, QVector<quint64>({ 1, 2 }));
+
+    // An event that isn't coalesced flushes the pending ones first
+    delivered.clear();
+    subscriptions.publish(5, "scroll", message(4), true);
+    subscriptions.publish(5, "saved", message(5));
+    QCOMPARE(delivered.size(), 2);
+    QCOMPARE(delivered[0].second, message(4));
+    QCOMPARE(delivered[1].second, message(5));
+
+    QTest::qWait(EventSubscriptions::COALESCE_INTERVAL_MS * 2);
+    QCOMPARE(delivered.size(), 2);
+
+    // Events for some clients only ignore the subscriptions, but not the order
+    delivered.clear();
+    subscriptions.publish(5, "scroll", message(6), true);
+    subscriptions.publishTo({ 2, 3 }, message(7));
+    QCOMPARE(delivered.size(), 2);
+    QCOMPARE(delivered[0].second, message(6));
+    QCOMPARE(delivered[1].first, QVector<quint64>({ 2 }));
+    QCOMPARE(delivered[1].second, message(7));
+}
+
+void NotepadqqTest::localCommunicationFramesMessages()
+{
+    SocketPair pair;
+    QVERIFY(pair.connect());
+
+    LocalCommunication sender(&pair.client);
+    LocalCommunication receiver(pair.accepted);
+
+    // Larger than the old 999999 bytes limit, and than the write buffer
+    QByteArray large;
+    for (int i = 0; i < 3 * 1024 * 1024; i++)
+        large.append(static_cast<char>(qrand() % 256));
+
+    QVERIFY(sender.send("hello"));
+    QVERIFY(sender.sendRaw(QByteArray()));
+    QVERIFY(sender.sendRaw(large));
+    QVERIFY(sender.send(QString::fromUtf8("\u00e8\u4e2d")));
+    QVERIFY(sender.bytesToWrite() > 0);
+
+    const QList<QByteArray> messages = receiveMessages(receiver, 4);
+    QCOMPARE(messages.size(), 4);
+    QCOMPARE(messages[0], QByteArray("hello"));
+    QVERIFY(messages[1].isEmpty() && !messages[1].isNull());
+    QCOMPARE(messages[2], large);
+    QCOMPARE(QString::fromUtf8(messages[3]), QString::fromUtf8("\u00e8\u4e2d"));
+    QCOMPARE(sender.bytesToWrite(), qint64(0));
+
+    // Blocking use, as in SingleApplication before the event loop starts
+    QVERIFY(receiver.send("ping"));
+    QVERIFY(receiver.waitForBytesWritten(5000));
+    QCOMPARE(sender.waitFor(5000), QString("ping"));
+    QVERIFY(sender.waitForRaw(10).isNull());
+
+    // A peer announcing a message over the limit is disconnected before anything is allocated
+    QByteArray header(sizeof(quint64), Qt::Uninitialized);
+    qToBigEndian<quint64>(LocalCommunication::MAX_MESSAGE_SIZE + 1, reinterpret_cast<uchar *>(header.data()));
+    pair.client.write(header);
+    QVERIFY(waitUntil([&] { return pair.accepted->state() == QLocalSocket::UnconnectedState; }));
+    QVERIFY(!receiver.hasPendingMessages());
+}
+
+void NotepadqqTest::localCommunicationBenchmark()
+{
+    SocketPair pair;
+    QVERIFY(pair.connect());
+
+    LocalCommunication sender(&pair.client);
+    LocalCommunication receiver(pair.accepted);
+
+    // 64 messages of 64 KiB per iteration: 4 MiB
+    const QByteArray payload(64 * 1024, 'x');
+    const int count = 64;
+
+    QBENCHMARK {
+        for (int i = 0; i < count; i++)
+            sender.sendRaw(payload);
+
+        QCOMPARE(receiveMessages(receiver, count).size(), count);
+    }
+}
+
+void NotepadqqTest::extensionsConnectionsBinaryProtocol()
+{
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+    using Extensions::ExtensionsConnections;
+
+    ExtensionsTestClient client;
+    QVERIFY(client.connect());
+
+    // The greeting was sent right away, but is held back until the handshake has been echoed
+    client.socket.write(ExtensionsConnections::BINARY_HANDSHAKE);
+    QVERIFY(waitUntil([&] { return client.socket.bytesAvailable() >= ExtensionsConnections::BINARY_HANDSHAKE.size(); }));
+    QCOMPARE(client.socket.read(ExtensionsConnections::BINARY_HANDSHAKE.size()), ExtensionsConnections::BINARY_HANDSHAKE);
+
+    QCborValue message = client.readFrame();
+    QVERIFY(message.isMap());
+    QCOMPARE(message.toMap().value(QStringLiteral("type")).toString(), QString("greeting"));
+
+    // An empty batch is answered with an empty array, and doesn't count as a request
+    client.socket.write(ExtensionsTestClient::frame(QCborArray()));
+    message = client.readFrame();
+    QVERIFY(message.isArray() && message.toArray().isEmpty());
+    QCOMPARE(client.connections.metrics().first().averageLatencyMs, 0.0);
+
+    // A single request and a batch, written in pieces that split the frames
+    QCborMap request;
+    request.insert(QStringLiteral("id"), 1);
+    request.insert(QStringLiteral("method"), QStringLiteral("first"));
+
+    QCborArray batch;
+    for (int id : { 2, 3 }) {
+        QCborMap item;
+        item.insert(QStringLiteral("id"), id);
+        item.insert(QStringLiteral("method"), QString("batch%1").arg(id));
+        batch.append(item);
+    }
+
+    const QByteArray data = ExtensionsTestClient::frame(request) + ExtensionsTestClient::frame(batch);
+    for (int pos = 0; pos < data.size(); pos += 5) {
+        client.socket.write(data.mid(pos, 5));
+        client.socket.flush();
+        QTest::qWait(1);
+    }
+
+    message = client.readFrame();
+    QVERIFY(message.isMap());
+    QCOMPARE(message.toMap().value(QStringLiteral("id")).toDouble(), 1.0);
+    QCOMPARE(message.toMap().value(QStringLiteral("result")).toString(), QString("first"));
+
+    // The batch is answered with a single frame, in order
+    message = client.readFrame();
+    QVERIFY(message.isArray());
+    const QCborArray replies = message.toArray();
+    QCOMPARE(replies.size(), qsizetype(2));
+    QCOMPARE(replies.at(0).toMap().value(QStringLiteral("id")).toDouble(), 2.0);
+    QCOMPARE(replies.at(0).toMap().value(QStringLiteral("result")).toString(), QString("batch2"));
+    QCOMPARE(replies.at(1).toMap().value(QStringLiteral("id")).toDouble(), 3.0);
+    QCOMPARE(replies.at(1).toMap().value(QStringLiteral("result")).toString(), QString("batch3"));
+
+    // An invalid frame is answered, and doesn't close the connection
+    QByteArray invalid(4, Qt::Uninitialized);
+    qToBigEndian<quint32>(2, reinterpret_cast<uchar *>(invalid.data()));
+    client.socket.write(invalid + QByteArray("\x82\x01", 2) + ExtensionsTestClient::frame(request));
+
+    message = client.readFrame();
+    QVERIFY(message.isMap());
+    QVERIFY(message.toMap().value(QStringLiteral("id")).isNull());
+    message = client.readFrame();
+    QCOMPARE(message.toMap().value(QStringLiteral("id")).toDouble(), 1.0);
+
+    QCOMPARE(client.requests, 5);
+    QCOMPARE(client.socket.bytesAvailable(), qint64(0));
+#else
+    QSKIP("The binary protocol needs Qt 5.12 or later");
+#endif
+}
+
+void NotepadqqTest::extensionsConnectionsJsonProtocol()
+{
+    {
+        // A client that writes right away gets the greeting before its replies
+        ExtensionsTestClient client;
+        QVERIFY(client.connect());
+
+        client.socket.write("{\"method\":\"first\"}\n{\"method\":\"second\"}\n");
+        QCOMPARE(client.readLine().value("type").toString(), QString("greeting"));
+        QCOMPARE(client.readLine().value("result").toString(), QString("first"));
+        QCOMPARE(client.readLine().value("result").toString(), QString("second"));
+    }
+
+    {
+        // A client that waits for the server to speak first gets the greeting after the negotiation timeout
+        ExtensionsTestClient client;
+        QVERIFY(client.connect());
+
+        QCOMPARE(client.readLine().value("type").toString(), QString("greeting"));
+
+        client.socket.write("{\"method\":\"first\"}\n");
+        QCOMPARE(client.readLine().value("result").toString(), QString("first"));
+    }
+}
+
+void NotepadqqTest::extensionsConnectionsRateLimit()
+{
+    const int maxRequestsPerSecond = 100;
+    const int count = 150;
+
+    QByteArray data;
+    for (int i = 0; i < count; i++)
+        data += QString("{\"method\":\"m%1\"}\n").arg(i).toUtf8();
+
+    {
+        ExtensionsTestClient client;
+        client.connections.setMaxRequestsPerSecond(maxRequestsPerSecond);
+        QVERIFY(client.connect());
+
+        // A burst of up to a second's worth of requests is read right away,
+        // the rest as the bucket refills
+        QElapsedTimer timer;
+        timer.start();
+        client.socket.write(data);
+
+        QCOMPARE(client.readLine().value("type").toString(), QString("greeting"));
+        for (int i = 0; i < count; i++)
+            QCOMPARE(client.readLine().value("result").toString(), QString("m%1").arg(i));
+
+        QVERIFY(client.batches.first() <= maxRequestsPerSecond);
+        QVERIFY(timer.elapsed() >= (count - maxRequestsPerSecond) * 1000 / maxRequestsPerSecond * 8 / 10);
+
+        const auto metrics = client.connections.metrics();
+        QCOMPARE(metrics.size(), 1);
+        QVERIFY(metrics.first().throttled >= 1);
+        QCOMPARE(metrics.first().requests, qint64(count));
+    }
+
+    {
+        // 0 means unlimited
+        ExtensionsTestClient client;
+        client.connections.setMaxRequestsPerSecond(0);
+        QVERIFY(client.connect());
+
+        client.socket.write(data);
+        QCOMPARE(client.readLine().value("type").toString(), QString("greeting"));
+        for (int i = 0; i < count; i++)
+            QCOMPARE(client.readLine().value("result").toString(), QString("m%1").arg(i));
+
+        QCOMPARE(client.connections.metrics().first().throttled, qint64(0));
+    }
+
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+    {
+        // Every request of a binary batch counts, so the second batch has to wait
+        ExtensionsTestClient client;
+        client.connections.setMaxRequestsPerSecond(maxRequestsPerSecond);
+        QVERIFY(client.connect());
+
+        client.socket.write(Extensions::ExtensionsConnections::BINARY_HANDSHAKE);
+        QVERIFY(waitUntil([&] { return client.socket.bytesAvailable() >= Extensions::ExtensionsConnections::BINARY_HANDSHAKE.size(); }));
+        client.socket.read(Extensions::ExtensionsConnections::BINARY_HANDSHAKE.size());
+        QVERIFY(client.readFrame().isMap());
+
+        QCborArray batch;
+        for (int i = 0; i < 60; i++)
+            batch.append(QCborMap{ { QStringLiteral("method"), QString("m%1").arg(i) } });
+        client.socket.write(ExtensionsTestClient::frame(batch) + ExtensionsTestClient::frame(batch));
+
+        QCOMPARE(client.readFrame().toArray().size(), qsizetype(60));
+        QCOMPARE(client.readFrame().toArray().size(), qsizetype(60));
+        QCOMPARE(client.batches, QVector<int>({ 60, 60 }));
+        QVERIFY(client.connections.metrics().first().throttled >= 1);
+    }
+#endif
+}
+
+void NotepadqqTest::extensionsConnectionsMetrics()
+{
+    ExtensionsTestClient client;
+    QVERIFY(client.connect());
+
+    QVector<Extensions::ExtensionsConnections::ClientMetrics> metrics = client.connections.metrics();
+    QCOMPARE(metrics.size(), 1);
+    QCOMPARE(metrics.first().clientId, client.clientId);
+    QCOMPARE(metrics.first().requests, qint64(0));
+
+    client.socket.write("{\"method\":\"first\"}\n{\"method\":\"second\"}\n");
+    QCOMPARE(client.readLine().value("type").toString(), QString("greeting"));
+    QCOMPARE(client.readLine().value("result").toString(), QString("first"));
+    QCOMPARE(client.readLine().value("result").toString(), QString("second"));
+
+    metrics = client.connections.metrics();
+    QCOMPARE(metrics.first().requests, qint64(2));
+    QVERIFY(metrics.first().averageLatencyMs <= metrics.first().maxLatencyMs);
+
+    // The rate is computed over windows of about a second
+    QTest::qWait(1100);
+    client.socket.write("{\"method\":\"third\"}\n");
+    QCOMPARE(client.readLine().value("result").toString(), QString("third"));
+
+    metrics = client.connections.metrics();
+    QCOMPARE(metrics.first().requests, qint64(3));
+    QVERIFY(metrics.first().requestsPerSecond > 0);
+    QVERIFY(metrics.first().requestsPerSecond <= 3);
+
+    // Every connection has its own metrics, which go away with it
+    const quint64 clientId = client.clientId;
+    QLocalSocket other;
+    other.connectToServer(client.connections.fullServerName());
+    QVERIFY(other.waitForConnected(5000));
+    QVERIFY(waitUntil([&] { return client.connections.metrics().size() == 2; }));
+
+    client.socket.disconnectFromServer();
+    QVERIFY(waitUntil([&] { return client.connections.metrics().size() == 1; }));
+    QVERIFY(client.connections.metrics().first().clientId != clientId);
+    QCOMPARE(client.connections.metrics().first().requests, qint64(0));
+}
+
+void NotepadqqTest::extensionsConnectionsOnIoThread()
+{
+    using Extensions::ExtensionsConnections;
+    qRegisterMetaType<QVector<QJsonObject>>("QVector<QJsonObject>");
+    qRegisterMetaType<QVector<quint64>>("QVector<quint64>");
+
+    // Set up like ExtensionsServer does: the sockets live on the I/O thread,
+    // the requests are handled on this one
+    QThread ioThread;
+    ExtensionsConnections *connections = new ExtensionsConnections();
+    connections->moveToThread(&ioThread);
+    connect(&ioThread, &QThread::finished, connections, &QObject::deleteLater);
+
+    QObject receiver;
+    quint64 clientId = 0;
+    bool handledOnThisThread = true;
+
+    connect(connections, &ExtensionsConnections::clientConnected, &receiver, [&](quint64 id) {
+        clientId = id;
+        const QVector<quint64> clientIds{ id };
+        const QJsonObject greeting{ { "type", "greeting" } };
+        QMetaObject::invokeMethod(connections, "sendMessage", Qt::QueuedConnection,
+                                  Q_ARG(QVector<quint64>, clientIds), Q_ARG(QJsonObject, greeting));
+    });
+
+    connect(connections, &ExtensionsConnections::requestsReceived, &receiver,
+            [&](quint64 id, const QVector<QJsonObject> &batch) {
+        handledOnThisThread &= QThread::currentThread() == receiver.thread();
+
+        QVector<QJsonObject> replies;
+        for (const QJsonObject &request : batch)
+            replies.append(QJsonObject{ { "result", request.value("method") } });
+        QMetaObject::invokeMethod(connections, "sendReplies", Qt::QueuedConnection,
+                                  Q_ARG(quint64, id), Q_ARG(QVector<QJsonObject>, replies));
+    });
+
+    ioThread.start();
+
+    const QString name = QString("nqq-test-%1-%2").arg(QCoreApplication::applicationPid()).arg(qrand());
+    bool listening = false;
+    QMetaObject::invokeMethod(connections, "listen", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, listening), Q_ARG(QString, name));
+    QVERIFY(listening);
+    QCOMPARE(connections->fullServerName().isEmpty(), false);
+
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    QVERIFY(socket.waitForConnected(5000));
+    QVERIFY(waitUntil([&] { return clientId != 0; }));
+
+    const int count = 100;
+    for (int i = 0; i < count; i++)
+        socket.write(QString("{\"method\":\"m%1\"}\n").arg(i).toUtf8());
+
+    auto readLine = [&] {
+        if (!waitUntil([&] { return socket.canReadLine(); }))
+            return QJsonObject();
+        return QJsonDocument::fromJson(socket.readLine()).object();
+    };
+
+    QCOMPARE(readLine().value("type").toString(), QString("greeting"));
+    for (int i = 0; i < count; i++)
+        QCOMPARE(readLine().value("result").toString(), QString("m%1").arg(i));
+
+    QVERIFY(handledOnThisThread);
+    QCOMPARE(connections->metrics().first().requests, qint64(count));
+
+    socket.disconnectFromServer();
+    ioThread.quit();
+    QVERIFY(ioThread.wait(5000));
+}
+
+void NotepadqqTest::editorTextRanges()
+{
+    QFile script(QFINDTESTDATA("../editor/classes/TextRanges.js"));
+    QVERIFY(script.open(QFile::ReadOnly));
+
+    QJSEngine engine;
+    auto evaluate = [&](const QString &program) {
+        const QJSValue value = engine.evaluate(program);
+        if (value.isError())
+            qWarning() << value.toString();
+        return value.toVariant();
+    };
+
+    evaluate(QString::fromUtf8(script.readAll()));
+
+    // Implements the parts of CodeMirror.Doc used by TextRanges
+    evaluate(R"(
+        function FakeDoc(text) { this.lines = text.split("\n"); }
+        FakeDoc.prototype.lineCount = function() { return this.lines.length; };
+        FakeDoc.prototype.getLine = function(line) { return this.lines[line]; };
+        FakeDoc.prototype.getValue = function() { return this.lines.join("\n"); };
+        FakeDoc.prototype.clipPos = function(pos) {
+            var line = Math.max(0, Math.min(pos.line, this.lines.length - 1));
+            return {line: line, ch: Math.max(0, Math.min(pos.ch, this.lines[line].length))};
+        };
+        FakeDoc.prototype.indexFromPos = function(pos) {
+            var index = pos.ch;
+            for (var i = 0; i < pos.line; i++)
+                index += this.lines[i].length + 1;
+            return index;
+        };
+        FakeDoc.prototype.posFromIndex = function(index) {
+            var line = 0;
+            while (line < this.lines.length - 1 && index > this.lines[line].length)
+                index -= this.lines[line++].length + 1;
+            return {line: line, ch: index};
+        };
+        FakeDoc.prototype.getRange = function(from, to) {
+            return this.getValue().substring(this.indexFromPos(from), this.indexFromPos(to));
+        };
+        FakeDoc.prototype.replaceRange = function(text, from, to) {
+            var value = this.getValue();
+            this.lines = (value.substring(0, this.indexFromPos(from)) + text + value.substring(this.indexFromPos(to))).split("\n");
+        };
+    )");
+
+    // 3000 lines of 100 characters, including the line break, read in chunks of EditorStub's size
+    const int maxLength = 256 * 1024;
+    evaluate(R"(
+        var lines = [];
+        for (var i = 0; i < 3000; i++) {
+            var line = "line " + i + " ";
+            while (line.length < 99)
+                line += "x";
+            lines.push(line);
+        }
+        var doc = new FakeDoc(lines.join("\n"));
+    )");
+    const QString text = evaluate("doc.getValue()").toString();
+
+    QStringList lines;
+    int next = 0;
+    int chunks = 0;
+    do {
+        const QVariantMap chunk = evaluate(QString("TextRanges.getLines(doc, %1, 100000, %2)").arg(next).arg(maxLength)).toMap();
+        const QStringList chunkLines = chunk.value("lines").toStringList();
+        QVERIFY(!chunkLines.isEmpty());
+        QVERIFY(chunkLines.join('\n').length() < maxLength);
+        lines += chunkLines;
+        next = chunk.value("next").toInt();
+        chunks++;
+    } while (next != -1 && chunks < 10);
+    QCOMPARE(chunks, 2);
+    QCOMPARE(lines.join('\n'), text);
+
+    QString range;
+    QVariantList from = { 0, 0 };
+    chunks = 0;
+    for (;;) {
+        const QVariantMap chunk = evaluate(QString("TextRanges.getRange(doc, [%1, %2], [2999, 99], %3)")
+                                           .arg(from.value(0).toInt()).arg(from.value(1).toInt()).arg(maxLength)).toMap();
+        QVERIFY(chunk.value("text").toString().length() <= maxLength);
+        range += chunk.value("text").toString();
+        chunks++;
+        if (chunk.value("next").toList().isEmpty() || chunks == 10)
+            break;
+        from = chunk.value("next").toList();
+    }
+    QCOMPARE(chunks, 2);
+    QCOMPARE(range, text);
+
+    // A line longer than a chunk is still returned whole
+    evaluate(QString("var longDoc = new FakeDoc(new Array(%1).join('y'));").arg(maxLength + 2));
+    const QVariantMap longLine = evaluate(QString("TextRanges.getLines(longDoc, 0, 1, %1)").arg(maxLength)).toMap();
+    QCOMPARE(longLine.value("lines").toStringList().value(0).length(), maxLength + 1);
+    QCOMPARE(longLine.value("next").toInt(), -1);
+
+    // Edits refer to the document before any of them, in any order
+    evaluate("var editDoc = new FakeDoc('abc\\ndef\\nghi');");
+    QVERIFY(evaluate(R"(TextRanges.applyEdits(editDoc, [
+        {from: [2, 0], to: [2, 3], text: "Y\nZ"},
+        {from: [0, 1], to: [0, 2], text: "X"}
+    ]))").toBool());
+    QCOMPARE(evaluate("editDoc.getValue()").toString(), QString("aXc\ndef\nY\nZ"));
+
+    // Overlapping edits change nothing
+    QVERIFY(!evaluate(R"(TextRanges.applyEdits(editDoc, [
+        {from: [0, 0], to: [1, 1], text: ""},
+        {from: [1, 0], to: [1, 2], text: ""}
+    ]))").toBool());
+    QCOMPARE(evaluate("editDoc.getValue()").toString(), QString("aXc\ndef\nY\nZ"));
+}
+
 #include "tst_notepadqqtest.moc"
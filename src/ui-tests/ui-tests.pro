@@ -2,8 +2,8 @@
 # Automatically generated by qmake (3.0) mar set 6 19:25:17 2016
 ######################################################################
 
-QT += testlib
-QT += core gui svg widgets printsupport network webenginewidgets webchannel websockets
+QT += testlib qml
+QT += core gui svg widgets printsupport network webenginewidgets webchannel websockets concurrent
 CONFIG += c++11
 TEMPLATE = app
 TARGET = ui-tests
@@ -13,3 +13,6 @@ include(../ui/libs/qtpromise/qtpromise.pri)
 
 # Input
 SOURCES += tst_notepadqqtest.cpp
+HEADERS += ../ui/include/localcommunication.h \
+           ../ui/include/Extensions/extensionsconnections.h \
+           ../ui/include/Extensions/eventsubscriptions.h
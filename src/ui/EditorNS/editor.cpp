@@ -176,10 +176,19 @@ namespace EditorNS
                 emit contentChanged();
             else if(msg == "J_EVT_CLEAN_CHANGED")
                 emit cleanChanged(data.toBool());
+            else if (msg == "J_EVT_JOURNAL") {
+                if (m_journalingEnabled)
+                    emit journalEntries(data.toList());
+                if (m_changeDeltasEnabled)
+                    emit changeDeltas(data.toList());
+            }
             else if (msg == "J_EVT_CURSOR_ACTIVITY") {
                 emit cursorActivity(data.toMap());
             } else if (msg == "J_EVT_DOCUMENT_INFO") {
                 emit documentInfoRequested(data.toMap());
+            } else if (msg == "J_EVT_SEARCH_MATCH_COUNT") {
+                const QVariantMap map = data.toMap();
+                emit searchMatchCountChanged(map.value("count").toInt(), map.value("complete").toBool());
             }
         });
     }
@@ -260,6 +269,35 @@ namespace EditorNS
                 .then([](QVariant v){return v.toInt();});
     }
 
+    QPromise<Editor::BackupState> Editor::backupStateP(int knownGeneration)
+    {
+        return asyncSendMessageWithResultP("C_FUN_GET_BACKUP_STATE", knownGeneration).then([](QVariant v){
+            const QVariantMap map = v.toMap();
+            BackupState state;
+            state.historyGeneration = map.value("generation", -1).toInt();
+            state.clean = map.value("clean", true).toBool();
+            state.scrollPosition = qMakePair(map.value("scrollX").toInt(), map.value("scrollY").toInt());
+            state.indentationMode.useTabs = map.value("useTabs", true).toBool();
+            state.indentationMode.size = map.value("indentSize", 4).toInt();
+            state.hasValue = map.contains("value");
+            state.value = map.value("value").toString();
+            state.journalSeq = map.value("journalSeq").toLongLong();
+            return state;
+        });
+    }
+
+    void Editor::setJournalingEnabled(bool enabled)
+    {
+        m_journalingEnabled = enabled;
+        sendMessage("C_CMD_SET_JOURNALING", enabled);
+    }
+
+    void Editor::setChangeDeltasEnabled(bool enabled)
+    {
+        m_changeDeltasEnabled = enabled;
+        sendMessage("C_CMD_SET_CHANGE_DELTAS", enabled);
+    }
+
     void Editor::setLanguage(const Language* lang)
     {
         if (lang == nullptr) {
@@ -385,6 +423,49 @@ namespace EditorNS
         return asyncSendMessageWithResult("C_FUN_GET_VALUE").get().toString();
     }
 
+    QPromise<QString> Editor::valueP()
+    {
+        return asyncSendMessageWithResultP("C_FUN_GET_VALUE")
+                .then([](QVariant v){ return v.toString(); });
+    }
+
+    QPromise<bool> Editor::replaceTextRangeP(int from, int to, const QString& text, int expectedLength)
+    {
+        QVariantMap data;
+        data["from"] = from;
+        data["to"] = to;
+        data["text"] = text;
+        data["expectedLength"] = expectedLength;
+        return asyncSendMessageWithResultP("C_FUN_REPLACE_TEXT_RANGE", data)
+                .then([](QVariant v){ return v.toBool(); });
+    }
+
+    QVariantMap Editor::lines(int from, int to, int maxLength)
+    {
+        QVariantMap data;
+        data["from"] = from;
+        data["to"] = to;
+        data["maxLength"] = maxLength;
+        return asyncSendMessageWithResult("C_FUN_GET_LINES", data).get().toMap();
+    }
+
+    QVariantMap Editor::textRange(const Cursor& from, const Cursor& to, int maxLength)
+    {
+        QVariantMap data;
+        data["from"] = QVariantList{from.line, from.column};
+        data["to"] = QVariantList{to.line, to.column};
+        data["maxLength"] = maxLength;
+        return asyncSendMessageWithResult("C_FUN_GET_RANGE", data).get().toMap();
+    }
+
+    QVariantMap Editor::applyEdits(const QVariantList& edits, qint64 expectedSeq)
+    {
+        QVariantMap data;
+        data["edits"] = edits;
+        data["expectedSeq"] = expectedSeq;
+        return asyncSendMessageWithResult("C_FUN_APPLY_EDITS", data).get().toMap();
+    }
+
     bool Editor::fileOnDiskChanged() const
     {
         return m_fileOnDiskChanged;
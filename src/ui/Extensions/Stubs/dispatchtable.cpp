@@ -0,0 +1,118 @@
+#include "include/Extensions/Stubs/dispatchtable.h"
+
+namespace Extensions {
+    namespace Stubs {
+
+        DispatchTable::DispatchTable(const QMetaObject *metaObject)
+        {
+            const int methodCount = metaObject->methodCount();
+
+            for (int i = 0; i < methodCount; i++) {
+                const QMetaMethod metaMethod = metaObject->method(i);
+
+                if (metaMethod.access() != QMetaMethod::Public)
+                    continue;
+
+                Method method;
+                method.metaMethod = metaMethod;
+                method.returnType = metaMethod.returnType();
+
+                // Calling such a method would make Qt write the return value into nothing
+                bool callable = method.returnType != QMetaType::UnknownType;
+
+                for (int j = 0; callable && j < metaMethod.parameterCount(); j++) {
+                    const int type = metaMethod.parameterType(j);
+                    callable = type != QMetaType::UnknownType;
+                    method.parameterTypes.append(type);
+                }
+
+                if (!callable)
+                    continue;
+
+                // Overloads with default arguments appear once per number of parameters
+                const QString name = QString::fromLatin1(metaMethod.name());
+                m_methods[qMakePair(name, metaMethod.parameterCount())].append(method);
+            }
+        }
+
+        QSharedPointer<const DispatchTable> DispatchTable::forMetaObject(const QMetaObject *metaObject)
+        {
+            static QHash<const QMetaObject *, QSharedPointer<const DispatchTable>> tables;
+
+            QSharedPointer<const DispatchTable> &table = tables[metaObject];
+            if (table.isNull()) {
+                table = QSharedPointer<const DispatchTable>(new DispatchTable(metaObject));
+            }
+
+            return table;
+        }
+
+        bool DispatchTable::invoke(QObject *object, const QString &method, const QJsonArray &args, QVariant &ret) const
+        {
+            const auto overloads = m_methods.constFind(qMakePair(method, args.count()));
+            if (overloads == m_methods.constEnd())
+                return false;
+
+            for (const Method &candidate : overloads.value()) {
+                QVariantList converted;
+                if (!convertArguments(candidate, args, converted))
+                    continue; // Maybe another overload accepts them
+
+                // The pointers must refer to 'converted', which stays alive until the call returns.
+                // QVariant parameters point to the QVariant itself rather than to its contents.
+                QGenericArgument arguments[10];
+                for (int i = 0; i < converted.size(); i++) {
+                    const int type = candidate.parameterTypes[i];
+                    QVariant &argument = converted[i];
+                    arguments[i] = QGenericArgument(QMetaType::typeName(type),
+                                                    type == QMetaType::QVariant ? &argument : argument.data());
+                }
+
+                QVariant returnValue;
+                QGenericReturnArgument returnArgument;
+                if (candidate.returnType == QMetaType::QVariant) {
+                    returnArgument = QGenericReturnArgument("QVariant", &returnValue);
+                } else if (candidate.returnType != QMetaType::Void) {
+                    returnValue = QVariant(candidate.returnType, static_cast<void *>(nullptr));
+                    returnArgument = QGenericReturnArgument(candidate.metaMethod.typeName(), returnValue.data());
+                }
+
+                const bool ok = candidate.metaMethod.invoke(
+                            object,
+                            Qt::DirectConnection,
+                            returnArgument,
+                            arguments[0], arguments[1], arguments[2], arguments[3], arguments[4],
+                            arguments[5], arguments[6], arguments[7], arguments[8], arguments[9]);
+
+                if (ok) {
+                    ret = returnValue;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool DispatchTable::convertArguments(const Method &method, const QJsonArray &args, QVariantList &converted)
+        {
+            if (args.count() > 10)
+                return false;
+
+            converted.reserve(args.count());
+
+            for (int i = 0; i < args.count(); i++) {
+                const int type = method.parameterTypes[i];
+                QVariant value = args.at(i).toVariant();
+
+                // QVariant parameters take the argument whatever it contains
+                if (type != QMetaType::QVariant && value.userType() != type && !value.convert(type))
+                    return false;
+
+                converted.append(value);
+            }
+
+            return true;
+        }
+
+    }
+}
@@ -1,16 +1,27 @@
 #include "include/Extensions/Stubs/editorstub.h"
 
+#include "include/Extensions/runtimesupport.h"
+
 namespace Extensions {
     namespace Stubs {
 
+        namespace {
+            // Larger ranges are returned in chunks, see getLines() and getRange()
+            const int MAX_CHUNK_LENGTH = 256 * 1024;
+        }
+
         EditorStub::EditorStub(const QWeakPointer<QObject> &object, RuntimeSupport *rts) : Stub(object, rts)
         {
-
+            // Extensions that crash or quit don't get to disable the change deltas themselves
+            connect(rts, &RuntimeSupport::clientRemoved, this, [this](quint64 clientId) {
+                setChangeDeltasEnabled(clientId, false);
+            });
         }
 
         EditorStub::~EditorStub()
         {
-
+            if (!m_changeDeltaClients.isEmpty() && editor() != nullptr)
+                editor()->setChangeDeltasEnabled(false);
         }
 
         EditorNS::Editor *EditorStub::editor()
@@ -49,5 +60,127 @@ namespace Extensions {
             return StubReturnValue();
         }
 
+        bool EditorStub::toCursor(const QJsonValue &value, EditorNS::Editor::Cursor &cursor)
+        {
+            const QJsonArray array = value.toArray();
+            if (array.count() != 2 || !array.at(0).isDouble() || !array.at(1).isDouble())
+                return false;
+
+            cursor.line = array.at(0).toInt();
+            cursor.column = array.at(1).toInt();
+            return true;
+        }
+
+        /**
+         * getLines(from, to): lines from 'from' up to, but excluding, 'to'.
+         * Returns {lines, next}. If 'next' isn't -1, the result was too large and
+         * the remaining lines start at 'next'.
+         */
+        NQQ_DEFINE_EXTENSION_METHOD(EditorStub, getLines, args)
+        {
+            if (args.count() != 2)
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_NUMBER);
+
+            if (!args.at(0).isDouble() || !args.at(1).isDouble())
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_TYPE);
+
+            const QVariantMap lines = editor()->lines(args.at(0).toInt(), args.at(1).toInt(), MAX_CHUNK_LENGTH);
+            return StubReturnValue(QJsonObject::fromVariantMap(lines));
+        }
+
+        /**
+         * getRange(from, to): text between two [line, column] positions.
+         * Returns {text, next}. If 'next' isn't null, the result was too large and
+         * the remaining text starts at 'next'.
+         */
+        NQQ_DEFINE_EXTENSION_METHOD(EditorStub, getRange, args)
+        {
+            if (args.count() != 2)
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_NUMBER);
+
+            EditorNS::Editor::Cursor from, to;
+            if (!toCursor(args.at(0), from) || !toCursor(args.at(1), to))
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_TYPE);
+
+            const QVariantMap range = editor()->textRange(from, to, MAX_CHUNK_LENGTH);
+            return StubReturnValue(QJsonObject::fromVariantMap(range));
+        }
+
+        /**
+         * applyEdits(edits, [expectedSeq]): replaces several ranges in one undoable step.
+         * 'edits' is an array of {from: [line, column], to: [line, column], text}, all referring
+         * to the document before the edits. If 'expectedSeq' is given, nothing is changed unless
+         * it matches the 'seq' returned by the previous call, or the last "changes" event.
+         * Returns {applied, seq}.
+         */
+        NQQ_DEFINE_EXTENSION_METHOD(EditorStub, applyEdits, args)
+        {
+            if (args.count() < 1 || args.count() > 2)
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_NUMBER);
+
+            if (!args.at(0).isArray() || (args.count() == 2 && !args.at(1).isDouble()))
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_TYPE);
+
+            QVariantList edits;
+            for (const QJsonValue &value : args.at(0).toArray()) {
+                const QJsonObject edit = value.toObject();
+                EditorNS::Editor::Cursor from, to;
+                if (!toCursor(edit.value("from"), from) || !toCursor(edit.value("to"), to))
+                    return StubReturnValue(ErrorCode::INVALID_ARGUMENT_TYPE);
+
+                QVariantMap item;
+                item["from"] = QVariantList{from.line, from.column};
+                item["to"] = QVariantList{to.line, to.column};
+                item["text"] = convertToString(edit.value("text"));
+                edits.append(item);
+            }
+
+            const qint64 expectedSeq = args.count() == 2 ? static_cast<qint64>(args.at(1).toDouble()) : -1;
+            const QVariantMap result = editor()->applyEdits(edits, expectedSeq);
+            return StubReturnValue(QJsonObject::fromVariantMap(result));
+        }
+
+        /**
+         * setChangeDeltasEnabled(enabled): while enabled, the calling extension receives "changes" events with
+         * the list of changes made to the document: {kind: "change", seq, offset, removed, text},
+         * {kind: "reset", seq} if the whole document was replaced, or {kind: "saved", seq}.
+         * They stay enabled as long as any extension enabled them and is still connected.
+         */
+        NQQ_DEFINE_EXTENSION_METHOD(EditorStub, setChangeDeltasEnabled, args)
+        {
+            if (args.count() != 1)
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_NUMBER);
+
+            if (!args.at(0).isBool())
+                return StubReturnValue(ErrorCode::INVALID_ARGUMENT_TYPE);
+
+            setChangeDeltasEnabled(runtimeSupport()->currentClient(), args.at(0).toBool());
+            return StubReturnValue();
+        }
+
+        void EditorStub::setChangeDeltasEnabled(quint64 clientId, bool enabled)
+        {
+            // Enabling or disabling twice from the same client doesn't count twice
+            if (enabled) {
+                if (m_changeDeltaClients.contains(clientId))
+                    return;
+
+                m_changeDeltaClients.insert(clientId);
+                if (m_changeDeltaClients.size() == 1 && editor() != nullptr) {
+                    connect(editor(), &EditorNS::Editor::changeDeltas, this, [this](const QVariantList &entries) {
+                        QJsonArray args;
+                        args.append(QJsonArray::fromVariantList(entries));
+                        // Only the extensions that asked for them: they can be large
+                        runtimeSupport()->emitEventTo(QVector<quint64>::fromList(m_changeDeltaClients.values()),
+                                                      this, "changes", args);
+                    });
+                    editor()->setChangeDeltasEnabled(true);
+                }
+            } else if (m_changeDeltaClients.remove(clientId) && m_changeDeltaClients.isEmpty() && editor() != nullptr) {
+                disconnect(editor(), &EditorNS::Editor::changeDeltas, this, nullptr);
+                editor()->setChangeDeltasEnabled(false);
+            }
+        }
+
     }
 }
@@ -0,0 +1,35 @@
+#include "include/Extensions/activationevents.h"
+
+#include <QJsonArray>
+
+namespace Extensions {
+
+    const QString ActivationEvents::STARTUP_EVENT = QStringLiteral("onStartup");
+
+    QString ActivationEvents::languageEvent(const QString &languageId)
+    {
+        return QStringLiteral("onLanguage:") + languageId;
+    }
+
+    QString ActivationEvents::commandEvent(const QString &commandId)
+    {
+        return QStringLiteral("onCommand:") + commandId;
+    }
+
+    ActivationEvents::ActivationEvents(const QJsonObject &manifest)
+    {
+        if (manifest.contains("activationEvents")) {
+            for (const QJsonValue &event : manifest.value("activationEvents").toArray())
+                m_events.append(event.toString());
+        } else {
+            // Extensions written before activation events existed expect to always run
+            m_events.append(STARTUP_EVENT);
+        }
+    }
+
+    bool ActivationEvents::contains(const QString &event) const
+    {
+        return m_events.contains(event) || m_events.contains("*");
+    }
+
+}
@@ -0,0 +1,141 @@
+#include "include/Extensions/eventsubscriptions.h"
+
+namespace Extensions {
+
+    const int EventSubscriptions::COALESCE_INTERVAL_MS;
+
+    EventSubscriptions::EventSubscriptions(QObject *parent) :
+        QObject(parent)
+    {
+        m_coalesceTimer.setSingleShot(true);
+        m_coalesceTimer.setInterval(COALESCE_INTERVAL_MS);
+        connect(&m_coalesceTimer, &QTimer::timeout, this, &EventSubscriptions::flush);
+    }
+
+    void EventSubscriptions::addClient(quint64 clientId)
+    {
+        m_clients.insert(clientId, Client());
+    }
+
+    void EventSubscriptions::removeClient(quint64 clientId)
+    {
+        for (const Subscription &subscription : m_clients.value(clientId).subscriptions)
+            removeSubscriber(subscription, clientId);
+
+        m_clients.remove(clientId);
+    }
+
+    void EventSubscriptions::subscribe(quint64 clientId, qint64 objectId, const QStringList &events)
+    {
+        if (!m_clients.contains(clientId))
+            return;
+
+        Client &client = m_clients[clientId];
+        client.subscribed = true;
+
+        for (const QString &event : events) {
+            const Subscription subscription(objectId, event);
+
+            if (!client.subscriptions.contains(subscription)) {
+                client.subscriptions.insert(subscription);
+                m_subscribers[subscription].append(clientId);
+            }
+        }
+    }
+
+    void EventSubscriptions::unsubscribe(quint64 clientId, qint64 objectId, const QStringList &events)
+    {
+        if (!m_clients.contains(clientId))
+            return;
+
+        Client &client = m_clients[clientId];
+        client.subscribed = true;
+
+        for (const QString &event : events) {
+            const Subscription subscription(objectId, event);
+
+            if (client.subscriptions.remove(subscription))
+                removeSubscriber(subscription, clientId);
+        }
+    }
+
+    void EventSubscriptions::removeSubscriber(const Subscription &subscription, quint64 clientId)
+    {
+        QVector<quint64> &clients = m_subscribers[subscription];
+        clients.removeOne(clientId);
+        if (clients.isEmpty())
+            m_subscribers.remove(subscription);
+    }
+
+    QVector<quint64> EventSubscriptions::subscribers(qint64 objectId, const QString &event) const
+    {
+        return subscribers(Subscription(objectId, event));
+    }
+
+    QVector<quint64> EventSubscriptions::subscribers(const Subscription &subscription) const
+    {
+        QVector<quint64> clients = m_subscribers.value(subscription);
+
+        // Clients that never subscribed to anything receive every event
+        for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) {
+            if (!it->subscribed)
+                clients.append(it.key());
+        }
+
+        return clients;
+    }
+
+    void EventSubscriptions::publish(qint64 objectId, const QString &event, const QJsonObject &message, bool coalesce)
+    {
+        const Subscription subscription(objectId, event);
+
+        if (coalesce) {
+            if (!m_pendingMessages.contains(subscription))
+                m_pendingEvents.append(subscription);
+
+            m_pendingMessages.insert(subscription, message);
+
+            if (!m_coalesceTimer.isActive())
+                m_coalesceTimer.start();
+
+            return;
+        }
+
+        // Clients receive the events in the order they were published
+        flush();
+
+        const QVector<quint64> clients = subscribers(subscription);
+        if (!clients.isEmpty())
+            emit deliver(clients, message);
+    }
+
+    void EventSubscriptions::publishTo(const QVector<quint64> &clientIds, const QJsonObject &message)
+    {
+        flush();
+
+        QVector<quint64> clients;
+        for (quint64 clientId : clientIds) {
+            if (m_clients.contains(clientId))
+                clients.append(clientId);
+        }
+
+        if (!clients.isEmpty())
+            emit deliver(clients, message);
+    }
+
+    void EventSubscriptions::flush()
+    {
+        m_coalesceTimer.stop();
+
+        const QList<Subscription> events = m_pendingEvents;
+        const QHash<Subscription, QJsonObject> messages = m_pendingMessages;
+        m_pendingEvents.clear();
+        m_pendingMessages.clear();
+
+        for (const Subscription &subscription : events) {
+            const QVector<quint64> clients = subscribers(subscription);
+            if (!clients.isEmpty())
+                emit deliver(clients, messages.value(subscription));
+        }
+    }
+}
@@ -1,22 +1,48 @@
 #include "include/Extensions/extension.h"
 
+#include "include/Extensions/manifestcache.h"
 #include "include/notepadqq.h"
+#include "include/nqqsettings.h"
 
 #include <QDebug>
-#include <QFile>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QTextStream>
+#include <QJsonArray>
 #include <QTime>
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
 
 namespace Extensions {
 
-    Extension::Extension(QString path, QString serverSocketPath) : QObject(0)
+    namespace {
+        /**
+         * @brief Runs the hosts with a lower priority, so that a busy extension doesn't
+         *        slow down the editor.
+         */
+        class HostProcess : public QProcess
+        {
+        protected:
+#ifdef Q_OS_UNIX
+            void setupChildProcess() override
+            {
+                ::setpriority(PRIO_PROCESS, 0, 10);
+
+                // A host that crashes in a loop shouldn't fill the disk with core dumps
+                struct rlimit core = { 0, 0 };
+                ::setrlimit(RLIMIT_CORE, &core);
+            }
+#endif
+        };
+    }
+
+    Extension::Extension(QString path, const QJsonObject &manifest, QString serverSocketPath) :
+        QObject(0),
+        m_path(path),
+        m_serverSocketPath(serverSocketPath)
     {
         m_extensionId = path + "-" + QTime::currentTime().msec() + "-" + QString::number(qrand());
 
-        QJsonObject manifest = getManifest(path);
-
         if (!manifest.isEmpty()) {
             m_name = manifest.value("name").toString();
 
@@ -26,28 +52,19 @@ namespace Extensions {
             }
 
             m_runtime = manifest.value("runtime").toString().toLower();
-            QString main = manifest.value("main").toString();
-
-            if (m_runtime == "nodejs") {
-
-                process = new QProcess();
-                process->setProcessChannelMode(QProcess::ForwardedChannels);
-                process->setWorkingDirectory(path);
-
-                QStringList args;
-                args << "--harmony-proxies";
-                args << main;
-                args << serverSocketPath;
-                args << m_extensionId;
-
-                QString runtimePath = Notepadqq::nodejsPath();
+            m_main = manifest.value("main").toString();
 
-                connect(process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(on_processError(QProcess::ProcessError)));
-
-                process->start(runtimePath, args);
+            m_activationEvents = ActivationEvents(manifest);
 
+            for (const QJsonValue &value : manifest.value("commands").toArray()) {
+                const QJsonObject command = value.toObject();
+                const QString id = command.value("id").toString();
+                if (!id.isEmpty())
+                    m_commands.append({ id, command.value("title").toString(id) });
             }
 
+            m_valid = true;
+
         } else {
             failedToLoadExtension(path, tr("unable to read nqq-manifest.json"));
             return;
@@ -67,36 +84,135 @@ namespace Extensions {
     Extension::~Extension()
     {
         if (process != nullptr) {
+            process->disconnect(this);
             process->deleteLater();
         }
     }
 
-    QJsonObject Extension::getManifest(const QString &extensionPath)
+    void Extension::activate(const QString &event)
     {
-        QFile fManifest(extensionPath + "/nqq-manifest.json");
-        if (fManifest.open(QFile::ReadOnly | QFile::Text)) {
-            QTextStream in(&fManifest);
-            QString content = in.readAll();
-            fManifest.close();
+        if (!m_valid || m_state != State::Inactive)
+            return;
 
-            QJsonParseError err;
-            QJsonDocument manifestDoc = QJsonDocument::fromJson(content.toUtf8(), &err);
+        m_activationEvent = event;
+        m_restartPolicy.reset();
+        startHost();
+    }
 
-            if (err.error != QJsonParseError::NoError) {
-                return QJsonObject();
-            }
+    void Extension::startHost()
+    {
+        if (m_runtime == "nodejs") {
+
+            process = new HostProcess();
+            process->setProcessChannelMode(QProcess::ForwardedChannels);
+            process->setWorkingDirectory(m_path);
 
-            return manifestDoc.object();
+            QStringList args;
+            args << "--harmony-proxies";
+
+            const int maxMemory = NqqSettings::getInstance().Extensions.getMaxHostMemoryMB();
+            if (maxMemory > 0)
+                args << QString("--max-old-space-size=%1").arg(maxMemory);
+
+            args << m_main;
+            args << m_serverSocketPath;
+            args << m_extensionId;
+            args << m_activationEvent;
+
+            QString runtimePath = Notepadqq::nodejsPath();
+
+            connect(process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(on_processError(QProcess::ProcessError)));
+            connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(on_processFinished(int,QProcess::ExitStatus)));
+
+            m_state = State::Running;
+            m_runTime.start();
+            process->start(runtimePath, args);
 
         } else {
-            return QJsonObject();
+            m_state = State::Failed;
+            failedToLoadExtension(m_name, tr("unsupported runtime: %1").arg(m_runtime));
+            emit stopped();
         }
     }
 
+    void Extension::terminate(const QString &reason)
+    {
+        if (process == nullptr)
+            return;
+
+        qWarning() << QString("%1 terminated: %2").arg(m_name).arg(reason).toStdString().c_str();
+        process->kill();
+    }
+
+    void Extension::on_processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+    {
+        process->deleteLater();
+        process = nullptr;
+
+        if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+            m_state = State::Inactive;
+            emit stopped();
+            return;
+        }
+
+        const int delay = m_restartPolicy.crashed(m_runTime.elapsed());
+
+        if (delay < 0) {
+            m_state = State::Failed;
+            failedToLoadExtension(m_name, tr("crashed %1 times in a row").arg(m_restartPolicy.consecutiveCrashes()));
+            emit stopped();
+            return;
+        }
+
+        m_state = State::Restarting;
+        m_restarts++;
+        QTimer::singleShot(delay, this, SLOT(startHost()));
+    }
+
+    bool Extension::isValid() const
+    {
+        return m_valid;
+    }
+
+    bool Extension::isActive() const
+    {
+        return m_state == State::Running || m_state == State::Restarting;
+    }
+
+    Extension::State Extension::state() const
+    {
+        return m_state;
+    }
+
+    qint64 Extension::processId() const
+    {
+        return process != nullptr ? process->processId() : 0;
+    }
+
+    int Extension::restartCount() const
+    {
+        return m_restarts;
+    }
+
+    bool Extension::activatesOn(const QString &event) const
+    {
+        return m_activationEvents.contains(event);
+    }
+
+    QJsonObject Extension::getManifest(const QString &extensionPath)
+    {
+        return ManifestCache::readManifest(extensionPath);
+    }
+
     void Extension::on_processError(QProcess::ProcessError error)
     {
         if (error == QProcess::FailedToStart) {
+            // 'finished' isn't emitted for a process that never started
+            process->deleteLater();
+            process = nullptr;
+            m_state = State::Failed;
             failedToLoadExtension(m_name, tr("failed to start. Check your runtime: %1").arg(m_runtime));
+            emit stopped();
         } else if (error == QProcess::Crashed) {
             qWarning() << QString("%1 crashed.").arg(m_name).toStdWString().c_str();
         }
@@ -118,4 +234,14 @@ namespace Extensions {
         return m_name;
     }
 
+    QString Extension::path() const
+    {
+        return m_path;
+    }
+
+    QList<Extension::Command> Extension::commands() const
+    {
+        return m_commands;
+    }
+
 }
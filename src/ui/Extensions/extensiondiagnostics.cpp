@@ -0,0 +1,120 @@
+#include "include/Extensions/extensiondiagnostics.h"
+
+#include "include/Extensions/extensionsloader.h"
+
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+namespace Extensions {
+
+    namespace {
+        const int REFRESH_INTERVAL_MS = 1000;
+
+        QString stateName(Extension::State state)
+        {
+            switch (state) {
+            case Extension::State::Inactive:    return ExtensionDiagnostics::tr("Inactive");
+            case Extension::State::Running:     return ExtensionDiagnostics::tr("Running");
+            case Extension::State::Restarting:  return ExtensionDiagnostics::tr("Restarting");
+            case Extension::State::Failed:      return ExtensionDiagnostics::tr("Failed");
+            }
+            return QString();
+        }
+    }
+
+    ExtensionDiagnostics::ExtensionDiagnostics(QWidget *parent) :
+        QDialog(parent),
+        m_table(new QTableWidget(this))
+    {
+        setWindowTitle(tr("Extension Diagnostics"));
+        resize(900, 300);
+
+        m_table->setColumnCount(ColumnCount);
+        m_table->setHorizontalHeaderLabels({
+            tr("Extension"), tr("State"), tr("PID"), tr("CPU %"), tr("Memory (MB)"), tr("Restarts"),
+            tr("Requests"), tr("Requests/s"), tr("Avg latency (ms)"), tr("Max latency (ms)")
+        });
+        m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+        m_table->verticalHeader()->hide();
+        m_table->horizontalHeader()->setSectionResizeMode(ColumnName, QHeaderView::Stretch);
+
+        QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+        connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+        QVBoxLayout *layout = new QVBoxLayout(this);
+        layout->addWidget(m_table);
+        layout->addWidget(buttons);
+
+        connect(&m_refreshTimer, &QTimer::timeout, this, &ExtensionDiagnostics::refresh);
+        m_refreshTimer.start(REFRESH_INTERVAL_MS);
+        refresh();
+    }
+
+    void ExtensionDiagnostics::refresh()
+    {
+        QSharedPointer<ExtensionHostSupervisor> supervisor = ExtensionsLoader::hostSupervisor();
+        QSharedPointer<ExtensionsServer> server = ExtensionsLoader::extensionsServer();
+
+        QVector<QStringList> rows;
+        QHash<QString, int> rowOfExtension;
+
+        if (!supervisor.isNull()) {
+            for (const ExtensionHostSupervisor::HostStats &host : supervisor->stats()) {
+                QStringList row;
+                for (int i = 0; i < ColumnCount; i++)
+                    row.append(QString());
+
+                row[ColumnName] = host.name;
+                row[ColumnState] = stateName(host.state);
+                row[ColumnProcessId] = host.processId > 0 ? QString::number(host.processId) : QString();
+                row[ColumnCpu] = host.cpuPercent >= 0 ? QString::number(host.cpuPercent, 'f', 1) : QString();
+                row[ColumnMemory] = host.memoryKB >= 0 ? QString::number(host.memoryKB / 1024.0, 'f', 1) : QString();
+                row[ColumnRestarts] = QString::number(host.restarts);
+
+                rowOfExtension.insert(host.extensionId, rows.size());
+                rows.append(row);
+            }
+        }
+
+        if (!server.isNull()) {
+            for (const ExtensionsConnections::ClientMetrics &metrics : server->metrics()) {
+                const QString extensionId = server->extensionId(metrics.clientId);
+
+                int index = rowOfExtension.value(extensionId, -1);
+                if (extensionId.isEmpty() || index == -1) {
+                    // The connection didn't say which extension it belongs to
+                    QStringList row;
+                    for (int i = 0; i < ColumnCount; i++)
+                        row.append(QString());
+                    row[ColumnName] = tr("Connection %1").arg(metrics.clientId);
+                    index = rows.size();
+                    rows.append(row);
+                }
+
+                QStringList &row = rows[index];
+                row[ColumnRequests] = QString::number(metrics.requests);
+                row[ColumnRequestsPerSecond] = QString::number(metrics.requestsPerSecond, 'f', 1);
+                row[ColumnAverageLatency] = QString::number(metrics.averageLatencyMs, 'f', 2);
+                row[ColumnMaxLatency] = QString::number(metrics.maxLatencyMs);
+            }
+        }
+
+        m_table->setRowCount(rows.size());
+        for (int r = 0; r < rows.size(); r++) {
+            for (int c = 0; c < ColumnCount; c++) {
+                QTableWidgetItem *item = m_table->item(r, c);
+                if (item == nullptr) {
+                    item = new QTableWidgetItem();
+                    if (c != ColumnName && c != ColumnState)
+                        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                    m_table->setItem(r, c, item);
+                }
+                item->setText(rows[r][c]);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,206 @@
+#include "include/Extensions/extensionhostsupervisor.h"
+
+#include "include/nqqsettings.h"
+
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace Extensions {
+
+    ExtensionHostSupervisor::ExtensionHostSupervisor(QObject *parent) : QObject(parent)
+    {
+        m_sampleTimer.setInterval(SAMPLE_INTERVAL_MS);
+        connect(&m_sampleTimer, &QTimer::timeout, this, &ExtensionHostSupervisor::sample);
+        m_clock.start();
+    }
+
+    void ExtensionHostSupervisor::start(QSharedPointer<Extension> extension, const QString &event)
+    {
+        if (extension.isNull() || extension->isActive())
+            return;
+
+        for (const PendingActivation &pending : m_pending) {
+            if (pending.extension == extension)
+                return;
+        }
+
+        const int maxHosts = NqqSettings::getInstance().Extensions.getMaxHostProcesses();
+        if (maxHosts > 0 && activeHosts() >= maxHosts) {
+            m_pending.append({ extension.toWeakRef(), event });
+            return;
+        }
+
+        if (!m_hosts.contains(extension->id())) {
+            m_hosts.insert(extension->id(), extension.toWeakRef());
+            connect(extension.data(), &Extension::stopped, this, &ExtensionHostSupervisor::on_extensionStopped);
+        }
+
+        extension->activate(event);
+
+        if (!m_sampleTimer.isActive())
+            m_sampleTimer.start();
+    }
+
+    int ExtensionHostSupervisor::activeHosts() const
+    {
+        int count = 0;
+        for (const QWeakPointer<Extension> &host : m_hosts) {
+            const QSharedPointer<Extension> extension = host.toStrongRef();
+            if (!extension.isNull() && extension->isActive())
+                count++;
+        }
+        return count;
+    }
+
+    void ExtensionHostSupervisor::on_extensionStopped()
+    {
+        Extension *extension = qobject_cast<Extension *>(sender());
+        if (extension != nullptr)
+            m_usage.remove(extension->id());
+
+        startPending();
+    }
+
+    void ExtensionHostSupervisor::startPending()
+    {
+        const int maxHosts = NqqSettings::getInstance().Extensions.getMaxHostProcesses();
+
+        while (!m_pending.isEmpty() && (maxHosts <= 0 || activeHosts() < maxHosts)) {
+            const PendingActivation pending = m_pending.takeFirst();
+            start(pending.extension.toStrongRef(), pending.event);
+        }
+    }
+
+    void ExtensionHostSupervisor::sample()
+    {
+        const NqqSettings &settings = NqqSettings::getInstance();
+        const qint64 maxMemoryKB = qint64(settings.Extensions.getMaxHostMemoryMB()) * 1024;
+        const int maxCpuPercent = settings.Extensions.getMaxHostCpuPercent();
+        const qint64 now = m_clock.elapsed();
+
+#ifdef Q_OS_LINUX
+        const double ticksPerSecond = ::sysconf(_SC_CLK_TCK);
+#else
+        const double ticksPerSecond = 100;
+#endif
+
+        bool anyRunning = false;
+
+        for (auto it = m_hosts.cbegin(); it != m_hosts.cend(); ++it) {
+            const QSharedPointer<Extension> extension = it.value().toStrongRef();
+            if (extension.isNull() || extension->state() != Extension::State::Running)
+                continue;
+
+            anyRunning = true;
+
+            const qint64 processId = extension->processId();
+            qint64 cpuTicks = 0;
+            qint64 memoryKB = 0;
+            if (processId <= 0 || !readUsage(processId, cpuTicks, memoryKB))
+                continue;
+
+            Usage &usage = m_usage[it.key()];
+            if (usage.processId != processId) {
+                // Restarted since the last sample
+                usage = Usage();
+                usage.processId = processId;
+            } else if (now > usage.sampledAt) {
+                usage.cpuPercent = (cpuTicks - usage.cpuTicks) / ticksPerSecond
+                        / ((now - usage.sampledAt) / 1000.0) * 100;
+            }
+
+            usage.cpuTicks = cpuTicks;
+            usage.sampledAt = now;
+            usage.memoryKB = memoryKB;
+
+            if (maxMemoryKB > 0 && memoryKB > maxMemoryKB) {
+                extension->terminate(tr("using %1 MB of memory").arg(memoryKB / 1024));
+                continue;
+            }
+
+            if (maxCpuPercent > 0 && usage.cpuPercent > maxCpuPercent)
+                usage.busySamples++;
+            else
+                usage.busySamples = 0;
+
+            if (usage.busySamples >= MAX_BUSY_SAMPLES) {
+                extension->terminate(tr("using %1% of the CPU for %2 seconds")
+                                     .arg(qRound(usage.cpuPercent))
+                                     .arg(MAX_BUSY_SAMPLES * SAMPLE_INTERVAL_MS / 1000));
+            }
+        }
+
+        if (!anyRunning && m_pending.isEmpty())
+            m_sampleTimer.stop();
+    }
+
+    QVector<ExtensionHostSupervisor::HostStats> ExtensionHostSupervisor::stats() const
+    {
+        QVector<HostStats> stats;
+
+        for (auto it = m_hosts.cbegin(); it != m_hosts.cend(); ++it) {
+            const QSharedPointer<Extension> extension = it.value().toStrongRef();
+            if (extension.isNull())
+                continue;
+
+            HostStats host;
+            host.extensionId = extension->id();
+            host.name = extension->name();
+            host.state = extension->state();
+            host.processId = extension->processId();
+            host.restarts = extension->restartCount();
+
+            const Usage usage = m_usage.value(it.key());
+            if (host.state == Extension::State::Running && usage.processId == host.processId) {
+                host.cpuPercent = usage.cpuPercent;
+                host.memoryKB = usage.memoryKB;
+            }
+
+            stats.append(host);
+        }
+
+        return stats;
+    }
+
+    bool ExtensionHostSupervisor::readUsage(qint64 processId, qint64 &cpuTicks, qint64 &memoryKB)
+    {
+#ifdef Q_OS_LINUX
+        QFile stat(QString("/proc/%1/stat").arg(processId));
+        if (!stat.open(QFile::ReadOnly))
+            return false;
+
+        // The command name is in parentheses and may contain spaces: the other fields
+        // start after the last ')'. utime and stime are the 14th and 15th fields.
+        const QByteArray line = stat.readAll();
+        const int nameEnd = line.lastIndexOf(')');
+        if (nameEnd == -1)
+            return false;
+
+        const QList<QByteArray> fields = line.mid(nameEnd + 2).split(' ');
+        if (fields.size() < 13)
+            return false;
+
+        cpuTicks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+
+        QFile statm(QString("/proc/%1/statm").arg(processId));
+        if (!statm.open(QFile::ReadOnly))
+            return false;
+
+        const QList<QByteArray> pages = statm.readAll().split(' ');
+        if (pages.size() < 2)
+            return false;
+
+        memoryKB = pages.at(1).toLongLong() * ::sysconf(_SC_PAGESIZE) / 1024;
+        return true;
+#else
+        Q_UNUSED(processId)
+        Q_UNUSED(cpuTicks)
+        Q_UNUSED(memoryKB)
+        return false;
+#endif
+    }
+
+}
@@ -0,0 +1,314 @@
+#include "include/Extensions/extensioninstaller.h"
+
+#include "include/Extensions/extensionpackage.h"
+#include "include/Sessions/persistentcache.h"
+#include "include/notepadqq.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QPointer>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QTimer>
+
+namespace Extensions {
+
+    namespace {
+        // Marks a cache entry whose unpacking finished
+        const QString COMPLETE_MARKER = QStringLiteral(".complete");
+        const QString TMP_NODE_MODULES = QStringLiteral("___tmp_node_modules");
+
+        class Task : public QRunnable
+        {
+        public:
+            Task(std::function<void()> work) : m_work(std::move(work)) {}
+            void run() override { m_work(); }
+        private:
+            std::function<void()> m_work;
+        };
+    }
+
+    ExtensionInstaller::ExtensionInstaller(const QString &packagePath, const QString &extensionPath, QObject *parent) :
+        QObject(parent),
+        m_packagePath(packagePath),
+        m_extensionPath(QDir::cleanPath(extensionPath)),
+        m_backupPath(m_extensionPath + "%%BACKUP")
+    {
+        m_pool.setMaxThreadCount(1);
+    }
+
+    ExtensionInstaller::~ExtensionInstaller()
+    {
+        m_pool.waitForDone();
+    }
+
+    void ExtensionInstaller::start()
+    {
+        if (m_running)
+            return;
+
+        m_running = true;
+        emit statusChanged(tr("Unpacking..."));
+        emit progress(0, 0);
+        runInBackground([this]() { return unpack(); }, &ExtensionInstaller::npmInstall);
+    }
+
+    bool ExtensionInstaller::isRunning() const
+    {
+        return m_running;
+    }
+
+    void ExtensionInstaller::runInBackground(const std::function<bool()> &work, Step next)
+    {
+        m_pool.start(new Task([this, work, next]() {
+            const bool success = work();
+
+            // Back to the thread of the installer
+            QTimer::singleShot(0, this, [this, success, next]() {
+                if (success)
+                    (this->*next)();
+                else
+                    fail(m_error);
+            });
+        }));
+    }
+
+    void ExtensionInstaller::runNpm(const QStringList &args, Step next)
+    {
+        QProcess *process = new QProcess(this);
+        process->setWorkingDirectory(m_extensionPath);
+
+        connect(process, &QProcess::readyReadStandardOutput, this, [=]() {
+            emit output(QString::fromLocal8Bit(process->readAllStandardOutput()));
+        });
+        connect(process, &QProcess::readyReadStandardError, this, [=]() {
+            emit output(QString::fromLocal8Bit(process->readAllStandardError()));
+        });
+
+        connect(process, static_cast<void (QProcess::*)(QProcess::ProcessError)>(&QProcess::error), this, [=](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                process->deleteLater();
+                fail(tr("Unable to run npm: %1").arg(process->errorString()));
+            }
+        });
+
+        connect(process, static_cast<void (QProcess::*)(int,QProcess::ExitStatus)>(&QProcess::finished), this, [=](int exitCode, QProcess::ExitStatus exitStatus) {
+            process->deleteLater();
+
+            if (exitStatus == QProcess::NormalExit && exitCode == 0)
+                (this->*next)();
+            else
+                fail(tr("npm %1 failed: exit code %2").arg(args.first()).arg(exitCode));
+        });
+
+        emit output(QString("> npm %1\n").arg(args.join(' ')));
+        process->start(Notepadqq::npmPath(), args);
+    }
+
+    bool ExtensionInstaller::unpack()
+    {
+        QFile package(m_packagePath);
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        if (!package.open(QFile::ReadOnly) || !hash.addData(&package)) {
+            m_error = tr("Unable to read %1").arg(m_packagePath);
+            return false;
+        }
+        package.close();
+
+        const QString uniqueName = QFileInfo(m_extensionPath).fileName();
+        const QDir cacheRoot(PersistentCache::extensionPackageCacheDirPath());
+        const QString cacheName = uniqueName + "-" + QString::fromLatin1(hash.result().toHex());
+        const QString cachePath = cacheRoot.absoluteFilePath(cacheName);
+
+        if (QFileInfo(cachePath + "/" + COMPLETE_MARKER).exists()) {
+            emit output(tr("Using the cached package %1\n").arg(cachePath));
+        } else {
+            ExtensionPackage extensionPackage(m_packagePath);
+            if (!extensionPackage.open()) {
+                m_error = extensionPackage.errorString();
+                return false;
+            }
+
+            // Unpacked next to the cache entry, and renamed when complete
+            const QString tmpPath = cachePath + ".tmp";
+            QDir(tmpPath).removeRecursively();
+            QDir(cachePath).removeRecursively();
+
+            emit statusChanged(tr("Unpacking..."));
+            const bool extracted = extensionPackage.extractAll(tmpPath, [this](int done, int total) {
+                emit progress(done, total);
+            });
+
+            QFile marker(tmpPath + "/" + COMPLETE_MARKER);
+            if (!extracted || !marker.open(QFile::WriteOnly) || !QDir().rename(tmpPath, cachePath)) {
+                m_error = extracted ? tr("Unable to write the package cache") : extensionPackage.errorString();
+                QDir(tmpPath).removeRecursively();
+                return false;
+            }
+            marker.close();
+
+            // Other versions of the extension won't be needed anymore. A wildcard would also match other
+            // extensions whose name starts with this one's, like "com.foo-bar" for "com.foo".
+            const QRegularExpression otherVersion("^" + QRegularExpression::escape(uniqueName) + "-[0-9a-f]{40}$");
+            const QStringList cached = cacheRoot.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+            for (const QString &name : cached) {
+                if (name != cacheName && otherVersion.match(name).hasMatch())
+                    QDir(cacheRoot.absoluteFilePath(name)).removeRecursively();
+            }
+        }
+
+        emit statusChanged(tr("Copying files..."));
+        emit progress(0, 0);
+
+        QDir(m_backupPath).removeRecursively();
+        if (QFileInfo(m_extensionPath).exists()) {
+            if (!QDir().rename(m_extensionPath, m_backupPath)) {
+                m_error = tr("Unable to move the installed version to %1").arg(m_backupPath);
+                return false;
+            }
+            m_backedUp = true;
+        }
+        m_replacing = true;
+
+        if (!copyRecursively(cachePath, m_extensionPath)) {
+            m_error = tr("Unable to copy the package to %1").arg(m_extensionPath);
+            return false;
+        }
+        QFile::remove(m_extensionPath + "/" + COMPLETE_MARKER);
+
+        // The package contains the manifest and the npm tarball
+        const QStringList files = QDir(m_extensionPath).entryList(QDir::Files | QDir::Hidden);
+        if (files.size() != 2 || !files.contains(ExtensionPackage::MANIFEST_FILENAME)) {
+            m_error = tr("Unexpected files found in %1").arg(m_extensionPath);
+            return false;
+        }
+
+        for (const QString &file : files) {
+            if (file != ExtensionPackage::MANIFEST_FILENAME)
+                m_tarball = QDir(m_extensionPath).absoluteFilePath(file);
+        }
+
+        return QDir(m_extensionPath).mkpath("node_modules");
+    }
+
+    void ExtensionInstaller::npmInstall()
+    {
+        emit statusChanged(tr("Installing..."));
+        emit progress(0, 0);
+        runNpm({ "install", "--production", "--no-registry", m_tarball }, &ExtensionInstaller::flattenModule);
+    }
+
+    void ExtensionInstaller::flattenModule()
+    {
+        // npm installed the extension into node_modules/<name>: take it out of there
+        runInBackground([this]() {
+            const QDir root(m_extensionPath);
+            const QString tmpModules = root.absoluteFilePath(TMP_NODE_MODULES);
+
+            if (!root.rename("node_modules", TMP_NODE_MODULES)) {
+                m_error = tr("Unable to rename %1").arg(root.absoluteFilePath("node_modules"));
+                return false;
+            }
+
+            const QStringList modules = QDir(tmpModules).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+            if (modules.size() != 1) {
+                m_error = tr("Unexpected files found in %1").arg(tmpModules);
+                return false;
+            }
+
+            const QDir module(QDir(tmpModules).absoluteFilePath(modules.first()));
+            const QStringList entries = module.entryList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot);
+            for (const QString &entry : entries) {
+                QDir(root.absoluteFilePath(entry)).removeRecursively();
+                QFile::remove(root.absoluteFilePath(entry));
+
+                if (!QDir().rename(module.absoluteFilePath(entry), root.absoluteFilePath(entry))) {
+                    m_error = tr("Unable to move %1").arg(module.absoluteFilePath(entry));
+                    return false;
+                }
+            }
+
+            QDir(tmpModules).removeRecursively();
+            QFile::remove(m_tarball);
+            return true;
+        }, &ExtensionInstaller::npmRebuild);
+    }
+
+    void ExtensionInstaller::npmRebuild()
+    {
+        runNpm({ "rebuild" }, &ExtensionInstaller::removeBackup);
+    }
+
+    void ExtensionInstaller::removeBackup()
+    {
+        runInBackground([this]() {
+            QDir(m_backupPath).removeRecursively();
+            return true;
+        }, &ExtensionInstaller::succeed);
+    }
+
+    void ExtensionInstaller::succeed()
+    {
+        m_running = false;
+        emit progress(1, 1);
+        emit output(tr("Installed to %1\n").arg(m_extensionPath));
+        emit finished(true, QString());
+    }
+
+    void ExtensionInstaller::fail(const QString &message)
+    {
+        emit statusChanged(tr("Restoring..."));
+        emit output(tr("Failed: %1\n").arg(message));
+
+        m_pool.start(new Task([this, message]() {
+            if (!restoreBackup())
+                emit output(tr("Unable to restore %1\n").arg(m_backupPath));
+
+            QTimer::singleShot(0, this, [this, message]() {
+                m_running = false;
+                emit finished(false, message);
+            });
+        }));
+    }
+
+    bool ExtensionInstaller::restoreBackup()
+    {
+        if (!m_replacing)
+            return true;
+
+        QDir(m_extensionPath).removeRecursively();
+        m_replacing = false;
+
+        if (m_backedUp && !QDir().rename(m_backupPath, m_extensionPath))
+            return false;
+
+        m_backedUp = false;
+        return true;
+    }
+
+    bool ExtensionInstaller::copyRecursively(const QString &source, const QString &destination)
+    {
+        const QDir sourceDir(source);
+        if (!QDir().mkpath(destination))
+            return false;
+
+        QDirIterator it(source, QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            const QString target = destination + "/" + sourceDir.relativeFilePath(path);
+
+            if (it.fileInfo().isDir()) {
+                if (!QDir().mkpath(target))
+                    return false;
+            } else if (!QFile::copy(path, target)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,593 @@
+#include "include/Extensions/extensionpackage.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <limits>
+
+namespace Extensions {
+
+    namespace {
+        const quint32 LOCAL_HEADER_SIGNATURE = 0x04034b50;
+        const quint32 CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+        const quint32 END_OF_DIRECTORY_SIGNATURE = 0x06054b50;
+        const int LOCAL_HEADER_SIZE = 30;
+        const int CENTRAL_HEADER_SIZE = 46;
+        const int END_OF_DIRECTORY_SIZE = 22;
+        const int MAX_COMMENT_SIZE = 0xFFFF;
+
+        const quint16 METHOD_STORED = 0;
+        const quint16 METHOD_DEFLATED = 8;
+        const quint16 FLAG_ENCRYPTED = 0x1;
+
+        inline quint16 read16(const char *data) { return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data)); }
+        inline quint32 read32(const char *data) { return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data)); }
+
+        /**
+         * @brief Canonical Huffman decoder, after zlib's "puff" reference inflater.
+         */
+        class Inflater
+        {
+        public:
+            Inflater(const QByteArray &input, int maxSize) :
+                m_in(reinterpret_cast<const uchar *>(input.constData())),
+                m_inSize(input.size()),
+                m_maxSize(maxSize),
+                m_out("")   // Not null, even if the stream is empty
+            {
+                // Don't trust the declared size further than the input could possibly expand
+                if (maxSize > 0)
+                    m_out.reserve(static_cast<int>(qMin<qint64>(maxSize, qint64(input.size()) * MAX_RATIO)));
+            }
+
+            QByteArray run()
+            {
+                int last;
+                do {
+                    last = bits(1);
+                    const int type = bits(2);
+
+                    if (m_error)
+                        break;
+                    else if (type == 0)
+                        stored();
+                    else if (type == 1)
+                        fixed();
+                    else if (type == 2)
+                        dynamic();
+                    else
+                        m_error = true;
+                } while (!last && !m_error);
+
+                return m_error ? QByteArray() : m_out;
+            }
+
+        private:
+            static const int MAX_BITS = 15;
+            static const int MAX_LENGTH_CODES = 286;
+            static const int MAX_DISTANCE_CODES = 30;
+            static const int FIXED_LENGTH_CODES = 288;
+            static const int MAX_RATIO = 1032;  // Best possible compression ratio of deflate
+
+            struct Huffman {
+                quint16 count[MAX_BITS + 1];    // Number of symbols of each length
+                quint16 symbol[FIXED_LENGTH_CODES];     // Symbols ordered by code
+            };
+
+            const uchar *m_in;
+            int m_inSize;
+            int m_inPos = 0;
+            quint32 m_bitBuffer = 0;
+            int m_bitCount = 0;
+            const int m_maxSize;        // -1 means unlimited
+            bool m_error = false;
+            QByteArray m_out;
+
+            /**
+             * @brief Fails as soon as the output would grow past m_maxSize, instead of
+             *        decompressing all of a stream that expands far more than declared.
+             */
+            bool canWrite(int length)
+            {
+                if (m_maxSize >= 0 && length > m_maxSize - m_out.size())
+                    m_error = true;
+                return !m_error;
+            }
+
+            int bits(int need)
+            {
+                quint32 value = m_bitBuffer;
+                while (m_bitCount < need) {
+                    if (m_inPos == m_inSize) {
+                        m_error = true;
+                        return 0;
+                    }
+                    value |= quint32(m_in[m_inPos++]) << m_bitCount;
+                    m_bitCount += 8;
+                }
+
+                m_bitBuffer = value >> need;
+                m_bitCount -= need;
+                return value & ((1u << need) - 1);
+            }
+
+            void stored()
+            {
+                // Stored blocks start at a byte boundary
+                m_bitBuffer = 0;
+                m_bitCount = 0;
+
+                if (m_inPos + 4 > m_inSize) {
+                    m_error = true;
+                    return;
+                }
+
+                const int length = m_in[m_inPos] | (m_in[m_inPos + 1] << 8);
+                const int complement = m_in[m_inPos + 2] | (m_in[m_inPos + 3] << 8);
+                m_inPos += 4;
+
+                if (length != (~complement & 0xFFFF) || m_inPos + length > m_inSize) {
+                    m_error = true;
+                    return;
+                }
+
+                if (!canWrite(length))
+                    return;
+
+                m_out.append(reinterpret_cast<const char *>(m_in + m_inPos), length);
+                m_inPos += length;
+            }
+
+            /**
+             * @return 0 for a complete code, a positive number for an incomplete one,
+             *         and a negative one for an over-subscribed one.
+             */
+            static int construct(Huffman &h, const quint16 *lengths, int n)
+            {
+                for (int len = 0; len <= MAX_BITS; len++)
+                    h.count[len] = 0;
+                for (int symbol = 0; symbol < n; symbol++)
+                    h.count[lengths[symbol]]++;
+
+                if (h.count[0] == n)
+                    return 0;
+
+                int left = 1;
+                for (int len = 1; len <= MAX_BITS; len++) {
+                    left <<= 1;
+                    left -= h.count[len];
+                    if (left < 0)
+                        return left;
+                }
+
+                quint16 offsets[MAX_BITS + 1];
+                offsets[1] = 0;
+                for (int len = 1; len < MAX_BITS; len++)
+                    offsets[len + 1] = offsets[len] + h.count[len];
+
+                for (int symbol = 0; symbol < n; symbol++) {
+                    if (lengths[symbol] != 0)
+                        h.symbol[offsets[lengths[symbol]]++] = symbol;
+                }
+
+                return left;
+            }
+
+            int decode(const Huffman &h)
+            {
+                int code = 0;
+                int first = 0;
+                int index = 0;
+
+                for (int len = 1; len <= MAX_BITS; len++) {
+                    code |= bits(1);
+                    if (m_error)
+                        return -1;
+
+                    const int count = h.count[len];
+                    if (code - count < first)
+                        return h.symbol[index + (code - first)];
+
+                    index += count;
+                    first += count;
+                    first <<= 1;
+                    code <<= 1;
+                }
+
+                m_error = true;
+                return -1;
+            }
+
+            void codes(const Huffman &lengthCode, const Huffman &distanceCode)
+            {
+                static const quint16 lengthBase[29] = {
+                    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+                static const quint16 lengthExtra[29] = {
+                    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+                static const quint16 distanceBase[30] = {
+                    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                    8193, 12289, 16385, 24577 };
+                static const quint16 distanceExtra[30] = {
+                    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+                for (;;) {
+                    int symbol = decode(lengthCode);
+                    if (m_error)
+                        return;
+
+                    if (symbol < 256) {
+                        if (!canWrite(1))
+                            return;
+                        m_out.append(char(symbol));
+                    } else if (symbol == 256) {
+                        return;
+                    } else {
+                        symbol -= 257;
+                        if (symbol >= 29) {
+                            m_error = true;
+                            return;
+                        }
+                        const int length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+
+                        symbol = decode(distanceCode);
+                        if (m_error || symbol >= 30) {
+                            m_error = true;
+                            return;
+                        }
+                        const int distance = distanceBase[symbol] + bits(distanceExtra[symbol]);
+                        if (m_error || distance > m_out.size()) {
+                            m_error = true;
+                            return;
+                        }
+
+                        if (!canWrite(length))
+                            return;
+
+                        // The source and the copy may overlap, so copy one byte at a time
+                        int from = m_out.size() - distance;
+                        m_out.reserve(m_out.size() + length);
+                        for (int i = 0; i < length; i++)
+                            m_out.append(m_out.at(from++));
+                    }
+                }
+            }
+
+            void fixed()
+            {
+                struct FixedCodes {
+                    Huffman lengthCode;
+                    Huffman distanceCode;
+
+                    FixedCodes()
+                    {
+                        quint16 lengths[FIXED_LENGTH_CODES];
+                        int symbol = 0;
+                        for (; symbol < 144; symbol++) lengths[symbol] = 8;
+                        for (; symbol < 256; symbol++) lengths[symbol] = 9;
+                        for (; symbol < 280; symbol++) lengths[symbol] = 7;
+                        for (; symbol < FIXED_LENGTH_CODES; symbol++) lengths[symbol] = 8;
+                        construct(lengthCode, lengths, FIXED_LENGTH_CODES);
+
+                        for (symbol = 0; symbol < MAX_DISTANCE_CODES; symbol++) lengths[symbol] = 5;
+                        construct(distanceCode, lengths, MAX_DISTANCE_CODES);
+                    }
+                };
+
+                // Initialized once, in a thread-safe way
+                static const FixedCodes fixedCodes;
+                codes(fixedCodes.lengthCode, fixedCodes.distanceCode);
+            }
+
+            void dynamic()
+            {
+                static const quint8 order[19] = {
+                    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+                const int lengthCount = bits(5) + 257;
+                const int distanceCount = bits(5) + 1;
+                const int codeCount = bits(4) + 4;
+                if (m_error || lengthCount > MAX_LENGTH_CODES || distanceCount > MAX_DISTANCE_CODES) {
+                    m_error = true;
+                    return;
+                }
+
+                quint16 lengths[MAX_LENGTH_CODES + MAX_DISTANCE_CODES];
+                int index = 0;
+                for (; index < codeCount; index++)
+                    lengths[order[index]] = bits(3);
+                for (; index < 19; index++)
+                    lengths[order[index]] = 0;
+
+                Huffman lengthCode;
+                Huffman distanceCode;
+                if (m_error || construct(lengthCode, lengths, 19) != 0) {
+                    m_error = true;
+                    return;
+                }
+
+                index = 0;
+                while (index < lengthCount + distanceCount) {
+                    int symbol = decode(lengthCode);
+                    if (m_error)
+                        return;
+
+                    if (symbol < 16) {
+                        lengths[index++] = symbol;
+                        continue;
+                    }
+
+                    int length = 0;
+                    if (symbol == 16) {
+                        if (index == 0) {
+                            m_error = true;
+                            return;
+                        }
+                        length = lengths[index - 1];
+                        symbol = 3 + bits(2);
+                    } else if (symbol == 17) {
+                        symbol = 3 + bits(3);
+                    } else {
+                        symbol = 11 + bits(7);
+                    }
+
+                    if (m_error || index + symbol > lengthCount + distanceCount) {
+                        m_error = true;
+                        return;
+                    }
+                    while (symbol--)
+                        lengths[index++] = length;
+                }
+
+                // Without an end-of-block code the block can't end
+                if (lengths[256] == 0) {
+                    m_error = true;
+                    return;
+                }
+
+                int left = construct(lengthCode, lengths, lengthCount);
+                if (left < 0 || (left > 0 && lengthCount - lengthCode.count[0] != 1)) {
+                    m_error = true;
+                    return;
+                }
+
+                left = construct(distanceCode, lengths + lengthCount, distanceCount);
+                if (left < 0 || (left > 0 && distanceCount - distanceCode.count[0] != 1)) {
+                    m_error = true;
+                    return;
+                }
+
+                codes(lengthCode, distanceCode);
+            }
+        };
+    }
+
+    const QString ExtensionPackage::MANIFEST_FILENAME = QStringLiteral("nqq-manifest.json");
+
+    ExtensionPackage::ExtensionPackage(const QString &path) :
+        m_file(path)
+    {
+
+    }
+
+    bool ExtensionPackage::open()
+    {
+        if (!m_file.open(QFile::ReadOnly)) {
+            m_error = m_file.errorString();
+            return false;
+        }
+
+        // The end of central directory record is at the end, followed by an optional comment
+        const qint64 tailSize = qMin<qint64>(m_file.size(), END_OF_DIRECTORY_SIZE + MAX_COMMENT_SIZE);
+        m_file.seek(m_file.size() - tailSize);
+        const QByteArray tail = m_file.read(tailSize);
+
+        int eocd = tail.size() - END_OF_DIRECTORY_SIZE;
+        while (eocd >= 0 && read32(tail.constData() + eocd) != END_OF_DIRECTORY_SIGNATURE)
+            eocd--;
+
+        if (eocd < 0) {
+            m_error = QStringLiteral("Not a zip archive");
+            return false;
+        }
+
+        const quint16 entryCount = read16(tail.constData() + eocd + 10);
+        const quint32 directorySize = read32(tail.constData() + eocd + 12);
+        const quint32 directoryOffset = read32(tail.constData() + eocd + 16);
+
+        if (directoryOffset == 0xFFFFFFFF || qint64(directoryOffset) + directorySize > m_file.size()) {
+            m_error = QStringLiteral("Unsupported or damaged zip archive");
+            return false;
+        }
+
+        m_file.seek(directoryOffset);
+        const QByteArray directory = m_file.read(directorySize);
+
+        int pos = 0;
+        for (int i = 0; i < entryCount; i++) {
+            if (pos + CENTRAL_HEADER_SIZE > directory.size() ||
+                    read32(directory.constData() + pos) != CENTRAL_HEADER_SIGNATURE) {
+                m_error = QStringLiteral("Damaged zip directory");
+                return false;
+            }
+
+            const char *header = directory.constData() + pos;
+            Entry entry;
+            entry.flags = read16(header + 8);
+            entry.method = read16(header + 10);
+            entry.crc = read32(header + 16);
+            entry.compressedSize = read32(header + 20);
+            entry.size = read32(header + 24);
+            const quint16 nameLength = read16(header + 28);
+            const quint16 extraLength = read16(header + 30);
+            const quint16 commentLength = read16(header + 32);
+            entry.localHeaderOffset = read32(header + 42);
+
+            if (pos + CENTRAL_HEADER_SIZE + nameLength > directory.size()) {
+                m_error = QStringLiteral("Damaged zip directory");
+                return false;
+            }
+
+            const QString name = QString::fromUtf8(header + CENTRAL_HEADER_SIZE, nameLength);
+            m_entryNames.append(name);
+            m_entries.insert(name, entry);
+
+            pos += CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+        }
+
+        return true;
+    }
+
+    QString ExtensionPackage::errorString() const
+    {
+        return m_error;
+    }
+
+    QStringList ExtensionPackage::entries() const
+    {
+        return m_entryNames;
+    }
+
+    QByteArray ExtensionPackage::read(const QString &entryName)
+    {
+        const auto it = m_entries.constFind(entryName);
+        if (it == m_entries.constEnd()) {
+            m_error = QString("%1 not found in the package").arg(entryName);
+            return QByteArray();
+        }
+
+        const Entry &entry = it.value();
+        if (entry.flags & FLAG_ENCRYPTED) {
+            m_error = QString("%1 is encrypted").arg(entryName);
+            return QByteArray();
+        }
+
+        // Name and extra field lengths can differ from the central directory
+        m_file.seek(entry.localHeaderOffset);
+        const QByteArray header = m_file.read(LOCAL_HEADER_SIZE);
+        if (header.size() != LOCAL_HEADER_SIZE || read32(header.constData()) != LOCAL_HEADER_SIGNATURE) {
+            m_error = QString("Damaged entry: %1").arg(entryName);
+            return QByteArray();
+        }
+
+        m_file.seek(entry.localHeaderOffset + LOCAL_HEADER_SIZE +
+                    read16(header.constData() + 26) + read16(header.constData() + 28));
+        const QByteArray compressed = m_file.read(entry.compressedSize);
+
+        QByteArray data;
+        if (entry.method == METHOD_STORED) {
+            data = compressed.isNull() ? QByteArray("") : compressed;
+        } else if (entry.method == METHOD_DEFLATED) {
+            if (entry.size > quint32(std::numeric_limits<int>::max())) {
+                m_error = QString("%1 is too large").arg(entryName);
+                return QByteArray();
+            }
+            data = inflate(compressed, static_cast<int>(entry.size));
+        } else {
+            m_error = QString("Unsupported compression method %1: %2").arg(entry.method).arg(entryName);
+            return QByteArray();
+        }
+
+        if (data.isNull() || quint32(data.size()) != entry.size || crc32(data) != entry.crc) {
+            m_error = QString("Damaged entry: %1").arg(entryName);
+            return QByteArray();
+        }
+
+        return data;
+    }
+
+    QJsonObject ExtensionPackage::manifest()
+    {
+        const QByteArray data = read(MANIFEST_FILENAME);
+        if (data.isNull())
+            return QJsonObject();
+
+        QJsonParseError err;
+        const QJsonDocument doc = QJsonDocument::fromJson(data, &err);
+        if (err.error != QJsonParseError::NoError) {
+            m_error = err.errorString();
+            return QJsonObject();
+        }
+
+        return doc.object();
+    }
+
+    bool ExtensionPackage::extractAll(const QString &destination, const std::function<void(int, int)> &progress)
+    {
+        const QDir root(destination);
+        if (!root.mkpath(".")) {
+            m_error = QString("Unable to create %1").arg(destination);
+            return false;
+        }
+
+        const QString rootPath = root.absolutePath() + "/";
+
+        for (int i = 0; i < m_entryNames.size(); i++) {
+            const QString &name = m_entryNames.at(i);
+            const QString target = QDir::cleanPath(root.absoluteFilePath(name));
+
+            if (!target.startsWith(rootPath)) {
+                m_error = QString("Invalid entry name: %1").arg(name);
+                return false;
+            }
+
+            if (name.endsWith('/')) {
+                root.mkpath(target);
+            } else {
+                const QByteArray data = read(name);
+                if (data.isNull())
+                    return false;
+
+                root.mkpath(QFileInfo(target).absolutePath());
+                QSaveFile file(target);
+                if (!file.open(QFile::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+                    m_error = QString("Unable to write %1").arg(target);
+                    return false;
+                }
+            }
+
+            if (progress)
+                progress(i + 1, m_entryNames.size());
+        }
+
+        return true;
+    }
+
+    QByteArray ExtensionPackage::inflate(const QByteArray &data, int maxSize)
+    {
+        return Inflater(data, maxSize).run();
+    }
+
+    quint32 ExtensionPackage::crc32(const QByteArray &data)
+    {
+        struct Table {
+            quint32 values[256];
+
+            Table()
+            {
+                for (quint32 i = 0; i < 256; i++) {
+                    quint32 c = i;
+                    for (int k = 0; k < 8; k++)
+                        c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+                    values[i] = c;
+                }
+            }
+        };
+
+        static const Table table;
+
+        quint32 crc = 0xFFFFFFFF;
+        const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+        for (int i = 0; i < data.size(); i++)
+            crc = table.values[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+
+        return crc ^ 0xFFFFFFFF;
+    }
+
+}
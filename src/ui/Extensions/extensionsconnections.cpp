@@ -0,0 +1,500 @@
+#include "include/Extensions/extensionsconnections.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include <limits>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborStreamReader>
+#include <QCborValue>
+#define NQQ_EXTENSIONS_BINARY_PROTOCOL
+#endif
+
+namespace Extensions {
+
+    namespace {
+        const int FRAME_HEADER_SIZE = 4;
+
+        // Larger frames are treated as a protocol error
+        const quint32 MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+        // Version 0 means "not supported"
+        const QByteArray BINARY_HANDSHAKE_UNSUPPORTED = QByteArray("\0NQQB\0", 6);
+
+        // How often throttled clients are given another chance
+        const int THROTTLE_INTERVAL_MS = 10;
+
+        // Window of ClientMetrics::requestsPerSecond
+        const qint64 RATE_WINDOW_MS = 1000;
+
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+        // Longest encoding of the head of a CBOR array
+        const int MAX_CBOR_HEAD_SIZE = 9;
+
+        /**
+         * @brief Returns the number of requests in a frame from the first bytes of its payload,
+         *        or -1 if it's an array whose length is only known once it has been parsed.
+         */
+        int frameRequests(const QByteArray &head)
+        {
+            QCborStreamReader reader(head);
+            if (!reader.isArray())
+                return 1;
+            if (!reader.isLengthKnown())
+                return -1;
+            return static_cast<int>(qMin<quint64>(reader.length(), std::numeric_limits<int>::max()));
+        }
+
+        QByteArray frame(const QCborValue &value)
+        {
+            const QByteArray payload = value.toCbor();
+
+            QByteArray data(FRAME_HEADER_SIZE, Qt::Uninitialized);
+            qToBigEndian(static_cast<quint32>(payload.size()), reinterpret_cast<uchar *>(data.data()));
+            data.append(payload);
+            return data;
+        }
+
+        QCborMap binaryReply(const QJsonObject &reply, const QJsonValue &id)
+        {
+            QCborMap map = QCborMap::fromJsonObject(reply);
+            map.insert(QStringLiteral("id"), QCborValue::fromJsonValue(id));
+            return map;
+        }
+#endif
+
+        QByteArray jsonLine(const QJsonObject &message)
+        {
+            QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact).trimmed();
+            line.append('\n');
+            return line;
+        }
+    }
+
+    const QByteArray ExtensionsConnections::BINARY_HANDSHAKE = QByteArray("\0NQQB\1", 6);
+    const int ExtensionsConnections::NEGOTIATION_TIMEOUT_MS = 200;
+
+    ExtensionsConnections::ExtensionsConnections(QObject *parent) : QObject(parent)
+    {
+        m_clock.start();
+    }
+
+    ExtensionsConnections::~ExtensionsConnections()
+    {
+
+    }
+
+    bool ExtensionsConnections::listen(const QString &name)
+    {
+        QLocalServer::removeServer(name);
+
+        m_server = new QLocalServer(this);
+        if (!m_server->listen(name))
+            return false;
+
+        m_throttleTimer = new QTimer(this);
+        m_throttleTimer->setSingleShot(true);
+        m_throttleTimer->setInterval(THROTTLE_INTERVAL_MS);
+        connect(m_throttleTimer, &QTimer::timeout, this, &ExtensionsConnections::resumeThrottledClients);
+
+        connect(m_server, &QLocalServer::newConnection, this, &ExtensionsConnections::on_newConnection);
+
+        QMutexLocker locker(&m_mutex);
+        m_fullServerName = m_server->fullServerName();
+        return true;
+    }
+
+    QString ExtensionsConnections::fullServerName() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_fullServerName;
+    }
+
+    QVector<ExtensionsConnections::ClientMetrics> ExtensionsConnections::metrics() const
+    {
+        QMutexLocker locker(&m_mutex);
+
+        QVector<ClientMetrics> metrics;
+        metrics.reserve(m_metrics.size());
+        for (const ClientMetrics &client : m_metrics)
+            metrics.append(client);
+
+        return metrics;
+    }
+
+    void ExtensionsConnections::setMaxRequestsPerSecond(int requests)
+    {
+        m_maxRequestsPerSecond = qMax(0, requests);
+    }
+
+    void ExtensionsConnections::on_newConnection()
+    {
+        while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+            Client client;
+            client.id = ++m_lastClientId;
+            client.socket = socket;
+            client.tokens = m_maxRequestsPerSecond;
+            client.lastRefill = m_clock.elapsed();
+            client.windowStart = client.lastRefill;
+
+            const quint64 id = client.id;
+            m_clients.insert(id, client);
+
+            {
+                QMutexLocker locker(&m_mutex);
+                ClientMetrics metrics;
+                metrics.clientId = id;
+                m_metrics.insert(id, metrics);
+            }
+
+            connect(socket, &QLocalSocket::readyRead, this, [=] { on_readyRead(id); });
+            connect(socket, &QLocalSocket::disconnected, this, [=] { on_disconnected(id); });
+            QTimer::singleShot(NEGOTIATION_TIMEOUT_MS, this, [=] { on_negotiationTimeout(id); });
+
+            emit clientConnected(id);
+        }
+    }
+
+    void ExtensionsConnections::on_disconnected(quint64 clientId)
+    {
+        const auto it = m_clients.find(clientId);
+        if (it == m_clients.end())
+            return;
+
+        it->socket->deleteLater();
+        m_clients.erase(it);
+        m_throttledClients.remove(clientId);
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_metrics.remove(clientId);
+        }
+
+        emit clientDisconnected(clientId);
+    }
+
+    void ExtensionsConnections::on_negotiationTimeout(quint64 clientId)
+    {
+        const auto it = m_clients.find(clientId);
+        if (it == m_clients.end() || it->protocol != Protocol::Unknown)
+            return;
+
+        // The client might be in the middle of sending the handshake
+        if (it->socket->bytesAvailable() > 0)
+            return;
+
+        it->protocol = Protocol::Json;
+        sendPendingMessages(it.value());
+    }
+
+    void ExtensionsConnections::on_readyRead(quint64 clientId)
+    {
+        const auto it = m_clients.find(clientId);
+        if (it == m_clients.end())
+            return;
+
+        Client &client = it.value();
+
+        if (client.protocol == Protocol::Unknown) {
+            if (!negotiateProtocol(client))
+                return;
+            sendPendingMessages(client);
+        }
+
+        Batch batch;
+        QVector<QJsonObject> requests;
+        bool throttled = false;
+
+        if (client.protocol == Protocol::Binary) {
+            if (!readBinaryRequests(client, batch, requests, throttled)) {
+                // Replies to the requests of this client won't be sent anymore
+                client.socket->abort();
+                return;
+            }
+        } else {
+            readJsonRequests(client, requests, throttled);
+        }
+
+        // An empty binary batch is still answered with an empty array
+        if (!requests.isEmpty() || !batch.sizes.isEmpty()) {
+            batch.requests = requests.size();
+            batch.receivedAt = m_clock.elapsed();
+            client.batches.enqueue(batch);
+            emit requestsReceived(clientId, requests);
+        }
+
+        if (throttled && !m_throttledClients.contains(clientId)) {
+            m_throttledClients.insert(clientId);
+
+            {
+                QMutexLocker locker(&m_mutex);
+                m_metrics[clientId].throttled++;
+            }
+
+            if (!m_throttleTimer->isActive())
+                m_throttleTimer->start();
+        }
+    }
+
+    void ExtensionsConnections::resumeThrottledClients()
+    {
+        const QSet<quint64> clients = m_throttledClients;
+        m_throttledClients.clear();
+
+        for (quint64 clientId : clients)
+            on_readyRead(clientId);
+    }
+
+    bool ExtensionsConnections::canRead(Client &client, int requests)
+    {
+        if (m_maxRequestsPerSecond <= 0)
+            return true;
+
+        // Requests that don't fit in the bucket need a full one, and leave the client in debt
+        if (requests < 0 || requests > m_maxRequestsPerSecond)
+            requests = m_maxRequestsPerSecond;
+
+        // Token bucket: a client can send up to a second's worth of requests in a burst
+        const qint64 now = m_clock.elapsed();
+        client.tokens = qMin<double>(m_maxRequestsPerSecond,
+                                     client.tokens + (now - client.lastRefill) * m_maxRequestsPerSecond / 1000.0);
+        client.lastRefill = now;
+
+        return client.tokens >= requests;
+    }
+
+    bool ExtensionsConnections::negotiateProtocol(Client &client)
+    {
+        QLocalSocket *socket = client.socket;
+
+        char first = 0;
+        if (socket->peek(&first, 1) != 1)
+            return false;
+
+        // JSON requests never start with a NUL byte
+        if (first != '\0') {
+            client.protocol = Protocol::Json;
+            return true;
+        }
+
+        if (socket->bytesAvailable() < BINARY_HANDSHAKE.size())
+            return false;
+
+        const QByteArray handshake = socket->read(BINARY_HANDSHAKE.size());
+
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+        if (handshake == BINARY_HANDSHAKE) {
+            client.protocol = Protocol::Binary;
+            // Frames are left in the socket until they can be read, so it never needs to hold more than one
+            socket->setReadBufferSize(FRAME_HEADER_SIZE + MAX_FRAME_SIZE);
+            socket->write(BINARY_HANDSHAKE);
+            return true;
+        }
+#endif
+
+        // Unknown version, or not supported by this build: the client has to fall back to JSON.
+        client.protocol = Protocol::Json;
+        socket->write(BINARY_HANDSHAKE_UNSUPPORTED);
+        return true;
+    }
+
+    void ExtensionsConnections::sendPendingMessages(Client &client)
+    {
+        QByteArray data;
+        for (const QJsonObject &message : client.pendingMessages)
+            data.append(encodeMessage(client.protocol, message));
+
+        client.pendingMessages.clear();
+
+        if (!data.isEmpty())
+            client.socket->write(data);
+    }
+
+    QByteArray ExtensionsConnections::encodeMessage(Protocol protocol, const QJsonObject &message)
+    {
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+        if (protocol == Protocol::Binary)
+            return frame(QCborMap::fromJsonObject(message));
+#else
+        Q_UNUSED(protocol);
+#endif
+        return jsonLine(message);
+    }
+
+    void ExtensionsConnections::readJsonRequests(Client &client, QVector<QJsonObject> &requests, bool &throttled)
+    {
+        // Unread lines stay in the socket's buffer
+        while (client.socket->canReadLine()) {
+            if (!canRead(client)) {
+                throttled = true;
+                break;
+            }
+
+            const QByteArray line = client.socket->readLine();
+
+            // Invalid requests are answered with an error by RuntimeSupport
+            requests.append(QJsonDocument::fromJson(line).object());
+            client.tokens -= 1;
+        }
+    }
+
+    bool ExtensionsConnections::readBinaryRequests(Client &client, Batch &batch, QVector<QJsonObject> &requests, bool &throttled)
+    {
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+        QLocalSocket *socket = client.socket;
+
+        // Unread frames stay in the socket's buffer
+        while (socket->bytesAvailable() >= FRAME_HEADER_SIZE) {
+            char head[FRAME_HEADER_SIZE + MAX_CBOR_HEAD_SIZE];
+            const qint64 peeked = socket->peek(head, sizeof(head));
+            const quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(head));
+
+            if (size > MAX_FRAME_SIZE) {
+                qWarning() << "Extension sent an oversized frame, closing the connection.";
+                return false;
+            }
+
+            if (socket->bytesAvailable() - FRAME_HEADER_SIZE < size)
+                break; // Wait for the rest of the frame
+
+            // A batch is only read once the client can send all of its requests
+            const int headSize = static_cast<int>(qMin<qint64>(size, peeked - FRAME_HEADER_SIZE));
+            if (!canRead(client, frameRequests(QByteArray::fromRawData(head + FRAME_HEADER_SIZE, headSize)))) {
+                throttled = true;
+                break;
+            }
+
+            socket->read(head, FRAME_HEADER_SIZE);
+
+            QCborParserError error;
+            const QCborValue request = QCborValue::fromCbor(socket->read(size), &error);
+
+            if (error.error != QCborError::NoError) {
+                // Answered with an error by RuntimeSupport, like invalid JSON requests
+                qWarning() << "Extension sent an invalid frame:" << error.errorString();
+                batch.sizes.append(-1);
+                batch.ids.append(QJsonValue());
+                requests.append(QJsonObject());
+                client.tokens -= 1;
+                continue;
+            }
+
+            if (request.isArray()) {
+                const QCborArray items = request.toArray();
+                batch.sizes.append(static_cast<int>(items.size()));
+                for (const QCborValue &item : items) {
+                    batch.ids.append(item.toMap().value(QStringLiteral("id")).toJsonValue());
+                    requests.append(item.toMap().toJsonObject());
+                }
+                client.tokens -= items.size();
+            } else {
+                batch.sizes.append(-1);
+                batch.ids.append(request.toMap().value(QStringLiteral("id")).toJsonValue());
+                requests.append(request.toMap().toJsonObject());
+                client.tokens -= 1;
+            }
+        }
+
+        return true;
+#else
+        Q_UNUSED(client);
+        Q_UNUSED(batch);
+        Q_UNUSED(requests);
+        Q_UNUSED(throttled);
+        return false;
+#endif
+    }
+
+    void ExtensionsConnections::sendReplies(quint64 clientId, const QVector<QJsonObject> &replies)
+    {
+        const auto it = m_clients.find(clientId);
+        if (it == m_clients.end())
+            return; // Disconnected meanwhile
+
+        Client &client = it.value();
+        if (client.batches.isEmpty()) {
+            qWarning() << "Extension replies without requests.";
+            return;
+        }
+
+        const Batch batch = client.batches.dequeue();
+        Q_ASSERT(batch.requests == replies.size());
+
+        // The replies to a batch are written at once
+        QByteArray data;
+
+        if (client.protocol == Protocol::Binary) {
+#ifdef NQQ_EXTENSIONS_BINARY_PROTOCOL
+            int reply = 0;
+            for (int size : batch.sizes) {
+                if (size < 0) {
+                    data.append(frame(binaryReply(replies.value(reply), batch.ids.value(reply))));
+                    reply++;
+                } else {
+                    QCborArray array;
+                    for (int i = 0; i < size; i++, reply++)
+                        array.append(binaryReply(replies.value(reply), batch.ids.value(reply)));
+                    data.append(frame(array));
+                }
+            }
+#endif
+        } else {
+            for (const QJsonObject &reply : replies)
+                data.append(jsonLine(reply));
+        }
+
+        client.socket->write(data);
+
+        // Metrics
+        const qint64 now = m_clock.elapsed();
+        const qint64 latency = now - batch.receivedAt;
+        client.totalLatencyMs += latency * batch.requests;
+        client.windowRequests += batch.requests;
+
+        QMutexLocker locker(&m_mutex);
+        ClientMetrics &metrics = m_metrics[clientId];
+        metrics.requests += batch.requests;
+        if (metrics.requests > 0)
+            metrics.averageLatencyMs = static_cast<double>(client.totalLatencyMs) / metrics.requests;
+        metrics.maxLatencyMs = qMax(metrics.maxLatencyMs, latency);
+
+        if (now - client.windowStart >= RATE_WINDOW_MS) {
+            metrics.requestsPerSecond = client.windowRequests * 1000.0 / (now - client.windowStart);
+            client.windowStart = now;
+            client.windowRequests = 0;
+        }
+    }
+
+    void ExtensionsConnections::sendMessage(const QVector<quint64> &clientIds, const QJsonObject &message)
+    {
+        // Every message is only encoded once per protocol
+        QByteArray jsonMessage;
+        QByteArray binaryMessage;
+
+        for (quint64 clientId : clientIds) {
+            const auto it = m_clients.find(clientId);
+            if (it == m_clients.end() || !it->socket->isOpen())
+                continue;
+
+            // The encoding isn't known until the client sent its first data
+            if (it->protocol == Protocol::Unknown) {
+                it->pendingMessages.append(message);
+                continue;
+            }
+
+            QByteArray &data = it->protocol == Protocol::Binary ? binaryMessage : jsonMessage;
+            if (data.isEmpty())
+                data = encodeMessage(it->protocol, message);
+
+            it->socket->write(data);
+        }
+    }
+
+}
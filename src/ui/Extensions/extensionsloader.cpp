@@ -1,14 +1,17 @@
 #include "include/Extensions/extensionsloader.h"
 
+#include "include/Extensions/manifestcache.h"
+#include "include/Sessions/persistentcache.h"
 #include "include/mainwindow.h"
 #include "include/notepadqq.h"
 
 #include <QDateTime>
-#include <QDirIterator>
+#include <QJsonArray>
 
 namespace Extensions {
 
     QSharedPointer<ExtensionsServer> ExtensionsLoader::m_extensionsServer;
+    QSharedPointer<ExtensionHostSupervisor> ExtensionsLoader::m_hostSupervisor;
     QMap<QString, QSharedPointer<Extension>> ExtensionsLoader::m_extensions;
 
     ExtensionsLoader::ExtensionsLoader(QObject *parent) : QObject(parent)
@@ -41,6 +44,8 @@ namespace Extensions {
 
         m_extensionsServer->startServer(name);
 
+        m_hostSupervisor = QSharedPointer<ExtensionHostSupervisor>(new ExtensionHostSupervisor());
+
         return m_extensionsServer;
     }
 
@@ -50,14 +55,40 @@ namespace Extensions {
             return;
         }
 
-        QDirIterator it(path, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable, QDirIterator::NoIteratorFlags);
-        while (it.hasNext()) {
-            QString fileName = it.next();
-            if (!fileName.endsWith("%%BACKUP", Qt::CaseInsensitive)) {
-                QSharedPointer<Extension> ext = QSharedPointer<Extension>(
-                        new Extension(fileName, m_extensionsServer->socketPath()));
-                m_extensions.insert(ext->id(), ext);
-            }
+        ManifestCache cache(PersistentCache::extensionManifestCachePath());
+
+        for (const ManifestCache::Entry &entry : cache.scan(path)) {
+            QSharedPointer<Extension> ext = QSharedPointer<Extension>(
+                    new Extension(entry.path, entry.manifest, m_extensionsServer->socketPath()));
+            m_extensions.insert(ext->id(), ext);
+        }
+
+        activate(ActivationEvents::STARTUP_EVENT);
+    }
+
+    void ExtensionsLoader::activate(const QString &event)
+    {
+        if (m_hostSupervisor.isNull())
+            return;
+
+        for (const QSharedPointer<Extension> &ext : m_extensions) {
+            if (!ext->isActive() && ext->isValid() && ext->activatesOn(event))
+                m_hostSupervisor->start(ext, event);
+        }
+    }
+
+    void ExtensionsLoader::invokeCommand(const QString &extensionId, const QString &commandId)
+    {
+        QSharedPointer<Extension> ext = m_extensions.value(extensionId);
+        if (ext.isNull() || !ext->isValid())
+            return;
+
+        if (!ext->isActive()) {
+            if (!m_hostSupervisor.isNull())
+                m_hostSupervisor->start(ext, ActivationEvents::commandEvent(commandId));
+        } else if (!m_extensionsServer.isNull()) {
+            m_extensionsServer->runtimeSupport()->emitNotepadqqEvent(
+                        QStringLiteral("commandInvoked"), QJsonArray { extensionId, commandId });
         }
     }
 
@@ -71,6 +102,11 @@ namespace Extensions {
         return m_extensionsServer;
     }
 
+    QSharedPointer<ExtensionHostSupervisor> ExtensionsLoader::hostSupervisor()
+    {
+        return m_hostSupervisor;
+    }
+
     bool ExtensionsLoader::extensionRuntimePresent()
     {
         QFileInfo f = QFileInfo(Notepadqq::nodejsPath());
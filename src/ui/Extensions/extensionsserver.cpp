@@ -1,29 +1,58 @@
 #include "include/Extensions/extensionsserver.h"
 
-#include <QJsonDocument>
-#include <QLocalSocket>
-#include <QMessageBox>
+#include "include/nqqsettings.h"
+
+#include <QDebug>
+#include <QJsonArray>
 
 namespace Extensions {
 
+    namespace {
+        // Stub methods can't contain '$'
+        const QString SUBSCRIBE_METHOD = QStringLiteral("$subscribe");
+        const QString UNSUBSCRIBE_METHOD = QStringLiteral("$unsubscribe");
+        const QString IDENTIFY_METHOD = QStringLiteral("$identify");
+    }
+
     ExtensionsServer::ExtensionsServer(QSharedPointer<RuntimeSupport> extensionsRTS, QObject *parent) :
         QObject(parent),
-        m_extensionsRTS(extensionsRTS)
+        m_extensionsRTS(extensionsRTS),
+        m_connections(new ExtensionsConnections())
     {
+        qRegisterMetaType<QVector<QJsonObject>>("QVector<QJsonObject>");
+        qRegisterMetaType<QVector<quint64>>("QVector<quint64>");
+
+        connect(&m_subscriptions, &EventSubscriptions::deliver, this, &ExtensionsServer::sendMessage);
+
+        m_connections->setMaxRequestsPerSecond(
+                    NqqSettings::getInstance().Extensions.getMaxRequestsPerSecond());
+        m_connections->moveToThread(&m_ioThread);
+        connect(&m_ioThread, &QThread::finished, m_connections, &QObject::deleteLater);
 
+        connect(m_connections, &ExtensionsConnections::clientConnected,
+                this, &ExtensionsServer::on_clientConnected);
+        connect(m_connections, &ExtensionsConnections::clientDisconnected,
+                this, &ExtensionsServer::on_clientDisconnected);
+        connect(m_connections, &ExtensionsConnections::requestsReceived,
+                this, &ExtensionsServer::on_requestsReceived);
+
+        m_ioThread.setObjectName("ExtensionsServer");
+        m_ioThread.start();
     }
 
     ExtensionsServer::~ExtensionsServer()
     {
-
+        m_ioThread.quit();
+        m_ioThread.wait();
     }
 
     bool ExtensionsServer::startServer(QString name)
     {
-        QLocalServer::removeServer(name);
+        bool listening = false;
+        QMetaObject::invokeMethod(m_connections, "listen", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, listening), Q_ARG(QString, name));
 
-        m_server = new QLocalServer(this);
-        if (!m_server->listen(name)) {
+        if (!listening) {
 
             qCritical() << QString("Unable to start extensions server %1. Extensions will not be loaded.")
                            .arg(name).toStdString().c_str();
@@ -31,86 +60,152 @@ namespace Extensions {
             return false;
         }
 
-        connect(m_server, &QLocalServer::newConnection, this, &ExtensionsServer::on_newConnection);
         return true;
     }
 
     QString ExtensionsServer::socketPath()
     {
-        if (m_server->isListening()) {
-            return m_server->fullServerName();
-        } else {
-            return QString();
-        }
+        return m_connections->fullServerName();
+    }
+
+    QVector<ExtensionsConnections::ClientMetrics> ExtensionsServer::metrics() const
+    {
+        return m_connections->metrics();
     }
 
-    void ExtensionsServer::on_newConnection()
+    void ExtensionsServer::on_clientConnected(quint64 clientId)
     {
-        QLocalSocket *client = m_server->nextPendingConnection();
-        if (client != nullptr) {
-            m_sockets.append(client);
+        m_clients.insert(clientId, Client());
+        m_subscriptions.addClient(clientId);
+        m_extensionsRTS->addClient(clientId);
 
-            connect(client, &QLocalSocket::readyRead, this, [=] { on_clientMessage(client); });
-            connect(client, &QLocalSocket::disconnected, this, [=] { on_socketDisconnected(client); });
+        sendMessage({ clientId }, m_extensionsRTS->getCurrentExtensionStartedEvent());
+    }
 
-            sendMessage(client, m_extensionsRTS->getCurrentExtensionStartedEvent());
-        }
+    void ExtensionsServer::on_clientDisconnected(quint64 clientId)
+    {
+        m_subscriptions.removeClient(clientId);
+        m_clients.remove(clientId);
+        m_extensionsRTS->removeClient(clientId);
     }
 
-    void ExtensionsServer::on_clientMessage(QLocalSocket *socket)
+    void ExtensionsServer::on_requestsReceived(quint64 clientId, const QVector<QJsonObject> &requests)
     {
-        QTextStream stream(socket);
+        if (!m_clients.contains(clientId))
+            return;
 
-        if (stream.atEnd())
+        // Handling a request might run an event loop. Batches that arrive meanwhile are
+        // handled by the outer call, so replies to a connection are never interleaved.
+        m_clients[clientId].batches.enqueue(requests);
+        if (m_clients[clientId].busy)
             return;
 
-        while (1) {
-            QString jsonRequest = stream.readLine();
-            if (jsonRequest.isNull())
-                break;
+        m_clients[clientId].busy = true;
 
-            QJsonDocument request = QJsonDocument::fromJson(jsonRequest.toUtf8());
+        while (m_clients.contains(clientId) && !m_clients[clientId].batches.isEmpty()) {
+            const QVector<QJsonObject> batch = m_clients[clientId].batches.dequeue();
 
-            QJsonObject response = m_extensionsRTS->handleRequest(request.object());
-            QString jsonResponse = QString(
-                        QJsonDocument(response).toJson(QJsonDocument::Compact))
-                    .trimmed();
+            QVector<QJsonObject> replies;
+            replies.reserve(batch.size());
+            for (const QJsonObject &request : batch)
+                replies.append(handleRequest(clientId, request));
 
-            stream << jsonResponse << "\n";
+            QMetaObject::invokeMethod(m_connections, "sendReplies", Qt::QueuedConnection,
+                                      Q_ARG(quint64, clientId), Q_ARG(QVector<QJsonObject>, replies));
         }
+
+        if (m_clients.contains(clientId))
+            m_clients[clientId].busy = false;
     }
 
-    void ExtensionsServer::on_socketDisconnected(QLocalSocket *socket)
+    QJsonObject ExtensionsServer::handleRequest(quint64 clientId, const QJsonObject &request)
     {
-        m_sockets.removeAll(socket);
-        socket->deleteLater();
-        Q_ASSERT(m_sockets.contains(socket) == false);
+        const QString method = request.value("method").toString();
+
+        if (method == SUBSCRIBE_METHOD)
+            return subscribe(clientId, request, true);
+        else if (method == UNSUBSCRIBE_METHOD)
+            return subscribe(clientId, request, false);
+        else if (method == IDENTIFY_METHOD)
+            return identify(clientId, request);
+        else
+            return m_extensionsRTS->handleRequest(request, clientId);
     }
 
-    void ExtensionsServer::broadcastMessage(const QJsonObject &message)
+    QJsonObject ExtensionsServer::subscribe(quint64 clientId, const QJsonObject &request, bool add)
     {
-        QString jsonMessage = QString(
-                    QJsonDocument(message).toJson(QJsonDocument::Compact))
-                .trimmed();
+        const qint64 objectId = request.value("objectId").toDouble();
+        const QJsonArray events = request.value("args").toArray();
+
+        if (objectId <= 0 || !m_clients.contains(clientId)) {
+            return Stubs::Stub::StubReturnValue(
+                        Stubs::Stub::ErrorCode::INVALID_REQUEST,
+                        QString("Invalid subscription (objectId: %1)").arg(objectId)
+                        ).toJsonObject();
+        }
 
-        for (QLocalSocket *socket : m_sockets) {
-            if (socket->isOpen()) {
-                QTextStream stream(socket);
-                stream << jsonMessage << "\n";
+        QStringList eventNames;
+        for (const QJsonValue &event : events) {
+            if (!event.isString()) {
+                return Stubs::Stub::StubReturnValue(
+                            Stubs::Stub::ErrorCode::INVALID_ARGUMENT_TYPE,
+                            QString("Event names must be strings")
+                            ).toJsonObject();
             }
+            eventNames.append(event.toString());
         }
+
+        if (add)
+            m_subscriptions.subscribe(clientId, objectId, eventNames);
+        else
+            m_subscriptions.unsubscribe(clientId, objectId, eventNames);
+
+        return Stubs::Stub::StubReturnValue(QJsonValue(true)).toJsonObject();
     }
 
-    void ExtensionsServer::sendMessage(QLocalSocket *socket, const QJsonObject &message)
+    QJsonObject ExtensionsServer::identify(quint64 clientId, const QJsonObject &request)
     {
-        if (socket->isOpen()) {
-            QString jsonMessage = QString(
-                        QJsonDocument(message).toJson(QJsonDocument::Compact))
-                    .trimmed();
+        const QString extensionId = request.value("args").toArray().at(0).toString();
 
-            QTextStream stream(socket);
-            stream << jsonMessage << "\n";
+        if (extensionId.isEmpty() || !m_clients.contains(clientId)) {
+            return Stubs::Stub::StubReturnValue(
+                        Stubs::Stub::ErrorCode::INVALID_ARGUMENT_TYPE,
+                        QString("Expected the extension id")
+                        ).toJsonObject();
         }
+
+        m_clients[clientId].extensionId = extensionId;
+        return Stubs::Stub::StubReturnValue(QJsonValue(true)).toJsonObject();
+    }
+
+    QString ExtensionsServer::extensionId(quint64 clientId) const
+    {
+        return m_clients.value(clientId).extensionId;
+    }
+
+    void ExtensionsServer::broadcastMessage(const QJsonObject &message)
+    {
+        sendMessage(m_clients.keys().toVector(), message);
+    }
+
+    void ExtensionsServer::publishEvent(qint64 objectId, const QString &event, const QJsonObject &message, bool coalesce)
+    {
+        m_subscriptions.publish(objectId, event, message, coalesce);
+    }
+
+    void ExtensionsServer::publishEventTo(const QVector<quint64> &clientIds, const QJsonObject &message)
+    {
+        m_subscriptions.publishTo(clientIds, message);
+    }
+
+    void ExtensionsServer::sendMessage(const QVector<quint64> &clientIds, const QJsonObject &message)
+    {
+        if (clientIds.isEmpty())
+            return;
+
+        // Encoded and written on the I/O thread
+        QMetaObject::invokeMethod(m_connections, "sendMessage", Qt::QueuedConnection,
+                                  Q_ARG(QVector<quint64>, clientIds), Q_ARG(QJsonObject, message));
     }
 
     QSharedPointer<RuntimeSupport> ExtensionsServer::runtimeSupport()
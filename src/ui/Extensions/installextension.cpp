@@ -1,14 +1,15 @@
 #include "include/Extensions/installextension.h"
 
 #include "include/Extensions/extension.h"
+#include "include/Extensions/extensioninstaller.h"
+#include "include/Extensions/extensionpackage.h"
 #include "include/notepadqq.h"
 #include "ui_installextension.h"
 
 #include <QDebug>
 #include <QDir>
 #include <QJsonObject>
-#include <QJsonParseError>
-#include <QProcess>
+#include <QMessageBox>
 
 namespace Extensions {
 
@@ -26,19 +27,17 @@ namespace Extensions {
         //setFixedSize(this->width(), this->height());
         setWindowFlags((windowFlags() | Qt::CustomizeWindowHint) & ~Qt::WindowMinMaxButtonsHint);
 
-        QString manifestStr = readExtensionManifest(extensionFilename);
-        if (!manifestStr.isNull()) {
-            QJsonParseError err;
-            QJsonDocument manifestDoc = QJsonDocument::fromJson(manifestStr.toUtf8(), &err);
+        // Shown once the installation starts
+        ui->txtOutput->hide();
+        ui->lblStatus->hide();
 
-            if (err.error != QJsonParseError::NoError) {
-                // FIXME Failed to load
-                qDebug() << manifestStr;
-                qCritical() << err.errorString();
-            }
-
-            QJsonObject manifest = manifestDoc.object();
+        // Only the end of the archive and the manifest are read, so this is quick
+        ExtensionPackage package(extensionFilename);
+        QJsonObject manifest;
+        if (package.open())
+            manifest = package.manifest();
 
+        if (!manifest.isEmpty()) {
             m_uniqueName = manifest.value("unique_name").toString();
             m_runtime = manifest.value("runtime").toString();
             ui->lblName->setText(manifest.value("name").toString());
@@ -60,7 +59,10 @@ namespace Extensions {
             }
 
         } else {
-            // FIXME Error reading manifest from archive
+            ui->lblName->setText(QFileInfo(extensionFilename).fileName());
+            ui->lblVersionAuthor->setText(tr("Unable to read the extension manifest"));
+            ui->lblDescription->setText(package.errorString());
+            ui->btnInstall->setEnabled(false);
         }
     }
 
@@ -94,75 +96,80 @@ namespace Extensions {
 
     void InstallExtension::installNodejsExtension(const QString &packagePath)
     {
+        const QString extensionPath = getAbsoluteExtensionFolder(Notepadqq::extensionsPath(), m_uniqueName);
+        if (extensionPath.isNull()) {
+            showError(tr("Invalid unique name: %1").arg(m_uniqueName));
+            return;
+        }
+
         ui->progressBar->setMinimum(0);
         ui->progressBar->setMaximum(0);
         ui->progressBar->setValue(0);
+        ui->txtOutput->clear();
+        ui->txtOutput->show();
+        ui->lblStatus->show();
+        ui->btnInstall->setEnabled(false);
+        ui->btnCancel->setEnabled(false);
+        m_output.clear();
+
+        m_installer = new ExtensionInstaller(packagePath, extensionPath, this);
+
+        connect(m_installer, &ExtensionInstaller::progress, this, [=](int value, int maximum) {
+            ui->progressBar->setMaximum(maximum);
+            ui->progressBar->setValue(value);
+        });
+        connect(m_installer, &ExtensionInstaller::statusChanged, ui->lblStatus, &QLabel::setText);
+        connect(m_installer, &ExtensionInstaller::output, this, [=](const QString &text) {
+            m_output += text;
+            ui->txtOutput->moveCursor(QTextCursor::End);
+            ui->txtOutput->insertPlainText(text);
+            ui->txtOutput->moveCursor(QTextCursor::End);
+        });
+        connect(m_installer, &ExtensionInstaller::finished, this, &InstallExtension::on_installerFinished);
 
-        QProcess *process = new QProcess(this);
+        m_installer->start();
+    }
+
+    void InstallExtension::on_installerFinished(bool success, const QString &message)
+    {
+        m_installer->deleteLater();
+        m_installer = nullptr;
+        ui->btnCancel->setEnabled(true);
 
-        connect(process, static_cast<void (QProcess::*)(QProcess::ProcessError)>(&QProcess::error), [=](){
-            setUIClean(false);
+        setUIClean(success);
 
+        if (success) {
             QMessageBox infoBox;
-            infoBox.setWindowTitle(tr("Error installing the extension"));
-            infoBox.setText(process->errorString());
-            infoBox.setIcon(QMessageBox::Critical);
+            infoBox.setWindowTitle(tr("Extension installed"));
+            infoBox.setText(tr("The extension has been successfully installed!"));
+            infoBox.setDetailedText(m_output);
+            infoBox.setIcon(QMessageBox::Information);
             infoBox.exec();
-        });
 
-        connect(process, static_cast<void (QProcess::*)(int,QProcess::ExitStatus)>(&QProcess::finished), [=](int exitCode, QProcess::ExitStatus) {
-            if (exitCode == 0) {
-                setUIClean(true);
-
-                QMessageBox infoBox;
-                infoBox.setWindowTitle(tr("Extension installed"));
-                infoBox.setText(tr("The extension has been successfully installed!"));
-                infoBox.setDetailedText(QString(process->readAllStandardOutput()));
-                infoBox.setIcon(QMessageBox::Information);
-                infoBox.exec();
-
-                accept();
-            } else {
-                setUIClean(false);
-
-                QMessageBox infoBox;
-                infoBox.setWindowTitle(tr("Error installing the extension"));
-                infoBox.setText(QString("Exit code: %1\n%2").arg(exitCode).arg(QString(process->readAllStandardError())));
-                infoBox.setDetailedText(QString(process->readAllStandardOutput()));
-                infoBox.setIcon(QMessageBox::Critical);
-                infoBox.exec();
-            }
-
-            if (process->isOpen()) {
-                process->close();
-            }
-        });
-
-        this->setEnabled(false);
-        process->setWorkingDirectory(Notepadqq::extensionToolsPath());
-        process->start(Notepadqq::nodejsPath(), QStringList()
-                      << "install.js"
-                      << packagePath
-                      << Notepadqq::extensionsPath()
-                      << Notepadqq::npmPath());
+            accept();
+        } else {
+            ui->btnInstall->setEnabled(true);
+            showError(message);
+        }
     }
 
-    QString InstallExtension::readExtensionManifest(const QString &archivePath)
+    void InstallExtension::showError(const QString &message)
     {
-        QProcess process;
-        QByteArray output;
-        process.setWorkingDirectory(Notepadqq::extensionToolsPath());
-        process.start(Notepadqq::nodejsPath(), QStringList() << "readmanifest.js" << archivePath);
-
-        if (process.waitForStarted(20000)) {
-            while (process.waitForReadyRead(30000)) {
-                output.append(process.readAllStandardOutput());
-            }
+        QMessageBox infoBox;
+        infoBox.setWindowTitle(tr("Error installing the extension"));
+        infoBox.setText(message);
+        infoBox.setDetailedText(m_output);
+        infoBox.setIcon(QMessageBox::Critical);
+        infoBox.exec();
+    }
 
-            return QString(output);
-        }
+    void InstallExtension::reject()
+    {
+        // Leaving now would leave the extension half installed
+        if (m_installer != nullptr && m_installer->isRunning())
+            return;
 
-        return QString();
+        QDialog::reject();
     }
 
 }
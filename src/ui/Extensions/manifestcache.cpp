@@ -0,0 +1,150 @@
+#include "include/Extensions/manifestcache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QtConcurrentMap>
+
+namespace Extensions {
+
+    namespace {
+        const int MANIFEST_CACHE_VERSION = 1;
+
+        struct ScannedManifest {
+            QString path;
+            qint64 modified = 0;
+            qint64 size = -1;       // -1 if there's no manifest
+            QJsonObject cached;     // Valid if 'modified' and 'size' still match
+            QJsonObject manifest;
+        };
+
+        QJsonObject readCache(const QString &cachePath)
+        {
+            QFile file(cachePath);
+            if (!file.open(QFile::ReadOnly))
+                return QJsonObject();
+
+            const QJsonObject cache = QJsonDocument::fromJson(file.readAll()).object();
+            if (cache.value("version").toInt() != MANIFEST_CACHE_VERSION)
+                return QJsonObject();
+
+            return cache.value("manifests").toObject();
+        }
+
+        void writeCache(const QString &cachePath, const QVector<ScannedManifest> &scanned)
+        {
+            QJsonObject manifests;
+            for (const ScannedManifest &item : scanned) {
+                // Invalid manifests are cached too, so that they aren't parsed on every run
+                if (item.size < 0)
+                    continue;
+
+                QJsonObject entry;
+                entry.insert("modified", item.modified);
+                entry.insert("size", item.size);
+                entry.insert("manifest", item.manifest);
+                manifests.insert(item.path, entry);
+            }
+
+            QJsonObject cache;
+            cache.insert("version", MANIFEST_CACHE_VERSION);
+            cache.insert("manifests", manifests);
+
+            QDir().mkpath(QFileInfo(cachePath).absolutePath());
+            QSaveFile file(cachePath);
+            if (file.open(QFile::WriteOnly)) {
+                file.write(QJsonDocument(cache).toJson(QJsonDocument::Compact));
+                file.commit();
+            }
+        }
+    }
+
+    ManifestCache::ManifestCache(const QString &cachePath) :
+        m_cachePath(cachePath)
+    {
+
+    }
+
+    QVector<ManifestCache::Entry> ManifestCache::scan(const QString &extensionsPath)
+    {
+        const QJsonObject cache = readCache(m_cachePath);
+
+        QVector<ScannedManifest> scanned;
+        QDirIterator it(extensionsPath, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable, QDirIterator::NoIteratorFlags);
+        while (it.hasNext()) {
+            QString fileName = it.next();
+            if (!fileName.endsWith("%%BACKUP", Qt::CaseInsensitive)) {
+                ScannedManifest item;
+                item.path = fileName;
+                item.cached = cache.value(fileName).toObject();
+                scanned.append(item);
+            }
+        }
+
+        // Only the manifests that changed since the last run are parsed
+        QAtomicInt misses(0);
+        QtConcurrent::blockingMap(scanned, [&misses](ScannedManifest &item) {
+            const QFileInfo info(item.path + "/nqq-manifest.json");
+            if (!info.exists())
+                return;
+
+            item.modified = info.lastModified().toMSecsSinceEpoch();
+            item.size = info.size();
+
+            if (item.cached.value("modified").toDouble() == item.modified &&
+                    item.cached.value("size").toDouble() == item.size) {
+                item.manifest = item.cached.value("manifest").toObject();
+            } else {
+                item.manifest = readManifest(item.path);
+                misses.ref();
+            }
+        });
+
+        m_misses = misses.load();
+
+        int manifestCount = 0;
+        for (const ScannedManifest &item : scanned) {
+            if (item.size >= 0)
+                manifestCount++;
+        }
+
+        // Also drops the extensions that were removed
+        if (m_misses > 0 || manifestCount != cache.size())
+            writeCache(m_cachePath, scanned);
+
+        QVector<Entry> entries;
+        entries.reserve(scanned.size());
+        for (const ScannedManifest &item : scanned)
+            entries.append({ item.path, item.manifest });
+
+        return entries;
+    }
+
+    int ManifestCache::misses() const
+    {
+        return m_misses;
+    }
+
+    QJsonObject ManifestCache::readManifest(const QString &extensionPath)
+    {
+        QFile fManifest(extensionPath + "/nqq-manifest.json");
+        if (fManifest.open(QFile::ReadOnly)) {
+            QJsonParseError err;
+            QJsonDocument manifestDoc = QJsonDocument::fromJson(fManifest.readAll(), &err);
+
+            if (err.error != QJsonParseError::NoError) {
+                return QJsonObject();
+            }
+
+            return manifestDoc.object();
+
+        } else {
+            return QJsonObject();
+        }
+    }
+
+}
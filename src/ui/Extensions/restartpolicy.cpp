@@ -0,0 +1,38 @@
+#include "include/Extensions/restartpolicy.h"
+
+namespace Extensions {
+
+    const int RestartPolicy::INITIAL_DELAY_MS;
+    const int RestartPolicy::MAX_DELAY_MS;
+    const int RestartPolicy::STABLE_RUN_MS;
+    const int RestartPolicy::MAX_CONSECUTIVE_CRASHES;
+
+    int RestartPolicy::crashed(qint64 runTimeMs)
+    {
+        if (runTimeMs >= STABLE_RUN_MS)
+            m_consecutiveCrashes = 0;
+
+        m_consecutiveCrashes++;
+
+        if (m_consecutiveCrashes >= MAX_CONSECUTIVE_CRASHES)
+            return -1;
+
+        // Shifting stops at MAX_DELAY_MS, so it can't overflow
+        int delay = INITIAL_DELAY_MS;
+        for (int i = 1; i < m_consecutiveCrashes && delay < MAX_DELAY_MS; i++)
+            delay *= 2;
+
+        return qMin(delay, MAX_DELAY_MS);
+    }
+
+    void RestartPolicy::reset()
+    {
+        m_consecutiveCrashes = 0;
+    }
+
+    int RestartPolicy::consecutiveCrashes() const
+    {
+        return m_consecutiveCrashes;
+    }
+
+}
@@ -8,10 +8,17 @@
 
 namespace Extensions {
 
-    RuntimeSupport::RuntimeSupport(QObject *parent) : QObject(parent)
+    RuntimeSupport::RuntimeSupport(QObject *parent) :
+        QObject(parent),
+        m_stubs(100)
     {
         QSharedPointer<Stubs::Stub> nqqStub = QSharedPointer<Stubs::Stub>(new Stubs::NotepadqqStub(this));
-        m_pointers.insert(NQQ_STUB_ID, nqqStub);
+        m_stubs.pin(NQQ_STUB_ID, nqqStub);
+
+        // Stubs of destroyed objects are otherwise only noticed when an extension calls them
+        m_sweepTimer.setInterval(SWEEP_INTERVAL_MS);
+        connect(&m_sweepTimer, &QTimer::timeout, this, [this] { m_stubs.sweep(); });
+        m_sweepTimer.start();
     }
 
     RuntimeSupport::~RuntimeSupport()
@@ -19,7 +26,7 @@ namespace Extensions {
 
     }
 
-    QJsonObject RuntimeSupport::handleRequest(const QJsonObject &request)
+    QJsonObject RuntimeSupport::handleRequest(const QJsonObject &request, quint64 clientId)
     {
         qint64 objectId = request.value("objectId").toDouble();
         QString method = request.value("method").toString();
@@ -34,20 +41,26 @@ namespace Extensions {
 
         Q_ASSERT(objectId >= 0 && method.length() > 0);
 
-        QSharedPointer<Stubs::Stub> object = m_pointers.value(objectId);
+        QSharedPointer<Stubs::Stub> object = m_stubs.value(objectId);
 
         if (!object.isNull()) {
 
             if (object->isAlive()) {
                 QJsonArray jsonArgs = request.value("args").toArray();
 
+                // Requests can be nested if the method runs an event loop
+                const quint64 previousClient = m_currentClient;
+                m_currentClient = clientId;
+
                 Stubs::Stub::StubReturnValue ret;
                 object->invoke(method, ret, jsonArgs);
 
+                m_currentClient = previousClient;
+
                 return ret.toJsonObject();
 
             } else {
-                m_pointers.remove(objectId);
+                m_stubs.remove(objectId);
                 return Stubs::Stub::StubReturnValue(
                             Stubs::Stub::ErrorCode::OBJECT_DEALLOCATED,
                             QString("Object id %1 is deallocated.").arg(objectId)
@@ -55,7 +68,6 @@ namespace Extensions {
             }
 
         } else {
-            m_pointers.remove(objectId);
             return Stubs::Stub::StubReturnValue(
                         Stubs::Stub::ErrorCode::OBJECT_NOT_FOUND,
                         QString("Object id %1 doesn't exist.").arg(objectId)
@@ -65,16 +77,9 @@ namespace Extensions {
 
     qint64 RuntimeSupport::presentObject(QSharedPointer<Stubs::Stub> stub)
     {
-        static qint64 counter = 100;
-
-        qint64 oldId = findStubId(stub.data());
-        if (oldId != -1) {
-            return oldId;
-        }
-
-        qint64 id = ++counter;
-        m_pointers.insert(id, stub);
-        Q_ASSERT(findStubId(stub.data()) != -1);
+        // Objects presented outside of a request are sent to every client
+        qint64 id = m_stubs.present(stub, m_currentClient);
+        Q_ASSERT(m_stubs.find(stub.data()) == id);
         return id;
     }
 
@@ -86,33 +91,34 @@ namespace Extensions {
         return obj;
     }
 
-    qint64 RuntimeSupport::findStubId(Stubs::Stub *stub)
+    void RuntimeSupport::emitEvent(Stubs::Stub *sender, QString event, const QJsonArray &args, bool coalesce)
     {
-        // FIXME This runs in O(n) time. Consider using a reverse hash too.
-
-        QHashIterator<qint64, QSharedPointer<Stubs::Stub>> i(m_pointers);
-
-        while (i.hasNext()) {
-            i.next();
-            if (*(i.value().data()) == *stub) {
-                return i.key();
-            }
+        qint64 objectId = m_stubs.find(sender);
+        if (objectId != -1) {
+            ExtensionsLoader::extensionsServer()->publishEvent(objectId, event,
+                                                               eventMessage(objectId, event, args), coalesce);
         }
+    }
 
-        return -1;
+    void RuntimeSupport::emitEventTo(const QVector<quint64> &clientIds, Stubs::Stub *sender, QString event, const QJsonArray &args)
+    {
+        qint64 objectId = m_stubs.find(sender);
+        if (objectId != -1)
+            ExtensionsLoader::extensionsServer()->publishEventTo(clientIds, eventMessage(objectId, event, args));
     }
 
-    void RuntimeSupport::emitEvent(Stubs::Stub *sender, QString event, const QJsonArray &args)
+    void RuntimeSupport::emitNotepadqqEvent(QString event, const QJsonArray &args)
     {
-        qint64 objectId = findStubId(sender);
-        if (objectId != -1) {
-            QJsonObject retJson;
-            retJson.insert("objectId", objectId);
-            retJson.insert("event", event);
-            retJson.insert("args", args);
+        ExtensionsLoader::extensionsServer()->publishEvent(NQQ_STUB_ID, event, eventMessage(NQQ_STUB_ID, event, args));
+    }
 
-            ExtensionsLoader::extensionsServer()->broadcastMessage(retJson);
-        }
+    QJsonObject RuntimeSupport::eventMessage(qint64 objectId, const QString &event, const QJsonArray &args)
+    {
+        QJsonObject retJson;
+        retJson.insert("objectId", objectId);
+        retJson.insert("event", event);
+        retJson.insert("args", args);
+        return retJson;
     }
 
     QJsonObject RuntimeSupport::getCurrentExtensionStartedEvent()
@@ -124,4 +130,15 @@ namespace Extensions {
         return retJson;
     }
 
+    void RuntimeSupport::addClient(quint64 clientId)
+    {
+        m_stubs.addClient(clientId);
+    }
+
+    void RuntimeSupport::removeClient(quint64 clientId)
+    {
+        m_stubs.removeClient(clientId);
+        emit clientRemoved(clientId);
+    }
+
 }
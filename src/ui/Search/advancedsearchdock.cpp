@@ -56,6 +56,18 @@ bool askConfirmationForReplace(QString replaceText, int numReplacements) {
                                     QMessageBox::Cancel) == QMessageBox::Ok;
 }
 
+/**
+ * @brief warnLimitReached Shows a blocking QMessageBox telling the user that a search which hit the result
+ *                         limit can't be used for replacing, since not all matches were recorded.
+ */
+void warnLimitReached() {
+    QMessageBox::warning(QApplication::activeWindow(),
+                         QObject::tr("Replace"),
+                         QObject::tr("This search reached the result limit, so not all matches were found. "
+                                     "Narrow down the search or raise the result limit, then search again "
+                                     "before replacing."));
+}
+
 
 QSearchDockTitleButton::QSearchDockTitleButton(QDockWidget *dockWidget)
     : QAbstractButton(dockWidget)
@@ -184,6 +196,8 @@ QLayout* AdvancedSearchDock::buildLeftTitlebar() {
     m_actExpandAll = menu->addAction(tr("Expand/Collapse All"));
     m_actExpandAll->setCheckable(true);
     m_actRedoSearch = menu->addAction(tr("Redo Search"));
+    m_actRefreshSearch = menu->addAction(tr("Refresh Search"));
+    m_actRefreshSearch->setToolTip(tr("Runs this search again. Only files that changed since are searched again."));
     m_actCopyContents = menu->addAction(tr("Copy Selected Contents To Clipboard"));
     m_actShowFullLines = menu->addAction(tr("Show Full Lines"));
     m_actShowFullLines->setCheckable(true);
@@ -358,6 +372,9 @@ QWidget* AdvancedSearchDock::buildSearchPanelWidget() {
     m_chkUseRegex = new QCheckBox(tr("Use Regular Expressions"));
     m_chkUseSpecialChars = new QCheckBox(tr("Use Special Characters ('\\t', '\\n', ...)"));
     m_chkUseSpecialChars->setToolTip(tr("If set, character sequences like '\\t' will be replaced by their respective special characters."));
+    m_chkMultiPattern = new QCheckBox(tr("Match Any of Several Words"));
+    m_chkMultiPattern->setToolTip(tr("If set, the search term is a list of words separated by spaces. "
+                                     "All words are searched for at once."));
     m_chkIncludeSubdirs = new QCheckBox(tr("Include Subdirectories"));
     m_chkIncludeSubdirs->setChecked(true);
 
@@ -365,6 +382,7 @@ QWidget* AdvancedSearchDock::buildSearchPanelWidget() {
     m_chkMatchWords->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
     m_chkUseRegex->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
     m_chkUseSpecialChars->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
+    m_chkMultiPattern->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
     m_chkIncludeSubdirs->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
 
     QGridLayout* mini = new QGridLayout;
@@ -372,9 +390,10 @@ QWidget* AdvancedSearchDock::buildSearchPanelWidget() {
     mini->addWidget(m_chkMatchWords, 1, 0);
     mini->addWidget(m_chkUseRegex, 2, 0);
     mini->addWidget(m_chkUseSpecialChars, 3, 0);
-    mini->addWidget(makeDivider(QFrame::HLine, 180), 4, 0);
-    mini->addWidget(m_chkIncludeSubdirs, 5, 0);
-    mini->addItem(new QSpacerItem(1, 1, QSizePolicy::Minimum, QSizePolicy::Expanding), 6, 0);
+    mini->addWidget(m_chkMultiPattern, 4, 0);
+    mini->addWidget(makeDivider(QFrame::HLine, 180), 5, 0);
+    mini->addWidget(m_chkIncludeSubdirs, 6, 0);
+    mini->addItem(new QSpacerItem(1, 1, QSizePolicy::Minimum, QSizePolicy::Expanding), 7, 0);
 
     QLabel* regexInfo = new QLabel("(<a href='info'>?</a>)");
     QObject::connect(regexInfo, &QLabel::linkActivated, &showRegexInfo);
@@ -558,6 +577,12 @@ void AdvancedSearchDock::startReplace()
     QString replaceText = m_cmbReplaceText->currentText();
     const SearchResult filteredResults = m_currentSearchInstance->getFilteredSearchResult();
 
+    // Replacing only the recorded matches would silently leave the rest of them in place.
+    if (filteredResults.limitReached) {
+        warnLimitReached();
+        return;
+    }
+
     if (!askConfirmationForReplace(replaceText, filteredResults.countResults()))
         return;
 
@@ -573,15 +598,30 @@ void AdvancedSearchDock::startReplace()
         // Since doc management is a mess we've got to go through all DocResults manually here.
         TopEditorContainer* tec = config.targetWindow->topEditorContainer();
 
+        QStringList modifiedDocuments;
+
         for (const DocResult& res : filteredResults.results) {
             Editor* ed = res.editor;
 
             // The editor might not be open anymore. Try to find it first
             if(!tec->tabWidgetFromEditor(ed)) continue;
 
-            QString content = ed->value();
-            FileReplacer::replaceAll(res, content, replaceText);
-            ed->setValue(content);
+            // The match positions are only valid for the text that was searched.
+            const QString content = ed->value();
+            if (content.length() != res.fileSize || DocResult::hashContent(content) != res.contentHash) {
+                modifiedDocuments << res.fileName;
+                continue;
+            }
+
+            // Replacing the range instead of setting the whole value keeps the undo history intact.
+            FileReplacer::replaceInEditor(ed, res, content, replaceText);
+        }
+
+        if (!modifiedDocuments.isEmpty()) {
+            QMessageBox::warning(QApplication::activeWindow(),
+                                 tr("Replace"),
+                                 tr("The following documents have been modified since they were searched "
+                                    "and were left unchanged:\n%1").arg(modifiedDocuments.join("\n")));
         }
         return;
     } else if (scope == SearchConfig::ScopeFileSystem) {
@@ -604,9 +644,18 @@ SearchConfig AdvancedSearchDock::getConfigFromInputs()
         config.searchMode = SearchConfig::ModePlainTextSpecialChars;
     else if (m_chkUseRegex->isChecked())
         config.searchMode = SearchConfig::ModeRegex;
+    else if (m_chkMultiPattern->isChecked())
+        config.searchMode = SearchConfig::ModeMultiPattern;
     config.includeSubdirs = m_chkIncludeSubdirs->isChecked();
     config.targetWindow = m_mainWindow;
 
+    NqqSettings& settings = NqqSettings::getInstance();
+    config.maxResultsPerFile = settings.Search.getMaxResultsPerFile();
+    config.maxResultsTotal = settings.Search.getMaxResultsTotal();
+    config.excludePattern = settings.Search.getExcludePattern();
+    config.respectIgnoreFiles = settings.Search.getRespectIgnoreFiles();
+    config.skipBinaryFiles = settings.Search.getSkipBinaryFiles();
+
     return config;
 }
 
@@ -621,6 +670,7 @@ void AdvancedSearchDock::setInputsFromConfig(const SearchConfig& config)
     m_chkMatchWords->setChecked(config.matchWord);
     m_chkUseRegex->setChecked(config.searchMode == SearchConfig::ModeRegex);
     m_chkUseSpecialChars->setChecked(config.searchMode == SearchConfig::ModePlainTextSpecialChars);
+    m_chkMultiPattern->setChecked(config.searchMode == SearchConfig::ModeMultiPattern);
     m_chkIncludeSubdirs->setChecked(config.includeSubdirs);
 }
 
@@ -713,11 +763,21 @@ AdvancedSearchDock::AdvancedSearchDock(MainWindow* mainWindow)
     });
     connect(m_chkUseRegex, &QCheckBox::toggled, [this](bool checked){
         m_chkUseSpecialChars->setEnabled(!checked);
+        m_chkMultiPattern->setEnabled(!checked);
         if(checked) m_chkUseSpecialChars->setChecked(false);
+        if(checked) m_chkMultiPattern->setChecked(false);
     });
     connect(m_chkUseSpecialChars, &QCheckBox::toggled, [this](bool checked){
         m_chkUseRegex->setEnabled(!checked);
+        m_chkMultiPattern->setEnabled(!checked);
         if(checked) m_chkUseRegex->setChecked(false);
+        if(checked) m_chkMultiPattern->setChecked(false);
+    });
+    connect(m_chkMultiPattern, &QCheckBox::toggled, [this](bool checked){
+        m_chkUseRegex->setEnabled(!checked);
+        m_chkUseSpecialChars->setEnabled(!checked);
+        if(checked) m_chkUseRegex->setChecked(false);
+        if(checked) m_chkUseSpecialChars->setChecked(false);
     });
 
     // "More Options" menu connections
@@ -732,6 +792,10 @@ AdvancedSearchDock::AdvancedSearchDock(MainWindow* mainWindow)
         setInputsFromConfig( m_currentSearchInstance->getSearchConfig() );
         m_cmbSearchHistory->setCurrentIndex(0);
     });
+    connect(m_actRefreshSearch, &QAction::triggered, [this](){
+        // The file results of the previous run are still cached, so only changed files will be read.
+        startSearch( m_currentSearchInstance->getSearchConfig() );
+    });
     connect(m_actCopyContents, &QAction::triggered, [this](){
         m_currentSearchInstance->copySelectedLinesToClipboard();
     });
@@ -899,24 +963,43 @@ void AdvancedSearchDock::showReplaceDialog(const SearchResult& filteredResults,
 
     const bool success = !w->hasErrors();
 
+    // Summarize how much work was done and how fast
+    int numFiles = 0;
+    qint64 bytesWritten = 0;
+    for (const FileReplacer::FileReport& report : w->getReports()) {
+        if (report.hasError()) continue;
+        numFiles++;
+        bytesWritten += report.bytesWritten;
+    }
+    const qint64 elapsedMs = std::max<qint64>(1, w->getElapsedMs());
+    const QString statsString = tr("%1 file(s), %2 KiB written in %3 ms (%4 KiB/s).")
+            .arg(numFiles)
+            .arg(bytesWritten / 1024)
+            .arg(elapsedMs)
+            .arg(bytesWritten * 1000 / 1024 / elapsedMs);
+
     if (!success) {
-        const QVector<QString>& errors = w->getErrors();
-        const int numErrors = errors.size();
-        const int maxCount = std::min(numErrors, 8);
-        QString errorString = tr("Replacing was unsuccessful for %1 file(s):\n").arg(numErrors);
+        int numErrors = 0;
+        QString errorString;
 
-        for (int i=0; i<maxCount; i++) {
-            errorString += "\"" + errors[i] + "\"\n";
+        for (const FileReplacer::FileReport& report : w->getReports()) {
+            if (!report.hasError()) continue;
+            if (++numErrors <= 8)
+                errorString += "\"" + report.fileName + "\": " + report.error + "\n";
         }
         if (numErrors > 8)
             errorString += tr("And %1 more.").arg(numErrors-8);
 
+        errorString.prepend(tr("Replacing was unsuccessful for %1 file(s):\n").arg(numErrors));
+        errorString += "\n" + statsString;
+
         QMessageBox::warning(QApplication::activeWindow(),
                              tr("Replacement Results"), errorString, QMessageBox::Ok);
     } else {
         QMessageBox::information(QApplication::activeWindow(),
                                  tr("Replacement Results"),
-                                 tr("All selected matches successfully replaced."), QMessageBox::Ok);
+                                 tr("All selected matches successfully replaced.") + "\n" + statsString,
+                                 QMessageBox::Ok);
     }
 
     delete w;
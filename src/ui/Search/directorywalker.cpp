@@ -0,0 +1,261 @@
+#include "include/Search/directorywalker.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QTextStream>
+
+const int DirectoryWalker::BINARY_CHECK_SIZE = 8192;
+
+DirectoryWalker::DirectoryWalker(const QString& rootDirectory, const QStringList& nameFilters, bool recursive)
+    : m_rootDirectory(QDir(rootDirectory).absolutePath()),
+      m_nameFilters(nameFilters),
+      m_recursive(recursive)
+{ }
+
+void DirectoryWalker::setExcludePatterns(const QStringList& patterns)
+{
+    m_excludes.baseDirectory = m_rootDirectory.endsWith('/') ? m_rootDirectory : m_rootDirectory + '/';
+    m_excludes.rules.clear();
+
+    for (const QString& pattern : patterns) {
+        IgnoreRule rule;
+        if (parseRule(pattern, rule))
+            m_excludes.rules.push_back(rule);
+    }
+}
+
+QStringList DirectoryWalker::listFiles(const std::atomic<bool>& wantToStop)
+{
+    struct PendingDir {
+        QString path;
+        QVector<IgnoreFile> ignoreFiles; // All ignore files that apply to this directory, outermost first
+    };
+
+    m_statistics = Statistics();
+
+    QStringList fileList;
+    QSet<QString> visitedDirs; // Canonical paths, to not run into symlink loops
+    QVector<PendingDir> pending;
+
+    PendingDir root;
+    root.path = m_rootDirectory;
+    if (!m_excludes.rules.isEmpty())
+        root.ignoreFiles.push_back(m_excludes);
+    pending.push_back(root);
+
+    while (!pending.isEmpty() && !wantToStop) {
+        PendingDir current = pending.takeLast();
+
+        const QString canonicalPath = QFileInfo(current.path).canonicalFilePath();
+        if (visitedDirs.contains(canonicalPath))
+            continue;
+        visitedDirs.insert(canonicalPath);
+
+        const QDir dir(current.path);
+
+        if (m_respectIgnoreFiles) {
+            for (const QString& name : { QStringLiteral(".gitignore"), QStringLiteral(".ignore") }) {
+                if (dir.exists(name)) {
+                    IgnoreFile ignoreFile = readIgnoreFile(current.path, name);
+                    if (!ignoreFile.rules.isEmpty())
+                        current.ignoreFiles.push_back(ignoreFile);
+                }
+            }
+        }
+
+        const QFileInfoList files = dir.entryInfoList(m_nameFilters, QDir::Files | QDir::Readable | QDir::Hidden,
+                                                      QDir::Name);
+        for (const QFileInfo& file : files) {
+            m_statistics.filesVisited++;
+            if (isIgnored(current.ignoreFiles, file.absoluteFilePath(), file.fileName(), false))
+                m_statistics.filesIgnored++;
+            else
+                fileList << file.absoluteFilePath();
+        }
+
+        if (!m_recursive)
+            continue;
+
+        const QFileInfoList subdirs = dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable | QDir::Hidden,
+                                                        QDir::Name | QDir::Reversed);
+        for (const QFileInfo& subdir : subdirs) {
+            // Pruning here means that nothing below an ignored directory is ever listed.
+            if (isIgnored(current.ignoreFiles, subdir.absoluteFilePath(), subdir.fileName(), true)) {
+                m_statistics.dirsPruned++;
+                continue;
+            }
+
+            PendingDir next;
+            next.path = subdir.absoluteFilePath();
+            next.ignoreFiles = current.ignoreFiles;
+            pending.push_back(next);
+        }
+    }
+
+    return fileList;
+}
+
+bool DirectoryWalker::looksBinary(const QByteArray& data)
+{
+    const int size = data.size();
+    if (size == 0)
+        return false;
+
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+
+    // UTF-16 and UTF-32 text contains lots of NUL bytes. UTF-32 LE starts with the UTF-16 LE BOM too.
+    if (size >= 2 && ((bytes[0] == 0xFF && bytes[1] == 0xFE) || (bytes[0] == 0xFE && bytes[1] == 0xFF)))
+        return false;
+    if (size >= 4 && bytes[0] == 0x00 && bytes[1] == 0x00 && bytes[2] == 0xFE && bytes[3] == 0xFF)
+        return false;
+
+    int controlChars = 0;
+    for (int i = 0; i < size; i++) {
+        const uchar c = bytes[i];
+        if (c == 0)
+            return true;
+        // Tab, line feed, vertical tab, form feed, carriage return, backspace and escape are common in text files
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\v' && c != '\f' && c != '\r' && c != '\b' && c != 0x1B)
+            controlChars++;
+        else if (c == 0x7F)
+            controlChars++;
+    }
+
+    return controlChars * 10 > size;
+}
+
+bool DirectoryWalker::parseRule(const QString& line, IgnoreRule& rule)
+{
+    QString pattern = line;
+
+    // Trailing whitespace is ignored unless escaped
+    while (pattern.endsWith(' ') && !pattern.endsWith("\\ "))
+        pattern.chop(1);
+
+    if (pattern.isEmpty() || pattern.startsWith('#'))
+        return false;
+
+    if (pattern.startsWith('!')) {
+        rule.negated = true;
+        pattern.remove(0, 1);
+    } else if (pattern.startsWith("\\!") || pattern.startsWith("\\#")) {
+        pattern.remove(0, 1);
+    }
+
+    if (pattern.endsWith('/')) {
+        rule.directoryOnly = true;
+        pattern.chop(1);
+    }
+
+    // A slash anywhere but at the end anchors the pattern to the ignore file's directory
+    rule.matchNameOnly = !pattern.contains('/');
+    if (pattern.startsWith('/'))
+        pattern.remove(0, 1);
+
+    if (pattern.isEmpty())
+        return false;
+
+    rule.regex.setPattern(wildcardToRegex(pattern));
+#ifdef Q_OS_WIN
+    rule.regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+#endif
+
+    return rule.regex.isValid();
+}
+
+QString DirectoryWalker::wildcardToRegex(const QString& pattern)
+{
+    QString regex = "^";
+    const int len = pattern.length();
+
+    for (int i = 0; i < len; i++) {
+        const QChar c = pattern[i];
+
+        if (c == '*') {
+            if (i+1 < len && pattern[i+1] == '*') {
+                const bool atStart = i == 0 || pattern[i-1] == '/';
+                const bool atEnd = i+2 == len || pattern[i+2] == '/';
+                if (atStart && i+2 < len && pattern[i+2] == '/') {
+                    regex += "(?:.*/)?";  // "**/" matches zero or more directories
+                    i += 2;
+                    continue;
+                }
+                if (atStart && atEnd) {
+                    regex += ".*";        // Trailing "/**" matches everything inside
+                    i += 1;
+                    continue;
+                }
+            }
+            regex += "[^/]*";
+        } else if (c == '?') {
+            regex += "[^/]";
+        } else if (c == '[') {
+            int j = i+1;
+            if (j < len && (pattern[j] == '!' || pattern[j] == '^')) j++;
+            if (j < len && pattern[j] == ']') j++;
+            while (j < len && pattern[j] != ']') j++;
+
+            if (j >= len) {
+                // Unterminated character class, treat '[' as a literal
+                regex += "\\[";
+                continue;
+            }
+
+            QString charClass = pattern.mid(i+1, j-i-1);
+            if (charClass.startsWith('!'))
+                charClass[0] = '^';
+            regex += '[' + charClass.replace("\\", "\\\\") + ']';
+            i = j;
+        } else if (c == '\\' && i+1 < len) {
+            regex += QRegularExpression::escape(pattern.mid(++i, 1));
+        } else {
+            regex += QRegularExpression::escape(c);
+        }
+    }
+
+    return regex + '$';
+}
+
+DirectoryWalker::IgnoreFile DirectoryWalker::readIgnoreFile(const QString& directory, const QString& fileName)
+{
+    IgnoreFile ignoreFile;
+    ignoreFile.baseDirectory = directory.endsWith('/') ? directory : directory + '/';
+
+    QFile file(ignoreFile.baseDirectory + fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return ignoreFile;
+
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    while (!stream.atEnd()) {
+        IgnoreRule rule;
+        if (parseRule(stream.readLine(), rule))
+            ignoreFile.rules.push_back(rule);
+    }
+
+    return ignoreFile;
+}
+
+bool DirectoryWalker::isIgnored(const QVector<IgnoreFile>& ignoreFiles, const QString& absolutePath,
+                                const QString& name, bool isDirectory)
+{
+    for (int f = ignoreFiles.size() - 1; f >= 0; f--) {
+        const IgnoreFile& ignoreFile = ignoreFiles[f];
+        if (!absolutePath.startsWith(ignoreFile.baseDirectory))
+            continue;
+
+        const QString relativePath = absolutePath.mid(ignoreFile.baseDirectory.length());
+
+        for (int r = ignoreFile.rules.size() - 1; r >= 0; r--) {
+            const IgnoreRule& rule = ignoreFile.rules[r];
+            if (rule.directoryOnly && !isDirectory)
+                continue;
+            if (rule.regex.match(rule.matchNameOnly ? name : relativePath).hasMatch())
+                return !rule.negated;
+        }
+    }
+
+    return false;
+}
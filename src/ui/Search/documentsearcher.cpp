@@ -0,0 +1,152 @@
+#include "include/Search/documentsearcher.h"
+
+#include "include/EditorNS/editor.h"
+#include "include/Search/searchengine.h"
+#include "include/Search/searchhelpers.h"
+#include "include/mainwindow.h"
+
+#include <QPointer>
+#include <QTimer>
+
+#include <memory>
+
+const int DocumentSearcher::SNAPSHOT_TIMEOUT_MS;
+
+DocumentSearcher::DocumentSearcher(const SearchConfig& config)
+    : QThread(nullptr),
+      m_searchConfig(config)
+{ }
+
+DocumentSearcher* DocumentSearcher::prepareAsyncSearch(const SearchConfig& config)
+{
+    return new DocumentSearcher(config);
+}
+
+void DocumentSearcher::startAsync()
+{
+    MainWindow* mw = m_searchConfig.targetWindow;
+    TopEditorContainer* tec = mw->topEditorContainer();
+
+    std::vector<Editor*> editorsToSearch;
+    if (m_searchConfig.searchScope == SearchConfig::ScopeCurrentDocument)
+        editorsToSearch.push_back( mw->currentEditor() );
+    else
+        editorsToSearch = tec->getOpenEditors();
+
+    const int numEditors = static_cast<int>(editorsToSearch.size());
+    m_snapshots.resize(numEditors);
+    m_snapshotReceived.fill(false, numEditors);
+    m_pendingSnapshots = numEditors;
+
+    if (numEditors == 0) {
+        start();
+        return;
+    }
+
+    // All requests are sent right away. The editors answer asynchronously, so the GUI thread is never blocked
+    // waiting for a single editor.
+    for (int i = 0; i < numEditors; i++) {
+        Editor* ed = editorsToSearch[i];
+        m_snapshots[i].editor = ed;
+        m_snapshots[i].name = tec->tabWidgetFromEditor(ed)->tabTextFromEditor(ed);
+
+        // An editor that is closed before it answered will never resolve its promise.
+        connect(ed, &QObject::destroyed, this, [this, i]() { onSnapshotReceived(i, QString(), false); });
+
+        // The searcher may already be gone when an editor answers after the timeout.
+        QPointer<DocumentSearcher> self = this;
+        ed->valueP().then([self, i](const QString& text) {
+            if (self)
+                self->onSnapshotReceived(i, text, true);
+        });
+    }
+
+    // Neither will an editor whose page got stuck, so the search doesn't wait forever.
+    QTimer::singleShot(SNAPSHOT_TIMEOUT_MS, this, &DocumentSearcher::onSnapshotTimeout);
+}
+
+void DocumentSearcher::onSnapshotTimeout()
+{
+    for (int i = 0; i < m_snapshotReceived.size(); i++) {
+        if (!m_snapshotReceived[i])
+            onSnapshotReceived(i, QString(), false);
+    }
+}
+
+void DocumentSearcher::onSnapshotReceived(int index, const QString& text, bool valid)
+{
+    // The search thread might already be running
+    if (m_snapshotReceived[index])
+        return;
+    m_snapshotReceived[index] = true;
+
+    m_snapshots[index].text = text;
+    m_snapshots[index].valid = valid;
+
+    if (--m_pendingSnapshots == 0)
+        start();
+}
+
+void DocumentSearcher::run()
+{
+    const std::unique_ptr<SearchEngine> engine = SearchEngine::create(m_searchConfig);
+    const int total = m_snapshots.size();
+
+    emit resultProgress(0, total);
+
+    QVector<DocResult> results(total);
+    DocResult* resultData = results.data();
+    const DocumentSnapshot* snapshots = m_snapshots.constData();
+    QAtomicInt finishedCount(0);
+
+    SearchHelpers::parallelFor(total, [&](int i) {
+        if (m_wantToStop || !snapshots[i].valid)
+            return;
+
+        DocResult& dr = resultData[i];
+        dr = engine->search(snapshots[i].text, m_searchConfig.maxResultsPerFile);
+
+        // Remember which text the matches refer to, so replacing can tell if the document changed since.
+        if (!dr.results.empty()) {
+            dr.fileSize = snapshots[i].text.length();
+            dr.contentHash = DocResult::hashContent(snapshots[i].text);
+        }
+
+        const int finished = finishedCount.fetchAndAddRelaxed(1) + 1;
+        if (finished % 10 == 0)
+            emit resultProgress(finished, total);
+    });
+
+    // Collect results in tab order. The total result limit is applied here since the documents
+    // were searched in parallel.
+    int totalResults = 0;
+    for (int i = 0; i < total && !m_wantToStop; i++) {
+        DocResult& dr = results[i];
+        if (dr.results.empty())
+            continue;
+
+        if (m_searchConfig.maxResultsTotal > 0) {
+            const int remaining = m_searchConfig.maxResultsTotal - totalResults;
+            if (remaining <= 0) {
+                m_searchResult.limitReached = true;
+                break;
+            }
+            if (dr.results.size() > remaining) {
+                dr.results.resize(remaining);
+                dr.limitReached = true;
+            }
+        }
+
+        totalResults += dr.results.size();
+        m_searchResult.limitReached |= dr.limitReached;
+        dr.docType = DocResult::TypeDocument;
+        dr.fileName = m_snapshots[i].name;
+        dr.editor = m_snapshots[i].editor;
+        m_searchResult.results.push_back(std::move(dr));
+    }
+
+    // The snapshots aren't needed anymore. The DocResults keep their own copies of matched lines.
+    m_snapshots.clear();
+
+    emit resultReady();
+}
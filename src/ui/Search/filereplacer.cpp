@@ -1,16 +1,20 @@
 #include "include/Search/filereplacer.h"
 
+#include "include/Search/searchhelpers.h"
+#include "include/Search/searchindex.h"
+#include "include/EditorNS/editor.h"
 #include "include/docengine.h"
 
+#include <QElapsedTimer>
 #include <QFile>
-#include <QTextStream>
+#include <QSaveFile>
 
 FileReplacer::FileReplacer(const SearchResult& results, const QString &replacement)
     : m_searchResult(results),
       m_replacement(replacement)
 { }
 
-void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QString& replacement)
+QVector<QStringRef> FileReplacer::replacementChunks(const DocResult& doc, const QString& content, const QString& replacement)
 {
     struct BackReference
     {
@@ -18,9 +22,6 @@ void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QStr
         int num;
     };
 
-    if (doc.results.isEmpty())
-        return;
-
     QVector<BackReference> backReferences;
 
     // Search the replacement string for occurences of back references.
@@ -50,17 +51,14 @@ void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QStr
     // - the part before the match
     // - the replacement string, with the proper replacements for the backreferences
 
-    int newLength = 0; // length of the new string, with all the replacements
     int lastEnd = 0;
     QVector<QStringRef> chunks;
-    const QString copy = content;
 
     for (const auto& result : doc.results) {
 
         int len = result.positionInFile - lastEnd;
         if (len > 0) {
-            chunks << copy.midRef(lastEnd, len);
-            newLength += len;
+            chunks << content.midRef(lastEnd, len);
         }
 
         lastEnd = 0;
@@ -71,15 +69,13 @@ void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QStr
             len = backReference.pos - lastEnd;
             if (len > 0) {
                 chunks << replacement.midRef(lastEnd, len);
-                newLength += len;
             }
 
             // backreference itself
-            len = result.regexMatch.capturedLength(backReference.num);
+            len = result.capturedLength(backReference.num);
             if (len > 0) {
-                chunks << copy.midRef(result.regexMatch.capturedStart(backReference.num),
+                chunks << content.midRef(result.capturedStart(backReference.num),
                                       len);
-                newLength += len;
             }
 
             lastEnd = backReference.pos + 2; // Back reference is length 2 (e.g. "\\1")
@@ -89,18 +85,31 @@ void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QStr
         len = replacement.length() - lastEnd;
         if (len > 0) {
             chunks << replacement.midRef(lastEnd, len);
-            newLength += len;
         }
 
         lastEnd = result.positionInFile + result.matchLength;
     }
 
     // 3. trailing string after the last match
-    if (copy.length() > lastEnd) {
-        chunks << copy.midRef(lastEnd);
-        newLength += copy.length() - lastEnd;
+    if (content.length() > lastEnd) {
+        chunks << content.midRef(lastEnd);
     }
 
+    return chunks;
+}
+
+void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QString& replacement)
+{
+    if (doc.results.isEmpty())
+        return;
+
+    const QString copy = content;
+    const QVector<QStringRef> chunks = replacementChunks(doc, copy, replacement);
+
+    int newLength = 0; // length of the new string, with all the replacements
+    for (const QStringRef &chunk : chunks)
+        newLength += chunk.length();
+
     // 4. assemble the chunks together
     content.resize(newLength);
     int i = 0;
@@ -112,35 +121,127 @@ void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QStr
     }
 }
 
+QPromise<bool> FileReplacer::replaceInEditor(EditorNS::Editor* editor, const DocResult& doc,
+                                             const QString& content, const QString& replacement)
+{
+    if (doc.results.isEmpty())
+        return QPromise<bool>::resolve(true);
+
+    if (doc.limitReached)
+        return QPromise<bool>::resolve(false);
+
+    const MatchResult& first = doc.results.first();
+    const MatchResult& last = doc.results.last();
+    const int from = first.positionInFile;
+    const int to = last.positionInFile + last.matchLength;
+
+    // Everything before the first and after the last match stays the same.
+    QString newContent = content;
+    replaceAll(doc, newContent, replacement);
+    const int newLength = newContent.length() - (content.length() - to) - from;
+
+    return editor->replaceTextRangeP(from, to, newContent.mid(from, newLength), content.length());
+}
+
+FileReplacer::FileReport FileReplacer::replaceInFile(const DocResult& doc, const QString& replacement)
+{
+    FileReport report;
+    report.fileName = doc.fileName;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (doc.limitReached) {
+        report.error = tr("Not all matches of this file were found because of the result limit.");
+        return report;
+    }
+
+    // Check that the file is still the one we searched. Size and mtime are cheap to compare, the content
+    // hash catches changes that happened within the mtime's granularity.
+    const SearchIndex::FileStamp stamp = SearchIndex::stampForFile(doc.fileName);
+    if (doc.fileSize != -1 && (stamp.size != doc.fileSize || stamp.lastModified != doc.fileLastModified)) {
+        report.error = tr("File has been modified since it was searched.");
+        return report;
+    }
+
+    QFile f(doc.fileName);
+    const DocEngine::DecodedText decodedText = DocEngine::readToString(&f);
+    if (decodedText.error) {
+        report.error = tr("File could not be read.");
+        return report;
+    }
+
+    if (!doc.contentHash.isEmpty() && DocResult::hashContent(decodedText.text) != doc.contentHash) {
+        report.error = tr("File has been modified since it was searched.");
+        return report;
+    }
+
+    // The new contents are streamed into a temporary file which is renamed over the original on commit(),
+    // so the original file stays intact if anything goes wrong. If the directory isn't writable we
+    // have to fall back to writing the file in place.
+    QSaveFile out(doc.fileName);
+    out.setDirectWriteFallback(true);
+    if (!out.open(QIODevice::WriteOnly)) {
+        report.error = tr("File could not be opened for writing.");
+        return report;
+    }
+
+    const QVector<QStringRef> chunks = replacementChunks(doc, decodedText.text, replacement);
+    const qint64 written = DocEngine::writeFromChunks(&out, chunks, decodedText.codec, decodedText.bom);
+
+    if (written == -1 || !out.commit()) {
+        report.error = tr("File could not be written.");
+        return report;
+    }
+
+    report.replacements = doc.results.size();
+    report.bytesWritten = written;
+    report.elapsedMs = timer.elapsed();
+    return report;
+}
+
 void FileReplacer::run()
 {
-    int count = 0;
+    const int total = m_searchResult.results.size();
 
-    for (const DocResult& docResult : m_searchResult.results) {
-        if(m_wantToStop)
-            return;
+    QVector<FileReport> reports(total);
+    QVector<bool> processed(total, false);
 
-        if (++count % 10 == 0)
-            emit resultProgress(count, m_searchResult.results.size());
+    // These are accessed concurrently. Don't detach the vectors while the workers are running.
+    FileReport* reportData = reports.data();
+    bool* processedData = processed.data();
+    const DocResult* docs = m_searchResult.results.constData();
 
-        if (docResult.results.isEmpty())
-            continue;
+    QAtomicInt finishedCount(0);
 
-        QFile f(docResult.fileName);
-        DocEngine::DecodedText decodedText;
+    QElapsedTimer timer;
+    timer.start();
 
-        decodedText = DocEngine::readToString(&f);
-        if (decodedText.error) {
-            m_failedFiles.push_back(docResult.fileName);
-            continue;
+    SearchHelpers::parallelFor(total, [&](int i) {
+        if (m_wantToStop)
+            return;
+
+        if (!docs[i].results.isEmpty()) {
+            reportData[i] = replaceInFile(docs[i], m_replacement);
+            processedData[i] = true;
         }
 
-        replaceAll(docResult, decodedText.text, m_replacement);
+        const int finished = finishedCount.fetchAndAddRelaxed(1) + 1;
+        if (finished % 10 == 0)
+            emit resultProgress(finished, total);
+    });
 
-        if (!DocEngine::writeFromString(&f, decodedText)) {
-            m_failedFiles.push_back(docResult.fileName);
+    m_elapsedMs = timer.elapsed();
+
+    m_reports.clear();
+    m_failedFiles.clear();
+    for (int i = 0; i < total; i++) {
+        if (!processed[i])
             continue;
-        }
+
+        m_reports.push_back(reports[i]);
+        if (reports[i].hasError())
+            m_failedFiles.push_back(reports[i].fileName);
     }
 
     emit resultReady();
@@ -1,12 +1,16 @@
 #include "include/Search/frmsearchreplace.h"
 
+#include "include/Search/filereplacer.h"
+#include "include/Search/searchengine.h"
 #include "include/Search/searchstring.h"
 #include "include/iconprovider.h"
 #include "include/nqqsettings.h"
 #include "ui_frmsearchreplace.h"
 
 #include <QCompleter>
+#include <QElapsedTimer>
 #include <QFileDialog>
+#include <QHideEvent>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QThread>
@@ -41,6 +45,19 @@ frmSearchReplace::frmSearchReplace(TopEditorContainer *topEditorContainer, QWidg
 
     connect(ui->actionAdvancedSearch, &QAction::triggered, this, &frmSearchReplace::toggleAdvancedSearch);
 
+    m_lblMatchCount = new QLabel(this);
+    m_lblMatchCount->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    ui->verticalLayout_4->insertWidget(1, m_lblMatchCount);
+
+    // Keep the highlighted matches in sync with the search string and options
+    connect(ui->cmbSearch, &QComboBox::currentTextChanged, this, &frmSearchReplace::updateHighlightAll);
+    connect(ui->chkMatchCase, &QCheckBox::toggled, this, &frmSearchReplace::updateHighlightAll);
+    connect(ui->chkMatchWholeWord, &QCheckBox::toggled, this, &frmSearchReplace::updateHighlightAll);
+    connect(ui->radSearchPlainText, &QRadioButton::toggled, this, &frmSearchReplace::updateHighlightAll);
+    connect(ui->radSearchWithRegex, &QRadioButton::toggled, this, &frmSearchReplace::updateHighlightAll);
+    connect(ui->radSearchWithSpecialChars, &QRadioButton::toggled, this, &frmSearchReplace::updateHighlightAll);
+    connect(m_topEditorContainer, &TopEditorContainer::currentEditorChanged, this, &frmSearchReplace::updateHighlightAll);
+
     ui->actionFind->setIcon(IconProvider::fromTheme("edit-find"));
     ui->actionReplace->setIcon(IconProvider::fromTheme("edit-find-replace"));
 
@@ -76,6 +93,12 @@ void frmSearchReplace::keyPressEvent(QKeyEvent *evt)
     }
 }
 
+void frmSearchReplace::hideEvent(QHideEvent *evt)
+{
+    clearHighlightAll();
+    QMainWindow::hideEvent(evt);
+}
+
 void frmSearchReplace::show(Tabs defaultTab)
 {
     setCurrentTab(defaultTab);
@@ -83,6 +106,7 @@ void frmSearchReplace::show(Tabs defaultTab)
     ui->cmbSearch->lineEdit()->selectAll();
     QMainWindow::show();
     manualSizeAdjust();
+    updateHighlightAll();
 }
 
 void frmSearchReplace::setSearchText(QString string)
@@ -164,29 +188,122 @@ void frmSearchReplace::replace(QString string, QString replacement, SearchHelper
     }
 }
 
-int frmSearchReplace::replaceAll(QString string, QString replacement, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions) {
-    QString rawSearch = SearchString::format(string, searchMode, searchOptions);
+QPromise<int> frmSearchReplace::replaceAll(QString string, QString replacement, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions) {
     if (searchMode == SearchHelpers::SearchMode::SpecialChars) {
             replacement = SearchString::unescape(replacement);
     }
 
+    // SearchString::format() builds a JavaScript regex for CodeMirror, which PCRE doesn't always
+    // understand (e.g. "\uXXXX"). Plain text searches are therefore done without a regex.
+    SearchConfig config;
+    config.searchString = string;
+    config.matchCase = searchOptions.MatchCase;
+    config.matchWord = searchOptions.MatchWholeWord;
+
+    switch (searchMode) {
+    case SearchHelpers::SearchMode::PlainText:
+        config.searchMode = SearchConfig::ModePlainText;
+        break;
+    case SearchHelpers::SearchMode::SpecialChars:
+        config.searchMode = SearchConfig::ModePlainTextSpecialChars;
+        break;
+    case SearchHelpers::SearchMode::Regex:
+        config.searchMode = SearchConfig::ModeRegex;
+        break;
+    }
+
+    if (config.searchMode == SearchConfig::ModeRegex) {
+        const QRegularExpression regex = SearchEngine::createRegexFromConfig(config);
+        if (!regex.isValid())
+            return QPromise<int>::reject(regex.errorString());
+    }
+
+    // Only regex searches support back references in the replacement, like in C_FUN_REPLACE.
+    const bool useBackReferences = searchMode == SearchHelpers::SearchMode::Regex;
+
+    // Doing the replacements in CodeMirror one by one would create one change, and one
+    // bridge notification, per match. Instead the new text is computed here and sent back
+    // as a single change.
+    // The editor might be closed before it answers.
+    QPointer<Editor> editor = currentEditor();
+    return editor->valueP().then([=](const QString& content) {
+        if (editor.isNull())
+            return QPromise<int>::resolve(-1);
+
+        const std::unique_ptr<SearchEngine> engine = SearchEngine::create(config);
+        DocResult doc = engine->search(content);
+        if (!useBackReferences)
+            doc.regexCaptureGroupCount = 0;
+
+        const int count = doc.results.size();
+        return FileReplacer::replaceInEditor(editor, doc, content, replacement)
+                .then([count](bool replaced) { return replaced ? count : -1; });
+    });
+}
+
+QPromise<int> frmSearchReplace::selectAll(QString string, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions) {
+    QString rawSearch = SearchString::format(string, searchMode, searchOptions);
+
     QList<QVariant> data = QList<QVariant>();
     data.append(rawSearch);
     data.append(regexModifiersFromSearchOptions(searchOptions));
-    data.append(replacement);
-		data.append(QString::number(static_cast<int>(searchMode)));
-    QVariant count = currentEditor()->asyncSendMessageWithResult("C_FUN_REPLACE_ALL", QVariant::fromValue(data)).get();
-    return count.toInt();
+    return currentEditor()->asyncSendMessageWithResultP("C_FUN_SEARCH_SELECT_ALL", QVariant::fromValue(data))
+            .then([](QVariant count) { return count.toInt(); });
 }
 
-int frmSearchReplace::selectAll(QString string, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions) {
-    QString rawSearch = SearchString::format(string, searchMode, searchOptions);
+void frmSearchReplace::updateHighlightAll()
+{
+    if (!isVisible())
+        return;
+
+    Editor *editor = currentEditor();
+    const QString string = ui->cmbSearch->currentText();
+
+    if (m_highlightedEditor != editor || string.isEmpty() ||
+            !NqqSettings::getInstance().Search.getHighlightAllMatches()) {
+        clearHighlightAll();
+    }
+
+    if (string.isEmpty() || !NqqSettings::getInstance().Search.getHighlightAllMatches())
+        return;
+
+    if (m_highlightedEditor != editor) {
+        m_highlightedEditor = editor;
+        connect(editor, &Editor::searchMatchCountChanged, this, &frmSearchReplace::on_searchMatchCountChanged);
+    }
+
+    SearchHelpers::SearchOptions searchOptions = searchOptionsFromUI();
 
     QList<QVariant> data = QList<QVariant>();
-    data.append(rawSearch);
+    data.append(SearchString::format(string, searchModeFromUI(), searchOptions));
     data.append(regexModifiersFromSearchOptions(searchOptions));
-    QVariant count = currentEditor()->asyncSendMessageWithResult("C_FUN_SEARCH_SELECT_ALL", QVariant::fromValue(data)).get();
-    return count.toInt();
+    editor->sendMessage("C_CMD_SEARCH_HIGHLIGHT_ALL", QVariant::fromValue(data));
+}
+
+void frmSearchReplace::clearHighlightAll()
+{
+    m_lblMatchCount->clear();
+
+    if (m_highlightedEditor.isNull())
+        return;
+
+    disconnect(m_highlightedEditor, &Editor::searchMatchCountChanged, this, &frmSearchReplace::on_searchMatchCountChanged);
+
+    QList<QVariant> data = QList<QVariant>();
+    data.append(QString());
+    data.append(QString());
+    m_highlightedEditor->sendMessage("C_CMD_SEARCH_HIGHLIGHT_ALL", QVariant::fromValue(data));
+    m_highlightedEditor = nullptr;
+}
+
+void frmSearchReplace::on_searchMatchCountChanged(int count, bool complete)
+{
+    if (count < 0)
+        m_lblMatchCount->clear();
+    else if (complete)
+        m_lblMatchCount->setText(tr("%n match(es)", "", count));
+    else
+        m_lblMatchCount->setText(tr("%n match(es) so far...", "", count));
 }
 
 SearchHelpers::SearchMode frmSearchReplace::searchModeFromUI()
@@ -267,31 +384,44 @@ void frmSearchReplace::on_btnReplacePrev_clicked()
 
 void frmSearchReplace::on_btnReplaceAll_clicked()
 {
-    int n = this->replaceAll(ui->cmbSearch->currentText(),
-                             ui->cmbReplace->currentText(),
-                             searchModeFromUI(),
-                             searchOptionsFromUI());
+    QElapsedTimer timer;
+    timer.start();
+
+    this->replaceAll(ui->cmbSearch->currentText(),
+                     ui->cmbReplace->currentText(),
+                     searchModeFromUI(),
+                     searchOptionsFromUI())
+            .then([this, timer](int n) {
+        if (n < 0) {
+            QMessageBox::warning(this, tr("Replace all"),
+                                 tr("The document was modified while replacing. Nothing has been replaced."));
+        } else {
+            QMessageBox::information(this, tr("Replace all"),
+                                     tr("%1 occurrences have been replaced in %2 ms.").arg(n).arg(timer.elapsed()));
+        }
+    }).fail([this](const QString& error) {
+        QMessageBox::warning(this, tr("Replace all"), tr("Invalid regular expression: %1").arg(error));
+    });
 
     addToSearchHistory(ui->cmbSearch->currentText());
     addToReplaceHistory(ui->cmbReplace->currentText());
-
-    QMessageBox::information(this, tr("Replace all"), tr("%1 occurrences have been replaced.").arg(n));
 }
 
 void frmSearchReplace::on_btnSelectAll_clicked()
 {
-    int count = this->selectAll(ui->cmbSearch->currentText(),
-                                searchModeFromUI(),
-                                searchOptionsFromUI());
+    this->selectAll(ui->cmbSearch->currentText(),
+                    searchModeFromUI(),
+                    searchOptionsFromUI())
+            .then([this](int count) {
+        if (count == 0) {
+            QMessageBox::information(this, tr("Select all"), tr("No results found"));
+        } else {
+            // Focus on main window
+            this->m_topEditorContainer->activateWindow();
+        }
+    });
 
     addToSearchHistory(ui->cmbSearch->currentText());
-
-    if (count == 0) {
-        QMessageBox::information(this, tr("Select all"), tr("No results found"));
-    } else {
-        // Focus on main window
-        this->m_topEditorContainer->activateWindow();
-    }
 }
 
 void frmSearchReplace::on_actionReplace_toggled(bool on)
@@ -0,0 +1,674 @@
+#include "include/Search/searchengine.h"
+
+#include "include/Search/searchstring.h"
+
+#include <QHash>
+#include <QRegularExpressionMatchIterator>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief matchesWholeWord Returns true if the substring at data.mid(index,matchLength) is a whole word.
+ *                         This means it's preceeded and followed by either a whitespace, symbol or punctuation.
+ */
+bool matchesWholeWord(int index, int matchLength, const QString &data)
+{
+    QChar boundary;
+
+    if (index != 0) {
+        boundary = data[index-1];
+        if (!boundary.isPunct() && !boundary.isSpace() && !boundary.isSymbol()) {
+            return false;
+        }
+    }
+    if (data.length() != index+matchLength) {
+        boundary = data[index+matchLength];
+        if (!boundary.isPunct() && !boundary.isSpace() && !boundary.isSymbol()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief getLinePositions Returns a vector with the positions of all line beginnings of the given string.
+ */
+std::vector<int> getLinePositions(const QString &data)
+{
+    const int dataSize = data.size();
+    std::vector<int> linePosition;
+
+    linePosition.push_back(0);
+
+    // Finds line-breaks in the string. Doesn't check the last char so the loop
+    // can be optimized.
+    for (int i = 0; i < dataSize-1; i++) {
+        if (data[i] == '\r' && data[i+1] == '\n') {
+            linePosition.push_back(i+2);
+            i++;
+        } else if (data[i] == '\r' || data[i] == '\n') {
+            linePosition.push_back(i+1);
+        }
+    }
+
+    // Check the last char manually
+    if (dataSize > 0 && (*data.end() == '\r' || *data.end() == '\n'))
+        linePosition.push_back(dataSize);
+
+
+    linePosition.push_back(dataSize);
+    return linePosition;
+}
+
+/**
+ * @brief extractRegexLiteral Returns the longest run of literal characters that every match of the
+ *                            regex pattern has to contain. This is a conservative approximation: anything
+ *                            inside groups, character classes or optional items is ignored, and patterns
+ *                            containing alternations, \Q...\E quoting or the extended (?x) syntax don't yield
+ *                            any literal at all. Extraction stops at the first escape that isn't escaped punctuation.
+ */
+QString extractRegexLiteral(const QString& pattern)
+{
+    if (pattern.contains('|'))
+        return QString();
+
+    const int len = pattern.length();
+
+    // Inside \Q...\E and under (?x), which ignores whitespace and comments, telling literal characters
+    // apart would need a full parser.
+    for (int i = 0; i < len; i++) {
+        if (pattern[i] == '\\') {
+            if (++i < len && pattern[i] == 'Q')
+                return QString();
+        } else if (pattern[i] == '(' && i+1 < len && pattern[i+1] == '?') {
+            // Inline options such as (?x), (?ix) or (?i-x:...)
+            for (int j = i+2; j < len && (pattern[j].isLetter() || pattern[j] == '-' || pattern[j] == '^'); j++) {
+                if (pattern[j] == 'x')
+                    return QString();
+            }
+        }
+    }
+
+    QString best;
+    QString current;
+    auto endRun = [&]() {
+        if (current.length() > best.length())
+            best = current;
+        current.clear();
+    };
+
+    auto isOptionalAt = [&](int pos) {
+        if (pos >= len) return false;
+        const QChar q = pattern[pos];
+        return q == '?' || q == '*' || q == '{';
+    };
+
+    for (int i = 0; i < len; i++) {
+        const QChar c = pattern[i];
+
+        if (c == '\\') {
+            if (i+1 >= len)
+                break;
+            const QChar escaped = pattern[++i];
+            // Escaped letters and digits are character classes, assertions, back references or character
+            // codes like \x41, \cA and \101. Some of them consume a varying number of the following
+            // characters, so nothing after them can be trusted to be literal.
+            if (escaped.isLetterOrNumber())
+                break;
+            if (isOptionalAt(i+1)) {
+                endRun();
+                continue;
+            }
+            current += escaped;
+            if (i+1 < len && pattern[i+1] == '+')
+                endRun();
+            continue;
+        }
+
+        if (c == '[') {
+            // Skip the whole character class. A ']' right at the start is a literal.
+            int j = i+1;
+            if (j < len && pattern[j] == '^') j++;
+            if (j < len && pattern[j] == ']') j++;
+            for (; j < len && pattern[j] != ']'; j++) {
+                if (pattern[j] == '\\') j++;
+            }
+            i = j;
+            endRun();
+            continue;
+        }
+
+        if (c == '(') {
+            // Skip the whole group, including nested groups.
+            int depth = 1;
+            int j = i+1;
+            for (; j < len && depth > 0; j++) {
+                if (pattern[j] == '\\') j++;
+                else if (pattern[j] == '(') depth++;
+                else if (pattern[j] == ')') depth--;
+            }
+            i = j-1;
+            endRun();
+            continue;
+        }
+
+        if (c == '{') {
+            // Skip quantifier contents so the digits don't end up as literals.
+            while (i < len && pattern[i] != '}') i++;
+            endRun();
+            continue;
+        }
+
+        if (c == '^' || c == '$' || c == '.' || c == ')' || c == '?' || c == '*' || c == '+' || c == '}') {
+            endRun();
+            continue;
+        }
+
+        if (isOptionalAt(i+1)) {
+            endRun();
+            continue;
+        }
+
+        current += c;
+        if (i+1 < len && pattern[i+1] == '+')
+            endRun();
+    }
+    endRun();
+
+    return best;
+}
+
+/**
+ * @brief The DocResultBuilder class collects the MatchResults of a single document. Every line that contains
+ *        a match is copied into the DocResult's line pool only once, no matter how many matches it contains.
+ *        This keeps memory usage proportional to the number of matched lines instead of the number of matches.
+ */
+class DocResultBuilder {
+public:
+    DocResultBuilder(const QString& content, int maxResults)
+        : m_content(content),
+          m_linePosition(getLinePositions(content)),
+          m_maxResults(maxResults)
+    { }
+
+    /**
+     * @brief isFull Returns true if the maximum number of results has been reached. When this is the case,
+     *               the caller should call setLimitReached() if there are more matches and stop searching.
+     */
+    bool isFull() const { return m_maxResults > 0 && m_result.results.size() >= m_maxResults; }
+
+    void setLimitReached() { m_result.limitReached = true; }
+
+    MatchResult& addMatch(int offset, int length)
+    {
+        // std::upper_bound returns an iterator to the first item greater than 'offset'. This is the line after the match.
+        // Substract 1 to get the line the match is on.
+        const auto it = std::upper_bound(m_linePosition.begin(), m_linePosition.end(), offset);
+        const int line = std::distance(m_linePosition.begin(), it);
+        const int lineStart = m_linePosition[line-1];
+
+        if (line != m_lastLine) {
+            // Only store the line without trailing whitespace and line breaks
+            int lineEnd = m_linePosition[line];
+            while (lineEnd > lineStart && m_content[lineEnd-1].isSpace())
+                lineEnd--;
+
+            m_lastLine = line;
+            m_lastLineOffset = m_linePool.length();
+            m_lastLineLength = lineEnd - lineStart;
+            m_linePool.append(m_content.midRef(lineStart, m_lastLineLength));
+        }
+
+        MatchResult result;
+        result.lineOffset = m_lastLineOffset;
+        result.lineLength = m_lastLineLength;
+        result.lineNumber = line;
+        result.positionInFile = offset;
+        result.positionInLine = offset - lineStart;
+        result.matchLength = length;
+        m_result.results.push_back(result);
+
+        return m_result.results.last();
+    }
+
+    /**
+     * @brief finish Returns the finished DocResult. All MatchResults share the same line pool.
+     */
+    DocResult finish()
+    {
+        m_linePool.squeeze();
+        for (MatchResult& result : m_result.results)
+            result.linePool = m_linePool;
+        m_result.results.squeeze();
+        return std::move(m_result);
+    }
+
+private:
+    const QString& m_content;
+    const std::vector<int> m_linePosition;
+    const int m_maxResults;
+
+    DocResult m_result;
+    QString m_linePool;
+    int m_lastLine = -1;
+    int m_lastLineOffset = 0;
+    int m_lastLineLength = 0;
+};
+
+class PlainTextSearchEngine : public SearchEngine {
+public:
+    PlainTextSearchEngine(const SearchConfig& config)
+        // The search itself is as fast as any prefilter could be, so don't use one.
+        : SearchEngine(EnginePlainText, QString(), Qt::CaseInsensitive),
+          m_searchString(config.searchMode == SearchConfig::ModePlainTextSpecialChars ?
+                             SearchString::unescape(config.searchString) : config.searchString),
+          m_caseSense(config.matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive),
+          m_matchWord(config.matchWord)
+    { }
+
+    DocResult search(const QString& content, int maxResults) const override
+    {
+        DocResultBuilder builder(content, maxResults);
+
+        const int matchLength = m_searchString.length();
+        int offset = 0;
+
+        while ((offset = content.indexOf(m_searchString, offset, m_caseSense)) != -1) {
+            if (m_matchWord && !matchesWholeWord(offset, matchLength, content)) {
+                offset += matchLength;
+                continue;
+            }
+
+            if (builder.isFull()) {
+                builder.setLimitReached();
+                break;
+            }
+
+            builder.addMatch(offset, matchLength);
+
+            offset += matchLength;
+        }
+
+        return builder.finish();
+    }
+
+private:
+    const QString m_searchString;
+    const Qt::CaseSensitivity m_caseSense;
+    const bool m_matchWord;
+};
+
+class RegexSearchEngine : public SearchEngine {
+public:
+    RegexSearchEngine(const SearchConfig& config, EngineType type)
+        : SearchEngine(type,
+                       type == EngineRegexJit ? extractRegexLiteral(config.searchString) : QString(),
+                       // Inline options such as (?i) could change case sensitivity of the literal
+                       config.matchCase && !config.searchString.contains("(?") ?
+                           Qt::CaseSensitive : Qt::CaseInsensitive),
+          m_regex(createRegexFromConfig(config))
+    {
+        // Compiles the pattern right away using PCRE2's JIT instead of waiting for the usage threshold.
+        if (type == EngineRegexJit)
+            m_regex.optimize();
+    }
+
+    DocResult search(const QString& content, int maxResults) const override
+    {
+        DocResultBuilder builder(content, maxResults);
+        const int captureCount = m_regex.captureCount();
+
+        auto addMatch = [&](const QRegularExpressionMatch& match) {
+            MatchResult& result = builder.addMatch(match.capturedStart(), match.capturedLength());
+
+            // Only keep the spans of the capture groups. Keeping the QRegularExpressionMatch would keep
+            // a reference to the whole subject string.
+            if (captureCount > 0) {
+                result.captureSpans.resize(captureCount);
+                for (int i = 1; i <= captureCount; i++)
+                    result.captureSpans[i-1] = MatchResult::CaptureSpan{ match.capturedStart(i), match.capturedLength(i) };
+            }
+        };
+
+        if (engineType() == EngineRegexJit) {
+            // globalMatch() sets up the match data only once for the whole iteration.
+            QRegularExpressionMatchIterator it = m_regex.globalMatch(content);
+            while (it.hasNext()) {
+                const QRegularExpressionMatch match = it.next();
+
+                if (builder.isFull()) {
+                    builder.setLimitReached();
+                    break;
+                }
+
+                addMatch(match);
+            }
+        } else {
+            int offset = 0;
+            for (;;) {
+                const QRegularExpressionMatch match = m_regex.match(content, offset);
+
+                if (!match.hasMatch())
+                    break;
+
+                if (builder.isFull()) {
+                    builder.setLimitReached();
+                    break;
+                }
+
+                addMatch(match);
+
+                // Advance at least by one to avoit infinite loops when capturing
+                // empty expressions.
+                offset = match.capturedStart() + std::max(1, match.capturedLength());
+            }
+        }
+
+        DocResult results = builder.finish();
+        results.regexCaptureGroupCount = captureCount;
+
+        return results;
+    }
+
+private:
+    QRegularExpression m_regex;
+};
+
+/**
+ * @brief The MultiPatternSearchEngine class searches for any of a list of literal patterns in a single pass
+ *        using an Aho-Corasick automaton. The automaton is compiled into a DFA over a compact alphabet that
+ *        only contains the characters used by the patterns, so scanning a document costs one table lookup
+ *        per character regardless of the number of patterns.
+ *        Matches are reported leftmost-longest and never overlap, so they can be used for replacing.
+ */
+class MultiPatternSearchEngine : public SearchEngine {
+public:
+    MultiPatternSearchEngine(const SearchConfig& config)
+        : SearchEngine(EngineMultiPattern, QString(), Qt::CaseInsensitive),
+          m_caseSense(config.matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive),
+          m_matchWord(config.matchWord)
+    {
+        buildAutomaton(config.getPatternList());
+    }
+
+    DocResult search(const QString& content, int maxResults) const override
+    {
+        struct Candidate {
+            int start;
+            int length;
+            int pattern;
+        };
+
+        DocResultBuilder builder(content, maxResults);
+        if (m_patternLengths.empty())
+            return builder.finish();
+
+        // Matches are picked leftmost-longest while scanning. Every match is a candidate, including the
+        // shorter ones reachable through dictionary links: a shorter match can be the one that's picked if
+        // the longer one ending at the same position overlaps an earlier match. A candidate is final once
+        // no match found later can start at or before it, so only the last few characters' worth of
+        // candidates are kept.
+        std::vector<Candidate> pending;
+        int lastEnd = 0;
+        bool full = false;
+
+        // Adds the leftmost-longest pending candidate to the result if it starts before 'limit'.
+        auto pickBefore = [&](int limit) {
+            auto best = pending.end();
+            for (auto it = pending.begin(); it != pending.end(); ++it) {
+                if (best == pending.end() || it->start < best->start ||
+                        (it->start == best->start && it->length > best->length))
+                    best = it;
+            }
+
+            if (best == pending.end() || best->start >= limit)
+                return false;
+
+            if (builder.isFull()) {
+                builder.setLimitReached();
+                full = true;
+                return false;
+            }
+
+            builder.addMatch(best->start, best->length).patternIndex = best->pattern;
+            lastEnd = best->start + best->length;
+            pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                         [lastEnd](const Candidate& c) { return c.start < lastEnd; }),
+                          pending.end());
+            return true;
+        };
+
+        const QChar* data = content.constData();
+        const int size = content.size();
+        int state = 0;
+
+        for (int i = 0; i < size; i++) {
+            // Fast path: in the root state, skip ASCII characters that can't start a pattern.
+            if (state == 0) {
+                while (i < size && data[i].unicode() < 128 && m_asciiClass[data[i].unicode()] == 0)
+                    i++;
+                if (i == size)
+                    break;
+            }
+
+            state = m_delta[state * m_alphabetSize + charClass(data[i].unicode())];
+
+            for (int s = m_terminal[state] >= 0 ? state : m_dictLink[state]; s != -1; s = m_dictLink[s]) {
+                const int pattern = m_terminal[s];
+                const int length = m_patternLengths[pattern];
+                const int start = i + 1 - length;
+                if (start < lastEnd || (m_matchWord && !matchesWholeWord(start, length, content)))
+                    continue;
+                pending.push_back(Candidate{ start, length, pattern });
+            }
+
+            // Matches found later start at i + 2 - m_maxPatternLength or after.
+            while (pickBefore(i + 2 - m_maxPatternLength)) { }
+            if (full)
+                break;
+        }
+
+        while (!full && pickBefore(size)) { }
+
+        return builder.finish();
+    }
+
+private:
+    ushort fold(ushort c) const
+    {
+        return m_caseSense == Qt::CaseSensitive ? c : QChar(c).toCaseFolded().unicode();
+    }
+
+    /**
+     * @brief charClass Returns the alphabet index of the given character. 0 means that it appears in no pattern.
+     */
+    int charClass(ushort c) const
+    {
+        if (c < 128)
+            return m_asciiClass[c];
+        // Some characters, like the Kelvin sign, fold to ASCII characters
+        const ushort folded = fold(c);
+        if (folded < 128)
+            return m_asciiClass[folded];
+        const auto it = m_charClass.constFind(folded);
+        return it != m_charClass.constEnd() ? it.value() : 0;
+    }
+
+    void buildAutomaton(const QStringList& patterns)
+    {
+        std::fill(std::begin(m_asciiClass), std::end(m_asciiClass), 0);
+
+        // Assign an alphabet index to every distinct (folded) character.
+        m_alphabetSize = 1;
+        for (const QString& pattern : patterns) {
+            for (const QChar ch : pattern) {
+                const ushort c = fold(ch.unicode());
+                if (charClass(c) != 0)
+                    continue;
+                if (c < 128) {
+                    m_asciiClass[c] = m_alphabetSize;
+                    // Case-insensitive ASCII lookups don't need to fold
+                    if (m_caseSense == Qt::CaseInsensitive && QChar(c).isLetter())
+                        m_asciiClass[QChar(c).toUpper().unicode()] = m_alphabetSize;
+                } else {
+                    m_charClass.insert(c, m_alphabetSize);
+                }
+                m_alphabetSize++;
+            }
+        }
+
+        // Build the trie. Missing transitions are -1 for now.
+        auto addState = [this]() {
+            m_delta.insert(m_delta.end(), m_alphabetSize, -1);
+            m_terminal.push_back(-1);
+            return static_cast<int>(m_terminal.size()) - 1;
+        };
+        addState();
+
+        for (const QString& pattern : patterns) {
+            const int index = static_cast<int>(m_patternLengths.size());
+            m_patternLengths.push_back(pattern.length());
+            m_maxPatternLength = std::max(m_maxPatternLength, pattern.length());
+
+            int state = 0;
+            for (const QChar ch : pattern) {
+                const int cls = charClass(fold(ch.unicode()));
+                int next = m_delta[state * m_alphabetSize + cls];
+                if (next == -1) {
+                    next = addState();
+                    m_delta[state * m_alphabetSize + cls] = next;
+                }
+                state = next;
+            }
+            // If a pattern appears twice, the first one is reported
+            if (m_terminal[state] == -1)
+                m_terminal[state] = index;
+        }
+
+        // Compute failure links breadth-first and turn the trie into a DFA.
+        const int numStates = static_cast<int>(m_terminal.size());
+        std::vector<int> fail(numStates, 0);
+        m_dictLink.assign(numStates, -1);
+
+        std::vector<int> queue;
+        queue.reserve(numStates);
+        for (int cls = 0; cls < m_alphabetSize; cls++) {
+            int& next = m_delta[cls];
+            if (next == -1) {
+                next = 0;
+            } else {
+                fail[next] = 0;
+                queue.push_back(next);
+            }
+        }
+
+        for (size_t q = 0; q < queue.size(); q++) {
+            const int state = queue[q];
+            const int failState = fail[state];
+            m_dictLink[state] = m_terminal[failState] >= 0 ? failState : m_dictLink[failState];
+
+            for (int cls = 0; cls < m_alphabetSize; cls++) {
+                int& next = m_delta[state * m_alphabetSize + cls];
+                if (next == -1) {
+                    next = m_delta[failState * m_alphabetSize + cls];
+                } else {
+                    fail[next] = m_delta[failState * m_alphabetSize + cls];
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    const Qt::CaseSensitivity m_caseSense;
+    const bool m_matchWord;
+
+    int m_asciiClass[128];
+    QHash<ushort, int> m_charClass;     // Alphabet indices of non-ASCII characters
+    int m_alphabetSize = 1;
+
+    std::vector<int> m_delta;           // Transition table, m_alphabetSize entries per state
+    std::vector<int> m_terminal;        // Index of the pattern that ends in a state, or -1
+    std::vector<int> m_dictLink;        // Nearest state on the failure chain that is terminal, or -1
+    std::vector<int> m_patternLengths;
+    int m_maxPatternLength = 0;
+};
+
+} // namespace
+
+SearchEngine::SearchEngine(EngineType type, const QString& literal, Qt::CaseSensitivity literalCaseSense)
+    : m_type(type),
+      m_literal(literal),
+      m_literalCaseSense(literalCaseSense)
+{ }
+
+std::unique_ptr<SearchEngine> SearchEngine::create(const SearchConfig& config)
+{
+    switch (config.searchMode) {
+    case SearchConfig::ModeRegex:
+        return create(config, EngineRegexJit);
+    case SearchConfig::ModeMultiPattern:
+        return create(config, EngineMultiPattern);
+    default:
+        return create(config, EnginePlainText);
+    }
+}
+
+std::unique_ptr<SearchEngine> SearchEngine::create(const SearchConfig& config, EngineType type)
+{
+    switch (type) {
+    case EnginePlainText:
+        return std::unique_ptr<SearchEngine>(new PlainTextSearchEngine(config));
+    case EngineRegex:
+    case EngineRegexJit:
+        return std::unique_ptr<SearchEngine>(new RegexSearchEngine(config, type));
+    case EngineMultiPattern:
+        return std::unique_ptr<SearchEngine>(new MultiPatternSearchEngine(config));
+    }
+
+    return nullptr;
+}
+
+QRegularExpression SearchEngine::createRegexFromConfig(const SearchConfig& config)
+{
+    QRegularExpression regex;
+
+    const QFlags<QRegularExpression::PatternOption> options = config.matchCase ?
+                QRegularExpression::MultilineOption :
+                QRegularExpression::MultilineOption | QRegularExpression::CaseInsensitiveOption;
+
+    const QString regexString = config.matchWord ?
+                "\\b" + config.searchString + "\\b" : config.searchString;
+
+    regex.setPattern(regexString);
+    regex.setPatternOptions(options);
+
+    return regex;
+}
+
+QString SearchEngine::requiredLiteral(const SearchConfig& config)
+{
+    switch (config.searchMode) {
+    case SearchConfig::ModePlainText:
+        return config.searchString;
+    case SearchConfig::ModePlainTextSpecialChars:
+        return SearchString::unescape(config.searchString);
+    case SearchConfig::ModeRegex:
+        return extractRegexLiteral(config.searchString);
+    case SearchConfig::ModeMultiPattern: {
+        // Files only need to contain one of the patterns, so there is no common literal unless there's a single one
+        const QStringList patterns = config.getPatternList();
+        return patterns.size() == 1 ? patterns.first() : QString();
+    }
+    }
+
+    return QString();
+}
+
+bool SearchEngine::mightMatch(const QString& content) const
+{
+    return m_literal.isEmpty() || content.contains(m_literal, m_literalCaseSense);
+}
@@ -0,0 +1,206 @@
+#include "include/Search/searchindex.h"
+
+#include "include/Sessions/persistentcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace {
+    // Increase whenever the on-disk format changes. Indices with a different version are discarded.
+    const quint32 INDEX_MAGIC = 0x4E514958; // "NQIX"
+    const quint32 INDEX_VERSION = 1;
+
+    QHash<QString, QWeakPointer<SearchIndex>>& indexRegistry()
+    {
+        static QHash<QString, QWeakPointer<SearchIndex>> registry;
+        return registry;
+    }
+}
+
+SearchIndex::SearchIndex(const QString& rootDirectory)
+    : m_rootDirectory(rootDirectory)
+{ }
+
+QSharedPointer<SearchIndex> SearchIndex::forDirectory(const QString& rootDirectory)
+{
+    static QMutex registryMutex;
+    QMutexLocker locker(&registryMutex);
+
+    auto& registry = indexRegistry();
+    QSharedPointer<SearchIndex> index = registry.value(rootDirectory).toStrongRef();
+
+    if (!index) {
+        index = QSharedPointer<SearchIndex>(new SearchIndex(rootDirectory));
+        index->load();
+        registry.insert(rootDirectory, index);
+    }
+
+    // Keep the most recently used index alive so that repeated searches don't hit the disk.
+    static QSharedPointer<SearchIndex> lastUsed;
+    lastUsed = index;
+
+    return index;
+}
+
+SearchIndex::FileStamp SearchIndex::stampForFile(const QString& filePath)
+{
+    FileStamp stamp;
+
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(filePath).constData(), &st) == 0) {
+        stamp.size = st.st_size;
+#ifdef Q_OS_LINUX
+        stamp.lastModified = static_cast<qint64>(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#else
+        stamp.lastModified = static_cast<qint64>(st.st_mtime) * 1000;
+#endif
+        stamp.inode = st.st_ino;
+    }
+#else
+    const QFileInfo info(filePath);
+    if (info.exists()) {
+        stamp.size = info.size();
+        stamp.lastModified = info.lastModified().toMSecsSinceEpoch();
+    }
+#endif
+
+    return stamp;
+}
+
+QVector<quint32> SearchIndex::trigramsForString(const QString& str)
+{
+    QVector<quint32> trigrams;
+    const QString folded = str.toCaseFolded();
+    const int length = folded.length();
+
+    if (length < 3)
+        return trigrams;
+
+    trigrams.reserve(length-2);
+    const QChar* data = folded.constData();
+    for (int i = 0; i < length-2; i++) {
+        // Collisions only cause false positives, which are filtered out by the actual search.
+        const quint32 trigram = (quint32(data[i].unicode()) << 20) ^
+                                (quint32(data[i+1].unicode()) << 10) ^
+                                quint32(data[i+2].unicode());
+        trigrams.append(trigram);
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    trigrams.squeeze();
+
+    return trigrams;
+}
+
+bool SearchIndex::isUpToDate(const QString& filePath, const FileStamp& stamp) const
+{
+    auto it = m_entries.constFind(filePath);
+    return it != m_entries.constEnd() && it->stamp == stamp;
+}
+
+bool SearchIndex::mayContain(const QString& filePath, const QVector<quint32>& queryTrigrams) const
+{
+    auto it = m_entries.constFind(filePath);
+    if (it == m_entries.constEnd())
+        return true;
+
+    const QVector<quint32>& fileTrigrams = it->trigrams;
+    return std::all_of(queryTrigrams.begin(), queryTrigrams.end(), [&fileTrigrams](quint32 trigram) {
+        return std::binary_search(fileTrigrams.begin(), fileTrigrams.end(), trigram);
+    });
+}
+
+void SearchIndex::updateFile(const QString& filePath, const FileStamp& stamp, const QString& content)
+{
+    Entry& entry = m_entries[filePath];
+    entry.stamp = stamp;
+    entry.trigrams = trigramsForString(content);
+    m_modified = true;
+}
+
+QString SearchIndex::indexFilePath() const
+{
+    const QByteArray hash = QCryptographicHash::hash(m_rootDirectory.toUtf8(), QCryptographicHash::Sha1);
+    return PersistentCache::searchIndexDirPath() + "/" + QString::fromLatin1(hash.toHex()) + ".idx";
+}
+
+bool SearchIndex::load()
+{
+    QFile file(indexFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    quint32 magic, version;
+    QString root;
+    stream >> magic >> version >> root;
+
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION || root != m_rootDirectory)
+        return false;
+
+    qint32 count = 0;
+    stream >> count;
+
+    QHash<QString, Entry> entries;
+    entries.reserve(count);
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        QString path;
+        Entry entry;
+        stream >> path >> entry.stamp.size >> entry.stamp.lastModified >> entry.stamp.inode >> entry.trigrams;
+        entries.insert(path, entry);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    m_entries = std::move(entries);
+    return true;
+}
+
+bool SearchIndex::save()
+{
+    // Forget about files that have been deleted since they were indexed.
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!QFileInfo::exists(it.key())) {
+            it = m_entries.erase(it);
+            m_modified = true;
+        } else {
+            ++it;
+        }
+    }
+
+    if (!m_modified)
+        return true;
+
+    QDir().mkpath(PersistentCache::searchIndexDirPath());
+
+    QSaveFile file(indexFilePath());
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream << INDEX_MAGIC << INDEX_VERSION << m_rootDirectory << qint32(m_entries.size());
+
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const Entry& entry = it.value();
+        stream << it.key() << entry.stamp.size << entry.stamp.lastModified << entry.stamp.inode << entry.trigrams;
+    }
+
+    if (stream.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    m_modified = false;
+    return true;
+}
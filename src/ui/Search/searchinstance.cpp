@@ -23,9 +23,10 @@ QString getFormattedLocationText(const DocResult& docResult, const QString& sear
     const QString relativePath = docResult.fileName.startsWith(searchLocation) ?
                 docResult.fileName.mid(commonPathLength) : docResult.fileName;
 
+    // A '+' after the number indicates that the result limit was reached and there are more matches
     return QString("<span style='white-space:pre-wrap;'>" +
                    QObject::tr("<b>%1</b> Results for:   '<b>%2</b>'")
-                   .arg(docResult.results.size(), 4) // Pad the number so all rows line up nicely.
+                   .arg(QString::number(docResult.results.size()) + (docResult.limitReached ? "+" : " "), 5)
                    .arg(relativePath.toHtmlEscaped())
                    + "</span>");
 }
@@ -127,7 +128,7 @@ SearchInstance::SearchInstance(const SearchConfig& config)
         auto* item = treeWidget->currentItem();
         auto it = m_resultMap.find(item);
         if (it != m_resultMap.end())
-            QApplication::clipboard()->setText( m_resultMap.at(it->first)->matchLineString );
+            QApplication::clipboard()->setText( m_resultMap.at(it->first)->getMatchLineString() );
     });
 
     m_actionOpenDocument = new QAction(tr("Open Document"), m_contextMenu);
@@ -186,50 +187,23 @@ SearchInstance::SearchInstance(const SearchConfig& config)
         m_contextMenu->exec( localPos );
     });
 
-    // If we're searching through documents we'll just do the search right now. File System searches are
-    // delegated to a FileSearcher instance because they can take a while to finish.
+    QTreeWidgetItem* toplevelitem = new QTreeWidgetItem(treeWidget);
+    toplevelitem->setText(0, tr("Calculating..."));
+
+    // Both document and file system searches run asynchronously. Documents are searched by a DocumentSearcher
+    // that works on snapshots of the editors' contents, files are searched by a FileSearcher.
     if (config.searchScope == SearchConfig::ScopeCurrentDocument ||
             config.searchScope == SearchConfig::ScopeAllOpenDocuments) {
+        m_documentSearcher = DocumentSearcher::prepareAsyncSearch(config);
+        connect(m_documentSearcher, &DocumentSearcher::resultProgress, this, &SearchInstance::onSearchProgress);
+        connect(m_documentSearcher, &DocumentSearcher::resultReady, this, &SearchInstance::onSearchCompleted);
+        connect(m_documentSearcher, &DocumentSearcher::finished, m_documentSearcher, &DocumentSearcher::deleteLater);
+        connect(m_documentSearcher, &DocumentSearcher::finished, this, [this]() {
+            m_documentSearcher = nullptr;
+        });
 
-        // This is a mess because Nqq's Editor management is a mess.
-        // We'll grab all Editors that want to be searched, then search them one-by-one and add the results
-        // to our SearchResult instance.
-        std::vector<Editor*> editorsToSearch;
-
-        MainWindow* mw = config.targetWindow;
-        TopEditorContainer* tec = mw->topEditorContainer();
-
-        if (config.searchScope == SearchConfig::ScopeCurrentDocument)
-            editorsToSearch.push_back( mw->currentEditor() );
-        else
-            editorsToSearch = tec->getOpenEditors();
-
-        if (config.searchMode == SearchConfig::ModePlainText ||
-            config.searchMode == SearchConfig::ModePlainTextSpecialChars) {
-            for(Editor* ed : editorsToSearch) {
-                DocResult dr = FileSearcher::searchPlainText(config, ed->value());
-                dr.docType = DocResult::TypeDocument;
-                dr.fileName = tec->tabWidgetFromEditor(ed)->tabTextFromEditor(ed);
-                dr.editor = ed;
-                if (!dr.results.empty())
-                    m_searchResult.results.push_back(dr);
-            }
-        } else if (config.searchMode == SearchConfig::ModeRegex) {
-            QRegularExpression regex = FileSearcher::createRegexFromConfig(config);
-            for(Editor* ed : editorsToSearch) {
-                DocResult dr = FileSearcher::searchRegExp(regex, ed->value());
-                dr.docType = DocResult::TypeDocument;
-                dr.fileName = tec->tabWidgetFromEditor(ed)->tabTextFromEditor(ed);
-                dr.editor = ed;
-                if (!dr.results.empty())
-                    m_searchResult.results.push_back(dr);
-            }
-        }
-        onSearchCompleted();
+        m_documentSearcher->startAsync();
     } else if (config.searchScope == SearchConfig::ScopeFileSystem) {
-        QTreeWidgetItem* toplevelitem = new QTreeWidgetItem(treeWidget);
-        toplevelitem->setText(0, tr("Calculating..."));
-
         m_fileSearcher = FileSearcher::prepareAsyncSearch(config);
         connect(m_fileSearcher, &FileSearcher::resultProgress, this, &SearchInstance::onSearchProgress);
         connect(m_fileSearcher, &FileSearcher::resultReady, this, &SearchInstance::onSearchCompleted);
@@ -245,13 +219,15 @@ SearchInstance::SearchInstance(const SearchConfig& config)
 
 SearchInstance::~SearchInstance()
 {
-    // After canceling, m_fileSearcher is deleted through a signal connected in SearchInstance's constructor
+    // After canceling, the searchers are deleted through a signal connected in SearchInstance's constructor
     if (m_fileSearcher) m_fileSearcher->cancel();
+    if (m_documentSearcher) m_documentSearcher->cancel();
 }
 
 SearchResult SearchInstance::getFilteredSearchResult() const
 {
     SearchResult result;
+    result.limitReached = m_searchResult.limitReached;
 
     const QTreeWidget* tree = getResultTreeWidget();
     for (int i=0; i<tree->topLevelItemCount(); i++) {
@@ -373,7 +349,7 @@ void SearchInstance::copySelectedLinesToClipboard() const
             QTreeWidgetItem* it = tree->topLevelItem(i)->child(c);
 
             if (it->checkState(0) == Qt::Checked)
-                cp += m_resultMap.at(it)->matchLineString + '\n';
+                cp += m_resultMap.at(it)->getMatchLineString() + '\n';
         }
     }
 
@@ -392,10 +368,27 @@ void SearchInstance::onSearchCompleted()
 {
     m_isSearchInProgress = false;
 
-    // m_fileSearcher is only instantiated when we've done a filesystem search. If so, get the results
-    // from there. Otherwise all search results were already added to m_searchResult
+    // Only one of the searchers is instantiated, depending on the search scope.
     if (m_fileSearcher) {
         m_searchResult = std::move(m_fileSearcher->getResult());
+
+        // Show how much work the ignore rules, binary detection and search index saved
+        const FileSearcher::Statistics& stats = m_fileSearcher->getStatistics();
+        QString statsText = tr("%1 files visited, %2 skipped, %3 directories pruned, %4 KiB read")
+                            .arg(stats.filesVisited)
+                            .arg(stats.filesSkipped())
+                            .arg(stats.dirsPruned)
+                            .arg(stats.bytesRead / 1024);
+        if (stats.cacheHits + stats.cacheMisses > 0)
+            statsText += ", " + tr("%1% cache hits").arg(qRound(stats.cacheHitRatio() * 100));
+        m_treeWidget->setHeaderLabel(m_treeWidget->headerItem()->text(0) + " (" + statsText + ")");
+    } else if (m_documentSearcher) {
+        m_searchResult = std::move(m_documentSearcher->getResult());
+    }
+
+    if (m_searchResult.limitReached) {
+        m_treeWidget->setHeaderLabel(m_treeWidget->headerItem()->text(0) + " " +
+                                     tr("(Result limit reached, not all matches are shown)"));
     }
 
     m_treeWidget->clear();
@@ -1,5 +1,10 @@
 #include "include/Search/searchobjects.h"
 
+#include <QCryptographicHash>
+#include <QRegularExpression>
+
+const int MatchResult::CUTOFF_LENGTH = 60;
+
 void SearchConfig::setScopeFromInt(int scopeAsInt) {
     if (scopeAsInt>0 && scopeAsInt<3)
         searchScope = static_cast<SearchScope>(scopeAsInt);
@@ -14,28 +19,60 @@ QString SearchConfig::getScopeAsString() const {
     }
 }
 
+QStringList SearchConfig::getPatternList() const {
+    return searchString.split(QRegularExpression("\\s+"), QString::SkipEmptyParts);
+}
+
+QString MatchResult::getMatchLineString() const {
+    return linePool.mid(lineOffset, lineLength);
+}
+
 QString MatchResult::getMatchString() const {
-    return matchLineString.mid(positionInLine, matchLength);
+    return linePool.midRef(lineOffset, lineLength).mid(positionInLine, matchLength).toString();
 }
 
 QString MatchResult::getPreMatchString(bool fullText) const {
+    const QStringRef matchLine = linePool.midRef(lineOffset, lineLength);
     const int pos = positionInLine;
 
     // Cut off part of the text if it is too long and the caller did not request full text
     if (!fullText && pos > CUTOFF_LENGTH)
-        return "..." + matchLineString.mid( std::max(0, pos-CUTOFF_LENGTH), std::min(CUTOFF_LENGTH, pos) );
+        return "..." + matchLine.mid( std::max(0, pos-CUTOFF_LENGTH), std::min(CUTOFF_LENGTH, pos) ).toString();
     else
-        return matchLineString.left(pos);
+        return matchLine.left(pos).toString();
 }
 
 QString MatchResult::getPostMatchString(bool fullText) const {
-    const int end = matchLineString.length();
+    const QStringRef matchLine = linePool.midRef(lineOffset, lineLength);
+    const int end = matchLine.length();
     const int pos = positionInLine + matchLength;
 
     if (!fullText && end-pos > CUTOFF_LENGTH)
-        return matchLineString.mid(pos, CUTOFF_LENGTH) + "...";
+        return matchLine.mid(pos, CUTOFF_LENGTH).toString() + "...";
     else
-        return matchLineString.right(end-pos);
+        return matchLine.right(end-pos).toString();
+}
+
+int MatchResult::capturedStart(int group) const {
+    if (group == 0)
+        return positionInFile;
+    if (group < 1 || group > captureSpans.size())
+        return -1;
+    return captureSpans[group-1].start;
+}
+
+int MatchResult::capturedLength(int group) const {
+    if (group == 0)
+        return matchLength;
+    if (group < 1 || group > captureSpans.size())
+        return 0;
+    return captureSpans[group-1].length;
+}
+
+QByteArray DocResult::hashContent(const QString& content) {
+    const QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(content.constData()),
+                                                   content.size() * static_cast<int>(sizeof(QChar)));
+    return QCryptographicHash::hash(raw, QCryptographicHash::Md5);
 }
 
 int SearchResult::countResults() const {
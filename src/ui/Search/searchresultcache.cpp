@@ -0,0 +1,118 @@
+#include "include/Search/searchresultcache.h"
+
+#include <QAtomicInt>
+#include <QList>
+
+namespace {
+    // Number of caches that are kept alive after their searches finished
+    const int MAX_RECENT_CACHES = 4;
+
+    // Limit of cached results when the searches themselves are unlimited
+    const int DEFAULT_MAX_CACHED_RESULTS = 200000;
+
+    // MatchResults held by all caches together, and their limit
+    QAtomicInt cachedResults(0);
+    QAtomicInt maxCachedResults(DEFAULT_MAX_CACHED_RESULTS);
+
+    QHash<QString, QWeakPointer<SearchResultCache>>& cacheRegistry()
+    {
+        static QHash<QString, QWeakPointer<SearchResultCache>> registry;
+        return registry;
+    }
+}
+
+QSharedPointer<SearchResultCache> SearchResultCache::forConfig(const SearchConfig& config)
+{
+    static QMutex registryMutex;
+    QMutexLocker locker(&registryMutex);
+
+    maxCachedResults.store(config.maxResultsTotal > 0 ? config.maxResultsTotal : DEFAULT_MAX_CACHED_RESULTS);
+
+    const QString key = keyForConfig(config);
+    auto& registry = cacheRegistry();
+    QSharedPointer<SearchResultCache> cache = registry.value(key).toStrongRef();
+
+    if (!cache) {
+        cache = QSharedPointer<SearchResultCache>(new SearchResultCache());
+        registry.insert(key, cache);
+    }
+
+    // Keep the caches of the most recent searches alive, most recent first.
+    static QList<QSharedPointer<SearchResultCache>> recentCaches;
+    recentCaches.removeAll(cache);
+    recentCaches.prepend(cache);
+    while (recentCaches.size() > MAX_RECENT_CACHES)
+        recentCaches.removeLast();
+
+    // Forget caches that are gone
+    for (auto it = registry.begin(); it != registry.end();) {
+        if (it.value().isNull())
+            it = registry.erase(it);
+        else
+            ++it;
+    }
+
+    return cache;
+}
+
+SearchResultCache::~SearchResultCache()
+{
+    cachedResults.fetchAndAddRelaxed(-m_resultCount);
+}
+
+QString SearchResultCache::keyForConfig(const SearchConfig& config)
+{
+    return QString("%1:%2:%3:%4")
+            .arg(static_cast<int>(config.searchMode))
+            .arg(config.matchCase)
+            .arg(config.matchWord)
+            .arg(config.searchString);
+}
+
+bool SearchResultCache::lookup(const QString& filePath, const SearchIndex::FileStamp& stamp, int maxResults,
+                               DocResult& result) const
+{
+    const auto it = m_entries.constFind(filePath);
+    if (it == m_entries.constEnd() || it->stamp != stamp)
+        return false;
+
+    const DocResult& cached = it->result;
+    const int count = cached.results.size();
+
+    // A result that was cut off can only serve searches with the same or a lower limit
+    if (cached.limitReached && (maxResults <= 0 || maxResults > count))
+        return false;
+
+    result = cached;
+    if (maxResults > 0 && count > maxResults) {
+        result.results.resize(maxResults);
+        result.limitReached = true;
+    }
+
+    return true;
+}
+
+void SearchResultCache::store(const QString& filePath, const SearchIndex::FileStamp& stamp, const DocResult& result)
+{
+    const auto it = m_entries.find(filePath);
+    const int replaced = it != m_entries.end() ? it->result.results.size() : 0;
+    const int added = result.results.size() - replaced;
+
+    if (added > 0 && cachedResults.load() + added > maxCachedResults.load()) {
+        // The old entry is outdated anyway
+        if (it != m_entries.end()) {
+            cachedResults.fetchAndAddRelaxed(-replaced);
+            m_resultCount -= replaced;
+            m_entries.erase(it);
+        }
+        return;
+    }
+
+    cachedResults.fetchAndAddRelaxed(added);
+    m_resultCount += added;
+
+    Entry entry;
+    entry.stamp = stamp;
+    entry.result = result;
+    m_entries.insert(filePath, entry);
+}
@@ -1,92 +1,129 @@
 #include "include/Sessions/backupservice.h"
 
+#include "include/Sessions/backupwriter.h"
 #include "include/Sessions/persistentcache.h"
 #include "include/Sessions/sessions.h"
+#include "include/Sessions/sessionstore.h"
 #include "include/mainwindow.h"
 
 #include <QApplication>
-
-#include <set>
+#include <QElapsedTimer>
 
 QTimer BackupService::s_autosaveTimer;
 bool BackupService::s_autosaveEnabled = false;
-std::set<BackupService::WindowData> BackupService::s_backupWindowData;
+bool BackupService::s_captureInProgress = false;
+BackupService::Metrics BackupService::s_metrics;
+std::map<MainWindow*, std::shared_ptr<SessionStore>> BackupService::s_sessionStores;
 
-void BackupService::executeBackup() {
-    const auto& backupPath = PersistentCache::backupDirPath();
+BackupWriter* BackupService::backupWriter()
+{
+    static BackupWriter* writer = nullptr;
 
-    std::set<WindowData> newData, savedData, temp;
-
-    // Fill newData with up-to-date window data
-    for (const auto& wnd : MainWindow::instances()) {
-        WindowData wd;
-        wd.ptr = wnd;
-        wnd->topEditorContainer()->forEachEditor([&wd](int,int,EditorTabWidget*,Editor* ed) {
-            int gen = -1;
-            ed->getHistoryGeneration().wait().tap([&](int value){gen = value;});
-            wd.editors.push_back( std::make_pair(ed, gen) );
-            return true;
-        });
-        newData.insert(std::move(wd));
+    if (!writer) {
+        // Parented to the application so that the thread is stopped before the application is gone.
+        writer = new BackupWriter(qApp);
+        QObject::connect(writer, &BackupWriter::jobsFinished, qApp, &BackupService::onJobsFinished);
     }
 
+    return writer;
+}
+
+void BackupService::executeBackup() {
+    const auto& backupPath = PersistentCache::backupDirPath();
+    const auto& windows = MainWindow::instances();
+    BackupWriter* writer = backupWriter();
+
     // Find all closed windows and remove their backups
-    std::set_difference(s_backupWindowData.begin(), s_backupWindowData.end(),
-                        newData.begin(), newData.end(),
-                        std::inserter(temp, temp.end()));
-
-    for (const auto& item : temp) {
-        const auto ptrToInt = reinterpret_cast<uintptr_t>(item.ptr);
-        const QString cachePath = backupPath + QString("/window_%1").arg(ptrToInt);
-        QDir(cachePath).removeRecursively();
+    for (auto it = s_sessionStores.begin(); it != s_sessionStores.end();) {
+        if (windows.contains(it->first)) {
+            ++it;
+            continue;
+        }
+
+        auto job = std::make_shared<SessionStore::Job>();
+        job->directory = it->second->directory();
+        job->blobDirectory = PersistentCache::backupBlobDirPath();
+        job->removeDirectory = true;
+        writer->enqueue(job);
+
+        it = s_sessionStores.erase(it);
     }
 
-    // Find all newly created windows and create their backups
-    temp.clear();
-    std::set_difference(newData.begin(), newData.end(),
-                        s_backupWindowData.begin(), s_backupWindowData.end(),
-                        std::inserter(temp, temp.end()));
-
-    for (const auto& item : temp) {
-        // If writeBackup() fails we don't mark this window as saved. Another attempt at saving will be made
-        // next time executeBackup() runs.
-        if (writeBackup(item.ptr))
-            savedData.insert(item);
+    // Don't pile up work if the previous tick isn't done yet or the disk can't keep up.
+    if (s_captureInProgress || writer->isCongested()) {
+        s_metrics.skippedTicks++;
+        return;
     }
 
-    // Find all persisting windows and re-check whether to save them
-    temp.clear();
-    std::set_intersection(s_backupWindowData.begin(), s_backupWindowData.end(),
-                          newData.begin(), newData.end(),
-                          std::inserter(temp, temp.end()));
+    const int tick = ++s_metrics.ticks;
+    s_metrics.lastCaptureMs = 0;
+    s_metrics.lastWriteMs = 0;
+    s_metrics.lastBytesWritten = 0;
+    s_metrics.lastTabsWritten = 0;
+    s_metrics.lastTabsSkipped = 0;
+    s_metrics.lastTabsDeduplicated = 0;
 
-    for (const auto& oldItem : temp) { // oldItem is always from the first set (s_backupWindowData)
-        const auto& newItem = *newData.find(oldItem);
+    QElapsedTimer timer;
+    timer.start();
 
-        // If oldItem and newItem are fully equal, their contents haven't changed and need not be backed up...
-        if (oldItem.isFullyEqual(newItem)) {
-            savedData.insert(newItem);
-            continue;
+    QVector<QPromise<void>> captures;
+
+    for (MainWindow* wnd : windows) {
+        auto& store = s_sessionStores[wnd];
+
+        if (!store) {
+            // MainWindow's address is used to have a unique path name.
+            const auto ptrToInt = reinterpret_cast<uintptr_t>(wnd);
+            store = std::make_shared<SessionStore>(backupPath + QString("/window_%1").arg(ptrToInt),
+                                                   PersistentCache::backupBlobDirPath());
         }
 
-        // ...otherwise we attempt saving the backup
-        if (writeBackup(newItem.ptr))
-            savedData.insert(newItem);
+        // The previous backup of this window is still being written
+        if (store->isBusy())
+            continue;
+
+        std::shared_ptr<SessionStore> currentStore = store;
+        captures.push_back(SessionStore::captureP(store, wnd->topEditorContainer())
+                           .then([wnd, currentStore, tick](const std::shared_ptr<SessionStore::Job>& job) {
+            if (!job)
+                return;
+
+            // The window might have been closed, or the backups cleared, in the meantime.
+            const auto it = s_sessionStores.find(wnd);
+            if (it == s_sessionStores.end() || it->second != currentStore) {
+                currentStore->jobFinished(*job);
+                return;
+            }
+
+            job->tick = tick;
+            s_metrics.lastTabsSkipped += job->statistics.tabsSkipped;
+            backupWriter()->enqueue(job);
+        }));
     }
 
-    s_backupWindowData = savedData;
+    s_captureInProgress = true;
+    QPromise<void>::all(captures).finally([timer, tick]() {
+        s_captureInProgress = false;
+        if (tick == s_metrics.ticks)
+            s_metrics.lastCaptureMs = timer.elapsed();
+    });
 }
 
-bool BackupService::writeBackup(MainWindow* wnd)
+void BackupService::onJobsFinished()
 {
-    // Save this MainWindow as a session inside the autosave path.
-    // MainWindow's address is used to have a unique path name.
-    const auto& backupPath = PersistentCache::backupDirPath();
-    const auto ptrToInt = reinterpret_cast<uintptr_t>(wnd);
-    const QString cachePath = backupPath + QString("/window_%1").arg(ptrToInt);
-    const QString sessPath = backupPath + QString("/window_%1/window.xml").arg(ptrToInt);
+    for (const auto& job : backupWriter()->takeFinishedJobs()) {
+        if (auto store = job->store.lock())
+            store->jobFinished(*job);
+
+        s_metrics.totalBytesWritten += job->statistics.bytesWritten;
 
-    return Sessions::saveSession(wnd->getDocEngine(), wnd->topEditorContainer(), sessPath, cachePath);
+        if (job->tick == s_metrics.ticks) {
+            s_metrics.lastWriteMs += job->statistics.elapsedMs;
+            s_metrics.lastBytesWritten += job->statistics.bytesWritten;
+            s_metrics.lastTabsWritten += job->statistics.tabsWritten;
+            s_metrics.lastTabsDeduplicated += job->statistics.tabsDeduplicated;
+        }
+    }
 }
 
 bool BackupService::restoreFromBackup()
@@ -94,10 +131,16 @@ bool BackupService::restoreFromBackup()
     const auto& backupPath = PersistentCache::backupDirPath();
 
     // Each window is saved as a separate session inside a subdirectory.
-    // Grab all subdirs and load the session files inside.
+    // Grab all subdirs and load the session files inside. Other directories,
+    // such as the blob directory, don't contain a session.
     QDir autosaveDir(backupPath);
     autosaveDir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
-    const auto& dirs = autosaveDir.entryInfoList();
+
+    QFileInfoList dirs;
+    for (const QFileInfo& dirInfo : autosaveDir.entryInfoList()) {
+        if (SessionStore::hasSnapshot(dirInfo.filePath()) || QFileInfo(dirInfo.filePath() + "/window.xml").isFile())
+            dirs.append(dirInfo);
+    }
 
     if (dirs.isEmpty())
         return false;
@@ -112,10 +155,17 @@ bool BackupService::restoreFromBackup()
         return false;
 
     for (const auto& dirInfo : dirs) {
-        const auto sessPath = dirInfo.filePath() + "/window.xml";
-
         MainWindow* wnd = new MainWindow(QStringList(), nullptr);
-        Sessions::loadSession(wnd->getDocEngine(), wnd->topEditorContainer(), sessPath);
+
+        // Backups of older versions are XML sessions
+        if (SessionStore::hasSnapshot(dirInfo.filePath())) {
+            SessionStore::load(wnd->getDocEngine(), wnd->topEditorContainer(), dirInfo.filePath(),
+                               PersistentCache::backupBlobDirPath());
+        } else {
+            const auto sessPath = dirInfo.filePath() + "/window.xml";
+            Sessions::loadSession(wnd->getDocEngine(), wnd->topEditorContainer(), sessPath);
+        }
+
         wnd->show();
     }
 
@@ -172,10 +222,13 @@ void BackupService::clearBackupData()
     const auto& backupPath = PersistentCache::backupDirPath();
     QDir backupDir(backupPath);
 
+    // Make sure the writer doesn't recreate anything after the directory is gone.
+    backupWriter()->discardPendingJobs();
+    onJobsFinished();
+    s_sessionStores.clear();
+
     if (backupDir.exists())
         backupDir.removeRecursively();
-
-    s_backupWindowData.clear();
 }
 
 void BackupService::pause()
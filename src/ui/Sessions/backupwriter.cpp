@@ -0,0 +1,92 @@
+#include "include/Sessions/backupwriter.h"
+
+#include <QMutexLocker>
+
+const qint64 BackupWriter::MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+BackupWriter::BackupWriter(QObject* parent)
+    : QThread(parent)
+{ }
+
+BackupWriter::~BackupWriter()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_wantToStop = true;
+        m_queue.clear();
+        m_jobAvailable.wakeAll();
+    }
+
+    wait();
+}
+
+void BackupWriter::enqueue(const std::shared_ptr<SessionStore::Job>& job)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue.push_back(job);
+        m_pendingBytes += job->pendingBytes;
+        m_jobAvailable.wakeOne();
+    }
+
+    if (!isRunning())
+        start(QThread::LowPriority);
+}
+
+qint64 BackupWriter::pendingBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pendingBytes;
+}
+
+std::vector<std::shared_ptr<SessionStore::Job>> BackupWriter::takeFinishedJobs()
+{
+    QMutexLocker locker(&m_mutex);
+    std::vector<std::shared_ptr<SessionStore::Job>> finished;
+    finished.swap(m_finished);
+    return finished;
+}
+
+void BackupWriter::discardPendingJobs()
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (const auto& job : m_queue) {
+        job->success = false;
+        m_pendingBytes -= job->pendingBytes;
+        m_finished.push_back(job);
+    }
+    m_queue.clear();
+
+    while (m_writing)
+        m_jobDone.wait(&m_mutex);
+}
+
+void BackupWriter::run()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_wantToStop) {
+        if (m_queue.empty()) {
+            m_jobAvailable.wait(&m_mutex);
+            continue;
+        }
+
+        std::shared_ptr<SessionStore::Job> job = m_queue.front();
+        m_queue.pop_front();
+        m_writing = true;
+
+        locker.unlock();
+        SessionStore::writeJob(*job);
+        locker.relock();
+
+        m_writing = false;
+        m_pendingBytes -= job->pendingBytes;
+        m_finished.push_back(job);
+        m_jobDone.wakeAll();
+
+        locker.unlock();
+        emit jobsFinished();
+        locker.relock();
+    }
+}
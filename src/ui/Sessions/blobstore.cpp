@@ -0,0 +1,144 @@
+#include "include/Sessions/blobstore.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace {
+    // First byte of every blob file
+    const char FORMAT_RAW = 'R';
+    const char FORMAT_ZLIB = 'Z';
+
+    // Blobs smaller than this aren't worth compressing
+    const int MIN_COMPRESS_SIZE = 4096;
+
+    // zlib level 1 is several times faster than the default and compresses text nearly as well
+    const int COMPRESSION_LEVEL = 1;
+
+    const int ID_LENGTH = 40; // Hex encoded SHA-1
+}
+
+BlobStore::BlobStore(const QString& directory)
+    : m_directory(QDir(directory).absolutePath())
+{ }
+
+QString BlobStore::idForData(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+}
+
+bool BlobStore::isValidId(const QString& id)
+{
+    if (id.length() != ID_LENGTH)
+        return false;
+
+    for (const QChar c : id) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+            return false;
+    }
+
+    return true;
+}
+
+QString BlobStore::pathForId(const QString& id) const
+{
+    // Blobs are spread over subdirectories so that no directory gets too large
+    return m_directory + '/' + id.left(2) + '/' + id;
+}
+
+bool BlobStore::contains(const QString& id) const
+{
+    return isValidId(id) && QFileInfo(pathForId(id)).isFile();
+}
+
+bool BlobStore::put(const QByteArray& data, QString& id, bool compress, qint64* bytesWritten)
+{
+    id = idForData(data);
+
+    if (bytesWritten)
+        *bytesWritten = 0;
+
+    const QString path = pathForId(id);
+    if (QFileInfo(path).isFile())
+        return true;
+
+    QByteArray contents;
+    if (compress && data.size() >= MIN_COMPRESS_SIZE) {
+        const QByteArray compressed = qCompress(data, COMPRESSION_LEVEL);
+        // Only keep the compressed version if it saves at least 10%
+        if (compressed.size() < data.size() - data.size() / 10)
+            contents = FORMAT_ZLIB + compressed;
+    }
+    if (contents.isEmpty())
+        contents = FORMAT_RAW + data;
+
+    if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+        return false;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    if (file.write(contents) != contents.size()) {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit())
+        return false;
+
+    if (bytesWritten)
+        *bytesWritten = contents.size();
+
+    return true;
+}
+
+bool BlobStore::get(const QString& id, QByteArray& data) const
+{
+    if (!isValidId(id))
+        return false;
+
+    QFile file(pathForId(id));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QByteArray contents = file.readAll();
+    if (contents.isEmpty())
+        return false;
+
+    QByteArray result;
+    if (contents[0] == FORMAT_RAW)
+        result = contents.mid(1);
+    else if (contents[0] == FORMAT_ZLIB)
+        result = qUncompress(contents.mid(1));
+    else
+        return false;
+
+    // qUncompress() returns an empty array on errors, and files might have been damaged
+    if (idForData(result) != id)
+        return false;
+
+    data = result;
+    return true;
+}
+
+int BlobStore::collectGarbage(const QSet<QString>& referencedIds)
+{
+    int removed = 0;
+    const QDir dir(m_directory);
+
+    for (const QString& subdirName : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QDir subdir(dir.filePath(subdirName));
+
+        for (const QString& fileName : subdir.entryList(QDir::Files | QDir::Hidden)) {
+            if (!referencedIds.contains(fileName) && subdir.remove(fileName))
+                removed++;
+        }
+
+        dir.rmdir(subdirName); // Only succeeds if it's empty
+    }
+
+    return removed;
+}
@@ -0,0 +1,297 @@
+#include "include/Sessions/editjournal.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QUuid>
+
+/* Log structure (QDataStream, Qt_5_6):
+ *
+ * quint32 magic            "NQQJ"
+ * quint32 version          LOG_VERSION
+ * records, each:
+ *      quint32 size        Size of the payload
+ *      quint16 checksum    qChecksum() of the payload
+ *      payload             quint8 kind, qint64 seq, qint32 offset, qint32 removed, QString text
+ *
+ * Records are only ever appended, until the log is truncated by rewriting it.
+ */
+
+namespace {
+    const quint32 LOG_MAGIC = 0x4E51514A; // "NQQJ"
+    const quint32 LOG_VERSION = 1;
+    const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_6;
+    const int HEADER_SIZE = 8;
+    const int RECORD_HEADER_SIZE = 6;
+
+    // Pending entries are appended after this time, or as soon as this many bytes are pending.
+    const int GROUP_COMMIT_INTERVAL_MS = 200;
+    const int GROUP_COMMIT_BYTES = 64 * 1024;
+
+    QByteArray logHeader()
+    {
+        QByteArray header;
+        QDataStream out(&header, QIODevice::WriteOnly);
+        out.setVersion(STREAM_VERSION);
+        out << LOG_MAGIC << LOG_VERSION;
+        return header;
+    }
+}
+
+EditJournal::EditJournal(const QString& directory)
+    : m_directory(QDir(directory).absolutePath())
+{
+    m_commitTimer.setSingleShot(true);
+    m_commitTimer.setInterval(GROUP_COMMIT_INTERVAL_MS);
+    QObject::connect(&m_commitTimer, &QTimer::timeout, [this]() { flush(); });
+}
+
+QString EditJournal::newLogId()
+{
+    // Strip the braces
+    return QUuid::createUuid().toString().mid(1, 36);
+}
+
+QString EditJournal::logPath(const QString& directory, const QString& id)
+{
+    return QDir(directory).filePath(id + ".log");
+}
+
+QByteArray EditJournal::encodeEntry(const Entry& entry)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(STREAM_VERSION);
+    out << static_cast<quint8>(entry.kind) << entry.seq << entry.offset << entry.removed << entry.text;
+
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(STREAM_VERSION);
+    stream << static_cast<quint32>(payload.size()) << qChecksum(payload.constData(), static_cast<uint>(payload.size()));
+    record.append(payload);
+
+    return record;
+}
+
+void EditJournal::append(const QString& id, const QVector<Entry>& entries)
+{
+    QByteArray& pending = m_pending[id];
+
+    for (const Entry& entry : entries) {
+        const QByteArray record = encodeEntry(entry);
+        pending.append(record);
+        m_pendingBytes += record.size();
+    }
+
+    if (m_pendingBytes >= GROUP_COMMIT_BYTES)
+        flush();
+    else if (!m_commitTimer.isActive())
+        m_commitTimer.start();
+}
+
+void EditJournal::flush()
+{
+    m_commitTimer.stop();
+
+    if (m_pending.isEmpty())
+        return;
+
+    // The directory is only created if its parent exists, so a journal never recreates a backup
+    // that has just been removed. Until then the entries are kept.
+    if (!QDir(m_directory).exists() && !QDir().mkdir(m_directory)) {
+        m_commitTimer.start();
+        return;
+    }
+
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        QFile file(logPath(m_directory, it.key()));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            ++it;
+            continue;
+        }
+
+        const QByteArray data = file.size() == 0 ? logHeader() + it.value() : it.value();
+        const qint64 written = file.write(data);
+        if (written > 0)
+            m_bytesWritten += written;
+
+        // If the write failed halfway, recover() stops at the torn record, so there's no point in retrying.
+        m_pendingBytes -= it.value().size();
+        it = m_pending.erase(it);
+    }
+
+    if (!m_pending.isEmpty())
+        m_commitTimer.start();
+}
+
+void EditJournal::truncate(const QString& id, qint64 seq)
+{
+    flush();
+
+    const QString path = logPath(m_directory, id);
+    if (!QFileInfo(path).isFile())
+        return;
+
+    QVector<Entry> entries;
+    if (!readLog(path, entries)) {
+        QFile::remove(path);
+        return;
+    }
+
+    QByteArray data;
+    for (const Entry& entry : entries) {
+        if (entry.seq > seq)
+            data.append(encodeEntry(entry));
+    }
+
+    if (data.isEmpty()) {
+        QFile::remove(path);
+        return;
+    }
+
+    // Replace the log atomically, a crash must not leave an empty log behind.
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    data.prepend(logHeader());
+    if (file.write(data) != data.size()) {
+        file.cancelWriting();
+        return;
+    }
+
+    file.commit();
+}
+
+void EditJournal::remove(const QString& id)
+{
+    const auto it = m_pending.find(id);
+    if (it != m_pending.end()) {
+        m_pendingBytes -= it.value().size();
+        m_pending.erase(it);
+    }
+
+    QFile::remove(logPath(m_directory, id));
+}
+
+QVector<EditJournal::Entry> EditJournal::entriesFromVariant(const QVariant& data)
+{
+    QVector<Entry> entries;
+
+    for (const QVariant& item : data.toList()) {
+        const QVariantMap map = item.toMap();
+        const QString kind = map.value("kind").toString();
+
+        Entry entry;
+        entry.seq = map.value("seq").toLongLong();
+
+        if (kind == "saved") {
+            entry.kind = Entry::Saved;
+        } else if (kind == "reset") {
+            entry.kind = Entry::Reset;
+        } else {
+            entry.kind = Entry::Change;
+            entry.offset = map.value("offset").toInt();
+            entry.removed = map.value("removed").toInt();
+            entry.text = map.value("text").toString();
+        }
+
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+bool EditJournal::readLog(const QString& path, QVector<Entry>& entries)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QByteArray data = file.readAll();
+    if (data.size() < HEADER_SIZE || !data.startsWith(logHeader()))
+        return false;
+
+    entries.clear();
+    int pos = HEADER_SIZE;
+
+    while (data.size() - pos >= RECORD_HEADER_SIZE) {
+        QDataStream header(data.mid(pos, RECORD_HEADER_SIZE));
+        header.setVersion(STREAM_VERSION);
+        quint32 size = 0;
+        quint16 checksum = 0;
+        header >> size >> checksum;
+        pos += RECORD_HEADER_SIZE;
+
+        if (size > static_cast<quint32>(data.size() - pos))
+            break; // Torn by a crash
+
+        const QByteArray payload = data.mid(pos, static_cast<int>(size));
+        pos += static_cast<int>(size);
+
+        if (qChecksum(payload.constData(), size) != checksum)
+            break;
+
+        QDataStream in(payload);
+        in.setVersion(STREAM_VERSION);
+        quint8 kind = 0;
+        Entry entry;
+        in >> kind >> entry.seq >> entry.offset >> entry.removed >> entry.text;
+
+        if (in.status() != QDataStream::Ok || kind > Entry::Reset)
+            break;
+
+        entry.kind = static_cast<Entry::Kind>(kind);
+        entries.push_back(entry);
+    }
+
+    return true;
+}
+
+EditJournal::Recovery EditJournal::recover(const QString& path, qint64 seq)
+{
+    Recovery recovery;
+
+    QVector<Entry> entries;
+    if (!readLog(path, entries))
+        return recovery;
+
+    // Only an unbroken sequence of changes can be replayed. Anything after a gap or a
+    // reset is lost, just like it would be without the journal.
+    qint64 expected = seq;
+
+    for (const Entry& entry : entries) {
+        if (entry.seq <= seq)
+            continue; // Already part of the snapshot
+
+        if (entry.kind == Entry::Saved) {
+            if (entry.seq != expected)
+                break;
+            recovery.saved = true;
+            recovery.changes.clear();
+            continue;
+        }
+
+        if (entry.kind == Entry::Reset || entry.seq != expected + 1)
+            break;
+
+        recovery.changes.push_back(entry);
+        expected = entry.seq;
+    }
+
+    return recovery;
+}
+
+bool EditJournal::apply(const QVector<Entry>& changes, QString& text)
+{
+    for (const Entry& change : changes) {
+        if (change.offset < 0 || change.removed < 0 || change.offset > text.size() - change.removed)
+            return false;
+
+        text.replace(change.offset, change.removed, change.text);
+    }
+
+    return true;
+}
@@ -17,6 +17,26 @@ QString PersistentCache::backupDirPath() {
     return path;
 }
 
+QString PersistentCache::backupBlobDirPath() {
+    static QString path = backupDirPath() + "/blobs";
+    return path;
+}
+
+QString PersistentCache::searchIndexDirPath() {
+    static QString path = QFileInfo(QSettings().fileName()).dir().absolutePath().append("/searchIndex");
+    return path;
+}
+
+QString PersistentCache::extensionManifestCachePath() {
+    static QString path = QFileInfo(QSettings().fileName()).dir().absolutePath().append("/extensionManifests.json");
+    return path;
+}
+
+QString PersistentCache::extensionPackageCacheDirPath() {
+    static QString path = QFileInfo(QSettings().fileName()).dir().absolutePath().append("/extensionPackages");
+    return path;
+}
+
 QUrl PersistentCache::createValidCacheName(const QDir& parent, const QString &fileName)
 {
     QUrl cacheFile;
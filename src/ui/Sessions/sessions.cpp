@@ -7,6 +7,8 @@
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
+#include <QPointer>
+#include <QSet>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
@@ -39,23 +41,6 @@
  * */
 
 
-struct TabData {
-    QString filePath;
-    QString cacheFilePath;
-    int scrollX = 0;
-    int scrollY = 0;
-    bool active = false;
-    QString language;
-    qint64 lastModified = 0;
-    bool customIndent = false;
-    bool useTabs = false;
-    int tabSize = 0; 
-};
-
-struct ViewData {
-    std::vector<TabData> tabs;
-};
-
 /**
  * @brief Provides a convenience class to read session .xml files.
  */
@@ -244,30 +229,209 @@ void SessionWriter::addTabData(const TabData& td){
     m_writer.writeEndElement();
 }
 
-namespace Sessions {
+namespace {
 
-bool saveSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QString sessionPath, QString cacheDirPath)
+/**
+ * @brief Loads a single tab of a session.
+ * @param insertIndex Position of the new tab. If -1, the tab is appended and becomes the current one.
+ * @param title Tab title to use if the tab has no file. If empty, a new document name is generated.
+ * @return The Editor of the new tab, or nullptr if neither the file nor the cache file could be loaded.
+ */
+Editor* restoreTab(DocEngine* docEngine, EditorTabWidget* tabW, const TabData& tab, int insertIndex,
+                   const QString& title)
 {
-    const bool cacheModifiedFiles = !cacheDirPath.isEmpty();
+    const QFileInfo fileInfo(tab.filePath);
+    const bool fileExists = fileInfo.exists();
+    const bool cacheFileExists = QFileInfo(tab.cacheFilePath).exists();
+
+    const QUrl fileUrl = QUrl::fromLocalFile(tab.filePath);
+    const QUrl cacheFileUrl = QUrl::fromLocalFile(tab.cacheFilePath);
+
+    // This is the file to load the document from
+    const QUrl& loadUrl = cacheFileExists ? cacheFileUrl : fileUrl;
+
+    if (!fileExists && !cacheFileExists)
+        return nullptr;
+
+    docEngine->getDocumentLoader()
+        .setUrl(loadUrl)
+        .setTabWidget(tabW)
+        .setRememberLastDir(false)
+        .setFileSizeWarning(DocEngine::FileSizeActionYesToAll)
+        .setInsertIndex(insertIndex)
+        .setActivate(insertIndex < 0)
+        .execute()
+        .wait(); // FIXME Transform to async
+
+    int idx = tabW->findOpenEditorByUrl(loadUrl);
+
+    if (idx == -1)
+        return nullptr;
+
+    // DocEngine sets the editor's fileName to loadUrl since this is where the file
+    // was loaded from. Since loadUrl could point to a cached file we reset it here.
+    Editor* editor = tabW->materializeEditor(idx);
+
+    if (cacheFileExists) {
+        editor->markDirty();
+        editor->setLanguageFromFilePath();
+        // Since we loaded from cache we want to unmonitor the cache file.
+        docEngine->unmonitorDocument(editor);
+    }
 
-    QDir cacheDir;
+    if (tab.filePath.isEmpty()) {
+        editor->setFilePath(QUrl());
+        tabW->setTabText(idx, title.isEmpty() ? docEngine->getNewDocumentName() : title);
+    } else {
+        editor->setFilePath(fileUrl);
+        if(fileExists)
+            docEngine->monitorDocument(editor);
+    }
 
-    // Clear the cache directory by deleting and recreating it.
-    if (cacheModifiedFiles) {
-        cacheDir = QDir(cacheDirPath);
+    // If we're loading an existing file from cache we want to inform the user whether
+    // the file has changed since Nqq was last closed. For this we can compare the
+    // file's last modification date.
+    if (fileExists && cacheFileExists && tab.lastModified != 0) {
+        auto lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
 
-        bool success = false;
+        if (lastModified > tab.lastModified) {
+            editor->setFileOnDiskChanged(true);
+        }
+    }
 
-        if (cacheDir.exists())
-            success = cacheDir.removeRecursively();
+    // If the orig. file does not exist but *should* exist, we inform the user of its removal.
+    if (!fileExists && !fileUrl.isEmpty()) {
+        editor->setFileOnDiskChanged(true);
+        emit docEngine->fileOnDiskChanged(tabW, idx, true);
+    }
 
-        success |= cacheDir.mkpath(cacheDirPath);
+    if(!tab.language.isEmpty()) editor->setLanguage(tab.language);
 
-        if(!success)
-            return false;
+    editor->setScrollPosition(tab.scrollX, tab.scrollY);
+
+    if (tab.customIndent) {
+        editor->setCustomIndentationMode(tab.useTabs, tab.tabSize);
     }
 
-    std::vector<ViewData> viewData;
+    // loadDocuments() explicitely calls setFocus() so we'll have to undo that.
+    editor->clearFocus();
+
+    return editor;
+}
+
+/**
+ * @brief Stands in for a tab of a lazily restored session until the tab is needed.
+ */
+class TabPlaceholder : public EditorPlaceholder {
+public:
+    TabPlaceholder(DocEngine* docEngine, const TabData& tab, const QString& title)
+        : m_docEngine(docEngine), m_tab(tab), m_title(title) { }
+
+    QUrl filePath() const override
+    {
+        return m_tab.filePath.isEmpty() ? QUrl() : QUrl::fromLocalFile(m_tab.filePath);
+    }
+
+    bool isClean() const override { return m_tab.cacheFilePath.isEmpty(); }
+
+    Editor* load(EditorTabWidget* tabWidget, int index) override
+    {
+        if (!m_docEngine)
+            return nullptr;
+
+        return restoreTab(m_docEngine, tabWidget, m_tab, index, m_title);
+    }
+
+    const TabData& tabData() const { return m_tab; }
+
+private:
+    QPointer<DocEngine> m_docEngine;
+    TabData m_tab;
+    QString m_title;
+};
+
+void restoreView(DocEngine* docEngine, EditorTabWidget* tabW, const ViewData& view)
+{
+    int activeIndex = 0;
+
+    for (const TabData& tab : view.tabs) {
+        Editor* editor = restoreTab(docEngine, tabW, tab, -1, QString());
+
+        if (editor && tab.active)
+            activeIndex = tabW->indexOf(editor);
+    }
+
+    // We finish by making the right tab the currently open one.
+    if (tabW->count() > 0)
+        tabW->setCurrentIndex(activeIndex);
+}
+
+void restoreViewLazily(DocEngine* docEngine, EditorTabWidget* tabW, const ViewData& view)
+{
+    // Drop the tabs that can't be restored now, so that a placeholder never fails to load later.
+    std::vector<TabData> tabs;
+    size_t active = 0;
+
+    for (TabData tab : view.tabs) {
+        if (!QFileInfo(tab.cacheFilePath).exists())
+            tab.cacheFilePath.clear();
+
+        if (tab.cacheFilePath.isEmpty() && !QFileInfo(tab.filePath).exists())
+            continue;
+
+        if (tab.active)
+            active = tabs.size();
+
+        tabs.push_back(tab);
+    }
+
+    if (tabs.empty())
+        return;
+
+    // Only the tab that's shown is loaded right away.
+    Editor* activeEditor = restoreTab(docEngine, tabW, tabs[active], -1, QString());
+    if (!activeEditor) {
+        restoreView(docEngine, tabW, view);
+        return;
+    }
+
+    // Placeholders go around the active tab, in their original order.
+    int insertIndex = tabW->indexOf(activeEditor);
+
+    for (size_t i = 0; i < tabs.size(); i++) {
+        if (i == active) {
+            insertIndex = tabW->indexOf(activeEditor) + 1;
+            continue;
+        }
+
+        const TabData& tab = tabs[i];
+        const QString title = tab.filePath.isEmpty() ? docEngine->getNewDocumentName()
+                                                     : QFileInfo(tab.filePath).fileName();
+
+        tabW->addPlaceholderTab(new TabPlaceholder(docEngine, tab, title), title, insertIndex++);
+    }
+
+    tabW->setCurrentWidget(activeEditor);
+}
+
+} // namespace
+
+namespace Sessions {
+
+bool getPlaceholderTabData(EditorTabWidget* tabWidget, int index, TabData& td)
+{
+    const auto* placeholder = dynamic_cast<const TabPlaceholder*>(tabWidget->placeholder(index));
+    if (!placeholder)
+        return false;
+
+    td = placeholder->tabData();
+    return true;
+}
+
+bool collectViewData(TopEditorContainer* editorContainer, std::vector<ViewData>& viewData,
+                     const std::function<bool(Editor*, const QString&, TabData&)>& cacheTab)
+{
+    const bool cacheModifiedFiles = static_cast<bool>(cacheTab);
 
     //Loop through all tabwidgets and their tabs
     const int tabWidgetsCount = editorContainer->count();
@@ -279,6 +443,22 @@ bool saveSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QStr
         ViewData& currentViewData = viewData.back();
 
         for (int j = 0; j < tabCount; j++) {
+            TabData placeholderData;
+            if (getPlaceholderTabData(tabWidget, j, placeholderData)) {
+                // The tab hasn't been loaded since it was restored, so nothing has changed.
+                if (!cacheModifiedFiles) {
+                    placeholderData.cacheFilePath.clear();
+                    placeholderData.lastModified = 0;
+                }
+
+                if (placeholderData.filePath.isEmpty() && placeholderData.cacheFilePath.isEmpty())
+                    continue;
+
+                placeholderData.active = tabWidget->currentIndex() == j;
+                currentViewData.tabs.push_back(placeholderData);
+                continue;
+            }
+
             Editor* editor = tabWidget->editor(j);
             bool isClean = editor->isClean();
             bool isOrphan = editor->filePath().isEmpty();
@@ -291,11 +471,7 @@ bool saveSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QStr
 
             if (!isClean && cacheModifiedFiles) {
                 // Tab is dirty, meaning it needs to be cached.
-                QUrl cacheFilePath = PersistentCache::createValidCacheName(cacheDir, tabWidget->tabText(j));
-
-                td.cacheFilePath = cacheFilePath.toLocalFile();
-
-                if (!docEngine->write(cacheFilePath, editor)) {
+                if (!cacheTab(editor, tabWidget->tabText(j), td)) {
                     return false;
                 }
             } else if (isOrphan) {
@@ -336,22 +512,85 @@ bool saveSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QStr
         } // end for
     } // end for
 
-    // Write all information to a session file
-    QFile file(sessionPath);
-    file.open(QIODevice::WriteOnly);
+    return true;
+}
 
-    if (!file.isOpen())
+bool saveSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QString sessionPath, QString cacheDirPath)
+{
+    const bool cacheModifiedFiles = !cacheDirPath.isEmpty();
+
+    QDir cacheDir;
+
+    // Old cache files are only removed once the new session has been written, since tabs
+    // that haven't been loaded yet might still need theirs.
+    if (cacheModifiedFiles) {
+        cacheDir = QDir(cacheDirPath);
+
+        if (!cacheDir.mkpath(cacheDirPath))
+            return false;
+    }
+
+    std::function<bool(Editor*, const QString&, TabData&)> cacheTab;
+    if (cacheModifiedFiles) {
+        cacheTab = [&](Editor* editor, const QString& tabText, TabData& td) {
+            QUrl cacheFilePath = PersistentCache::createValidCacheName(cacheDir, tabText);
+            td.cacheFilePath = cacheFilePath.toLocalFile();
+            return docEngine->write(cacheFilePath, editor);
+        };
+    }
+
+    std::vector<ViewData> viewData;
+    if (!collectViewData(editorContainer, viewData, cacheTab))
         return false;
 
-    SessionWriter sessionWriter(file);
+    // Tabs that haven't been loaded still refer to the cache files they were restored from.
+    // Those have to end up in the cache directory too.
+    QSet<QString> referencedCacheFiles;
+    for (auto& view : viewData) {
+        for (auto& td : view.tabs) {
+            if (td.cacheFilePath.isEmpty())
+                continue;
 
-    for (const auto& view : viewData)
-        sessionWriter.addViewData(view);
+            QFileInfo cacheFile(td.cacheFilePath);
+            if (cacheFile.absolutePath() != cacheDir.absolutePath()) {
+                const QString newPath = PersistentCache::createValidCacheName(cacheDir, cacheFile.fileName()).toLocalFile();
+                if (!QFile::copy(td.cacheFilePath, newPath))
+                    return false;
+
+                td.cacheFilePath = newPath;
+                cacheFile = QFileInfo(newPath);
+            }
+
+            referencedCacheFiles.insert(cacheFile.fileName());
+        }
+    }
+
+    {
+        // Write all information to a session file
+        QFile file(sessionPath);
+        file.open(QIODevice::WriteOnly);
+
+        if (!file.isOpen())
+            return false;
+
+        SessionWriter sessionWriter(file);
+
+        for (const auto& view : viewData)
+            sessionWriter.addViewData(view);
+    }
+
+    // The session is complete, so cache files of previous sessions can go.
+    if (cacheModifiedFiles) {
+        for (const QString& fileName : cacheDir.entryList(QDir::Files | QDir::Hidden)) {
+            if (!referencedCacheFiles.contains(fileName))
+                cacheDir.remove(fileName);
+        }
+    }
 
     return true;
 }
 
-void loadSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QString sessionPath)
+void loadSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QString sessionPath, bool lazy)
 {
     QFile file(sessionPath);
     file.open(QIODevice::ReadOnly);
@@ -368,101 +607,31 @@ void loadSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QStr
         return;
     }
 
+    restoreViewData(docEngine, editorContainer, views, lazy);
+}
+
+void restoreViewData(DocEngine* docEngine, TopEditorContainer* editorContainer, const std::vector<ViewData>& views,
+                     bool lazy)
+{
     int viewCounter = 0;
     for (const auto& view : views) {
         // Each new view must be created if it does not yet exist.
         EditorTabWidget* tabW = editorContainer->tabWidget(viewCounter);
-        int activeIndex = 0;
 
         if (!tabW)
             tabW = editorContainer->addTabWidget();
 
         viewCounter++;
 
-        for (const TabData& tab : view.tabs) {
-            const QFileInfo fileInfo(tab.filePath);
-            const bool fileExists = fileInfo.exists();
-            const bool cacheFileExists = QFileInfo(tab.cacheFilePath).exists();
-
-            const QUrl fileUrl = QUrl::fromLocalFile(tab.filePath);
-            const QUrl cacheFileUrl = QUrl::fromLocalFile(tab.cacheFilePath);
-
-            // This is the file to load the document from
-            const QUrl& loadUrl = cacheFileExists ? cacheFileUrl : fileUrl;
-
-            if (!fileExists && !cacheFileExists)
-                continue;
-
-            docEngine->getDocumentLoader()
-                .setUrl(loadUrl)
-                .setTabWidget(tabW)
-                .setRememberLastDir(false)
-                .setFileSizeWarning(DocEngine::FileSizeActionYesToAll)
-                .execute()
-                .wait(); // FIXME Transform to async
-
-            int idx = tabW->findOpenEditorByUrl(loadUrl);
-
-            if (idx == -1)
-                continue;
-
-            // DocEngine sets the editor's fileName to loadUrl since this is where the file
-            // was loaded from. Since loadUrl could point to a cached file we reset it here.
-            Editor* editor = tabW->editor(idx);
-
-            if (cacheFileExists) {
-                editor->markDirty();
-                editor->setLanguageFromFilePath();
-                // Since we loaded from cache we want to unmonitor the cache file.
-                docEngine->unmonitorDocument(editor);
-            }
-
-            if (tab.filePath.isEmpty()) {
-                editor->setFilePath(QUrl());
-                tabW->setTabText(idx, docEngine->getNewDocumentName());
-            } else {
-                editor->setFilePath(fileUrl);
-                if(fileExists)
-                    docEngine->monitorDocument(editor);
-            }
-
-            // If we're loading an existing file from cache we want to inform the user whether
-            // the file has changed since Nqq was last closed. For this we can compare the
-            // file's last modification date.
-            if (fileExists && cacheFileExists && tab.lastModified != 0) {
-                auto lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
-
-                if (lastModified > tab.lastModified) {
-                    editor->setFileOnDiskChanged(true);
-                }
-            }
-
-            // If the orig. file does not exist but *should* exist, we inform the user of its removal.
-            if (!fileExists && !fileUrl.isEmpty()) {
-                editor->setFileOnDiskChanged(true);
-                emit docEngine->fileOnDiskChanged(tabW, idx, true);
-            }
-
-            if(tab.active) activeIndex = idx;
-
-            if(!tab.language.isEmpty()) editor->setLanguage(tab.language);
-
-            editor->setScrollPosition(tab.scrollX, tab.scrollY);
-
-            if (tab.customIndent) {
-                editor->setCustomIndentationMode(tab.useTabs, tab.tabSize);
-            }
-
-            // loadDocuments() explicitely calls setFocus() so we'll have to undo that.
-            editor->clearFocus();
-        } // end for
+        if (lazy)
+            restoreViewLazily(docEngine, tabW, view);
+        else
+            restoreView(docEngine, tabW, view);
 
         // In case a new tabwidget was created but no tabs were actually added to it,
         // we'll attempt to re-use the widget for the next view.
         if (tabW->count() == 0)
             viewCounter--;
-        else // Otherwise we finish by making the right tab the currently open one.
-            tabW->setCurrentIndex(activeIndex);
 
     } // end for
 
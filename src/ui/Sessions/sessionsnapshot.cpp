@@ -0,0 +1,149 @@
+#include "include/Sessions/sessionsnapshot.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+/* Snapshot structure (QDataStream, Qt_5_6):
+ *
+ * quint32 magic            "NQQS"
+ * quint32 version          SNAPSHOT_VERSION
+ * QByteArray payload
+ * QByteArray checksum      SHA-1 of payload
+ *
+ * The payload contains:
+ *
+ * quint32 viewCount
+ *      quint32 tabCount
+ *          QString filePath, QString cacheFilePath, qint32 scrollX, qint32 scrollY,
+ *          bool active, QString language, qint64 lastModified,
+ *          bool customIndent, bool useTabs, qint32 tabSize,
+ *          QString contentHash                                         (version 2+)
+ *          QString journalId, qint64 journalSeq                        (version 3+)
+ *
+ * Fields may only be appended to a tab record together with a version bump.
+ */
+
+namespace {
+    const quint32 SNAPSHOT_MAGIC = 0x4E515153; // "NQQS"
+    const quint32 SNAPSHOT_VERSION = 3;
+    const quint32 OLDEST_SUPPORTED_VERSION = 1;
+    const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_6;
+}
+
+QByteArray SessionSnapshot::toBinary() const
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(STREAM_VERSION);
+
+    out << static_cast<quint32>(views.size());
+    for (const ViewData& view : views) {
+        out << static_cast<quint32>(view.tabs.size());
+        for (const TabData& tab : view.tabs) {
+            out << tab.filePath << tab.cacheFilePath
+                << static_cast<qint32>(tab.scrollX) << static_cast<qint32>(tab.scrollY)
+                << tab.active << tab.language << tab.lastModified
+                << tab.customIndent << tab.useTabs << static_cast<qint32>(tab.tabSize)
+                << tab.contentHash
+                << tab.journalId << tab.journalSeq;
+        }
+    }
+
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    stream.setVersion(STREAM_VERSION);
+    stream << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << payload
+           << QCryptographicHash::hash(payload, QCryptographicHash::Sha1);
+
+    return result;
+}
+
+bool SessionSnapshot::fromBinary(const QByteArray& data, SessionSnapshot& snapshot)
+{
+    QDataStream stream(data);
+    stream.setVersion(STREAM_VERSION);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray payload;
+    QByteArray checksum;
+
+    stream >> magic >> version;
+    if (magic != SNAPSHOT_MAGIC || version < OLDEST_SUPPORTED_VERSION || version > SNAPSHOT_VERSION)
+        return false;
+
+    stream >> payload >> checksum;
+    if (stream.status() != QDataStream::Ok ||
+            checksum != QCryptographicHash::hash(payload, QCryptographicHash::Sha1))
+        return false;
+
+    QDataStream in(payload);
+    in.setVersion(STREAM_VERSION);
+
+    std::vector<ViewData> views;
+    quint32 viewCount = 0;
+    in >> viewCount;
+
+    for (quint32 i = 0; i < viewCount && in.status() == QDataStream::Ok; i++) {
+        ViewData view;
+        quint32 tabCount = 0;
+        in >> tabCount;
+
+        for (quint32 j = 0; j < tabCount && in.status() == QDataStream::Ok; j++) {
+            TabData tab;
+            qint32 scrollX = 0, scrollY = 0, tabSize = 0;
+            in >> tab.filePath >> tab.cacheFilePath >> scrollX >> scrollY
+               >> tab.active >> tab.language >> tab.lastModified
+               >> tab.customIndent >> tab.useTabs >> tabSize;
+            if (version >= 2)
+                in >> tab.contentHash;
+            if (version >= 3)
+                in >> tab.journalId >> tab.journalSeq;
+            tab.scrollX = scrollX;
+            tab.scrollY = scrollY;
+            tab.tabSize = tabSize;
+            view.tabs.push_back(tab);
+        }
+
+        views.push_back(view);
+    }
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    snapshot.views = std::move(views);
+    return true;
+}
+
+bool SessionSnapshot::writeToFile(const QString& path, qint64* bytesWritten) const
+{
+    const QByteArray data = toBinary();
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    if (file.write(data) != data.size()) {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit())
+        return false;
+
+    if (bytesWritten)
+        *bytesWritten = data.size();
+
+    return true;
+}
+
+bool SessionSnapshot::readFromFile(const QString& path, SessionSnapshot& snapshot)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    return fromBinary(file.readAll(), snapshot);
+}
@@ -0,0 +1,547 @@
+#include "include/Sessions/sessionstore.h"
+
+#include "include/Sessions/blobstore.h"
+#include "include/Sessions/editjournal.h"
+#include "include/Sessions/sessions.h"
+#include "include/nqqsettings.h"
+#include "include/topeditorcontainer.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+namespace {
+    const QString SNAPSHOT_FILE_NAME = QStringLiteral("snapshot.bin");
+    const QString JOURNAL_DIR_NAME = QStringLiteral("journal");
+
+    /**
+     * @brief Like Editor::backupStateP(), but the promise is rejected if the editor is destroyed
+     *        before it replied. Otherwise it would never be settled.
+     */
+    QPromise<Editor::BackupState> guardedBackupStateP(Editor* editor, int knownGeneration)
+    {
+        return QPromise<Editor::BackupState>([&](const QPromiseResolve<Editor::BackupState>& resolve,
+                                                 const QPromiseReject<Editor::BackupState>& reject) {
+            auto conn = std::make_shared<QMetaObject::Connection>();
+            *conn = QObject::connect(editor, &QObject::destroyed, [reject]() {
+                reject(QString("Editor destroyed"));
+            });
+
+            editor->backupStateP(knownGeneration).then([=](const Editor::BackupState& state) {
+                QObject::disconnect(*conn);
+                resolve(state);
+            });
+        });
+    }
+
+    /**
+     * @brief Applies the changes the journal recorded after the snapshot was taken to a tab. The recovered
+     *        contents are written to 'tempDir' and become the tab's cache file.
+     * @return False if there was nothing to recover, or the changes couldn't be applied.
+     */
+    bool replayJournal(const QString& journalDirectory, const BlobStore& blobs, const QTemporaryDir& tempDir,
+                       TabData& tab)
+    {
+        if (tab.journalId.isEmpty() || !tempDir.isValid())
+            return false;
+
+        const EditJournal::Recovery recovery =
+                EditJournal::recover(EditJournal::logPath(journalDirectory, tab.journalId), tab.journalSeq);
+        if (!recovery.saved && recovery.changes.isEmpty())
+            return false;
+
+        // The changes apply to the snapshot's contents, or to the file if the tab was clean or has been saved since.
+        QByteArray data;
+        qint64 lastModified = tab.lastModified;
+        if (!recovery.saved && !tab.contentHash.isEmpty()) {
+            if (!blobs.get(tab.contentHash, data))
+                return false;
+        } else {
+            QFile file(tab.filePath);
+            if (tab.filePath.isEmpty() || !file.open(QIODevice::ReadOnly))
+                return false;
+            data = file.readAll();
+            lastModified = QFileInfo(tab.filePath).lastModified().toMSecsSinceEpoch();
+        }
+
+        if (recovery.changes.isEmpty()) {
+            // Saved after the snapshot and unchanged since
+            tab.contentHash.clear();
+            tab.cacheFilePath.clear();
+            tab.lastModified = lastModified;
+            return true;
+        }
+
+        DocEngine::DecodedText decoded = DocEngine::decodeText(data);
+        if (decoded.error)
+            return false;
+
+        // Same line separator detection as DocEngine::read()
+        QString endOfLineSequence = "\n";
+        if (decoded.text.contains("\r\n"))
+            endOfLineSequence = "\r\n";
+        else if (!decoded.text.contains('\n') && decoded.text.contains('\r'))
+            endOfLineSequence = "\r";
+
+        QString text = decoded.text.replace("\r\n", "\n").replace('\r', '\n');
+        if (!EditJournal::apply(recovery.changes, text))
+            return false;
+        decoded.text = text.replace("\n", endOfLineSequence);
+
+        const QString path = tempDir.path() + "/journal_" + tab.journalId;
+        QFile file(path);
+        if (!DocEngine::writeFromString(&file, decoded))
+            return false;
+
+        tab.contentHash.clear();
+        tab.cacheFilePath = path;
+        tab.lastModified = lastModified;
+        return true;
+    }
+}
+
+SessionStore::SessionStore(const QString& directory, const QString& blobDirectory)
+    : m_directory(QDir(directory).absolutePath()),
+      m_blobDirectory(QDir(blobDirectory).absolutePath()),
+      m_journal(new EditJournal(QDir(m_directory).filePath(JOURNAL_DIR_NAME)))
+{ }
+
+SessionStore::~SessionStore()
+{
+    for (auto it = m_journaledEditors.constBegin(); it != m_journaledEditors.constEnd(); ++it) {
+        QObject::disconnect(it->entries);
+        QObject::disconnect(it->destroyed);
+        it.key()->setJournalingEnabled(false);
+    }
+}
+
+QString SessionStore::journalEditor(Editor* editor)
+{
+    const auto it = m_journaledEditors.constFind(editor);
+    if (it != m_journaledEditors.constEnd())
+        return it->logId;
+
+    JournaledEditor journaled;
+    journaled.logId = EditJournal::newLogId();
+
+    EditJournal* journal = m_journal.get();
+    const QString logId = journaled.logId;
+    journaled.entries = QObject::connect(editor, &Editor::journalEntries, [journal, logId](const QVariantList& entries) {
+        journal->append(logId, EditJournal::entriesFromVariant(entries));
+    });
+    journaled.destroyed = QObject::connect(editor, &QObject::destroyed, [this, editor]() {
+        // The tab has been closed, there's nothing to recover anymore.
+        m_journal->remove(m_journaledEditors.take(editor).logId);
+    });
+
+    m_journaledEditors.insert(editor, journaled);
+    editor->setJournalingEnabled(true);
+
+    return logId;
+}
+
+void SessionStore::stopJournaling(const QSet<Editor*>& keep)
+{
+    for (auto it = m_journaledEditors.begin(); it != m_journaledEditors.end();) {
+        if (keep.contains(it.key())) {
+            ++it;
+            continue;
+        }
+
+        // The editor has been moved to another window, whose SessionStore journals it from now on.
+        // So journaling stays enabled on the editor's side.
+        QObject::disconnect(it->entries);
+        QObject::disconnect(it->destroyed);
+        m_journal->remove(it->logId);
+        it = m_journaledEditors.erase(it);
+    }
+}
+
+QPromise<std::shared_ptr<SessionStore::Job>> SessionStore::captureP(const std::shared_ptr<SessionStore>& self,
+                                                                    TopEditorContainer* editorContainer)
+{
+    // Everything that's cheap to get on the C++ side is collected right away.
+    struct TabInfo {
+        int view;
+        QWidget* widget;             // The Editor, or the placeholder of a tab that hasn't been loaded
+        bool active;
+        QString filePath;
+        QString language;
+        bool customIndent;
+        bool fileOnDiskChanged;
+        QTextCodec* codec;
+        bool bom;
+        QString endOfLineSequence;
+        QString cacheFilePath;       // Placeholders only: file with the unsaved contents
+        qint64 lastModified;         // Placeholders only
+        QString journalId;           // Editors only: log of the editor's changes
+    };
+
+    auto tabs = std::make_shared<std::vector<TabInfo>>();
+    QVector<QPromise<Editor::BackupState>> states;
+    QSet<Editor*> editorSet;
+    const int viewCount = editorContainer->count();
+
+    for (int i = 0; i < viewCount; i++) {
+        EditorTabWidget* tabWidget = editorContainer->tabWidget(i);
+        const int tabCount = tabWidget->count();
+
+        for (int j = 0; j < tabCount; j++) {
+            TabInfo tab;
+            tab.view = i;
+            tab.active = tabWidget->currentIndex() == j;
+            tab.lastModified = 0;
+
+            // Tabs that haven't been loaded since the session was restored are backed up from
+            // their session data, loading them would defeat the purpose.
+            TabData placeholderData;
+            if (Sessions::getPlaceholderTabData(tabWidget, j, placeholderData)) {
+                tab.widget = tabWidget->widget(j);
+                tab.filePath = placeholderData.filePath;
+                tab.language = placeholderData.language;
+                tab.customIndent = placeholderData.customIndent;
+                tab.fileOnDiskChanged = false;
+                tab.codec = nullptr;
+                tab.bom = false;
+                tab.cacheFilePath = placeholderData.cacheFilePath;
+                tab.lastModified = placeholderData.lastModified;
+                tabs->push_back(tab);
+
+                Editor::BackupState state;
+                state.historyGeneration = 0;
+                state.clean = placeholderData.cacheFilePath.isEmpty();
+                state.scrollPosition = qMakePair(placeholderData.scrollX, placeholderData.scrollY);
+                state.indentationMode.useTabs = placeholderData.useTabs;
+                state.indentationMode.size = placeholderData.tabSize;
+                states.push_back(QPromise<Editor::BackupState>::resolve(state));
+                continue;
+            }
+
+            Editor* editor = tabWidget->editor(j);
+            tab.widget = editor;
+            tab.filePath = editor->filePath().isEmpty() ? QString() : editor->filePath().toLocalFile();
+            tab.language = editor->getLanguage()->id;
+            tab.customIndent = editor->isUsingCustomIndentationMode();
+            tab.fileOnDiskChanged = editor->fileOnDiskChanged();
+            tab.codec = editor->codec();
+            tab.bom = editor->bom();
+            tab.endOfLineSequence = editor->endOfLineSequence();
+
+            // Journaling has to start before the state is requested: changes made after that
+            // aren't part of the snapshot and must be in the journal.
+            tab.journalId = self->journalEditor(editor);
+            editorSet.insert(editor);
+
+            tabs->push_back(tab);
+
+            // Only editors that changed since the last backup need to send their contents.
+            int knownGeneration = -1;
+            const auto it = self->m_cachedTabs.constFind(editor);
+            if (it != self->m_cachedTabs.constEnd() && it->widget == editor)
+                knownGeneration = it->generation;
+
+            states.push_back(guardedBackupStateP(editor, knownGeneration));
+        }
+    }
+
+    self->stopJournaling(editorSet);
+    self->m_busy = true;
+
+    return QPromise<Editor::BackupState>::all(states).then([self, tabs, viewCount](const QVector<Editor::BackupState>& results) {
+        SessionStore* store = self.get();
+
+        std::vector<std::pair<QWidget*, int>> editors;
+        for (size_t i = 0; i < tabs->size(); i++)
+            editors.emplace_back((*tabs)[i].widget, results[static_cast<int>(i)].historyGeneration);
+
+        if (store->m_hasBackup && editors == store->m_savedEditors) {
+            store->m_busy = false;
+            return std::shared_ptr<Job>();
+        }
+
+        auto job = std::make_shared<Job>();
+        job->directory = store->m_directory;
+        job->blobDirectory = store->m_blobDirectory;
+        job->compressBlobs = NqqSettings::getInstance().General.getCompressBackups();
+        job->store = self;
+        job->snapshot.views.resize(static_cast<size_t>(viewCount));
+
+        store->m_pendingTabs.clear();
+        store->m_pendingEditors = editors;
+
+        for (size_t i = 0; i < tabs->size(); i++) {
+            const TabInfo& tab = (*tabs)[i];
+            const Editor::BackupState& state = results[static_cast<int>(i)];
+            const bool isOrphan = tab.filePath.isEmpty();
+
+            // Same rules as Sessions::collectViewData()
+            if (state.clean && isOrphan)
+                continue;
+
+            TabData td;
+            std::vector<TabData>& viewTabs = job->snapshot.views[static_cast<size_t>(tab.view)].tabs;
+
+            if (!state.clean) {
+                CachedTab cached;
+                cached.widget = tab.widget;
+                cached.generation = state.historyGeneration;
+                cached.view = static_cast<size_t>(tab.view);
+                cached.tab = viewTabs.size();
+
+                const auto it = store->m_cachedTabs.constFind(tab.widget);
+                if (!state.hasValue && it != store->m_cachedTabs.constEnd()) {
+                    // Unchanged since the last backup, keep using its blob.
+                    td.contentHash = it->contentHash;
+                    job->referencedBlobs.insert(it->contentHash);
+                    job->statistics.tabsSkipped++;
+                } else {
+                    // The contents are hashed and stored by writeJob(), which then fills in td.contentHash.
+                    Job::CacheFile file;
+                    file.view = cached.view;
+                    file.tab = cached.tab;
+                    if (!tab.cacheFilePath.isEmpty()) {
+                        file.sourceFile = tab.cacheFilePath;
+                    } else {
+                        file.content.text = QString(state.value).replace("\n", tab.endOfLineSequence);
+                        file.content.codec = tab.codec;
+                        file.content.bom = tab.bom;
+                        job->pendingBytes += file.content.text.size() * static_cast<int>(sizeof(QChar));
+                    }
+                    job->cacheFiles.push_back(file);
+                }
+
+                store->m_pendingTabs.insert(tab.widget, cached);
+            }
+
+            td.filePath = tab.filePath;
+            td.scrollX = state.scrollPosition.first;
+            td.scrollY = state.scrollPosition.second;
+            td.active = tab.active;
+            td.language = tab.language;
+            td.journalId = tab.journalId;
+            td.journalSeq = state.journalSeq;
+
+            if (tab.customIndent) {
+                td.customIndent = true;
+                td.useTabs = state.indentationMode.useTabs;
+                td.tabSize = state.indentationMode.size;
+            }
+
+            // The file's modification time is read by writeJob(). As a special case, if the file has
+            // *already* changed we set it to 1 so we always trigger the warning on restore.
+            if (!isOrphan && tab.fileOnDiskChanged)
+                td.lastModified = 1;
+            else if (tab.lastModified != 0)
+                td.lastModified = tab.lastModified; // Placeholders keep the time they were restored with
+
+            viewTabs.push_back(td);
+        }
+
+        // If the new snapshot doesn't need all blobs of the previous one anymore, they might be garbage.
+        job->collectGarbage = !store->m_hasBackup;
+        for (const CachedTab& cached : store->m_cachedTabs) {
+            if (!job->referencedBlobs.contains(cached.contentHash)) {
+                job->collectGarbage = true;
+                break;
+            }
+        }
+
+        return job;
+    }).fail([self]() {
+        // An editor has been closed while capturing. Try again next time.
+        self->m_busy = false;
+        return std::shared_ptr<Job>();
+    });
+}
+
+void SessionStore::jobFinished(const Job& job)
+{
+    m_busy = false;
+
+    if (job.success) {
+        for (CachedTab& cached : m_pendingTabs)
+            cached.contentHash = job.snapshot.views[cached.view].tabs[cached.tab].contentHash;
+
+        m_cachedTabs = m_pendingTabs;
+        m_savedEditors = m_pendingEditors;
+        m_hasBackup = true;
+
+        // The journal only needs the changes made after the snapshot was captured.
+        for (const ViewData& view : job.snapshot.views) {
+            for (const TabData& tab : view.tabs) {
+                if (!tab.journalId.isEmpty())
+                    m_journal->truncate(tab.journalId, tab.journalSeq);
+            }
+        }
+    } else {
+        // We don't know what made it to disk, so everything is stored again next time.
+        m_cachedTabs.clear();
+        m_savedEditors.clear();
+        m_hasBackup = false;
+    }
+
+    m_pendingTabs.clear();
+    m_pendingEditors.clear();
+}
+
+void SessionStore::writeJob(Job& job)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    job.success = false;
+
+    if (job.removeDirectory) {
+        job.success = QDir(job.directory).removeRecursively();
+        if (job.success && !job.blobDirectory.isEmpty())
+            job.statistics.blobsRemoved = collectGarbage(job.directory, job.blobDirectory);
+        job.statistics.elapsedMs = timer.elapsed();
+        return;
+    }
+
+    const QDir dir(job.directory);
+    if (!dir.mkpath(job.directory))
+        return;
+
+    BlobStore blobs(job.blobDirectory);
+
+    for (const Job::CacheFile& cacheFile : job.cacheFiles) {
+        QByteArray data;
+
+        if (!cacheFile.sourceFile.isEmpty()) {
+            // Already encoded
+            QFile file(cacheFile.sourceFile);
+            if (!file.open(QIODevice::ReadOnly))
+                return;
+            data = file.readAll();
+        } else {
+            QBuffer buffer;
+            if (!DocEngine::writeFromString(&buffer, cacheFile.content))
+                return;
+            data = buffer.data();
+        }
+
+        QString id;
+        qint64 blobSize = 0;
+        if (!blobs.put(data, id, job.compressBlobs, &blobSize))
+            return;
+
+        job.snapshot.views[cacheFile.view].tabs[cacheFile.tab].contentHash = id;
+
+        if (blobSize > 0) {
+            job.statistics.tabsWritten++;
+            job.statistics.bytesWritten += blobSize;
+        } else {
+            job.statistics.tabsDeduplicated++;
+        }
+    }
+
+    // Blobs stored by earlier jobs must still be there
+    for (const QString& id : job.referencedBlobs) {
+        if (!blobs.contains(id))
+            return;
+    }
+
+    // Reading the modification times here keeps the file system accesses off the GUI thread.
+    for (ViewData& view : job.snapshot.views) {
+        for (TabData& tab : view.tabs) {
+            if (!tab.filePath.isEmpty() && tab.lastModified == 0)
+                tab.lastModified = QFileInfo(tab.filePath).lastModified().toMSecsSinceEpoch();
+        }
+    }
+
+    qint64 snapshotSize = 0;
+    if (!job.snapshot.writeToFile(dir.filePath(SNAPSHOT_FILE_NAME), &snapshotSize))
+        return;
+    job.statistics.bytesWritten += snapshotSize;
+
+    // The snapshot is the only file the directory needs. Anything else was left behind by older versions.
+    for (const QString& fileName : dir.entryList(QDir::Files | QDir::Hidden)) {
+        if (fileName != SNAPSHOT_FILE_NAME && QFile::remove(dir.filePath(fileName)))
+            job.statistics.filesRemoved++;
+    }
+
+    // The new snapshot is on disk, so the blobs only referenced by the previous one can go.
+    if (job.collectGarbage)
+        job.statistics.blobsRemoved = collectGarbage(job.directory, job.blobDirectory);
+
+    job.success = true;
+    job.statistics.elapsedMs = timer.elapsed();
+}
+
+int SessionStore::collectGarbage(const QString& directory, const QString& blobDirectory)
+{
+    // 'directory' itself might have been removed already
+    const QDir parent(QFileInfo(directory).absolutePath());
+    QSet<QString> referencedIds;
+
+    for (const QFileInfo& dirInfo : parent.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const QString path = QDir(dirInfo.filePath()).filePath(SNAPSHOT_FILE_NAME);
+        if (!QFileInfo(path).isFile())
+            continue;
+
+        // If we can't tell which blobs a snapshot needs, don't remove anything.
+        SessionSnapshot snapshot;
+        if (!SessionSnapshot::readFromFile(path, snapshot))
+            return 0;
+
+        for (const ViewData& view : snapshot.views) {
+            for (const TabData& tab : view.tabs) {
+                if (!tab.contentHash.isEmpty())
+                    referencedIds.insert(tab.contentHash);
+            }
+        }
+    }
+
+    return BlobStore(blobDirectory).collectGarbage(referencedIds);
+}
+
+bool SessionStore::hasSnapshot(const QString& directory)
+{
+    return QFileInfo(QDir(directory).filePath(SNAPSHOT_FILE_NAME)).isFile();
+}
+
+bool SessionStore::load(DocEngine* docEngine, TopEditorContainer* editorContainer, const QString& directory,
+                        const QString& blobDirectory)
+{
+    const QDir dir(directory);
+
+    SessionSnapshot snapshot;
+    if (!SessionSnapshot::readFromFile(dir.filePath(SNAPSHOT_FILE_NAME), snapshot))
+        return false;
+
+    // DocEngine can only load files, so the blobs are extracted into a temporary directory.
+    // It's safe to remove it when we're done since restoreViewData() loads synchronously.
+    const BlobStore blobs(blobDirectory);
+    const QString journalDirectory = dir.filePath(JOURNAL_DIR_NAME);
+    QTemporaryDir tempDir;
+
+    for (ViewData& view : snapshot.views) {
+        for (TabData& tab : view.tabs) {
+            if (replayJournal(journalDirectory, blobs, tempDir, tab))
+                continue;
+
+            if (!tab.contentHash.isEmpty()) {
+                tab.cacheFilePath.clear();
+
+                QByteArray data;
+                if (!tempDir.isValid() || !blobs.get(tab.contentHash, data))
+                    continue; // Fall back to the file on disk, if any
+
+                const QString path = tempDir.path() + '/' + tab.contentHash;
+                QFile file(path);
+                if (file.exists() || (file.open(QIODevice::WriteOnly) && file.write(data) == data.size()))
+                    tab.cacheFilePath = path;
+            } else if (!tab.cacheFilePath.isEmpty()) {
+                // Snapshots of version 1 keep cache files next to the snapshot
+                tab.cacheFilePath = dir.absoluteFilePath(tab.cacheFilePath);
+            }
+        }
+    }
+
+    Sessions::restoreViewData(docEngine, editorContainer, snapshot.views);
+    return true;
+}
@@ -140,7 +140,9 @@ QPromise<void> DocEngine::loadDocuments(const DocEngine::DocumentLoader& docLoad
     const auto& reloadAction = docLoader.reloadAction;
     const auto& codec = docLoader.textCodec;
     const auto& bom = docLoader.bom;
+    const auto& activate = docLoader.activate;
     auto fileSizeAction = std::make_shared<FileSizeAction>(docLoader.fileSizeAction);
+    auto insertIndex = std::make_shared<int>(docLoader.insertIndex);
 
     if (fileNames.empty())
         return QPromise<void>::resolve();
@@ -176,7 +178,7 @@ QPromise<void> DocEngine::loadDocuments(const DocEngine::DocumentLoader& docLoad
             EditorTabWidget *tabW = static_cast<EditorTabWidget *>
                                     (m_topEditorContainer->widget(openPos.first));
 
-            if (*isFirstDocument) {
+            if (*isFirstDocument && activate) {
                 *isFirstDocument = false;
                 tabW->setCurrentIndex(openPos.second);
             }
@@ -215,11 +217,13 @@ QPromise<void> DocEngine::loadDocuments(const DocEngine::DocumentLoader& docLoad
         if (isAlreadyOpen) {
             tabWidget = m_topEditorContainer->tabWidget(openPos.first);
             tabIndex = openPos.second;
+        } else if (*insertIndex >= 0) {
+            tabIndex = tabWidget->addEditorTab(false, fi.fileName(), (*insertIndex)++);
         } else {
             tabIndex = tabWidget->addEditorTab(false, fi.fileName());
         }
 
-        Editor* editor = tabWidget->editor(tabIndex);
+        Editor* editor = tabWidget->materializeEditor(tabIndex);
 
         // In case of a reload, save cursor and scroll position
         QPair<int, int> scrollPosition;
@@ -280,8 +284,9 @@ QPromise<void> DocEngine::loadDocuments(const DocEngine::DocumentLoader& docLoad
             editor->markDirty();
         }
 
-        // If there was only a new empty tab opened, remove it
-        if (tabWidget->count() == 2) {
+        // If there was only a new empty tab opened, remove it. Tabs inserted at a specific
+        // position are meant to go next to the existing ones, so the empty tab is kept then.
+        if (tabWidget->count() == 2 && *insertIndex < 0 && !tabWidget->isPlaceholder(0)) {
             Editor *victim = tabWidget->editor(0);
             if (victim->filePath().isEmpty() && victim->isClean()) {
                 tabWidget->removeTab(0);
@@ -300,7 +305,7 @@ QPromise<void> DocEngine::loadDocuments(const DocEngine::DocumentLoader& docLoad
 
         monitorDocument(editor);
 
-        if (*isFirstDocument) {
+        if (*isFirstDocument && activate) {
             *isFirstDocument = false;
             tabWidget->setCurrentIndex(tabIndex);
             tabWidget->editor(tabIndex)->setFocus();
@@ -386,7 +391,7 @@ QPromise<void> DocEngine::loadDocuments(const DocEngine::DocumentLoader& docLoad
             tabIndex = tabWidget->addEditorTab(false, fi.fileName());
         }
 
-        Editor* editor = tabWidget->editor(tabIndex);
+        Editor* editor = tabWidget->materializeEditor(tabIndex);
 
         // In case of a reload, save cursor and scroll position
         QPair<int, int> scrollPosition;
@@ -562,6 +567,46 @@ bool DocEngine::writeFromString(QIODevice *io, const DecodedText &write)
     return true;
 }
 
+qint64 DocEngine::writeFromChunks(QIODevice *io, const QVector<QStringRef> &chunks, QTextCodec *codec, bool bom)
+{
+    // Encoded data is collected into a buffer of this size before being written
+    const int bufferSize = 256 * 1024;
+
+    qint64 written = 0;
+    QByteArray buffer;
+    buffer.reserve(bufferSize);
+
+    auto flush = [&]() {
+        if (buffer.isEmpty())
+            return true;
+        if (io->write(buffer) != buffer.size())
+            return false;
+        written += buffer.size();
+        buffer.clear();
+        return true;
+    };
+
+    // See writeFromString() for why the BOM is written manually
+    if (bom && codec->mibEnum() == MIB_UTF_8)
+        buffer.append(getBomForCodec(codec));
+
+    // The encoder keeps its state between chunks, so surrogate pairs split
+    // across chunk boundaries are encoded correctly.
+    QScopedPointer<QTextEncoder> encoder(codec->makeEncoder());
+
+    for (const QStringRef &chunk : chunks) {
+        buffer.append(encoder->fromUnicode(chunk.unicode(), chunk.length()));
+
+        if (buffer.size() >= bufferSize && !flush())
+            return -1;
+    }
+
+    if (!flush())
+        return -1;
+
+    return written;
+}
+
 bool DocEngine::write(QIODevice *io, Editor *editor)
 {
     DecodedText info;
@@ -675,7 +720,7 @@ bool DocEngine::trySudoSave(QString sudoProgram, QUrl outFileName, Editor* edito
 
 int DocEngine::saveDocument(EditorTabWidget *tabWidget, int tab, QUrl outFileName, bool copy)
 {
-    QSharedPointer<Editor> editor = tabWidget->editorSharedPtr(tabWidget->editor(tab));
+    QSharedPointer<Editor> editor = tabWidget->editorSharedPtr(tabWidget->materializeEditor(tab));
 
     if (!copy)
         unmonitorDocument(editor);
@@ -768,7 +813,7 @@ void DocEngine::documentChanged(QString fileName)
         QFile file(fileName);
         EditorTabWidget *tabWidget = m_topEditorContainer->tabWidget(pos.first);
 
-        Editor *editor = tabWidget->editor(pos.second);
+        Editor *editor = tabWidget->materializeEditor(pos.second);
         editor->markDirty();
         editor->setFileOnDiskChanged(true);
         emit fileOnDiskChanged(tabWidget, pos.second, !file.exists());
@@ -777,8 +822,10 @@ void DocEngine::documentChanged(QString fileName)
 
 void DocEngine::closeDocument(EditorTabWidget *tabWidget, int tab)
 {
-    Editor *editor = tabWidget->editor(tab);
-    unmonitorDocument(editor);
+    // Placeholders aren't monitored, and there's no need to load them just to close them.
+    if (!tabWidget->isPlaceholder(tab))
+        unmonitorDocument(tabWidget->editor(tab));
+
     tabWidget->removeTab(tab);
 }
 
@@ -4,12 +4,19 @@
 
 #include <QApplication>
 #include <QFileInfo>
+#include <QPointer>
 #include <QTabBar>
+#include <QTimer>
 
 #ifdef QT_DEBUG
 #include <QElapsedTimer>
 #endif
 
+namespace {
+    // Delay before the neighbours of a tab that has just been loaded are loaded too
+    const int PREFETCH_DELAY_MS = 500;
+}
+
 EditorTabWidget::EditorTabWidget(QWidget *parent) :
     QTabWidget(parent)
 {
@@ -29,12 +36,17 @@ EditorTabWidget::EditorTabWidget(QWidget *parent) :
     setStyleSheet(style);
 #endif
 
+    connect(this, &EditorTabWidget::currentChanged, this, &EditorTabWidget::on_currentChanged);
 }
 
 EditorTabWidget::~EditorTabWidget()
 {
     // Manually remove each tab to keep m_editorPointers consistent
     for (int i = this->count() - 1; i >= 0; i--) {
+        // Placeholders are plain children, QObject will delete them.
+        if (isPlaceholder(i))
+            continue;
+
         QSharedPointer<Editor> edt = editorSharedPtr(i);
         m_editorPointers.remove(edt.data());
         // Remove the parent so that QObject cannot destroy the
@@ -43,9 +55,82 @@ EditorTabWidget::~EditorTabWidget()
     }
 }
 
-int EditorTabWidget::addEditorTab(bool setFocus, const QString &title)
+int EditorTabWidget::addEditorTab(bool setFocus, const QString &title, int index)
+{
+    return this->rawAddEditorTab(setFocus, title, 0, 0, index);
+}
+
+int EditorTabWidget::addPlaceholderTab(EditorPlaceholder *placeholder, const QString &title, int index)
+{
+    if (count() == 0) {
+        // The first tab becomes the current one right away, so there's nothing to gain by deferring it.
+        Editor *editor = placeholder->load(this, 0);
+        delete placeholder;
+        return editor ? indexOf(editor) : addEditorTab(false, title);
+    }
+
+    m_placeholders.insert(placeholder);
+    index = insertTab(index, placeholder, title);
+
+    setSavedIcon(index, placeholder->isClean());
+
+    const QUrl filePath = placeholder->filePath();
+    if (!filePath.isEmpty())
+        setTabToolTip(index, filePath.toDisplayString(QUrl::PreferLocalFile | QUrl::RemovePassword));
+
+    return index;
+}
+
+EditorPlaceholder *EditorTabWidget::placeholder(int index) const
+{
+    return dynamic_cast<EditorPlaceholder *>(this->widget(index));
+}
+
+void EditorTabWidget::loadPlaceholder(int index)
+{
+    EditorPlaceholder *placeholder = this->placeholder(index);
+    if (!placeholder || placeholder->m_loading)
+        return;
+
+    placeholder->m_loading = true;
+    const QString title = QTabWidget::tabText(index);
+
+    // Loading runs an event loop, so the tabs might change in the meantime.
+    QPointer<Editor> editor = placeholder->load(this, index);
+    const int placeholderIndex = indexOf(placeholder);
+
+    if (placeholderIndex == -1) {
+        // The tab has been closed while it was loading
+        if (editor && indexOf(editor) != -1)
+            removeTab(indexOf(editor));
+        return;
+    }
+
+    if (!editor || indexOf(editor) == -1) {
+        // Don't leave the tab without an Editor, callers of materializeEditor() rely on getting one.
+        editor = this->editor(addEditorTab(false, title, placeholderIndex));
+    }
+
+    if (currentWidget() == placeholder)
+        setCurrentWidget(editor);
+
+    removeTab(indexOf(placeholder));
+}
+
+void EditorTabWidget::prefetchNeighbours(Editor *editor)
 {
-    return this->rawAddEditorTab(setFocus, title, 0, 0);
+    QPointer<Editor> target = editor;
+
+    QTimer::singleShot(PREFETCH_DELAY_MS, this, [this, target]() {
+        // Don't bother if the user has already moved on
+        if (!target || currentWidget() != target)
+            return;
+
+        // Loading a placeholder keeps the indexes of all other tabs intact
+        const int index = indexOf(target);
+        loadPlaceholder(index + 1);
+        loadPlaceholder(index - 1);
+    });
 }
 
 void EditorTabWidget::connectEditorSignals(Editor *editor)
@@ -84,13 +169,18 @@ QString EditorTabWidget::tabText(Editor* editor) const
 
 QString EditorTabWidget::tabText(int index) const
 {
-    return editor(index)->tabName();
+    if (isPlaceholder(index))
+        return QTabWidget::tabText(index);
+
+    return dynamic_cast<Editor *>(this->widget(index))->tabName();
 }
 
 void EditorTabWidget::setTabText(int index, const QString& text)
 {
     QTabWidget::setTabText(index, text);
-    editor(index)->setTabName(text);
+
+    if (!isPlaceholder(index))
+        editor(index)->setTabName(text);
 }
 
 
@@ -115,7 +205,8 @@ int EditorTabWidget::transferEditorTab(bool setFocus, EditorTabWidget *source, i
  *        tab gets moved to another container. Use connectEditorSignals()
  *        and disconnectEditorSignals() methods instead.
  */
-int EditorTabWidget::rawAddEditorTab(const bool setFocus, const QString &title, EditorTabWidget *source, const int sourceTabIndex)
+int EditorTabWidget::rawAddEditorTab(const bool setFocus, const QString &title, EditorTabWidget *source, const int sourceTabIndex,
+                                     const int insertIndex)
 {
 #ifdef QT_DEBUG
     QElapsedTimer __aet_timer;
@@ -148,7 +239,7 @@ int EditorTabWidget::rawAddEditorTab(const bool setFocus, const QString &title,
     // before that happens so it can be displayed properly.
     const QString& tabTitle = create ? title : oldText;
     editor->setTabName(tabTitle);
-    int index = addTab(editor.data(), tabTitle);
+    int index = insertTab(insertIndex, editor.data(), tabTitle);
 
     if (!create) {
         source->disconnectEditorSignals(editor.data());
@@ -189,6 +280,13 @@ int EditorTabWidget::findOpenEditorByUrl(const QUrl &filename)
         absFileName = QUrl::fromLocalFile(QFileInfo(filename.toLocalFile()).absoluteFilePath());
 
     for (int i = 0; i < count(); i++) {
+        // Don't load placeholders just to find out their file path
+        if (EditorPlaceholder *placeholder = this->placeholder(i)) {
+            if (!placeholder->isLoading() && placeholder->filePath() == filename)
+                return i;
+            continue;
+        }
+
         Editor *editor = this->editor(i);
         if (editor->filePath() == filename)
             return i;
@@ -202,9 +300,15 @@ Editor *EditorTabWidget::editor(int index) const
     return dynamic_cast<Editor *>(this->widget(index));
 }
 
+Editor *EditorTabWidget::materializeEditor(int index)
+{
+    loadPlaceholder(index);
+    return editor(index);
+}
+
 QSharedPointer<Editor> EditorTabWidget::editorSharedPtr(int index)
 {
-    return m_editorPointers.value(editor(index));
+    return m_editorPointers.value(materializeEditor(index));
 }
 
 QSharedPointer<Editor> EditorTabWidget::editorSharedPtr(Editor *editor)
@@ -235,17 +339,26 @@ void EditorTabWidget::tabRemoved(int)
             break;
         }
     }
+
+    const QSet<EditorPlaceholder*> placeholders = m_placeholders;
+    for (EditorPlaceholder *placeholder : placeholders) {
+        if (indexOf(placeholder) == -1) {
+            m_placeholders.remove(placeholder);
+            // It might still be loading, see loadPlaceholder()
+            placeholder->deleteLater();
+        }
+    }
 }
 
 Editor *EditorTabWidget::currentEditor()
 {
-    return editor(currentIndex());
+    return materializeEditor(currentIndex());
 }
 
 QString EditorTabWidget::tabTextFromEditor(Editor* ed)
 {
     for(int i=0; i<count(); ++i)
-        if (editor(i) == ed) return tabText(i);
+        if (widget(i) == ed) return tabText(i);
 
     return QString();
 }
@@ -259,8 +372,10 @@ void EditorTabWidget::setZoomFactor(const qreal &zoomFactor)
 {
     m_zoomFactor = zoomFactor;
 
+    // Placeholders get the zoom factor when they're loaded
     for (int i = 0; i < count(); i++) {
-        editor(i)->setZoomFactor(zoomFactor);
+        if (!isPlaceholder(i))
+            editor(i)->setZoomFactor(zoomFactor);
     }
 }
 
@@ -331,6 +446,18 @@ void EditorTabWidget::mouseReleaseEvent(QMouseEvent *ev)
     QTabWidget::mouseReleaseEvent(ev);
 }
 
+void EditorTabWidget::on_currentChanged(int index)
+{
+    if (!isPlaceholder(index))
+        return;
+
+    loadPlaceholder(index);
+
+    // The tabs next to this one are likely to be looked at next
+    if (Editor *editor = dynamic_cast<Editor *>(currentWidget()))
+        prefetchNeighbours(editor);
+}
+
 void EditorTabWidget::on_fileNameChanged(const QUrl & /*oldFileName*/, const QUrl &newFileName)
 {
     Editor *editor = dynamic_cast<Editor *>(sender());
@@ -409,7 +409,7 @@ bool frmPreferences::applySettings()
     for (MainWindow *w : MainWindow::instances()) {
         w->showExtensionsMenu(Extensions::ExtensionsLoader::extensionRuntimePresent());
 
-        w->topEditorContainer()->forEachEditor([&](const int, const int, EditorTabWidget *, Editor *editor) {
+        w->topEditorContainer()->forEachLoadedEditor([&](const int, const int, EditorTabWidget *, Editor *editor) {
 
             // Set new theme
             editor->setTheme(newTheme);
@@ -129,6 +129,19 @@ namespace EditorNS
             int size;
         };
 
+        /**
+         * @brief Everything needed to back up an editor, see backupStateP().
+         */
+        struct BackupState {
+            int historyGeneration = -1;
+            bool clean = true;
+            QPair<int, int> scrollPosition;
+            IndentationMode indentationMode = {true, 4};
+            bool hasValue = false;  // True if 'value' has been retrieved
+            QString value;          // The editor's contents, with "\n" as line separator
+            qint64 journalSeq = 0;  // Number of changes made to the document, see journalEntries()
+        };
+
         /**
              * @brief Adds a new Editor to the internal buffer used by getNewEditor().
              *        You might want to call this method e.g. as soon as the application
@@ -189,6 +202,26 @@ namespace EditorNS
          */
         Q_INVOKABLE QPromise<int> getHistoryGeneration();
 
+        /**
+         * @brief Retrieves the state needed for a backup with a single message.
+         * @param knownGeneration History generation of the previous backup. The editor's
+         *        contents are only retrieved if the editor is dirty and its history
+         *        generation differs from this one.
+         */
+        QPromise<BackupState> backupStateP(int knownGeneration);
+
+        /**
+         * @brief While journaling is enabled, every change made to the document is reported
+         *        through journalEntries(), so it can be recovered after a crash.
+         */
+        void setJournalingEnabled(bool enabled);
+
+        /**
+         * @brief While change deltas are enabled, every change made to the document is reported
+         *        through changeDeltas(). Independent from journaling.
+         */
+        void setChangeDeltasEnabled(bool enabled);
+
         /**
          * @brief Set the language to use for the editor.
          *        It automatically adjusts tab settings from
@@ -201,6 +234,43 @@ namespace EditorNS
         Q_INVOKABLE void setLanguageFromFilePath();
         Q_INVOKABLE QPromise<void> setValue(const QString &value);
         Q_INVOKABLE QString value();
+        QPromise<QString> valueP();
+
+        /**
+         * @brief Replaces the characters between the offsets 'from' and 'to' with 'text'.
+         *        This is a single change: it's undone in one step and only emits
+         *        contentChanged() once.
+         * @param expectedLength Length of the text the offsets refer to. Nothing is
+         *        replaced if the document's length differs, e.g. because it was edited
+         *        after the offsets were computed.
+         * @return A promise for true if the text was replaced.
+         */
+        QPromise<bool> replaceTextRangeP(int from, int to, const QString& text, int expectedLength);
+
+        /**
+         * @brief Returns the lines from 'from' up to, but excluding, 'to'.
+         * @param maxLength Lines are only returned up to about this many characters, but at least one.
+         * @return A map with "lines" and "next", the first line that wasn't returned or -1.
+         */
+        QVariantMap lines(int from, int to, int maxLength);
+
+        /**
+         * @brief Returns the text between two positions, with "\n" as line separator.
+         * @param maxLength At most this many characters are returned.
+         * @return A map with "text" and "next", the [line, column] where the text that
+         *         wasn't returned starts, or null.
+         */
+        QVariantMap textRange(const Cursor& from, const Cursor& to, int maxLength);
+
+        /**
+         * @brief Replaces several ranges of the document in a single undoable step.
+         * @param edits Maps with "from" and "to" ([line, column], both referring to the document
+         *              before any of the edits) and "text". The ranges must not overlap.
+         * @param expectedSeq If not negative, nothing is changed unless the document has been
+         *                    changed exactly this many times, see BackupState::journalSeq.
+         * @return A map with "applied" and "seq", the number of changes after applying the edits.
+         */
+        QVariantMap applyEdits(const QVariantList& edits, qint64 expectedSeq);
 
         /**
          * @brief Set custom indentation settings which may be different
@@ -336,6 +406,8 @@ namespace EditorNS
         QTextCodec *m_codec = QTextCodec::codecForName("UTF-8");
         bool m_bom = false;
         bool m_customIndentationMode = false;
+        bool m_journalingEnabled = false;
+        bool m_changeDeltasEnabled = false;
         const Language* m_currentLanguage = nullptr;
         inline void waitAsyncLoad();
         QString jsStringEscape(QString str) const;
@@ -361,6 +433,28 @@ namespace EditorNS
         void cursorActivity(QMap<QString, QVariant> data);
         void documentInfoRequested(QMap<QString, QVariant> data);
         void cleanChanged(bool isClean);
+
+        /**
+         * @brief Changes made to the document while journaling is enabled, see
+         *        EditJournal::entriesFromVariant().
+         */
+        void journalEntries(const QVariantList& entries);
+
+        /**
+         * @brief Changes made to the document while change deltas are enabled,
+         *        in the same format as journalEntries().
+         */
+        void changeDeltas(const QVariantList& entries);
+
+        /**
+         * @brief The number of matches of the search started with
+         *        C_CMD_SEARCH_HIGHLIGHT_ALL changed.
+         * @param count Number of matches found so far, or -1 if the search
+         *        can't be counted.
+         * @param complete True if the whole document has been searched.
+         */
+        void searchMatchCountChanged(int count, bool complete);
+
         void fileNameChanged(const QUrl &oldFileName, const QUrl &newFileName);
 
         /**
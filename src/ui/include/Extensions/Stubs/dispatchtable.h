@@ -0,0 +1,57 @@
+#ifndef EXTENSIONS_STUBS_DISPATCHTABLE_H
+#define EXTENSIONS_STUBS_DISPATCHTABLE_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QMetaMethod>
+#include <QPair>
+#include <QSharedPointer>
+#include <QVariant>
+#include <QVector>
+
+namespace Extensions {
+    namespace Stubs {
+
+        /**
+         * @brief The DispatchTable class calls the public methods of a QObject by name, with
+         *        arguments received from an extension.
+         *
+         *        Methods are resolved once per class: a call is a hash lookup by name and number of
+         *        arguments, followed by the conversion of the arguments and the invocation.
+         *        Methods with parameter or return types unknown to QMetaType can't be called.
+         */
+        class DispatchTable
+        {
+        public:
+            explicit DispatchTable(const QMetaObject *metaObject);
+
+            /**
+             * @brief Returns the table of a class, building it on first use.
+             *        Must only be called from the GUI thread.
+             */
+            static QSharedPointer<const DispatchTable> forMetaObject(const QMetaObject *metaObject);
+
+            /**
+             * @brief Invokes the first overload of 'method' that accepts 'args'.
+             * @param ret Return value of the method, null if it returns void.
+             * @return False if no overload accepts the arguments.
+             */
+            bool invoke(QObject *object, const QString &method, const QJsonArray &args, QVariant &ret) const;
+
+        private:
+            struct Method {
+                QMetaMethod metaMethod;
+                QVector<int> parameterTypes;
+                int returnType;
+            };
+
+            // Overloads by method name and number of parameters, in declaration order
+            QHash<QPair<QString, int>, QVector<Method>> m_methods;
+
+            static bool convertArguments(const Method &method, const QJsonArray &args, QVariantList &converted);
+        };
+
+    }
+}
+
+#endif // EXTENSIONS_STUBS_DISPATCHTABLE_H
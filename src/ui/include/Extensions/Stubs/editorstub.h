@@ -5,6 +5,7 @@
 #include "include/Extensions/Stubs/stub.h"
 
 #include <QObject>
+#include <QSet>
 
 namespace Extensions {
     namespace Stubs {
@@ -21,8 +22,16 @@ namespace Extensions {
             NQQ_DECLARE_EXTENSION_METHOD(setValue)
             NQQ_DECLARE_EXTENSION_METHOD(value)
             NQQ_DECLARE_EXTENSION_METHOD(setSelectionsText)
+            NQQ_DECLARE_EXTENSION_METHOD(getLines)
+            NQQ_DECLARE_EXTENSION_METHOD(getRange)
+            NQQ_DECLARE_EXTENSION_METHOD(applyEdits)
+            NQQ_DECLARE_EXTENSION_METHOD(setChangeDeltasEnabled)
+
+            QSet<quint64> m_changeDeltaClients;     // Clients that enabled the change deltas
 
             EditorNS::Editor *editor();
+            void setChangeDeltasEnabled(quint64 clientId, bool enabled);
+            static bool toCursor(const QJsonValue &value, EditorNS::Editor::Cursor &cursor);
         };
 
     }
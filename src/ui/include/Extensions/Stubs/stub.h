@@ -22,6 +22,8 @@
 #ifndef EXTENSIONS_STUBS_STUB_H
 #define EXTENSIONS_STUBS_STUB_H
 
+#include "include/Extensions/stubregistry.h"
+
 #include <QHash>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -109,6 +111,11 @@ namespace Extensions {
 
             QString convertToString(const QJsonValue &value);
 
+            /**
+             * @brief Identifies the object referenced by this stub, even after it has been destroyed.
+             */
+            StubIdentity identity() const;
+
             bool operator ==(const Stub &other) const;
             bool operator !=(const Stub &other) const;
         signals:
@@ -130,8 +137,8 @@ namespace Extensions {
             QWeakPointer<QObject> m_weakPointer;
             QSharedPointer<QObject> m_sharedPointer;
             QObject *m_unmanagedPointer = nullptr;
+            const void *m_object = nullptr;
             QHash<QString, std::function<StubReturnValue (const QJsonArray &)>> m_methods;
-            QVariant genericCall(QObject *object, QMetaMethod metaMethod, QVariantList args, ErrorCode &error);
             bool invokeOnRealObject(const QString &method, Stub::StubReturnValue &ret, const QJsonArray &args);
         };
 
@@ -0,0 +1,35 @@
+#ifndef ACTIVATIONEVENTS_H
+#define ACTIVATIONEVENTS_H
+
+#include <QJsonObject>
+#include <QStringList>
+
+namespace Extensions {
+
+    /**
+     * @brief The "activationEvents" of an extension manifest:
+     *        - "onStartup" (or "*"): as soon as the extensions are loaded. This is the default
+     *          for manifests without "activationEvents".
+     *        - "onLanguage:<id>": when a document switches to the language <id>.
+     *        - "onCommand:<id>": when the user invokes the command <id>, declared in the
+     *          "commands" array of the manifest as { "id": ..., "title": ... }.
+     */
+    class ActivationEvents
+    {
+    public:
+        static const QString STARTUP_EVENT;
+        static QString languageEvent(const QString &languageId);
+        static QString commandEvent(const QString &commandId);
+
+        ActivationEvents() = default;
+        explicit ActivationEvents(const QJsonObject &manifest);
+
+        bool contains(const QString &event) const;
+
+    private:
+        QStringList m_events;
+    };
+
+}
+
+#endif // ACTIVATIONEVENTS_H
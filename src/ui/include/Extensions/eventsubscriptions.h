@@ -0,0 +1,79 @@
+#ifndef EVENTSUBSCRIPTIONS_H
+#define EVENTSUBSCRIPTIONS_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+namespace Extensions {
+
+    /**
+     * @brief Decides which clients receive an event, and delays and merges the frequent ones.
+     *
+     *        A client receives every event until it subscribes to something. From then on, it
+     *        only receives the events it subscribed to, even after unsubscribing from all of them.
+     */
+    class EventSubscriptions : public QObject
+    {
+        Q_OBJECT
+    public:
+        static const int COALESCE_INTERVAL_MS = 50;
+
+        explicit EventSubscriptions(QObject *parent = 0);
+
+        void addClient(quint64 clientId);
+        void removeClient(quint64 clientId);
+
+        void subscribe(quint64 clientId, qint64 objectId, const QStringList &events);
+        void unsubscribe(quint64 clientId, qint64 objectId, const QStringList &events);
+
+        QVector<quint64> subscribers(qint64 objectId, const QString &event) const;
+
+        /**
+         * @brief Emits deliver() for the subscribers of the event.
+         * @param coalesce If true, the event is delivered COALESCE_INTERVAL_MS later, and replaced
+         *                 by any newer instance of it in the meantime.
+         */
+        void publish(qint64 objectId, const QString &event, const QJsonObject &message, bool coalesce = false);
+
+        /**
+         * @brief Emits deliver() for the given clients, whatever they subscribed to, after the
+         *        pending coalesced events.
+         */
+        void publishTo(const QVector<quint64> &clientIds, const QJsonObject &message);
+
+        /**
+         * @brief Delivers the coalesced events right away.
+         */
+        void flush();
+
+    signals:
+        void deliver(const QVector<quint64> &clientIds, const QJsonObject &message);
+
+    private:
+        // Object id and event name
+        typedef QPair<qint64, QString> Subscription;
+
+        struct Client {
+            bool subscribed = false;    // Only receives the events in 'subscriptions'
+            QSet<Subscription> subscriptions;
+        };
+
+        QHash<quint64, Client> m_clients;
+        QHash<Subscription, QVector<quint64>> m_subscribers;
+        QList<Subscription> m_pendingEvents;    // Coalesced events, in order
+        QHash<Subscription, QJsonObject> m_pendingMessages;
+        QTimer m_coalesceTimer;
+
+        QVector<quint64> subscribers(const Subscription &subscription) const;
+        void removeSubscriber(const Subscription &subscription, quint64 clientId);
+    };
+
+}
+
+#endif // EVENTSUBSCRIPTIONS_H
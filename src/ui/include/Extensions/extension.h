@@ -1,31 +1,100 @@
 #ifndef EXTENSION_H
 #define EXTENSION_H
 
+#include "include/Extensions/activationevents.h"
+#include "include/Extensions/restartpolicy.h"
+
+#include <QElapsedTimer>
+#include <QJsonObject>
 #include <QObject>
 #include <QProcess>
+#include <QStringList>
 
 namespace Extensions {
 
+    /**
+     * @brief An installed extension. Its runtime is only started when one of the
+     *        activation events listed in its manifest fires, see ActivationEvents.
+     *
+     *        The event that started the runtime is passed as its last argument.
+     *
+     *        A runtime that crashes or exits with an error is restarted as decided by RestartPolicy.
+     *        When the policy gives up, the extension is marked as failed.
+     */
     class Extension : public QObject
     {
         Q_OBJECT
     public:
-        explicit Extension(QString path, QString serverSocketPath);
+        struct Command {
+            QString id;
+            QString title;
+        };
+
+        enum class State {
+            Inactive,       // Not started, or exited normally
+            Running,
+            Restarting,     // Crashed, waiting to be started again
+            Failed          // Couldn't be started, or crashed too many times
+        };
+
+        explicit Extension(QString path, const QJsonObject &manifest, QString serverSocketPath);
         ~Extension();
 
         QString id() const;
         QString name() const;
+        QString path() const;
+        QList<Command> commands() const;
+
+        /**
+         * @brief False if the manifest is missing or invalid. Such an extension is never started.
+         */
+        bool isValid() const;
+        bool isActive() const;
+        State state() const;
+        qint64 processId() const;
+        int restartCount() const;
+        bool activatesOn(const QString &event) const;
+
+        /**
+         * @brief Starts the runtime of the extension, if it isn't running yet.
+         * @param event Activation event that caused the start.
+         */
+        void activate(const QString &event);
+
+        /**
+         * @brief Kills the runtime, which is then restarted like after a crash.
+         */
+        void terminate(const QString &reason);
+
         static QJsonObject getManifest(const QString &extensionPath);
     signals:
+        /**
+         * @brief Emitted when the runtime exits and won't be restarted.
+         */
+        void stopped();
 
     public slots:
 
     private slots:
         void on_processError(QProcess::ProcessError error);
+        void on_processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+        void startHost();
     private:
+
         QString m_extensionId;
         QString m_name;
+        QString m_path;
         QString m_runtime;
+        QString m_main;
+        QString m_serverSocketPath;
+        ActivationEvents m_activationEvents;
+        QList<Command> m_commands;
+        bool m_valid = false;
+        State m_state = State::Inactive;
+        QString m_activationEvent;
+        QElapsedTimer m_runTime;
+        int m_restarts = 0;
+        RestartPolicy m_restartPolicy;
         void failedToLoadExtension(QString path, QString reason);
         QProcess *process = nullptr;
     };
@@ -0,0 +1,45 @@
+#ifndef EXTENSIONDIAGNOSTICS_H
+#define EXTENSIONDIAGNOSTICS_H
+
+#include <QDialog>
+#include <QTimer>
+
+class QTableWidget;
+
+namespace Extensions {
+
+    /**
+     * @brief Shows the state, resource usage and request latency of every started extension,
+     *        refreshed every second.
+     */
+    class ExtensionDiagnostics : public QDialog
+    {
+        Q_OBJECT
+    public:
+        explicit ExtensionDiagnostics(QWidget *parent = 0);
+
+    private slots:
+        void refresh();
+
+    private:
+        enum Column {
+            ColumnName,
+            ColumnState,
+            ColumnProcessId,
+            ColumnCpu,
+            ColumnMemory,
+            ColumnRestarts,
+            ColumnRequests,
+            ColumnRequestsPerSecond,
+            ColumnAverageLatency,
+            ColumnMaxLatency,
+            ColumnCount
+        };
+
+        QTableWidget *m_table;
+        QTimer m_refreshTimer;
+    };
+
+}
+
+#endif // EXTENSIONDIAGNOSTICS_H
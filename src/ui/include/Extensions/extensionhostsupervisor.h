@@ -0,0 +1,92 @@
+#ifndef EXTENSIONHOSTSUPERVISOR_H
+#define EXTENSIONHOSTSUPERVISOR_H
+
+#include "include/Extensions/extension.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+
+namespace Extensions {
+
+    /**
+     * @brief The ExtensionHostSupervisor class decides when the extension hosts are started,
+     *        and keeps an eye on them while they run.
+     *
+     *        At most Extensions.MaxHostProcesses hosts run at the same time: activations beyond
+     *        that wait for another host to stop. Hosts that use more than Extensions.MaxHostMemoryMB
+     *        of memory, or more than Extensions.MaxHostCpuPercent of a core for several seconds,
+     *        are terminated and then restarted by their Extension like after a crash.
+     *
+     *        Resource usage is only available on Linux.
+     */
+    class ExtensionHostSupervisor : public QObject
+    {
+        Q_OBJECT
+    public:
+        struct HostStats {
+            QString extensionId;
+            QString name;
+            Extension::State state = Extension::State::Inactive;
+            qint64 processId = 0;
+            double cpuPercent = -1;     // Of a single core, -1 if unknown
+            qint64 memoryKB = -1;       // Resident set size, -1 if unknown
+            int restarts = 0;
+        };
+
+        explicit ExtensionHostSupervisor(QObject *parent = 0);
+
+        /**
+         * @brief Activates the extension, as soon as there is room for another host.
+         */
+        void start(QSharedPointer<Extension> extension, const QString &event);
+
+        /**
+         * @brief Stats of the extensions started so far.
+         */
+        QVector<HostStats> stats() const;
+
+    private slots:
+        void sample();
+        void on_extensionStopped();
+
+    private:
+        struct Usage {
+            qint64 processId = 0;
+            qint64 cpuTicks = -1;
+            qint64 sampledAt = 0;
+            double cpuPercent = -1;
+            qint64 memoryKB = -1;
+            int busySamples = 0;    // Consecutive samples above the CPU limit
+        };
+
+        struct PendingActivation {
+            QWeakPointer<Extension> extension;
+            QString event;
+        };
+
+        static const int SAMPLE_INTERVAL_MS = 2000;
+        static const int MAX_BUSY_SAMPLES = 5;
+
+        QHash<QString, QWeakPointer<Extension>> m_hosts;
+        QHash<QString, Usage> m_usage;
+        QList<PendingActivation> m_pending;
+        QTimer m_sampleTimer;
+        QElapsedTimer m_clock;
+
+        int activeHosts() const;
+        void startPending();
+
+        /**
+         * @brief Reads the CPU time and resident memory of a process.
+         * @return False if they're not available on this platform.
+         */
+        static bool readUsage(qint64 processId, qint64 &cpuTicks, qint64 &memoryKB);
+    };
+
+}
+
+#endif // EXTENSIONHOSTSUPERVISOR_H
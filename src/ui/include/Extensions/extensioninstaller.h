@@ -0,0 +1,79 @@
+#ifndef EXTENSIONINSTALLER_H
+#define EXTENSIONINSTALLER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <functional>
+
+namespace Extensions {
+
+    /**
+     * @brief The ExtensionInstaller class installs a nodejs extension package without blocking
+     *        the GUI thread. File operations run on a worker thread, npm runs asynchronously and
+     *        its output is streamed through output().
+     *
+     *        Packages are unpacked into a cache keyed by their content, so installing the same
+     *        package again skips unpacking. If anything fails, the previously installed version
+     *        of the extension is restored.
+     */
+    class ExtensionInstaller : public QObject
+    {
+        Q_OBJECT
+    public:
+        /**
+         * @param extensionPath Folder the extension is installed into. It is replaced if it exists.
+         */
+        explicit ExtensionInstaller(const QString &packagePath, const QString &extensionPath, QObject *parent = 0);
+        ~ExtensionInstaller();
+
+        void start();
+        bool isRunning() const;
+
+    signals:
+        /**
+         * @param maximum 0 if the duration of the current step is unknown.
+         */
+        void progress(int value, int maximum);
+        void statusChanged(const QString &status);
+        void output(const QString &text);
+        void finished(bool success, const QString &message);
+
+    private:
+        typedef void (ExtensionInstaller::*Step)();
+
+        QString m_packagePath;
+        QString m_extensionPath;
+        QString m_backupPath;
+        QString m_tarball;
+        QString m_error;
+        bool m_running = false;
+        bool m_backedUp = false;    // The installed version was moved to m_backupPath
+        bool m_replacing = false;   // m_extensionPath contains the new version, maybe partially
+        QThreadPool m_pool;
+
+        /**
+         * @brief Runs 'work' on the worker thread, then 'next' on this thread if it succeeded.
+         *        'work' sets m_error when it fails.
+         */
+        void runInBackground(const std::function<bool()> &work, Step next);
+        void runNpm(const QStringList &args, Step next);
+
+        // Steps, in order
+        bool unpack();
+        void npmInstall();
+        void flattenModule();
+        void npmRebuild();
+        void removeBackup();
+        void succeed();
+
+        void fail(const QString &message);
+        bool restoreBackup();
+
+        static bool copyRecursively(const QString &source, const QString &destination);
+    };
+
+}
+
+#endif // EXTENSIONINSTALLER_H
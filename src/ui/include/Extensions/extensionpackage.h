@@ -0,0 +1,81 @@
+#ifndef EXTENSIONPACKAGE_H
+#define EXTENSIONPACKAGE_H
+
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <functional>
+
+namespace Extensions {
+
+    /**
+     * @brief Reads .nqqext extension packages, which are zip archives containing
+     *        nqq-manifest.json and the npm tarball of the extension.
+     *
+     *        Entries can be stored or deflated. Encrypted entries and zip64 archives are
+     *        not supported. Only QtCore is used, so packages can be read on any thread.
+     */
+    class ExtensionPackage
+    {
+    public:
+        static const QString MANIFEST_FILENAME;
+
+        explicit ExtensionPackage(const QString &path);
+
+        /**
+         * @brief Reads the list of entries. Must be called before anything else.
+         */
+        bool open();
+        QString errorString() const;
+
+        QStringList entries() const;
+
+        /**
+         * @brief Returns the uncompressed contents of an entry, checking their CRC.
+         *        Returns a null array on errors.
+         */
+        QByteArray read(const QString &entryName);
+
+        /**
+         * @brief Parses the manifest of the package. Returns an empty object on errors.
+         */
+        QJsonObject manifest();
+
+        /**
+         * @brief Extracts every entry into the directory, which is created if needed.
+         *        Entries pointing outside of it are rejected.
+         * @param progress Called after each entry with the number of entries extracted.
+         */
+        bool extractAll(const QString &destination, const std::function<void(int, int)> &progress = nullptr);
+
+        /**
+         * @brief Decompresses a raw deflate stream (RFC 1951).
+         * @param maxSize Size of the result, used to preallocate it. Decompression fails as soon as
+         *                the result grows larger than this. -1 means unlimited.
+         * @return A null array if the stream is invalid or too large.
+         */
+        static QByteArray inflate(const QByteArray &data, int maxSize = -1);
+
+        static quint32 crc32(const QByteArray &data);
+
+    private:
+        struct Entry {
+            quint16 method = 0;
+            quint16 flags = 0;
+            quint32 crc = 0;
+            quint32 compressedSize = 0;
+            quint32 size = 0;
+            quint32 localHeaderOffset = 0;
+        };
+
+        QFile m_file;
+        QStringList m_entryNames;   // In archive order
+        QHash<QString, Entry> m_entries;
+        QString m_error;
+    };
+
+}
+
+#endif // EXTENSIONPACKAGE_H
@@ -0,0 +1,161 @@
+#ifndef EXTENSIONSCONNECTIONS_H
+#define EXTENSIONSCONNECTIONS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+class QLocalServer;
+class QLocalSocket;
+
+namespace Extensions {
+
+    /**
+     * @brief The ExtensionsConnections class owns the sockets of the extensions, on the I/O thread of
+     *        ExtensionsServer. It does the reading, framing, parsing and serialization of both
+     *        protocols, so that the GUI thread only sees requests and replies as JSON objects.
+     *
+     *        All requests read from a connection at once are handed over in a single batch by
+     *        requestsReceived(), and their replies must be sent back in the same order with sendReplies().
+     *        A connection that sends more than setMaxRequestsPerSecond() requests is throttled: the rest of
+     *        its data stays in the socket until it's allowed to send more.
+     *
+     *        Messages sent to a client before it chose its protocol are held back and sent in the
+     *        chosen encoding, right after the handshake. A client that doesn't send anything within
+     *        NEGOTIATION_TIMEOUT_MS is assumed to use JSON, so that clients waiting for the first
+     *        event keep working.
+     */
+    class ExtensionsConnections : public QObject
+    {
+        Q_OBJECT
+    public:
+        struct ClientMetrics {
+            quint64 clientId = 0;
+            qint64 requests = 0;            // Requests answered
+            double requestsPerSecond = 0;   // Over the last second or so
+            double averageLatencyMs = 0;    // From reading a request to writing its reply
+            qint64 maxLatencyMs = 0;
+            qint64 throttled = 0;           // Times the connection had to wait because of the rate limit
+        };
+
+        explicit ExtensionsConnections(QObject *parent = 0);
+        ~ExtensionsConnections();
+
+        /**
+         * @brief Sent by the client to use the binary protocol, and echoed by the server.
+         *        The last byte is the protocol version.
+         */
+        static const QByteArray BINARY_HANDSHAKE;
+
+        static const int NEGOTIATION_TIMEOUT_MS;
+
+        /**
+         * @brief Returns the name of the server, once listen() succeeded.
+         */
+        QString fullServerName() const;
+
+        /**
+         * @brief Can be called from any thread.
+         */
+        QVector<ClientMetrics> metrics() const;
+
+    public slots:
+        bool listen(const QString &name);
+
+        /**
+         * @brief Sends the replies to the oldest batch of requests of a client.
+         */
+        void sendReplies(quint64 clientId, const QVector<QJsonObject> &replies);
+
+        /**
+         * @brief Sends a message to some clients, encoding it only once per protocol.
+         */
+        void sendMessage(const QVector<quint64> &clientIds, const QJsonObject &message);
+
+        /**
+         * @brief Limits the requests of each client. 0 means unlimited.
+         */
+        void setMaxRequestsPerSecond(int requests);
+
+    signals:
+        void clientConnected(quint64 clientId);
+        void clientDisconnected(quint64 clientId);
+        void requestsReceived(quint64 clientId, const QVector<QJsonObject> &requests);
+
+    private:
+        enum class Protocol {
+            Unknown,    // Nothing received yet
+            Json,
+            Binary
+        };
+
+        // Requests read together, whose replies are written together
+        struct Batch {
+            QVector<int> sizes;         // Binary protocol: number of requests per frame, -1 if not an array
+            QVector<QJsonValue> ids;    // Binary protocol: id of every request
+            int requests = 0;
+            qint64 receivedAt = 0;
+        };
+
+        struct Client {
+            quint64 id = 0;
+            QLocalSocket *socket = nullptr;
+            Protocol protocol = Protocol::Unknown;
+            QQueue<Batch> batches;      // Waiting for their replies
+            QVector<QJsonObject> pendingMessages;   // Sent before the protocol was known
+
+            double tokens = 0;          // Requests it can send right now
+            qint64 lastRefill = 0;
+            qint64 windowStart = 0;
+            qint64 windowRequests = 0;
+            qint64 totalLatencyMs = 0;
+        };
+
+        QLocalServer *m_server = nullptr;
+        QString m_fullServerName;
+        QHash<quint64, Client> m_clients;
+        QSet<quint64> m_throttledClients;
+        QHash<quint64, ClientMetrics> m_metrics;
+        quint64 m_lastClientId = 0;
+        int m_maxRequestsPerSecond = 0;
+        QElapsedTimer m_clock;
+        QTimer *m_throttleTimer = nullptr;
+        mutable QMutex m_mutex;     // Protects m_fullServerName and the metrics
+
+        void on_newConnection();
+        void on_readyRead(quint64 clientId);
+        void on_disconnected(quint64 clientId);
+        void on_negotiationTimeout(quint64 clientId);
+        void resumeThrottledClients();
+
+        /**
+         * @brief Reads the handshake, if the client sent one, and decides which protocol to use.
+         * @return False if more data is needed to decide.
+         */
+        bool negotiateProtocol(Client &client);
+        void sendPendingMessages(Client &client);
+        static QByteArray encodeMessage(Protocol protocol, const QJsonObject &message);
+        void readJsonRequests(Client &client, QVector<QJsonObject> &requests, bool &throttled);
+
+        /**
+         * @return False if the client sent invalid data and must be disconnected.
+         */
+        bool readBinaryRequests(Client &client, Batch &batch, QVector<QJsonObject> &requests, bool &throttled);
+
+        /**
+         * @brief Returns true if the rate limit allows the client to send that many more requests.
+         *        -1 means an unknown number.
+         */
+        bool canRead(Client &client, int requests = 1);
+    };
+
+}
+
+#endif // EXTENSIONSCONNECTIONS_H
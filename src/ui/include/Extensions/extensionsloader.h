@@ -2,6 +2,7 @@
 #define EXTENSIONLOADER_H
 
 #include "include/Extensions/extension.h"
+#include "include/Extensions/extensionhostsupervisor.h"
 #include "include/Extensions/extensionsserver.h"
 
 #include <QObject>
@@ -18,9 +19,27 @@ namespace Extensions {
          */
         static QSharedPointer<Extensions::ExtensionsServer> startExtensionsServer();
         static QSharedPointer<ExtensionsServer> startExtensionsServer(QString name);
+        /**
+         * @brief Reads the manifests of the extensions in the directory, and starts
+         *        those that activate on startup. The others are started by activate().
+         *        Manifests are read in parallel, and cached until they are modified.
+         */
         static void loadExtensions(QString path);
+
+        /**
+         * @brief Starts every extension waiting for the event. See Extension for the events.
+         */
+        static void activate(const QString &event);
+
+        /**
+         * @brief Runs a command declared in the manifest of an extension. If the extension isn't
+         *        running, it is started with the command as activation event. Otherwise,
+         *        it receives a "commandInvoked" event with its id and the command id.
+         */
+        static void invokeCommand(const QString &extensionId, const QString &commandId);
         static QMap<QString, QSharedPointer<Extension>> loadedExtensions();
         static QSharedPointer<ExtensionsServer> extensionsServer();
+        static QSharedPointer<ExtensionHostSupervisor> hostSupervisor();
         static bool extensionRuntimePresent();
 
     signals:
@@ -32,6 +51,7 @@ namespace Extensions {
         ~ExtensionsLoader();
 
         static QSharedPointer<ExtensionsServer> m_extensionsServer;
+        static QSharedPointer<ExtensionHostSupervisor> m_hostSupervisor;
         static QMap<QString, QSharedPointer<Extension>> m_extensions;
     };
 
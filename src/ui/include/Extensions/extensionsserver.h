@@ -1,13 +1,45 @@
 #ifndef EXTENSIONSSERVER_H
 #define EXTENSIONSSERVER_H
 
+#include "include/Extensions/eventsubscriptions.h"
+#include "include/Extensions/extensionsconnections.h"
 #include "include/Extensions/runtimesupport.h"
 
-#include <QLocalServer>
+#include <QHash>
 #include <QObject>
+#include <QQueue>
+#include <QThread>
 
 namespace Extensions {
 
+    /**
+     * @brief The ExtensionsServer class talks to the extension runtimes through a local socket.
+     *
+     *        By default, requests, replies and events are newline-delimited JSON objects, and
+     *        every request is answered in order.
+     *
+     *        A client can switch to a binary protocol by sending ExtensionsConnections::BINARY_HANDSHAKE
+     *        before anything else. The server answers with the same handshake if it supports the protocol (Qt 5.12
+     *        or later), or with version 0 and keeps using JSON. Afterwards, every message is a frame:
+     *        a big-endian quint32 size followed by a single CBOR value.
+     *        - A request is a map with "id", "objectId", "method" and "args". Its reply is the
+     *          usual reply map plus the request's "id", so a client can have many requests in
+     *          flight and match the replies in any order.
+     *        - An array of requests is a batch. It is answered with a single frame containing the
+     *          array of replies.
+     *        - Events are maps without "id".
+     *
+     *        Every client receives every event, until it calls the "$subscribe" method of an object
+     *        with the names of the events it is interested in. From then on, it only receives the
+     *        events it subscribed to. "$unsubscribe" undoes a subscription, but doesn't bring
+     *        back the events the client never subscribed to. See EventSubscriptions.
+     *
+     *        A client can call "$identify" with the id of its extension (any objectId), so that
+     *        its metrics can be attributed to it.
+     *
+     *        The sockets are handled by ExtensionsConnections on a separate I/O thread. Only the
+     *        requests themselves are handled on the GUI thread, in batches.
+     */
     class ExtensionsServer : public QObject
     {
         Q_OBJECT
@@ -16,25 +48,61 @@ namespace Extensions {
         ~ExtensionsServer();
         bool startServer(QString name);
         void broadcastMessage(const QJsonObject &message);
+
+        /**
+         * @brief Sends an event to the clients that subscribed to it.
+         * @param coalesce If true, the event is delivered a little later, and replaced by any
+         *                 newer instance of it in the meantime. Meant for frequent events
+         *                 where only the last one is relevant.
+         */
+        void publishEvent(qint64 objectId, const QString &event, const QJsonObject &message, bool coalesce = false);
+
+        /**
+         * @brief Sends an event to some clients only, whatever they subscribed to.
+         */
+        void publishEventTo(const QVector<quint64> &clientIds, const QJsonObject &message);
+
         QSharedPointer<RuntimeSupport> runtimeSupport();
         QString socketPath();
 
+        /**
+         * @brief Request rate and latency of every connected extension. Each extension
+         *        runs in its own process, with its own connection.
+         */
+        QVector<ExtensionsConnections::ClientMetrics> metrics() const;
+
+        /**
+         * @brief Id of the extension that identified itself on the connection, if any.
+         */
+        QString extensionId(quint64 clientId) const;
+
     signals:
 
     public slots:
 
     private slots:
-        void on_newConnection();
+        void on_clientConnected(quint64 clientId);
+        void on_clientDisconnected(quint64 clientId);
+        void on_requestsReceived(quint64 clientId, const QVector<QJsonObject> &requests);
 
     private:
+        struct Client {
+            bool busy = false;          // Requests are being handled
+            QQueue<QVector<QJsonObject>> batches;   // Received while busy
+            QString extensionId;        // Set by "$identify"
+        };
+
         QSharedPointer<RuntimeSupport> m_extensionsRTS;
-        QLocalServer *m_server;
-        QString m_bufferedData = "";
-        QList<QLocalSocket *> m_sockets;
+        QThread m_ioThread;
+        ExtensionsConnections *m_connections;
+        QHash<quint64, Client> m_clients;
+        EventSubscriptions m_subscriptions;
+
+        void sendMessage(const QVector<quint64> &clientIds, const QJsonObject &message);
 
-        void on_clientMessage(QLocalSocket *socket);
-        void on_socketDisconnected(QLocalSocket *socket);
-        void sendMessage(QLocalSocket *socket, const QJsonObject &message);
+        QJsonObject handleRequest(quint64 clientId, const QJsonObject &request);
+        QJsonObject subscribe(quint64 clientId, const QJsonObject &request, bool add);
+        QJsonObject identify(quint64 clientId, const QJsonObject &request);
     };
 
 }
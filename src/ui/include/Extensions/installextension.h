@@ -9,6 +9,8 @@ class InstallExtension;
 
 namespace Extensions {
 
+    class ExtensionInstaller;
+
     class InstallExtension : public QDialog
     {
         Q_OBJECT
@@ -17,20 +19,26 @@ namespace Extensions {
         explicit InstallExtension(const QString &extensionFilename, QWidget *parent = 0);
         ~InstallExtension();
 
+    public slots:
+        void reject() override;
+
     private slots:
         void on_btnCancel_clicked();
         void on_btnInstall_clicked();
+        void on_installerFinished(bool success, const QString &message);
 
     private:
         Ui::InstallExtension *ui;
         QString m_extensionFilename;
         QString m_uniqueName;
         QString m_runtime;
+        QString m_output;
+        ExtensionInstaller *m_installer = nullptr;
 
-        static QString readExtensionManifest(const QString &archivePath);
         void installNodejsExtension(const QString &packagePath);
         static QString getAbsoluteExtensionFolder(const QString &extensionsPath, const QString &extensionUniqueName);
         void setUIClean(bool success);
+        void showError(const QString &message);
     };
 
 }
@@ -0,0 +1,47 @@
+#ifndef MANIFESTCACHE_H
+#define MANIFESTCACHE_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+namespace Extensions {
+
+    /**
+     * @brief Reads the manifests of the installed extensions, keeping a copy of them in a
+     *        single file. A manifest is only parsed again if its size or modification time changed.
+     */
+    class ManifestCache
+    {
+    public:
+        struct Entry {
+            QString path;           // Directory of the extension
+            QJsonObject manifest;   // Empty if missing or invalid
+        };
+
+        explicit ManifestCache(const QString &cachePath);
+
+        /**
+         * @brief Returns every extension directory in extensionsPath. Manifests are read in
+         *        parallel, and the cache file is rewritten if anything changed.
+         */
+        QVector<Entry> scan(const QString &extensionsPath);
+
+        /**
+         * @brief Number of manifests that weren't in the cache during the last scan().
+         */
+        int misses() const;
+
+        /**
+         * @brief Parses the nqq-manifest.json of an extension.
+         */
+        static QJsonObject readManifest(const QString &extensionPath);
+
+    private:
+        QString m_cachePath;
+        int m_misses = 0;
+    };
+
+}
+
+#endif // MANIFESTCACHE_H
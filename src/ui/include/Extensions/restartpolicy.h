@@ -0,0 +1,42 @@
+#ifndef RESTARTPOLICY_H
+#define RESTARTPOLICY_H
+
+#include <QtGlobal>
+
+namespace Extensions {
+
+    /**
+     * @brief Decides whether, and when, a crashed extension host is restarted.
+     *
+     *        The delay doubles after every crash, from INITIAL_DELAY_MS up to MAX_DELAY_MS.
+     *        After MAX_CONSECUTIVE_CRASHES crashes in a row the host isn't restarted anymore.
+     *        A host that ran for STABLE_RUN_MS before crashing starts a new series.
+     */
+    class RestartPolicy
+    {
+    public:
+        static const int INITIAL_DELAY_MS = 1000;
+        static const int MAX_DELAY_MS = 60 * 1000;
+        static const int STABLE_RUN_MS = 60 * 1000;
+        static const int MAX_CONSECUTIVE_CRASHES = 5;
+
+        /**
+         * @param runTimeMs How long the host ran before crashing.
+         * @return Milliseconds to wait before restarting, or -1 to give up.
+         */
+        int crashed(qint64 runTimeMs);
+
+        /**
+         * @brief Forgets the previous crashes.
+         */
+        void reset();
+
+        int consecutiveCrashes() const;
+
+    private:
+        int m_consecutiveCrashes = 0;
+    };
+
+}
+
+#endif // RESTARTPOLICY_H
@@ -2,11 +2,13 @@
 #define EXTENSIONSRTS_H
 
 #include "include/Extensions/Stubs/stub.h"
+#include "include/Extensions/stubregistry.h"
 
-#include <QHash>
 #include <QJsonObject>
 #include <QObject>
 #include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
 
 namespace Extensions {
 
@@ -19,22 +21,56 @@ namespace Extensions {
         explicit RuntimeSupport(QObject *parent = 0);
         ~RuntimeSupport();
 
-        QJsonObject handleRequest(const QJsonObject &request);
+        /**
+         * @brief Handles a request of an extension.
+         * @param clientId Connection the request comes from. The objects presented while
+         *                 handling the request are kept alive as long as it is connected.
+         */
+        QJsonObject handleRequest(const QJsonObject &request, quint64 clientId = 0);
         qint64 presentObject(QSharedPointer<Stubs::Stub> stub);
         QJsonObject getJSONStub(qint64 objectId, QString stubType);
-        void emitEvent(Stubs::Stub *sender, QString event, const QJsonArray &args);
+        /**
+         * @brief Sends an event of a presented object to the extensions subscribed to it.
+         * @param coalesce See ExtensionsServer::publishEvent()
+         */
+        void emitEvent(Stubs::Stub *sender, QString event, const QJsonArray &args, bool coalesce = false);
+
+        /**
+         * @brief Sends an event of a presented object to some extensions only, whatever they subscribed to.
+         */
+        void emitEventTo(const QVector<quint64> &clientIds, Stubs::Stub *sender, QString event, const QJsonArray &args);
+
+        /**
+         * @brief Sends an event of the Notepadqq object to the extensions subscribed to it.
+         */
+        void emitNotepadqqEvent(QString event, const QJsonArray &args);
 
         QJsonObject getCurrentExtensionStartedEvent();
+
+        void addClient(quint64 clientId);
+        void removeClient(quint64 clientId);
+
+        /**
+         * @brief Connection of the request being handled, or 0 outside of requests.
+         */
+        quint64 currentClient() const { return m_currentClient; }
     signals:
+        /**
+         * @brief Emitted when a connection is closed, so that stubs can release what it held.
+         */
+        void clientRemoved(quint64 clientId);
 
     public slots:
 
     private:
         const qint64 NQQ_STUB_ID = 1;
-        QHash<qint64, QSharedPointer<Stubs::Stub>> m_pointers;
-        //QHash<QSharedPointer<Stubs::Stub>, qint64> m_pointersRev;
+        const int SWEEP_INTERVAL_MS = 60 * 1000;
+        StubRegistry<Stubs::Stub> m_stubs;
+        quint64 m_currentClient = 0;
+        QTimer m_sweepTimer;
         QSharedPointer<ExtensionsServer> m_extensionServer;
-        qint64 findStubId(Stubs::Stub *stub);
+
+        QJsonObject eventMessage(qint64 objectId, const QString &event, const QJsonArray &args);
     };
 
 }
@@ -0,0 +1,189 @@
+#ifndef EXTENSIONS_STUBREGISTRY_H
+#define EXTENSIONS_STUBREGISTRY_H
+
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+
+namespace Extensions {
+
+    /**
+     * @brief Identifies the object behind a stub: two stubs with the same identity
+     *        refer to the same object, so they are given the same id.
+     */
+    struct StubIdentity {
+        const void *object = nullptr;   // nullptr for stubs that don't wrap an object
+        QString stubName;
+
+        bool operator ==(const StubIdentity &other) const {
+            return object == other.object && stubName == other.stubName;
+        }
+    };
+
+    inline uint qHash(const StubIdentity &identity, uint seed = 0)
+    {
+        return ::qHash(identity.object, seed) ^ ::qHash(identity.stubName, seed);
+    }
+
+    /**
+     * @brief The StubRegistry class assigns ids to the stubs presented to the extensions, and
+     *        keeps them alive while some client may still use them.
+     *
+     *        Every id is referenced by the clients it has been sent to. When the last of them
+     *        disconnects, the stub is released. Stubs whose object has been destroyed are
+     *        released by sweep(). Looking up the id of a stub takes constant time.
+     *
+     *        T must provide "StubIdentity identity() const" and "bool isAlive()".
+     */
+    template <typename T>
+    class StubRegistry
+    {
+    public:
+        /**
+         * @param firstId Ids of presented stubs are greater than this.
+         */
+        explicit StubRegistry(qint64 firstId) : m_lastId(firstId) {}
+
+        /**
+         * @brief Registers a stub with a fixed id. It is never released.
+         */
+        void pin(qint64 id, const QSharedPointer<T> &stub)
+        {
+            insert(id, stub, true);
+        }
+
+        /**
+         * @brief Returns the id of the stub, assigning a new one if the stub hasn't been
+         *        presented yet.
+         * @param clientId Client the id is sent to, or 0 if it is sent to every client.
+         */
+        qint64 present(const QSharedPointer<T> &stub, quint64 clientId)
+        {
+            qint64 id = find(stub.data());
+
+            if (id != -1 && !m_entries.value(id).stub->isAlive()) {
+                // The object is gone, and a new one took its address
+                remove(id);
+                id = -1;
+            }
+
+            if (id == -1) {
+                id = ++m_lastId;
+                insert(id, stub, false);
+            }
+
+            if (clientId != 0) {
+                ref(id, clientId);
+            } else {
+                for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it)
+                    ref(id, it.key());
+            }
+
+            return id;
+        }
+
+        /**
+         * @brief Returns the id of the stub, or -1 if it hasn't been presented.
+         */
+        qint64 find(const T *stub) const
+        {
+            return m_ids.value(stub->identity(), -1);
+        }
+
+        QSharedPointer<T> value(qint64 id) const
+        {
+            return m_entries.value(id).stub;
+        }
+
+        void remove(qint64 id)
+        {
+            const auto it = m_entries.find(id);
+            if (it == m_entries.end() || it->pinned)
+                return;
+
+            const auto rev = m_ids.find(it->stub->identity());
+            if (rev != m_ids.end() && rev.value() == id)
+                m_ids.erase(rev);
+
+            if (it->refs > 0) {
+                for (auto client = m_clients.begin(); client != m_clients.end(); ++client)
+                    client->remove(id);
+            }
+
+            m_entries.erase(it);
+        }
+
+        void addClient(quint64 clientId)
+        {
+            m_clients[clientId];
+        }
+
+        /**
+         * @brief Drops the references of a client, releasing the stubs nobody else uses.
+         */
+        void removeClient(quint64 clientId)
+        {
+            const QSet<qint64> ids = m_clients.take(clientId);
+
+            for (qint64 id : ids) {
+                const auto it = m_entries.find(id);
+                if (it != m_entries.end() && --it->refs == 0)
+                    remove(id);
+            }
+        }
+
+        /**
+         * @brief Releases the stubs whose object has been destroyed.
+         * @return Number of released stubs.
+         */
+        int sweep()
+        {
+            QList<qint64> dead;
+            for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+                if (!it->pinned && !it->stub->isAlive())
+                    dead.append(it.key());
+            }
+
+            for (qint64 id : dead)
+                remove(id);
+
+            return dead.size();
+        }
+
+        int size() const { return m_entries.size(); }
+
+    private:
+        struct Entry {
+            QSharedPointer<T> stub;
+            int refs = 0;           // Number of clients holding the id
+            bool pinned = false;
+        };
+
+        QHash<qint64, Entry> m_entries;
+        QHash<StubIdentity, qint64> m_ids;
+        QHash<quint64, QSet<qint64>> m_clients;
+        qint64 m_lastId;
+
+        void insert(qint64 id, const QSharedPointer<T> &stub, bool pinned)
+        {
+            Entry entry;
+            entry.stub = stub;
+            entry.pinned = pinned;
+            m_entries.insert(id, entry);
+            m_ids.insert(stub->identity(), id);
+        }
+
+        void ref(qint64 id, quint64 clientId)
+        {
+            QSet<qint64> &ids = m_clients[clientId];
+            if (!ids.contains(id)) {
+                ids.insert(id);
+                m_entries[id].refs++;
+            }
+        }
+    };
+
+}
+
+#endif // EXTENSIONS_STUBREGISTRY_H
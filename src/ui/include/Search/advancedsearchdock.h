@@ -152,6 +152,7 @@ private:
     QCheckBox*   m_chkMatchWords;
     QCheckBox*   m_chkUseRegex;
     QCheckBox*   m_chkUseSpecialChars;
+    QCheckBox*   m_chkMultiPattern;
     QCheckBox*   m_chkIncludeSubdirs;
 
     // Replace panel items
@@ -162,6 +163,7 @@ private:
     // "More Options" menu items
     QAction* m_actExpandAll;
     QAction* m_actRedoSearch;
+    QAction* m_actRefreshSearch;
     QAction* m_actCopyContents;
     QAction* m_actShowFullLines;
     QAction* m_actRemoveSearch;
@@ -0,0 +1,103 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+/**
+ * @brief The DirectoryWalker class lists the files to be searched by a FileSearcher. Unlike a plain QDirIterator
+ *        it honours .gitignore and .ignore files as well as a list of exclude patterns. Ignored directories are
+ *        pruned before descending into them, so none of their contents are ever listed.
+ *        Ignore files are interpreted like git does: patterns without a slash match names at any depth,
+ *        patterns with a slash are relative to the directory of the ignore file, "**" matches any number of
+ *        directories, a trailing slash only matches directories and a leading '!' re-includes a path.
+ */
+class DirectoryWalker {
+public:
+
+    /**
+     * @brief The Statistics struct holds counters about what the walker has seen.
+     */
+    struct Statistics {
+        int filesVisited = 0;   // Files that matched the file filters
+        int filesIgnored = 0;   // Files that matched the filters but were excluded by an ignore rule
+        int dirsPruned = 0;     // Directories that were excluded and not descended into
+    };
+
+    /**
+     * @brief DirectoryWalker
+     * @param rootDirectory The directory to start in
+     * @param nameFilters Wildcard filters the names of the listed files must match. Empty means all files.
+     * @param recursive If true, subdirectories are searched as well.
+     */
+    DirectoryWalker(const QString& rootDirectory, const QStringList& nameFilters, bool recursive);
+
+    /**
+     * @brief setExcludePatterns Sets gitignore-style patterns that are excluded in addition to the ones found
+     *                           in ignore files. They behave as if they were part of an ignore file in the root.
+     */
+    void setExcludePatterns(const QStringList& patterns);
+
+    /**
+     * @brief setRespectIgnoreFiles Sets whether .gitignore and .ignore files should be honoured. Default is true.
+     */
+    void setRespectIgnoreFiles(bool respect) { m_respectIgnoreFiles = respect; }
+
+    /**
+     * @brief listFiles Walks the directory tree and returns the absolute paths of all files that weren't ignored.
+     * @param wantToStop Checked periodically; walking ends early when it becomes true.
+     */
+    QStringList listFiles(const std::atomic<bool>& wantToStop);
+
+    const Statistics& getStatistics() const { return m_statistics; }
+
+    /**
+     * @brief looksBinary Returns true if the given data, usually the first block of a file, looks like it
+     *                    belongs to a binary file. This is the case if it contains NUL bytes or too many
+     *                    control characters. Data starting with a UTF-16 or UTF-32 BOM is never considered binary.
+     */
+    static bool looksBinary(const QByteArray& data);
+
+    /**
+     * @brief BINARY_CHECK_SIZE The number of bytes at the start of a file that should be passed to looksBinary().
+     */
+    static const int BINARY_CHECK_SIZE;
+
+private:
+    struct IgnoreRule {
+        QRegularExpression regex;
+        bool negated = false;
+        bool directoryOnly = false;
+        bool matchNameOnly = false; // The pattern has no slash and is matched against the name only
+    };
+
+    struct IgnoreFile {
+        QString baseDirectory; // Absolute path with trailing slash
+        QVector<IgnoreRule> rules;
+    };
+
+    static bool parseRule(const QString& line, IgnoreRule& rule);
+    static QString wildcardToRegex(const QString& pattern);
+    static IgnoreFile readIgnoreFile(const QString& directory, const QString& fileName);
+
+    /**
+     * @brief isIgnored Returns true if the path is excluded by any of the given ignore files. Rules of deeper
+     *                  ignore files and later rules take precedence, like they do in git.
+     */
+    static bool isIgnored(const QVector<IgnoreFile>& ignoreFiles, const QString& absolutePath, const QString& name,
+                          bool isDirectory);
+
+    QString m_rootDirectory;
+    QStringList m_nameFilters;
+    bool m_recursive;
+    bool m_respectIgnoreFiles = true;
+    IgnoreFile m_excludes;
+    Statistics m_statistics;
+};
+
+#endif // DIRECTORYWALKER_H
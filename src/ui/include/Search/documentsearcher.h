@@ -0,0 +1,83 @@
+#ifndef DOCUMENTSEARCHER_H
+#define DOCUMENTSEARCHER_H
+
+#include "searchobjects.h"
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+
+#include <atomic>
+
+namespace EditorNS { class Editor; }
+
+/**
+ * @brief The DocumentSearcher class searches open documents asynchronously. It is the counterpart to FileSearcher
+ *        for ScopeCurrentDocument and ScopeAllOpenDocuments searches and emits the same signals.
+ *        Use prepareAsyncSearch() and call startAsync() on the returned object. The contents of all documents
+ *        are first requested from their editors at once, without blocking the GUI thread. Once all snapshots
+ *        arrived, the thread is started and the snapshots are searched in parallel. Documents whose editor is
+ *        closed, or doesn't answer within SNAPSHOT_TIMEOUT_MS, are skipped.
+ */
+class DocumentSearcher : public QThread {
+    Q_OBJECT
+
+public:
+    static const int SNAPSHOT_TIMEOUT_MS = 10000;
+
+    /**
+     * @brief prepareAsyncSearch Returns a DocumentSearcher* object to be used in async document search. The
+     *                           documents to search are taken from config.targetWindow.
+     */
+    static DocumentSearcher* prepareAsyncSearch(const SearchConfig& config);
+
+    /**
+     * @brief startAsync Starts taking snapshots of the documents. The search thread is started as soon as
+     *                   all snapshots have been received. Must be called from the GUI thread.
+     */
+    void startAsync();
+
+    /**
+     * @brief cancel Orders the DocumentSearcher to stop searching at the earliest convenience. Won't immediately stop.
+     */
+    void cancel() { m_wantToStop = true; }
+
+    /**
+     * @brief getResult Returns a SearchResult item with all found results. Will be empty until the DocumentSearcher
+     *                  completely finished its search and emitted resultReady()
+     */
+    const SearchResult& getResult() { return m_searchResult; }
+
+signals:
+    /**
+     * @brief resultProgress is emitted periodically. 'Processed' is the number of documents already searched.
+     *                       'Total' is the total number of documents to be searched.
+     */
+    void resultProgress(int processed, int total);
+    void resultReady();
+
+protected:
+    void run() override;
+
+private:
+    DocumentSearcher(const SearchConfig& config);
+
+    struct DocumentSnapshot {
+        EditorNS::Editor* editor = nullptr;
+        QString name;
+        QString text;
+        bool valid = false; // False if the editor was closed before its contents were received
+    };
+
+    void onSnapshotReceived(int index, const QString& text, bool valid);
+    void onSnapshotTimeout();
+
+    SearchConfig m_searchConfig;
+    QVector<DocumentSnapshot> m_snapshots;
+    QVector<bool> m_snapshotReceived; // Only used on the GUI thread. Later answers are ignored.
+    int m_pendingSnapshots = 0;
+    std::atomic<bool> m_wantToStop{false};
+    SearchResult m_searchResult;
+};
+
+#endif // DOCUMENTSEARCHER_H
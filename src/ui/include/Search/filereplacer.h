@@ -6,6 +6,9 @@
 #include <QObject>
 #include <QThread>
 #include <QVector>
+#include <QtPromise>
+
+#include <atomic>
 
 /**
  * @brief The FileReplacer class can be used to replace text in strings and files.
@@ -16,6 +19,19 @@ class FileReplacer : public QThread
 
 public:
 
+    /**
+     * @brief The FileReport struct describes the outcome of replacing the matches of a single file.
+     */
+    struct FileReport {
+        QString fileName;
+        QString error;              // Empty if replacing was successful
+        int replacements = 0;       // Number of replaced matches
+        qint64 bytesWritten = 0;
+        qint64 elapsedMs = 0;       // Time spent reading, replacing and writing the file
+
+        bool hasError() const { return !error.isEmpty(); }
+    };
+
     /**
      * @brief FileReplacer Constructs a FileReplacer to replace all matches in the given SearchResult.
      *                     Use this to replace in ScopeFileSystem for ScopeFileSystem searches, and use
@@ -38,6 +54,17 @@ public:
      */
     const QVector<QString>& getErrors() const { return m_failedFiles; }
 
+    /**
+     * @brief getReports Returns one FileReport for every file that has been processed. Files that weren't
+     *                   processed because the FileReplacer was canceled have no report.
+     */
+    const QVector<FileReport>& getReports() const { return m_reports; }
+
+    /**
+     * @brief getElapsedMs Returns the wall clock time it took to process all files.
+     */
+    qint64 getElapsedMs() const { return m_elapsedMs; }
+
     /**
      * @brief replaceAll Replaces all matches in 'content' with 'replacement'.
      * @param doc All of this DocResult's ResultMatches will be replaced
@@ -47,23 +74,50 @@ public:
      */
     static void replaceAll(const DocResult& doc, QString& content, const QString& replacement);
 
+    /**
+     * @brief replaceInEditor Replaces all matches of 'doc' in the given editor. Only the text between the
+     *                        first and the last match is sent to the editor, where it is applied as a single
+     *                        change that can be undone in one step.
+     * @param content The current text of the editor, which the matches of 'doc' refer to. Nothing is replaced
+     *                if the editor's text was changed in the meantime, or if 'doc' hit a result limit.
+     * @return A promise for true if the text was replaced.
+     */
+    static QtPromise::QPromise<bool> replaceInEditor(EditorNS::Editor* editor, const DocResult& doc,
+                                                     const QString& content, const QString& replacement);
+
 protected:
     void run() override;
 
 signals:
     /**
-     * @brief resultProgress Emitted periodically. 'current' is the number of successful replacements done,
-     *                       'total' is the total number of replacements to be done.
+     * @brief resultProgress Emitted periodically. 'current' is the number of files processed,
+     *                       'total' is the total number of files to be processed. Might be emitted
+     *                       from a worker thread.
      */
     void resultProgress(int current, int total);
     void resultReady();
 
 private:
+    /**
+     * @brief replacementChunks Returns the pieces of text that, when concatenated, form 'content' with all matches
+     *                          of 'doc' replaced. The returned references point into 'content' and 'replacement'.
+     */
+    static QVector<QStringRef> replacementChunks(const DocResult& doc, const QString& content, const QString& replacement);
+
+    /**
+     * @brief replaceInFile Replaces all matches of 'doc' in its file. The new contents are written to a temporary
+     *                      file that atomically replaces the original. Nothing is written if the file changed
+     *                      since it was searched, or if 'doc' hit a result limit and doesn't hold all matches.
+     */
+    static FileReport replaceInFile(const DocResult& doc, const QString& replacement);
+
     SearchResult m_searchResult;
     QString m_replacement;
 
-    bool m_wantToStop = false;
+    std::atomic<bool> m_wantToStop{false};
     QVector<QString> m_failedFiles;
+    QVector<FileReport> m_reports;
+    qint64 m_elapsedMs = 0;
 };
 
 #endif // FILEREPLACER_H
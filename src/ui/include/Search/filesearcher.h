@@ -5,13 +5,13 @@
 #include "searchobjects.h"
 
 #include <QObject>
-#include <QRegularExpression>
 #include <QThread>
 
+#include <atomic>
+
 /**
- * @brief The FileSearcher class contains the tools to search strings and files asynchronously and synchronously.
- *        Use prepareAsyncSearch() and run start() on the returned FileSearcher* object to search files
- *        asynchronously. Use searchPlainText() and searchRegExp() to search strings synchronously.
+ * @brief The FileSearcher class searches files asynchronously. Use prepareAsyncSearch() and run start() on the
+ *        returned FileSearcher* object to search files. Use SearchEngine to search strings synchronously.
  */
 class FileSearcher : public QThread {
     Q_OBJECT
@@ -20,42 +20,49 @@ public:
 
     /**
      * @brief prepareAsynchSearch Returns a FileSearcher* object to be used in async file search. Only use this for
-     *                            ScopeFileSystem searches. Use the static functions for searching documents or strings.
+     *                            ScopeFileSystem searches. Use SearchEngine for searching documents or strings.
      */
     static FileSearcher* prepareAsyncSearch(const SearchConfig& config);
 
     /**
-     * @brief createRegexFromConfig Creates a RegularExpression based on the given config that can be used
-     *                              in conjuncture with searchRegExp()
+     * @brief cancel Orders the FileSearcher to stop searching at the earliest convenience. Won't immediately stop.
      */
-    static QRegularExpression createRegexFromConfig(const SearchConfig& config);
+    void cancel() { m_wantToStop = true; }
 
     /**
-     * @brief searchPlainText Searches a given string (synchronously)
-     * @param config Contains the search string and other parameters for the search
-     * @param content The string to be searched
-     * @return A DocResult containing all found matches.
+     * @brief getResult Returns a SearchResult item with all found results. Will be empty until the FileSearcher
+     *                  completely finished its search and emitted resultReady()
      */
-    static DocResult searchPlainText(const SearchConfig& config, const QString& content);
+    const SearchResult& getResult() { return m_searchResult; }
 
     /**
-     * @brief searchRegExp  Searches a given string via a RegularExpression (synchronously)
-     * @param regex The RegExp to be used. Can be created  via createRegexFromString()
-     * @param content The string to be searched
-     * @return A DocResult containing all found matches.
+     * @brief The Statistics struct holds counters about the work done during the search.
      */
-    static DocResult searchRegExp(const QRegularExpression& regex, const QString& content);
+    struct Statistics {
+        int filesVisited = 0;           // Files that matched the file pattern
+        int filesIgnored = 0;           // Files excluded by ignore files or exclude patterns
+        int filesBinary = 0;            // Files skipped because they look binary
+        int filesSkippedByIndex = 0;    // Files skipped because the SearchIndex ruled out a match
+        int dirsPruned = 0;             // Directories that were excluded and not descended into
+        int cacheHits = 0;              // Files whose result was taken from the SearchResultCache
+        int cacheMisses = 0;            // Files that had to be searched because they weren't cached or changed
+        qint64 bytesRead = 0;
 
-    /**
-     * @brief cancel Orders the FileSearcher to stop searching at the earliest convenience. Won't immediately stop.
-     */
-    void cancel() { m_wantToStop = true; }
+        int filesSkipped() const { return filesIgnored + filesBinary + filesSkippedByIndex + cacheHits; }
+
+        /**
+         * @brief cacheHitRatio Returns the share of cache lookups that were hits, between 0 and 1.
+         */
+        double cacheHitRatio() const {
+            const int lookups = cacheHits + cacheMisses;
+            return lookups > 0 ? static_cast<double>(cacheHits) / lookups : 0.0;
+        }
+    };
 
     /**
-     * @brief getResult Returns a SearchResult item with all found results. Will be empty until the FileSearcher
-     *                  completely finished its search and emitted resultReady()
+     * @brief getStatistics Returns the counters of this search. Only complete after resultReady() was emitted.
      */
-    const SearchResult& getResult() { return m_searchResult; }
+    const Statistics& getStatistics() const { return m_statistics; }
 
 signals:
     /**
@@ -72,9 +79,11 @@ private:
     FileSearcher(const SearchConfig& config);
 
     SearchConfig m_searchConfig;
-    QRegularExpression m_regex;
-    bool m_wantToStop = false;
+    std::atomic<bool> m_wantToStop{false};
+    bool m_useIndex = true;
+    bool m_useResultCache = true;
     SearchResult m_searchResult;
+    Statistics m_statistics;
 };
 
 #endif // FILESEARCHER_H
@@ -6,8 +6,10 @@
 
 #include <QComboBox>
 #include <QDialog>
+#include <QLabel>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QPointer>
 #include <QStandardItemModel>
 
 namespace Ui {
@@ -46,6 +48,7 @@ public:
     void replaceFromUI(bool forward, bool searchFromStart = false);
 protected:
     void keyPressEvent(QKeyEvent *evt);
+    void hideEvent(QHideEvent *evt);
 
 signals:
     void toggleAdvancedSearch();
@@ -64,11 +67,14 @@ private slots:
     void on_radSearchPlainText_toggled(bool checked);
     void on_radSearchWithSpecialChars_toggled(bool checked);
     void on_searchStringEdited(const QString &text);
+    void on_searchMatchCountChanged(int count, bool complete);
 
 private:
     Ui::frmSearchReplace*  ui;
     TopEditorContainer*    m_topEditorContainer;
     QString                m_lastSearch;
+    QLabel*                m_lblMatchCount;
+    QPointer<Editor>       m_highlightedEditor;
 
    /**
     * @brief Get the current editor.
@@ -98,16 +104,29 @@ private:
     * @param `replacement`:   The string which will replace `string`.
     * @param `searchMode`:    Search mode to use.
     * @param `searchOptions`: Search options to use.
+    * @return A promise for the number of replaced instances, or -1 if the document
+    *         was modified while replacing. Rejected with the error message if the
+    *         regular expression is invalid.
     */
-    int replaceAll(QString string, QString replacement, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions);
+    QPromise<int> replaceAll(QString string, QString replacement, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions);
    /**
     * @brief Select all instances of `string` within the current document.
     * @param `string`:        The string to search for.
     * @param `searchMode`:    Search mode to use.
-    * @param `forward`:       Direction in which to search.
     * @param `searchOptions`: Search options to use.
+    * @return A promise for the number of selected instances.
+    */
+    QPromise<int> selectAll(QString string, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions);
+   /**
+    * @brief Counts and highlights all matches of the search string in the current
+    *        editor. The editor scans the document in small slices and reports the
+    *        count through Editor::searchMatchCountChanged.
+    */
+    void updateHighlightAll();
+   /**
+    * @brief Removes the highlights set by updateHighlightAll().
     */
-    int selectAll(QString string, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions);
+    void clearHighlightAll();
    /**
     * @brief Sets the current tab.
     * @param `tab`: The tab to be set to.
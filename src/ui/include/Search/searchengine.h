@@ -0,0 +1,77 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include "searchobjects.h"
+
+#include <QRegularExpression>
+#include <QString>
+
+#include <memory>
+
+/**
+ * @brief The SearchEngine class matches the search string of a SearchConfig against arbitrary strings.
+ *        Use create() to get the engine that fits a config. All preparation work (unescaping, regex
+ *        compilation, literal extraction) is done once on creation, so a single engine should be reused
+ *        for all documents of a search. Engines are immutable after creation and can be used from
+ *        multiple threads at once.
+ */
+class SearchEngine {
+public:
+
+    enum EngineType {
+        EnginePlainText,    // QString::indexOf() based search. Used for ModePlainText and ModePlainTextSpecialChars
+        EngineRegex,        // Unoptimized QRegularExpression. Only useful for comparison.
+        EngineRegexJit,     // QRegularExpression compiled by PCRE2's JIT, with a literal prefilter
+        EngineMultiPattern  // Aho-Corasick automaton over a list of literal patterns. Used for ModeMultiPattern
+    };
+
+    virtual ~SearchEngine() = default;
+
+    /**
+     * @brief create Returns the engine best suited for the given config.
+     */
+    static std::unique_ptr<SearchEngine> create(const SearchConfig& config);
+
+    /**
+     * @brief create Returns an engine of the given type for the config. EngineRegex and EngineRegexJit
+     *               will treat the search string as a regex even if config.searchMode is something else.
+     */
+    static std::unique_ptr<SearchEngine> create(const SearchConfig& config, EngineType type);
+
+    /**
+     * @brief createRegexFromConfig Creates a RegularExpression based on the given config
+     */
+    static QRegularExpression createRegexFromConfig(const SearchConfig& config);
+
+    /**
+     * @brief requiredLiteral Returns a string that must appear in every match of the given config, or an
+     *                        empty string if no such literal could be determined.
+     */
+    static QString requiredLiteral(const SearchConfig& config);
+
+    /**
+     * @brief mightMatch Cheap prefilter. Returns false if 'content' cannot contain any match. If this
+     *                   returns true, 'content' may or may not contain a match.
+     */
+    virtual bool mightMatch(const QString& content) const;
+
+    /**
+     * @brief search Searches the given string (synchronously)
+     * @param content The string to be searched
+     * @param maxResults The maximum number of matches to record. 0 means unlimited.
+     * @return A DocResult containing all found matches.
+     */
+    virtual DocResult search(const QString& content, int maxResults = 0) const = 0;
+
+    EngineType engineType() const { return m_type; }
+
+protected:
+    SearchEngine(EngineType type, const QString& literal, Qt::CaseSensitivity literalCaseSense);
+
+private:
+    const EngineType m_type;
+    const QString m_literal;
+    const Qt::CaseSensitivity m_literalCaseSense;
+};
+
+#endif // SEARCHENGINE_H
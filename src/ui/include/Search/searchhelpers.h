@@ -1,11 +1,47 @@
 #ifndef SEARCHHELPERS_H
 #define SEARCHHELPERS_H
 
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <functional>
+
 class SearchHelpers
 {
 
 public:
 
+    /**
+     * @brief parallelFor Calls func(i) for every i in [0, count) using a number of worker threads that matches
+     *                    the number of CPU cores. Blocks until all calls returned. 'func' must be thread-safe.
+     *                    Items are handed out one at a time, so expensive items don't stall other workers.
+     */
+    static void parallelFor(int count, const std::function<void(int)>& func) {
+        class Worker : public QRunnable {
+        public:
+            Worker(std::function<void()> work) : m_work(std::move(work)) {}
+            void run() override { m_work(); }
+        private:
+            std::function<void()> m_work;
+        };
+
+        QAtomicInt nextIndex(0);
+        auto work = [&]() {
+            for (int i = nextIndex.fetchAndAddRelaxed(1); i < count; i = nextIndex.fetchAndAddRelaxed(1))
+                func(i);
+        };
+
+        QThreadPool pool;
+        const int workerCount = std::max(1, std::min(QThread::idealThreadCount(), count));
+        pool.setMaxThreadCount(workerCount);
+        for (int i = 0; i < workerCount; i++)
+            pool.start(new Worker(work));
+        pool.waitForDone();
+    }
+
     enum class SearchMode {
         PlainText = 1,
         SpecialChars = 2,
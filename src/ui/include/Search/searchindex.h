@@ -0,0 +1,99 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include "searchobjects.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The SearchIndex class is a persistent trigram index over the files of one search root directory.
+ *        For every file it remembers the file's size, mtime and inode together with the set of all trigrams
+ *        found in its (case-folded) contents. A FileSearcher can use it to skip reading files that cannot
+ *        possibly contain the search string. Entries are revalidated against the file's stamp on every search,
+ *        so only files that changed since the last search need to be re-read.
+ *        Indices are stored in PersistentCache::searchIndexDirPath(), one file per search root.
+ */
+class SearchIndex {
+public:
+
+    /**
+     * @brief The FileStamp struct identifies a specific version of a file on disk.
+     */
+    struct FileStamp {
+        qint64 size = -1;
+        qint64 lastModified = 0; // Milliseconds since epoch
+        quint64 inode = 0;       // Zero if the platform does not support inodes
+
+        bool operator==(const FileStamp& other) const {
+            return size == other.size && lastModified == other.lastModified && inode == other.inode;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief forDirectory Returns the shared index for the given search root. The index is loaded from disk
+     *                     the first time it is requested and then kept in memory for subsequent searches.
+     *                     Lock mutex() before using the returned object.
+     */
+    static QSharedPointer<SearchIndex> forDirectory(const QString& rootDirectory);
+
+    /**
+     * @brief stampForFile Returns the current FileStamp of the file at the given path.
+     */
+    static FileStamp stampForFile(const QString& filePath);
+
+    /**
+     * @brief trigramsForString Returns the sorted, unique list of trigrams found in the case-folded string.
+     */
+    static QVector<quint32> trigramsForString(const QString& str);
+
+    /**
+     * @brief isUpToDate Returns true if the index contains an entry for filePath with the given stamp.
+     */
+    bool isUpToDate(const QString& filePath, const FileStamp& stamp) const;
+
+    /**
+     * @brief mayContain Returns true if the file's indexed contents contain all of the given trigrams.
+     *                   Only meaningful if isUpToDate() returned true for this file.
+     */
+    bool mayContain(const QString& filePath, const QVector<quint32>& queryTrigrams) const;
+
+    /**
+     * @brief updateFile Replaces the index entry of the given file.
+     */
+    void updateFile(const QString& filePath, const FileStamp& stamp, const QString& content);
+
+    /**
+     * @brief save Removes entries of files that no longer exist and writes the index to disk if it was modified.
+     * @return True if the index was saved successfully or didn't need to be saved.
+     */
+    bool save();
+
+    QMutex* mutex() { return &m_mutex; }
+
+private:
+    SearchIndex(const QString& rootDirectory);
+
+    /**
+     * @brief indexFilePath Returns the path of the file the index for m_rootDirectory is stored in.
+     */
+    QString indexFilePath() const;
+
+    bool load();
+
+    struct Entry {
+        FileStamp stamp;
+        QVector<quint32> trigrams;
+    };
+
+    QString m_rootDirectory;
+    QHash<QString, Entry> m_entries;
+    bool m_modified = false;
+    QMutex m_mutex;
+};
+
+#endif // SEARCHINDEX_H
@@ -1,6 +1,7 @@
 #ifndef SEARCHINSTANCE_H
 #define SEARCHINSTANCE_H
 
+#include "documentsearcher.h"
 #include "filesearcher.h"
 #include "searchobjects.h"
 
@@ -25,8 +26,8 @@ public:
     /**
      * @brief SearchInstance Constructs SearchInstance object and starts a search.
      * @param config If config.searchScope is ScopeFileSystem, a non-blocking file search will be started.
-     *               If it's ScopeCurrentDocument or ScopeAllDocuments, a blocking document search will
-     *               be started, but searching documents is fast enough not to visibly block the UI.
+     *               If it's ScopeCurrentDocument or ScopeAllDocuments, a non-blocking search through
+     *               snapshots of the documents' contents will be started.
      */
     SearchInstance(const SearchConfig& config);
     ~SearchInstance();
@@ -42,7 +43,7 @@ public:
     bool areResultsExpanded() const { return m_resultsAreExpanded; }
 
     /**
-     * @brief isSearchInProgress Returns true if a file search is currently in progress.
+     * @brief isSearchInProgress Returns true if a search is currently in progress.
      */
     bool isSearchInProgress() const { return m_isSearchInProgress; }
 
@@ -89,6 +90,7 @@ private:
     QScopedPointer<QTreeWidget> m_treeWidget;
     SearchResult                m_searchResult;
     FileSearcher*               m_fileSearcher = nullptr;
+    DocumentSearcher*           m_documentSearcher = nullptr;
 
     // Context menu
     QMenu*                      m_contextMenu;
@@ -3,9 +3,10 @@
 
 #include "include/Search/searchhelpers.h"
 
+#include <QByteArray>
 #include <QObject>
-#include <QRegularExpressionMatch>
 #include <QString>
+#include <QStringList>
 #include <QVector>
 
 class MainWindow;
@@ -22,6 +23,12 @@ struct SearchConfig {
      */
     QString getScopeAsString() const;
 
+    /**
+     * @brief getPatternList Returns the whitespace-separated patterns of searchString. Only used if
+     *                       searchMode==ModeMultiPattern. MatchResult::patternIndex refers to this list.
+     */
+    QStringList getPatternList() const;
+
 
     QString searchString;
     QString filePattern; // Only used if searchMode==ScopeFileSystem.
@@ -30,7 +37,13 @@ struct SearchConfig {
 
     bool matchCase      = false;
     bool matchWord      = false;
+    QString excludePattern;      // Only used if searchMode==ScopeFileSystem. Comma-separated gitignore-style patterns.
     bool includeSubdirs = false; // Only used if searchMode==ScopeFileSystem.
+    bool respectIgnoreFiles = false; // Only used if searchMode==ScopeFileSystem. Honour .gitignore and .ignore files.
+    bool skipBinaryFiles = false;    // Only used if searchMode==ScopeFileSystem.
+
+    int maxResultsPerFile   = 0; // Maximum number of MatchResults per DocResult. 0 means unlimited.
+    int maxResultsTotal     = 0; // Maximum number of MatchResults in the whole SearchResult. 0 means unlimited.
 
     enum SearchScope {
         ScopeCurrentDocument    = 0,
@@ -42,12 +55,18 @@ struct SearchConfig {
     enum SearchMode {
         ModePlainText               = 0,
         ModePlainTextSpecialChars   = 1,
-        ModeRegex                   = 2
+        ModeRegex                   = 2,
+        ModeMultiPattern            = 3  // searchString is a whitespace-separated list of literal patterns
     };
     SearchMode searchMode = ModePlainText;
 };
 
 struct MatchResult {
+    /**
+     * @brief getMatchLineString Returns the full text line where the match occured
+     */
+    QString getMatchLineString() const;
+
     /**
      * @brief getMatchString Returns the match as a string
      */
@@ -65,12 +84,34 @@ struct MatchResult {
      */
     QString getPostMatchString(bool fullText=false) const;
 
-    QString matchLineString; // The full text line where the match occured
+    /**
+     * @brief capturedStart Returns the offset of the given capture group from the beginning of the file,
+     *                      or -1 if the group did not participate in the match. Group 0 is the whole match.
+     */
+    int capturedStart(int group) const;
+
+    /**
+     * @brief capturedLength Returns the length of the given capture group. Group 0 is the whole match.
+     */
+    int capturedLength(int group) const;
+
+    struct CaptureSpan {
+        int start;
+        int length;
+    };
+
+    // The text line where the match occured is stored as linePool.mid(lineOffset, lineLength). The pool is
+    // shared between all MatchResults of a DocResult and contains every line with a match exactly once.
+    QString linePool;
+    int lineOffset;
+    int lineLength;
+
     int lineNumber;          // The line number, starting at 1
     int positionInFile;      // The match's offset from the beginning of the file
     int positionInLine;      // The match's offset from the beginning of the line
     int matchLength;         // The match's length
-    QRegularExpressionMatch regexMatch; // Only valid if this MatchResult was created by a regex search
+    QVector<CaptureSpan> captureSpans; // Spans of capture groups 1..n. Only set by regex searches.
+    int patternIndex = -1;   // Index of the matched pattern in SearchConfig::getPatternList(). Only set by multi-pattern searches.
 
 private:
     static const int CUTOFF_LENGTH; //Number of characters before/after match result that will be shown in preview
@@ -91,6 +132,19 @@ struct DocResult {
     QString fileName;                   // Is a file path when docType==TypeFile and a file name when TypeDocument
     QVector<MatchResult> results;
     int regexCaptureGroupCount = 0;     // Only used when DocResult was created by a regex search
+    bool limitReached = false;          // True if not all matches were recorded because of a result limit
+
+    // State of the file or document at the time it was searched. For TypeDocument, fileSize is the length
+    // of the document's text in characters and fileLastModified is unused.
+    qint64 fileSize = -1;
+    qint64 fileLastModified = 0;        // Milliseconds since epoch
+    QByteArray contentHash;             // See hashContent()
+
+    /**
+     * @brief hashContent Returns a hash of the given decoded file contents. Used to verify that a file
+     *                    hasn't changed between searching and replacing.
+     */
+    static QByteArray hashContent(const QString& content);
 };
 
 enum class SearchUserInteraction {
@@ -106,6 +160,8 @@ struct SearchResult {
     int countResults() const;
 
     QVector<DocResult> results;
+    bool limitReached = false; // True if any DocResult hit its limit or the total result limit was reached
+
 };
 
 
@@ -0,0 +1,69 @@
+#ifndef SEARCHRESULTCACHE_H
+#define SEARCHRESULTCACHE_H
+
+#include "searchindex.h"
+#include "searchobjects.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+/**
+ * @brief The SearchResultCache class remembers the per-file results of previous file searches. There is one
+ *        cache for every combination of search string and matching options, so a search can reuse the results
+ *        of any earlier search that matched the same way, no matter which directory, file pattern or subdirectory
+ *        setting it used. Entries are tied to the file's FileStamp, so files that changed are searched again.
+ *        Caches only live in memory. The ones of the most recent searches are kept alive.
+ *        All caches together hold at most as many MatchResults as a single search may return
+ *        (SearchConfig::maxResultsTotal). Results that don't fit anymore aren't cached.
+ */
+class SearchResultCache {
+public:
+    ~SearchResultCache();
+
+    /**
+     * @brief forConfig Returns the shared cache that fits the matching options of the given config.
+     *                  Lock mutex() before using the returned object. Also sets the limit of cached
+     *                  results to the config's maxResultsTotal.
+     */
+    static QSharedPointer<SearchResultCache> forConfig(const SearchConfig& config);
+
+    /**
+     * @brief lookup Retrieves the cached result of the given file.
+     * @param filePath The file to look up
+     * @param stamp The current stamp of the file. Cached results for other stamps are outdated.
+     * @param maxResults The maximum number of MatchResults wanted. 0 means unlimited.
+     * @param result Set to the cached result if one was found.
+     * @return True if a usable result was found. A result that was itself cut off by a lower result limit
+     *         is not usable.
+     */
+    bool lookup(const QString& filePath, const SearchIndex::FileStamp& stamp, int maxResults, DocResult& result) const;
+
+    /**
+     * @brief store Caches the result of searching the given file. 'result' may be empty.
+     *              If the limit of cached results is reached, the file isn't cached.
+     */
+    void store(const QString& filePath, const SearchIndex::FileStamp& stamp, const DocResult& result);
+
+    QMutex* mutex() { return &m_mutex; }
+
+private:
+    SearchResultCache() = default;
+
+    /**
+     * @brief keyForConfig Returns a string that is equal for all configs that produce the same matches.
+     */
+    static QString keyForConfig(const SearchConfig& config);
+
+    struct Entry {
+        SearchIndex::FileStamp stamp;
+        DocResult result;
+    };
+
+    QHash<QString, Entry> m_entries;
+    int m_resultCount = 0;      // MatchResults in m_entries
+    QMutex m_mutex;
+};
+
+#endif // SEARCHRESULTCACHE_H
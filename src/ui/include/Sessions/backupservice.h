@@ -4,13 +4,12 @@
 #include <QString>
 #include <QTimer>
 
-#include <set>
-#include <tuple>
+#include <map>
+#include <memory>
 
-namespace EditorNS{
-class Editor;
-}
+class BackupWriter;
 class MainWindow;
+class SessionStore;
 
 /**
  * @brief The BackupService class handles automatic saving of currently open windows, tabs, and documents.
@@ -57,43 +56,52 @@ public:
      */
     static void resume();
 
+    /**
+     * @brief The Metrics struct describes the work done by the autosave.
+     */
+    struct Metrics {
+        int ticks = 0;                  // Autosave ticks that captured the state of the windows
+        int skippedTicks = 0;           // Ticks skipped because the previous one wasn't done yet
+        qint64 lastCaptureMs = 0;       // Time the last tick spent collecting the state of the editors
+        qint64 lastWriteMs = 0;         // Time the writer thread spent writing the backups of the last tick
+        qint64 lastBytesWritten = 0;    // Bytes written for the last tick
+        int lastTabsWritten = 0;        // Dirty tabs whose contents were written for the last tick
+        int lastTabsSkipped = 0;        // Dirty tabs that didn't need to be written for the last tick
+        int lastTabsDeduplicated = 0;   // Changed tabs whose contents were already stored, for the last tick
+        qint64 totalBytesWritten = 0;
+    };
+
+    static const Metrics& getMetrics() { return s_metrics; }
+
 private:
     static QTimer s_autosaveTimer;
     static bool s_autosaveEnabled;
+    static bool s_captureInProgress;
+    static Metrics s_metrics;
 
     /**
-     * @brief The WindowData struct contains a list Editor*'s and the history generation
-     *        at the time of the last autosave. With every new autosave this data will be
-     *        compared to the MainWindow's current list of Editor*'s and their history gens
-     *        to determine whether the MainWindow has changed since the last save.
+     * @brief s_sessionStores contains the SessionStore of every window that is being backed up.
+     *        A SessionStore remembers which tabs it has already written, so it has to be kept
+     *        for as long as its window is open.
      */
-    struct WindowData {
-        MainWindow* ptr;
-        std::vector<std::pair<EditorNS::Editor*, int>> editors;
-
-        // Note this is only a shallow comparison. Do deep compares using isFullyEqual().
-        bool operator==(const WindowData& other) const { return ptr == other.ptr; }
-        bool operator<(const WindowData& other) const { return ptr < other.ptr; }
-
-        bool isFullyEqual(const WindowData& other) const { return ptr == other.ptr && editors == other.editors; }
-    };
+    static std::map<MainWindow*, std::shared_ptr<SessionStore>> s_sessionStores;
 
     /**
-     * @brief s_backupWindowData contains the WindowData at the time of the last backup.
+     * @brief backupWriter Returns the BackupWriter that does all disk I/O. It's created on first use.
      */
-    static std::set<WindowData> s_backupWindowData;
+    static BackupWriter* backupWriter();
 
     /**
-     * @brief executeAutosave Updates the data inside s_autosaveData and executes saveSession
-     *        for every open MainWindow that needs it.
+     * @brief executeBackup First collects the state of all windows that changed since their last backup,
+     *        asynchronously and without blocking the GUI. Then hands the backups over to the BackupWriter.
+     *        If the previous tick is still collecting or the writer is congested, this tick is skipped.
      */
     static void executeBackup();
 
     /**
-     * @brief writeBackup Writes a backup of the given MainWindow into a unique location inside the backupCache
-     * @return True if the backup was created successfully
+     * @brief onJobsFinished Updates the SessionStores and metrics after the BackupWriter wrote some jobs.
      */
-    static bool writeBackup(MainWindow* wnd);
+    static void onJobsFinished();
 };
 
 /**
@@ -0,0 +1,82 @@
+#ifndef BACKUPWRITER_H
+#define BACKUPWRITER_H
+
+#include "include/Sessions/sessionstore.h"
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The BackupWriter class is the write-behind queue of BackupService. It writes SessionStore::Jobs
+ *        one after another on its own thread, in the order they were enqueued.
+ *        The queue is bounded by the amount of data it holds: while isCongested() returns true no new jobs
+ *        should be created, so slow disks can't make the queue grow without limit.
+ */
+class BackupWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief MAX_PENDING_BYTES When this much data is waiting to be written, the queue is congested.
+     */
+    static const qint64 MAX_PENDING_BYTES;
+
+    explicit BackupWriter(QObject* parent = nullptr);
+
+    /**
+     * @brief ~BackupWriter Discards all queued jobs and waits for the current one to finish.
+     */
+    ~BackupWriter();
+
+    /**
+     * @brief enqueue Adds a job to the queue. Starts the thread if it isn't running yet.
+     */
+    void enqueue(const std::shared_ptr<SessionStore::Job>& job);
+
+    /**
+     * @brief pendingBytes Returns the amount of data of all jobs that haven't been written yet.
+     */
+    qint64 pendingBytes() const;
+
+    bool isCongested() const { return pendingBytes() >= MAX_PENDING_BYTES; }
+
+    /**
+     * @brief takeFinishedJobs Returns the jobs that were written (or failed) since the last call.
+     *                         Call this after jobsFinished() was emitted.
+     */
+    std::vector<std::shared_ptr<SessionStore::Job>> takeFinishedJobs();
+
+    /**
+     * @brief discardPendingJobs Removes all jobs that haven't been started yet and waits until the
+     *                           job that is currently being written is done. Discarded jobs are returned
+     *                           by takeFinishedJobs() as failed.
+     */
+    void discardPendingJobs();
+
+protected:
+    void run() override;
+
+signals:
+    /**
+     * @brief jobsFinished Emitted from the writer thread after one or more jobs were written.
+     */
+    void jobsFinished();
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_jobAvailable;
+    QWaitCondition m_jobDone;
+    std::deque<std::shared_ptr<SessionStore::Job>> m_queue;
+    std::vector<std::shared_ptr<SessionStore::Job>> m_finished;
+    qint64 m_pendingBytes = 0;
+    bool m_writing = false;
+    bool m_wantToStop = false;
+};
+
+#endif // BACKUPWRITER_H
@@ -0,0 +1,64 @@
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+
+/**
+ * @brief The BlobStore class is a content-addressed file store: every blob is saved in a file named after
+ *        the hash of its contents. Storing data that is already in the store costs nothing but the hash,
+ *        no matter who stored it first. Blobs are optionally compressed; compression is transparent
+ *        to readers and doesn't affect the blob's id.
+ *
+ *        A BlobStore is not synchronized. All writes and collectGarbage() calls on a directory must come
+ *        from the same thread.
+ */
+class BlobStore {
+public:
+
+    explicit BlobStore(const QString& directory);
+
+    /**
+     * @brief idForData Returns the id a blob with the given contents has.
+     */
+    static QString idForData(const QByteArray& data);
+
+    /**
+     * @brief isValidId Returns true if 'id' looks like an id returned by idForData().
+     */
+    static bool isValidId(const QString& id);
+
+    /**
+     * @brief contains Returns true if the blob with the given id is in the store.
+     */
+    bool contains(const QString& id) const;
+
+    /**
+     * @brief put Stores 'data' unless it's already in the store.
+     * @param id Set to the id of the blob.
+     * @param compress Whether to compress the blob if that makes it noticeably smaller.
+     * @param bytesWritten If not null, set to the number of bytes written to disk, 0 if the blob already existed.
+     * @return False if the blob couldn't be written.
+     */
+    bool put(const QByteArray& data, QString& id, bool compress, qint64* bytesWritten = nullptr);
+
+    /**
+     * @brief get Reads the blob with the given id.
+     * @return False if the blob doesn't exist or is damaged.
+     */
+    bool get(const QString& id, QByteArray& data) const;
+
+    /**
+     * @brief collectGarbage Removes all blobs whose id is not in 'referencedIds'.
+     * @return The number of removed blobs.
+     */
+    int collectGarbage(const QSet<QString>& referencedIds);
+
+private:
+    QString pathForId(const QString& id) const;
+
+    QString m_directory;
+};
+
+#endif // BLOBSTORE_H
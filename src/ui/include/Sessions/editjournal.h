@@ -0,0 +1,129 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+
+/**
+ * @brief The EditJournal class is a write-ahead log of the changes made to documents between two
+ *        SessionStore snapshots, so that a crash loses a fraction of a second of typing instead of
+ *        everything since the last autosave.
+ *
+ *        Every document has its own log file in the journal directory. Entries are buffered and appended
+ *        in groups, at most GROUP_COMMIT_INTERVAL_MS after they were recorded or as soon as enough of them
+ *        are pending. Every record carries a checksum, so a record torn by a crash is detected and ignored
+ *        on recovery, together with everything after it. Once a snapshot contains the changes up to some
+ *        point, truncate() drops them from the log. The work done is proportional to the size of the
+ *        changes, never to the size of the documents.
+ */
+class EditJournal {
+public:
+
+    /**
+     * @brief The Entry struct is a single change to a document, see Editor::journalEntries().
+     */
+    struct Entry {
+        enum Kind : quint8 {
+            Change = 0,     // 'removed' characters at 'offset' were replaced with 'text'
+            Saved = 1,      // The document was saved, so it's identical to its file
+            Reset = 2       // The whole document was replaced, the new contents aren't known
+        };
+
+        Kind kind = Change;
+        qint64 seq = 0;     // Number of changes made to the document, including this one
+        qint32 offset = 0;  // Position within the document, with "\n" as line separator
+        qint32 removed = 0;
+        QString text;
+    };
+
+    /**
+     * @brief The Recovery struct describes the changes of a document that are missing from a snapshot.
+     */
+    struct Recovery {
+        bool saved = false;         // The document has been saved after the snapshot. 'changes' apply
+                                    // to its file instead of the snapshot's contents.
+        QVector<Entry> changes;     // Changes to apply, in order
+    };
+
+    /**
+     * @param directory Directory of the log files. It's created on demand, but its parent must exist.
+     */
+    explicit EditJournal(const QString& directory);
+
+    /**
+     * @brief Entries that haven't been appended yet are discarded: the journal is only destroyed
+     *        when its documents don't need to be recovered anymore.
+     */
+    ~EditJournal() = default;
+
+    /**
+     * @brief newLogId Returns a new, unique id for the log of a document.
+     */
+    static QString newLogId();
+
+    static QString logPath(const QString& directory, const QString& id);
+
+    /**
+     * @brief append Schedules entries to be appended to the log 'id'.
+     */
+    void append(const QString& id, const QVector<Entry>& entries);
+
+    /**
+     * @brief flush Appends all pending entries to their logs right away.
+     */
+    void flush();
+
+    /**
+     * @brief truncate Removes the entries up to and including 'seq' from the log 'id', because
+     *                 a snapshot with these changes has been written.
+     */
+    void truncate(const QString& id, qint64 seq);
+
+    /**
+     * @brief remove Deletes the log 'id', including its pending entries.
+     */
+    void remove(const QString& id);
+
+    /**
+     * @brief bytesWritten Returns the number of bytes appended to logs so far.
+     */
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+    /**
+     * @brief entriesFromVariant Converts the entries sent by the editor's JavaScript code.
+     */
+    static QVector<Entry> entriesFromVariant(const QVariant& data);
+
+    /**
+     * @brief readLog Reads all intact entries of a log, stopping at the first damaged record.
+     * @return False if the file isn't a log.
+     */
+    static bool readLog(const QString& path, QVector<Entry>& entries);
+
+    /**
+     * @brief recover Reads the changes a log recorded after a snapshot was taken.
+     * @param seq Number of changes made to the document when the snapshot was taken.
+     */
+    static Recovery recover(const QString& path, qint64 seq);
+
+    /**
+     * @brief apply Applies changes to a document with "\n" as line separator.
+     * @return False if a change doesn't fit the document. 'text' is undefined then.
+     */
+    static bool apply(const QVector<Entry>& changes, QString& text);
+
+private:
+    static QByteArray encodeEntry(const Entry& entry);
+
+    QString m_directory;
+    QHash<QString, QByteArray> m_pending;   // Encoded records to append, per log
+    int m_pendingBytes = 0;
+    qint64 m_bytesWritten = 0;
+    QTimer m_commitTimer;
+};
+
+#endif // EDITJOURNAL_H
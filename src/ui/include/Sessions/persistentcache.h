@@ -22,6 +22,29 @@ public:
     */
     static QString backupDirPath();
 
+    /**
+    * @brief Returns the path to the directory inside backupDirPath() that contains the contents
+    *        of backed up tabs, shared by all windows.
+    */
+    static QString backupBlobDirPath();
+
+    /**
+    * @brief Returns the path to the directory that contains the file search indices.
+    *        Unlike the tab cache, this directory is not cleared when the session is saved.
+    */
+    static QString searchIndexDirPath();
+
+    /**
+     * @brief Returns the path to the file that caches the manifests of the installed extensions.
+     */
+    static QString extensionManifestCachePath();
+
+    /**
+     * @brief Returns the path to the directory that contains the unpacked extension packages,
+     *        reused when the same package is installed again.
+     */
+    static QString extensionPackageCacheDirPath();
+
     /**
      * @brief Generates a QUrl to a file within the a directory.
      * @param parent The parent directory for the file.
@@ -1,10 +1,19 @@
 #ifndef SESSIONS_H
 #define SESSIONS_H
 
+#include "include/Sessions/sessionsnapshot.h"
+
 #include <QString>
 
+#include <functional>
+#include <vector>
+
 class DocEngine;
+class EditorTabWidget;
 class TopEditorContainer;
+namespace EditorNS {
+class Editor;
+}
 
 namespace Sessions {
 
@@ -25,8 +34,40 @@ bool saveSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QStr
  * @param docEngine The DocEngine used to load all files.
  * @param editorContainer The TopEditorContainer which will receive all newly crated Tabs.
  * @param sessionPath Path to where the XML file is located.
+ * @param lazy See restoreViewData().
+ */
+void loadSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QString sessionPath, bool lazy = false);
+
+/**
+ * @brief Collects the session data of all views and tabs of a TopEditorContainer.
+ * @param editorContainer The TopEditorContainer whose views and tabs will be collected.
+ * @param viewData Receives one ViewData per tab widget.
+ * @param cacheTab Called for every tab with unsaved changes, with the tab's text as second
+ *        argument. It must store the tab's contents and set TabData::cacheFilePath, or return
+ *        false to abort. If empty, no tabs are cached and tabs without a file are skipped.
+ *        Tabs that haven't been loaded since they were restored keep the cacheFilePath
+ *        they were restored from.
+ * @return False if cacheTab failed.
+ */
+bool collectViewData(TopEditorContainer* editorContainer, std::vector<ViewData>& viewData,
+                     const std::function<bool(EditorNS::Editor*, const QString&, TabData&)>& cacheTab);
+
+/**
+ * @brief Restores the given views and their tabs in the specified window.
+ * @param docEngine The DocEngine used to load all files.
+ * @param editorContainer The TopEditorContainer which will receive all newly crated Tabs.
+ * @param views The views to restore, e.g. read from a session file.
+ * @param lazy If true, only the active tab of each view is loaded. All other tabs are
+ *        loaded when they're first needed, so their cache files must stay around until then.
+ */
+void restoreViewData(DocEngine* docEngine, TopEditorContainer* editorContainer, const std::vector<ViewData>& views,
+                     bool lazy = false);
+
+/**
+ * @brief Retrieves the session data of a tab that hasn't been loaded since it was lazily restored.
+ * @return False if the tab contains an Editor.
  */
-void loadSession(DocEngine* docEngine, TopEditorContainer* editorContainer, QString sessionPath);
+bool getPlaceholderTabData(EditorTabWidget* tabWidget, int index, TabData& td);
 
 } // namespace Autosave
 
@@ -0,0 +1,68 @@
+#ifndef SESSIONSNAPSHOT_H
+#define SESSIONSNAPSHOT_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <vector>
+
+/**
+ * @brief The TabData struct describes a single tab of a session.
+ */
+struct TabData {
+    QString filePath;
+    QString cacheFilePath;
+    QString contentHash; // Id of the BlobStore blob with the tab's contents, used instead of cacheFilePath
+    int scrollX = 0;
+    int scrollY = 0;
+    bool active = false;
+    QString language;
+    qint64 lastModified = 0;
+    bool customIndent = false;
+    bool useTabs = false;
+    int tabSize = 0;
+    QString journalId;   // Snapshots only: EditJournal log with the changes made after the snapshot
+    qint64 journalSeq = 0; // Snapshots only: number of changes made to the document when it was captured
+};
+
+/**
+ * @brief The ViewData struct describes a tab widget of a session and its tabs.
+ */
+struct ViewData {
+    std::vector<TabData> tabs;
+};
+
+/**
+ * @brief The SessionSnapshot class is a compact binary representation of a session, used by SessionStore.
+ *        Unlike session XML files, snapshots are not meant to be edited or shared. They are versioned and
+ *        checksummed so that truncated or corrupt snapshots are detected instead of being partially restored.
+ */
+class SessionSnapshot {
+public:
+    std::vector<ViewData> views;
+
+    /**
+     * @brief toBinary Serializes the snapshot.
+     */
+    QByteArray toBinary() const;
+
+    /**
+     * @brief fromBinary Deserializes a snapshot created by toBinary().
+     * @return False if 'data' isn't a complete snapshot of a supported version. 'snapshot' is unchanged then.
+     */
+    static bool fromBinary(const QByteArray& data, SessionSnapshot& snapshot);
+
+    /**
+     * @brief writeToFile Atomically replaces the file at 'path' with this snapshot. The previous
+     *                    snapshot stays intact if writing fails.
+     * @param bytesWritten If not null, set to the size of the written snapshot.
+     */
+    bool writeToFile(const QString& path, qint64* bytesWritten = nullptr) const;
+
+    /**
+     * @brief readFromFile Reads a snapshot written by writeToFile().
+     */
+    static bool readFromFile(const QString& path, SessionSnapshot& snapshot);
+};
+
+#endif // SESSIONSNAPSHOT_H
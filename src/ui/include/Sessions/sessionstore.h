@@ -0,0 +1,194 @@
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include "include/Sessions/sessionsnapshot.h"
+#include "include/docengine.h"
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QtPromise>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+class EditJournal;
+class TopEditorContainer;
+namespace EditorNS {
+class Editor;
+}
+
+/**
+ * @brief The SessionStore class keeps a crash recovery snapshot of a single window in a directory.
+ *
+ *        The directory contains a binary SessionSnapshot. The contents of dirty tabs are kept in a BlobStore
+ *        that is shared by all SessionStores whose directories are siblings, so identical contents are only
+ *        stored once, no matter how many tabs, windows or backups refer to them. Unlike Sessions::saveSession(),
+ *        a SessionStore never clears its directory: a tab's contents are only written when the tab changed
+ *        since the previous backup, and the snapshot is replaced atomically. Blobs that are no longer
+ *        referenced by any snapshot are deleted only after the new snapshot has been committed. This way
+ *        there is a complete snapshot on disk at all times.
+ *
+ *        Backing up happens in two phases. captureP() asynchronously collects the state of all editors
+ *        on the GUI thread and returns a Job. writeJob() then does all serialization and disk I/O and
+ *        can run on any thread.
+ *
+ *        Between two snapshots, the changes made to the editors are recorded in an EditJournal in the
+ *        same directory. load() replays them on top of the snapshot.
+ */
+class SessionStore {
+public:
+
+    /**
+     * @brief The Statistics struct describes the work done by a Job.
+     */
+    struct Statistics {
+        int tabsWritten = 0;        // Dirty tabs whose contents were written
+        int tabsSkipped = 0;        // Dirty tabs that were unchanged since the previous backup
+        int tabsDeduplicated = 0;   // Dirty tabs that changed, but whose contents were already stored
+        int filesRemoved = 0;       // Files in the directory that weren't referenced anymore
+        int blobsRemoved = 0;       // Blobs that weren't referenced by any snapshot anymore
+        qint64 bytesWritten = 0;
+        qint64 elapsedMs = 0;   // Time spent in writeJob()
+    };
+
+    /**
+     * @brief The Job struct contains everything needed to write a backup, without referring to
+     *        any editors. It is safe to pass to another thread.
+     */
+    struct Job {
+        struct CacheFile {
+            size_t view;                     // Position of the tab in 'snapshot'. Its contentHash is set
+            size_t tab;                      // once the contents have been stored.
+            DocEngine::DecodedText content;
+            QString sourceFile;              // If set, the already encoded contents are read from here
+        };
+
+        QString directory;
+        QString blobDirectory;
+        bool removeDirectory = false;        // Delete the whole backup instead of writing one
+        bool compressBlobs = false;
+        bool collectGarbage = false;         // Blobs of the previous snapshot might not be needed anymore
+        SessionSnapshot snapshot;
+        std::vector<CacheFile> cacheFiles;   // Tab contents that need to be stored
+        QSet<QString> referencedBlobs;       // Blobs stored by earlier jobs that the snapshot needs
+        qint64 pendingBytes = 0;             // Rough amount of data to be written
+        int tick = 0;                        // Set by the caller, for its own bookkeeping
+
+        std::weak_ptr<SessionStore> store;   // Only to be used on the GUI thread
+
+        // Results, set by writeJob()
+        bool success = false;
+        Statistics statistics;
+    };
+
+    /**
+     * @param directory Directory of the snapshot.
+     * @param blobDirectory Directory of the BlobStore with the tab contents.
+     */
+    SessionStore(const QString& directory, const QString& blobDirectory);
+    ~SessionStore();
+
+    /**
+     * @brief captureP Collects the current state of all tabs of 'editorContainer'. All editors are queried
+     *                 at the same time, and the contents of a tab are only retrieved if the tab changed since
+     *                 the previous backup.
+     * @param self Shared pointer to this store. It is kept alive until the capture is done.
+     * @return A promise for the Job that writes the backup, or for nullptr if nothing changed since the
+     *         previous backup. The store is busy until jobFinished() is called with the returned Job.
+     */
+    static QtPromise::QPromise<std::shared_ptr<Job>> captureP(const std::shared_ptr<SessionStore>& self,
+                                                              TopEditorContainer* editorContainer);
+
+    /**
+     * @brief jobFinished Must be called on the GUI thread after a Job returned by captureP() has been written
+     *                    or discarded.
+     */
+    void jobFinished(const Job& job);
+
+    /**
+     * @brief isBusy Returns true while a capture is running or its Job hasn't finished yet.
+     */
+    bool isBusy() const { return m_busy; }
+
+    const QString& directory() const { return m_directory; }
+
+    /**
+     * @brief writeJob Stores the tab contents and writes the snapshot of the Job, then removes unreferenced
+     *                 files and blobs. Sets job.success and job.statistics. Jobs that share a blob directory
+     *                 must not be written concurrently.
+     */
+    static void writeJob(Job& job);
+
+    /**
+     * @brief hasSnapshot Returns true if 'directory' contains a snapshot written by a SessionStore.
+     */
+    static bool hasSnapshot(const QString& directory);
+
+    /**
+     * @brief load Restores the snapshot in 'directory' into the given window, including the changes
+     *             its journal recorded after the snapshot was taken.
+     * @param blobDirectory Directory of the BlobStore the snapshot refers to.
+     * @return False if there is no valid snapshot.
+     */
+    static bool load(DocEngine* docEngine, TopEditorContainer* editorContainer, const QString& directory,
+                     const QString& blobDirectory);
+
+private:
+    struct CachedTab {
+        QPointer<QWidget> widget;          // Editor or placeholder. Becomes null when it's destroyed.
+        int generation = -1;               // History generation of the editor when the contents were stored
+        QString contentHash;               // Blob with the contents. Empty while the Job is pending.
+        size_t view = 0;                   // Position of the tab in the pending Job's snapshot
+        size_t tab = 0;
+    };
+
+    /**
+     * @brief collectGarbage Removes all blobs that aren't referenced by the snapshot of any SessionStore
+     *                       whose directory is a sibling of 'directory'.
+     * @return The number of removed blobs.
+     */
+    static int collectGarbage(const QString& directory, const QString& blobDirectory);
+
+    /**
+     * @brief journalEditor Starts journaling the changes of 'editor', if it isn't journaled yet.
+     * @return The id of the editor's log.
+     */
+    QString journalEditor(EditorNS::Editor* editor);
+
+    /**
+     * @brief stopJournaling Stops journaling editors that aren't part of the window anymore.
+     */
+    void stopJournaling(const QSet<EditorNS::Editor*>& keep);
+
+    struct JournaledEditor {
+        QString logId;
+        QMetaObject::Connection entries;
+        QMetaObject::Connection destroyed;
+    };
+
+    QString m_directory;
+    QString m_blobDirectory;
+    bool m_busy = false;
+    bool m_hasBackup = false; // True if the last Job succeeded
+
+    std::unique_ptr<EditJournal> m_journal;
+    QHash<EditorNS::Editor*, JournaledEditor> m_journaledEditors;
+
+    // Tabs of the last successfully written backup. Tabs that haven't been loaded since the
+    // session was restored are identified by their placeholder.
+    QHash<QWidget*, CachedTab> m_cachedTabs;
+
+    // Editors and their history generations at the time of the last successful backup. If nothing of
+    // this changed, the window doesn't need to be backed up again.
+    std::vector<std::pair<QWidget*, int>> m_savedEditors;
+
+    // Used by jobFinished(): the state that becomes current once the pending Job succeeded
+    QHash<QWidget*, CachedTab> m_pendingTabs;
+    std::vector<std::pair<QWidget*, int>> m_pendingEditors;
+};
+
+#endif // SESSIONSTORE_H
@@ -8,6 +8,7 @@
 #include <QFileSystemWatcher>
 #include <QObject>
 #include <QUrl>
+#include <QVector>
 
 /**
  * @brief Provides methods for managing documents
@@ -69,6 +70,12 @@ public:
         // Determines how already opened documents should be treated.
         DocumentLoader& setReloadAction(ReloadAction reload) { reloadAction = reload; return *this; }
 
+        // Set the position at which new tabs are inserted into the TabWidget. -1 appends them.
+        DocumentLoader& setInsertIndex(int index) { insertIndex = index; return *this; }
+
+        // If false, loaded documents don't become the current tab and don't get the focus.
+        DocumentLoader& setActivate(bool act) { activate = act; return *this; }
+
         /**
          * @brief execute Runs the load operation.
          */
@@ -82,6 +89,8 @@ public:
         EditorTabWidget* tabWidget      = nullptr;
         QTextCodec* textCodec           = nullptr;
         ReloadAction reloadAction       = ReloadActionAsk;
+        int insertIndex                 = -1;
+        bool activate                   = true;
         bool rememberLastDir            = true;
         bool bom                        = false;
         FileSizeAction fileSizeAction   = FileSizeActionAsk;
@@ -134,8 +143,30 @@ public:
     void reinterpretEncoding(Editor *editor, QTextCodec *codec, bool bom);
     static DocEngine::DecodedText readToString(QFile *file);
     static DocEngine::DecodedText readToString(QFile *file, QTextCodec *codec, bool bom);
+
+    /**
+     * @brief Decodes a byte array into a string, trying to guess the best
+     *        codec.
+     * @param contents
+     * @return
+     */
+    static DecodedText decodeText(const QByteArray &contents);
+
     static bool writeFromString(QIODevice *io, const DecodedText &write);
 
+    /**
+     * @brief Encodes the given chunks of text one after another and writes them
+     *        to an already opened IO device. Unlike writeFromString(), the
+     *        full encoded text is never held in memory at once.
+     * @param io Device to write to. It has to be opened for writing and is
+     *           not closed by this function.
+     * @param chunks Pieces of text that form the document when concatenated
+     * @param codec Codec used for encoding
+     * @param bom Whether to write a BOM, as in DecodedText::bom
+     * @return The number of bytes written, or -1 on error
+     */
+    static qint64 writeFromChunks(QIODevice *io, const QVector<QStringRef> &chunks, QTextCodec *codec, bool bom);
+
     /**
      * @brief Write the provided Editor content to the specified IO device, using
      *        the encoding and the BOM settings specified in the Editor.
@@ -177,13 +208,6 @@ private:
     void monitorDocument(const QString &fileName);
     void unmonitorDocument(const QString &fileName);
 
-    /**
-     * @brief Decodes a byte array into a string, trying to guess the best
-     *        codec.
-     * @param contents
-     * @return
-     */
-    static DecodedText decodeText(const QByteArray &contents);
     /**
      * @brief Decodes a byte array into a string, using the specified codec.
      * @param contents
@@ -0,0 +1,48 @@
+#ifndef EDITORPLACEHOLDER_H
+#define EDITORPLACEHOLDER_H
+
+#include <QUrl>
+#include <QWidget>
+
+class EditorTabWidget;
+namespace EditorNS {
+class Editor;
+}
+
+/**
+ * @brief An EditorPlaceholder stands in for an Editor whose document hasn't been loaded yet,
+ *        e.g. a tab of a restored session that hasn't been looked at. It's much cheaper than an
+ *        Editor. EditorTabWidget replaces it with a real Editor as soon as the tab is shown or
+ *        the tab's Editor is requested through EditorTabWidget::materializeEditor().
+ */
+class EditorPlaceholder : public QWidget
+{
+public:
+    explicit EditorPlaceholder(QWidget *parent = nullptr) : QWidget(parent) {}
+
+    /**
+     * @brief filePath Returns the path of the document, or an empty url if the document
+     *                 has never been saved.
+     */
+    virtual QUrl filePath() const = 0;
+
+    /**
+     * @brief isClean Returns false if the document will have unsaved changes once it is loaded.
+     */
+    virtual bool isClean() const = 0;
+
+    /**
+     * @brief load Loads the document into a new Editor tab at position 'index' of 'tabWidget',
+     *             without making it the current tab. Other tabs must not be moved or removed.
+     * @return The new Editor, or nullptr if the document couldn't be loaded.
+     */
+    virtual EditorNS::Editor *load(EditorTabWidget *tabWidget, int index) = 0;
+
+    bool isLoading() const { return m_loading; }
+
+private:
+    friend class EditorTabWidget;
+    bool m_loading = false;
+};
+
+#endif // EDITORPLACEHOLDER_H
@@ -2,7 +2,9 @@
 #define EDITORTABWIDGET_H
 
 #include "EditorNS/editor.h"
+#include "editorplaceholder.h"
 
+#include <QSet>
 #include <QTabWidget>
 #include <QWheelEvent>
 
@@ -19,7 +21,38 @@ public:
     explicit EditorTabWidget(QWidget *parent = 0);
     ~EditorTabWidget();
 
-    int addEditorTab(bool setFocus, const QString &title);
+    /**
+     * @brief Add a new, empty Editor tab
+     * @param setFocus True to give focus to the new document
+     * @param title Title of the new tab
+     * @param index Position of the new tab. -1 to append it.
+     * @return Tab index of the new document.
+     */
+    int addEditorTab(bool setFocus, const QString &title, int index = -1);
+
+    /**
+     * @brief Add a tab whose Editor is only created once it's needed. The tab widget takes
+     *        ownership of the placeholder.
+     * @param placeholder Placeholder that loads the document
+     * @param title Title of the new tab
+     * @param index Position of the new tab. -1 to append it.
+     * @return Tab index of the new tab.
+     */
+    int addPlaceholderTab(EditorPlaceholder *placeholder, const QString &title, int index = -1);
+
+    /**
+     * @brief placeholder Returns the placeholder at the given tab index, or nullptr if the tab
+     *                    contains an Editor.
+     */
+    EditorPlaceholder *placeholder(int index) const;
+    bool isPlaceholder(int index) const { return placeholder(index) != nullptr; }
+
+    /**
+     * @brief loadPlaceholder Replaces the placeholder at the given tab index with an Editor.
+     *                        Does nothing if the tab already contains an Editor.
+     */
+    void loadPlaceholder(int index);
+
     /**
      * @brief Add a new document, moving it from another EditorTabWidget
      * @param setFocus True to give focus to the new document
@@ -28,8 +61,23 @@ public:
      * @return Tab index of the new document inside this EditorTabWidget.
      */
     int transferEditorTab(bool setFocus, EditorTabWidget *source, int tabIndex);
+    /**
+     * @brief findOpenEditorByUrl Returns the index of the tab that contains the given file,
+     *                            or -1. Tabs that haven't been loaded yet are found too.
+     */
     int findOpenEditorByUrl(const QUrl &filename);
+
+    /**
+     * @brief editor Returns the Editor at the given tab index, or nullptr if the tab is a
+     *               placeholder that hasn't been loaded yet.
+     */
     Editor *editor(int index) const;
+
+    /**
+     * @brief materializeEditor Returns the Editor at the given tab index. If the tab is a
+     *                          placeholder, its document is loaded first.
+     */
+    Editor *materializeEditor(int index);
     QSharedPointer<Editor> editorSharedPtr(int index);
     QSharedPointer<Editor> editorSharedPtr(Editor *editor);
     Editor *currentEditor();
@@ -73,6 +121,9 @@ private:
 
     qreal m_zoomFactor = 1;
 
+    // Placeholders currently in this TabWidget
+    QSet<EditorPlaceholder*> m_placeholders;
+
     void setTabBarHidden(bool yes);
     void setTabBarHighlight(bool yes);
     void connectEditorSignals(Editor *editor);
@@ -84,13 +135,22 @@ private:
      * @param title Title of the new tab. It's not used if a tab transfer is occurring
      * @param source Container of the tab to transfer. Set it to 0 to create a new tab.
      * @param sourceTabIndex Tab index, within @param source, of the tab to transfer
+     * @param index Position of the new tab. -1 to append it.
      * @return Index of the tab
      */
-    int rawAddEditorTab(const bool setFocus, const QString &title, EditorTabWidget *source, const int sourceTabIndex);
+    int rawAddEditorTab(const bool setFocus, const QString &title, EditorTabWidget *source, const int sourceTabIndex,
+                        const int index = -1);
+
+    /**
+     * @brief prefetchNeighbours Loads the placeholders next to the given Editor once the
+     *        application is idle, so switching to them is fast.
+     */
+    void prefetchNeighbours(Editor *editor);
 private slots:
     void on_cleanChanged(bool isClean); 
     void on_editorMouseWheel(QWheelEvent *ev);
     void on_fileNameChanged(const QUrl &, const QUrl &newFileName);
+    void on_currentChanged(int index);
 signals:
     void gotFocus();
     void editorAdded(int index);
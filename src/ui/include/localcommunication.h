@@ -2,22 +2,94 @@
 #define LOCALCOMMUNICATION_H
 
 #include <QLocalSocket>
+#include <QObject>
+#include <QQueue>
 #include <QString>
 
 /**
- * @brief Send and receive messages through local sockets.
+ * @brief Send and receive messages through a local socket.
+ *
+ *        Every message is framed by its size, as a big-endian quint64. Messages can
+ *        be up to MAX_MESSAGE_SIZE bytes; a peer announcing a larger one is
+ *        disconnected. Incoming data is parsed as it arrives, without blocking:
+ *        messageReceived() is emitted once complete messages are available, and
+ *        payloads are read straight into their own buffer, which grows as bytes
+ *        arrive rather than trusting the announced size.
+ *
+ *        Outgoing messages are queued and handed to the socket in chunks, keeping at
+ *        most WRITE_HIGH_WATERMARK bytes in its buffer. The rest is written as the
+ *        socket drains.
  */
-class LocalCommunication
+class LocalCommunication : public QObject
 {
+    Q_OBJECT
 public:
-    static bool sendRaw(QByteArray data, QLocalSocket *socket);
-    static bool send(QString message, QLocalSocket *socket);
-    static QByteArray receiveRaw(QLocalSocket *socket);
-    static QString receive(QLocalSocket *socket);
-    static int numOfDigits(int n);
+    /**
+     * @brief The socket must outlive this object.
+     */
+    explicit LocalCommunication(QLocalSocket *socket, QObject *parent = 0);
+
+    QLocalSocket *socket() const;
+
+    /**
+     * @brief Queues a message. Fails if the socket isn't connected or the message
+     *        is larger than MAX_MESSAGE_SIZE.
+     */
+    bool sendRaw(const QByteArray &data);
+    bool send(const QString &message);
+
+    bool hasPendingMessages() const;
+
+    /**
+     * @brief Returns the oldest received message, or a null array if there are none.
+     */
+    QByteArray nextRaw();
+    QString next();
+
+    /**
+     * @brief Blocks until a message is received, for callers without an event loop.
+     * @return A null array if none arrived within msecs.
+     */
+    QByteArray waitForRaw(int msecs = 30000);
+    QString waitFor(int msecs = 30000);
+
+    /**
+     * @brief Blocks until every queued message has been written to the socket.
+     */
+    bool waitForBytesWritten(int msecs = 30000);
+
+    /**
+     * @brief Number of bytes that haven't been written to the socket yet.
+     */
+    qint64 bytesToWrite() const;
+
+    static const qint64 WRITE_CHUNK_SIZE = 64 * 1024;
+    static const qint64 WRITE_HIGH_WATERMARK = 1024 * 1024;
+    static const qint64 MAX_MESSAGE_SIZE = 256 * 1024 * 1024;
+
+signals:
+    void messageReceived();
 
 private:
-    static const int MAX_PKT_SIZE = 999999;
+    static const int HEADER_SIZE = sizeof(quint64);
+
+    QLocalSocket *m_socket;
+
+    // Incoming frame
+    char m_header[HEADER_SIZE];
+    int m_headerReceived = 0;
+    QByteArray m_payload;
+    qint64 m_payloadSize = 0;
+    qint64 m_payloadReceived = 0;
+    QQueue<QByteArray> m_received;
+
+    // Outgoing data. The payloads are shared with the caller, not copied.
+    QQueue<QByteArray> m_writeQueue;
+    qint64 m_writeOffset = 0;   // Already written from the head of the queue
+    qint64 m_queuedBytes = 0;
+
+    void readFrames();
+    void writeChunks();
 };
 
 #endif // LOCALCOMMUNICATION_H
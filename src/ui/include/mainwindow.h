@@ -186,6 +186,7 @@ private slots:
     void on_editorUrlsDropped(QList<QUrl> urls);
     void on_actionGo_to_Line_triggered();
     void on_actionInstall_Extension_triggered();
+    void on_actionExtension_Diagnostics_triggered();
     void on_actionFull_Screen_toggled(bool on);
     void on_actionShow_End_of_Line_triggered(bool on);
     void on_actionShow_All_Characters_toggled(bool on);
@@ -217,6 +218,11 @@ private:
     QString               m_workingDirectory;
     QMap<QSharedPointer<Extensions::Extension>, QMenu*> m_extensionMenus;
 
+    /**
+     * @brief Adds the menu items of the commands declared in the extension manifests.
+     */
+    void addExtensionCommands();
+
     AdvancedSearchDock*  m_advSearchDock;
 
     /**
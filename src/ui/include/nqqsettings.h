@@ -80,7 +80,9 @@ public:
         NQQ_SETTING(ShowEOL,                        bool,       false)
 
         NQQ_SETTING(RememberTabsOnExit,             bool,       true)
+        NQQ_SETTING(LazySessionRestore,             bool,       true)    // Load restored tabs when they're first shown
         NQQ_SETTING(AutosaveInterval,               int,        15)      // In seconds
+        NQQ_SETTING(CompressBackups,                bool,       true)
         NQQ_SETTING(LastSelectedDir,                QString,    ".")
         NQQ_SETTING(LastSelectedSessionDir,         QString,    QString())
         NQQ_SETTING(RecentDocuments,                QList<QVariant>, QList<QVariant>())
@@ -100,16 +102,28 @@ public:
 
     BEGIN_CATEGORY(Search)
         NQQ_SETTING(SearchAsIType,  bool,           true)
+        NQQ_SETTING(HighlightAllMatches, bool,      true)
         NQQ_SETTING(SaveHistory,    bool,           true)
         NQQ_SETTING(SearchHistory,  QStringList,    QStringList())
         NQQ_SETTING(ReplaceHistory, QStringList,    QStringList())
         NQQ_SETTING(FileHistory,    QStringList,    QStringList())
         NQQ_SETTING(FilterHistory,  QStringList,    QStringList())
+        NQQ_SETTING(UseSearchIndex, bool,           true)
+        NQQ_SETTING(UseResultCache, bool,           true)
+        NQQ_SETTING(MaxResultsPerFile, int,         10000)  // 0 means unlimited
+        NQQ_SETTING(MaxResultsTotal, int,           200000) // 0 means unlimited
+        NQQ_SETTING(ExcludePattern, QString,        ".git,.hg,.svn,node_modules")
+        NQQ_SETTING(RespectIgnoreFiles, bool,       true)
+        NQQ_SETTING(SkipBinaryFiles, bool,          true)
     END_CATEGORY(Search)
 
     BEGIN_CATEGORY(Extensions)
         NQQ_SETTING(RuntimeNodeJS,  QString, QString())
         NQQ_SETTING(RuntimeNpm,     QString, QString())
+        NQQ_SETTING(MaxRequestsPerSecond, int, 2000)    // Per extension, 0 means unlimited
+        NQQ_SETTING(MaxHostProcesses, int,  16)         // Running at the same time, 0 means unlimited
+        NQQ_SETTING(MaxHostMemoryMB, int,   512)        // Per extension, 0 means unlimited
+        NQQ_SETTING(MaxHostCpuPercent, int, 90)         // Per extension, sustained. 0 means unlimited
     END_CATEGORY(Extensions)
 
     BEGIN_CATEGORY(Languages)
@@ -4,6 +4,8 @@
 #include <QApplication>
 #include <QLocalServer>
 
+class LocalCommunication;
+
 /**
  * @brief QApplication subclass which, using local sockets, makes sure only
  *        one instance of the application is running at the same time.
@@ -31,8 +33,8 @@ public slots:
 private:
     QLocalServer *m_localServer = nullptr;
 
-    bool sendCommandLineArguments(QLocalSocket *socket);
-    QLocalSocket *alreadyRunningInstance();
+    bool sendCommandLineArguments(LocalCommunication *communication);
+    LocalCommunication *alreadyRunningInstance();
     void newConnection();
     QString socketNameForUser();
 };
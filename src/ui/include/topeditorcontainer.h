@@ -42,7 +42,8 @@ public:
     EditorTabWidget *tabWidgetFromEditor(Editor *editor);
 
     /**
-     * @brief Executes the specified function for each editor in this container.
+     * @brief Executes the specified function for each editor in this container. Tabs that
+     *        haven't been loaded yet (see EditorPlaceholder) aren't loaded: their Editor is nullptr.
      * @param backwardIndexes True if you want to get the items in the reverse order
      *                        (useful for example if you're deleting the items
      *                         while iterating over them).
@@ -52,6 +53,13 @@ public:
     void forEachEditor(bool backwardIndexes, std::function<bool (const int, const int, EditorTabWidget *, Editor *)> callback);
     void forEachEditor(std::function<bool (const int, const int, EditorTabWidget *, Editor *)> callback);
 
+    /**
+     * @brief Like forEachEditor(), but skips tabs that haven't been loaded yet (see EditorPlaceholder).
+     *        Useful to apply settings that are also applied to new editors, without loading
+     *        every tab of a lazily restored session.
+     */
+    void forEachLoadedEditor(std::function<bool (const int, const int, EditorTabWidget *, Editor *)> callback);
+
     /**
      * @brief Executes the specified asynchronous function for each editor in this container, in order.
      *        Every callback can be asynchronous and should call goOn() as soon as it finishes to invoke
@@ -1,83 +1,177 @@
 #include "include/localcommunication.h"
 
-bool LocalCommunication::sendRaw(QByteArray data, QLocalSocket *socket)
+#include <QElapsedTimer>
+#include <QtEndian>
+
+const qint64 LocalCommunication::WRITE_CHUNK_SIZE;
+const qint64 LocalCommunication::WRITE_HIGH_WATERMARK;
+const qint64 LocalCommunication::MAX_MESSAGE_SIZE;
+
+LocalCommunication::LocalCommunication(QLocalSocket *socket, QObject *parent) :
+    QObject(parent),
+    m_socket(socket)
 {
-    if (data.length() > MAX_PKT_SIZE)
-        return false;
+    connect(m_socket, &QLocalSocket::readyRead, this, &LocalCommunication::readFrames);
+    connect(m_socket, &QLocalSocket::bytesWritten, this, &LocalCommunication::writeChunks);
 
-    QByteArray header = QString::number(data.length())
-            .rightJustified(numOfDigits(MAX_PKT_SIZE), '0').toUtf8();
+    // Data might have arrived before we were connected
+    readFrames();
+}
 
-    int written = 0;
-    while (written < header.length()) {
-        int bytes = socket->write(header);
+QLocalSocket *LocalCommunication::socket() const
+{
+    return m_socket;
+}
 
-        if (bytes > -1)
-            written += bytes;
-        else
-            return false;
-    }
+bool LocalCommunication::sendRaw(const QByteArray &data)
+{
+    if (m_socket->state() != QLocalSocket::ConnectedState || data.size() > MAX_MESSAGE_SIZE)
+        return false;
 
-    written = 0;
-    while (written < data.length()) {
-        int bytes = socket->write(data);
+    QByteArray header(HEADER_SIZE, Qt::Uninitialized);
+    qToBigEndian<quint64>(data.size(), reinterpret_cast<uchar *>(header.data()));
 
-        if (bytes > -1)
-            written += bytes;
-        else
-            return false;
+    m_writeQueue.enqueue(header);
+    m_queuedBytes += header.size();
+    if (!data.isEmpty()) {
+        m_writeQueue.enqueue(data);
+        m_queuedBytes += data.size();
     }
 
+    writeChunks();
     return true;
 }
 
-bool LocalCommunication::send(QString message, QLocalSocket *socket)
+bool LocalCommunication::send(const QString &message)
 {
-    return sendRaw(message.toUtf8(), socket);
+    return sendRaw(message.toUtf8());
 }
 
-QByteArray LocalCommunication::receiveRaw(QLocalSocket *socket)
+void LocalCommunication::writeChunks()
 {
-    QByteArray header;
-    int bytes = QString(numOfDigits(MAX_PKT_SIZE), '0').toUtf8().length();
+    while (!m_writeQueue.isEmpty() && m_socket->bytesToWrite() < WRITE_HIGH_WATERMARK) {
+        const QByteArray &head = m_writeQueue.head();
+        const qint64 length = qMin(WRITE_CHUNK_SIZE, head.size() - m_writeOffset);
 
-    while (header.length() < bytes) {
-        header.append(socket->read(bytes - header.length()));
-        socket->waitForReadyRead(100);
+        const qint64 written = m_socket->write(head.constData() + m_writeOffset, length);
+        if (written <= 0)
+            return;
+
+        m_writeOffset += written;
+        m_queuedBytes -= written;
+
+        if (m_writeOffset == head.size()) {
+            m_writeQueue.dequeue();
+            m_writeOffset = 0;
+        }
     }
+}
 
-    QString sizeStr = QString::fromUtf8(header);
-    bool ok;
-    int size = sizeStr.toInt(&ok);
+qint64 LocalCommunication::bytesToWrite() const
+{
+    return m_queuedBytes + m_socket->bytesToWrite();
+}
 
-    if (ok)
-    {
-        QByteArray msgData;
+void LocalCommunication::readFrames()
+{
+    bool received = false;
+
+    while (m_socket->bytesAvailable() > 0) {
+        if (m_headerReceived < HEADER_SIZE) {
+            const qint64 bytes = m_socket->read(m_header + m_headerReceived, HEADER_SIZE - m_headerReceived);
+            if (bytes <= 0)
+                break;
+
+            m_headerReceived += bytes;
+            if (m_headerReceived < HEADER_SIZE)
+                break;
+
+            const quint64 size = qFromBigEndian<quint64>(reinterpret_cast<const uchar *>(m_header));
+            if (size > quint64(MAX_MESSAGE_SIZE)) {
+                // Either a misbehaving peer or not our protocol
+                m_socket->abort();
+                return;
+            }
+
+            m_payload = QByteArray();
+            m_payloadSize = qint64(size);
+            m_payloadReceived = 0;
+        }
+
+        if (m_payloadReceived < m_payloadSize) {
+            // Only allocate what has actually arrived
+            const qint64 length = qMin(m_socket->bytesAvailable(), m_payloadSize - m_payloadReceived);
+            m_payload.resize(int(m_payloadReceived + length));
 
-        while (msgData.length() < size) {
-            msgData.append(socket->read(size - msgData.length()));
+            const qint64 bytes = m_socket->read(m_payload.data() + m_payloadReceived, length);
+            m_payloadReceived += qMax<qint64>(bytes, 0);
+            m_payload.resize(int(m_payloadReceived));
+            if (bytes <= 0)
+                break;
         }
 
-        return msgData;
-    } else {
-        return QByteArray();
+        if (m_payloadReceived == m_payloadSize) {
+            // Empty messages are valid, and not null
+            m_received.enqueue(m_payload.isNull() ? QByteArray("") : m_payload);
+            m_payload = QByteArray();
+            m_headerReceived = 0;
+            received = true;
+        }
     }
+
+    if (received)
+        emit messageReceived();
 }
 
-QString LocalCommunication::receive(QLocalSocket *socket)
+bool LocalCommunication::hasPendingMessages() const
 {
-    return QString::fromUtf8(receiveRaw(socket));
+    return !m_received.isEmpty();
 }
 
-int LocalCommunication::numOfDigits(int n) {
-    int digits = 0;
-    if (n <= 0) {
-        n = -n;
-        ++digits;
+QByteArray LocalCommunication::nextRaw()
+{
+    return m_received.isEmpty() ? QByteArray() : m_received.dequeue();
+}
+
+QString LocalCommunication::next()
+{
+    return QString::fromUtf8(nextRaw());
+}
+
+QByteArray LocalCommunication::waitForRaw(int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while (m_received.isEmpty()) {
+        const int remaining = msecs - int(timer.elapsed());
+        if (remaining <= 0 || !m_socket->waitForReadyRead(remaining))
+            return QByteArray();
+
+        // readyRead isn't emitted again while its handlers run
+        readFrames();
     }
-    while (n) {
-        n /= 10;
-        ++digits;
+
+    return nextRaw();
+}
+
+QString LocalCommunication::waitFor(int msecs)
+{
+    return QString::fromUtf8(waitForRaw(msecs));
+}
+
+bool LocalCommunication::waitForBytesWritten(int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while (bytesToWrite() > 0) {
+        writeChunks();
+
+        const int remaining = msecs - int(timer.elapsed());
+        if (remaining <= 0 || !m_socket->waitForBytesWritten(remaining))
+            return false;
     }
-    return digits;
+
+    return true;
 }
@@ -154,7 +154,8 @@ int main(int argc, char *argv[])
         MainWindow* wnd = new MainWindow(QStringList(), nullptr);
 
         if (settings.General.getRememberTabsOnExit()) {
-            Sessions::loadSession(wnd->getDocEngine(), wnd->topEditorContainer(), PersistentCache::cacheSessionPath());
+            Sessions::loadSession(wnd->getDocEngine(), wnd->topEditorContainer(), PersistentCache::cacheSessionPath(),
+                                  settings.General.getLazySessionRestore());
         }
 
         wnd->openCommandLineProvidedUrls(QDir::currentPath(), QApplication::arguments());
@@ -5,6 +5,7 @@
 #include "include/EditorNS/bannerindentationdetected.h"
 #include "include/EditorNS/editor.h"
 #include "include/Extensions/Stubs/windowstub.h"
+#include "include/Extensions/extensiondiagnostics.h"
 #include "include/Extensions/extensionsloader.h"
 #include "include/Extensions/installextension.h"
 #include "include/Sessions/backupservice.h"
@@ -127,6 +128,7 @@ MainWindow::MainWindow(const QString &workingDirectory, const QStringList &argum
     setupLanguagesMenu();
 
     showExtensionsMenu(Extensions::ExtensionsLoader::extensionRuntimePresent());
+    addExtensionCommands();
 
     //Registers all actions so that NqqSettings knows their default and current shortcuts.
     const QList<QAction*> allActions = getActions();
@@ -678,7 +680,7 @@ void MainWindow::toggleOverwrite()
 {
     m_overwrite = !m_overwrite;
 
-    m_topEditorContainer->forEachEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
         editor->setOverwrite(m_overwrite);
         return true;
     });
@@ -735,9 +737,9 @@ bool MainWindow::updateSymbols(bool on)
 
 void MainWindow::on_actionShow_Tabs_triggered(bool on)
 {
-    m_topEditorContainer->forEachEditorConcurrent([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor, std::function<void()> done) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
         editor->setTabsVisible(on);
-        done();
+        return true;
     });
     if (!updateSymbols(on)) {
         m_settings.General.setTabsVisible(on);
@@ -746,9 +748,9 @@ void MainWindow::on_actionShow_Tabs_triggered(bool on)
 
 void MainWindow::on_actionShow_Spaces_triggered(bool on)
 {
-    m_topEditorContainer->forEachEditorConcurrent([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor, std::function<void()> done) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
         editor->setWhitespaceVisible(on);
-        done();
+        return true;
     });
     if (!updateSymbols(on)) {
         m_settings.General.setSpacesVisisble(on);
@@ -757,9 +759,9 @@ void MainWindow::on_actionShow_Spaces_triggered(bool on)
 
 void MainWindow::on_actionShow_End_of_Line_triggered(bool on)
 {
-    m_topEditorContainer->forEachEditorConcurrent([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor, std::function<void()> done) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
         editor->setEOLVisible(on);
-        done();
+        return true;
     });
     if (!updateSymbols(on)) {
         m_settings.General.setShowEOL(on);
@@ -789,11 +791,11 @@ void MainWindow::on_actionShow_All_Characters_toggled(bool on)
         ui->actionShow_Spaces->setChecked(showSpaces);
     }
 
-    m_topEditorContainer->forEachEditorConcurrent([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor, std::function<void()> done) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
         editor->setEOLVisible(ui->actionShow_End_of_Line->isChecked());
         editor->setTabsVisible(ui->actionShow_Tabs->isChecked());
         editor->setWhitespaceVisible(on);
-        done();
+        return true;
     });
 
     m_settings.General.setShowAllSymbols(on);
@@ -801,9 +803,9 @@ void MainWindow::on_actionShow_All_Characters_toggled(bool on)
 
 void MainWindow::on_actionMath_Rendering_toggled(bool on)
 {
-    m_topEditorContainer->forEachEditorConcurrent([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor, std::function<void()> done) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
         editor->setMathEnabled(on);
-        done();
+        return true;
     });
 
     m_settings.General.setMathRendering(on);
@@ -921,7 +923,15 @@ int MainWindow::askIfWantToSave(EditorTabWidget *tabWidget, int tab, int reason)
 int MainWindow::closeTab(EditorTabWidget *tabWidget, int tab, bool remove, bool force)
 {
     int result = MainWindow::tabCloseResult_AlreadySaved;
-    Editor *editor = tabWidget->editor(tab);
+    Editor *editor = nullptr;
+
+    // Tabs that were never loaded can be closed without loading them first.
+    if (tabWidget->isPlaceholder(tab) && (force || tabWidget->placeholder(tab)->isClean())) {
+        if (remove) m_docEngine->closeDocument(tabWidget, tab);
+        goto cleanup;
+    }
+
+    editor = tabWidget->materializeEditor(tab);
 
     // If the tab is the only existing one, is not associated with a file, and has no contents,
     // we'll not close it.
@@ -999,7 +1009,7 @@ int MainWindow::closeTab(EditorTabWidget *tabWidget, int tab)
 
 int MainWindow::save(EditorTabWidget *tabWidget, int tab)
 {
-    Editor *editor = tabWidget->editor(tab);
+    Editor *editor = tabWidget->materializeEditor(tab);
 
     if (editor->filePath().isEmpty())
     {
@@ -1059,12 +1069,12 @@ int MainWindow::saveAs(EditorTabWidget *tabWidget, int tab, bool copy)
 
 QUrl MainWindow::getSaveDialogDefaultFileName(EditorTabWidget *tabWidget, int tab)
 {
-    QUrl docFileName = tabWidget->editor(tab)->filePath();
+    QUrl docFileName = tabWidget->materializeEditor(tab)->filePath();
 
     if (docFileName.isEmpty()) {
         // For tabs that don't have a filename associated with them we'll composite one using
         // its tab title and the language mode's file extension.
-        const auto& extensions = tabWidget->editor(tab)->getLanguage()->fileExtensions;
+        const auto& extensions = tabWidget->materializeEditor(tab)->getLanguage()->fileExtensions;
         QString ext = extensions.isEmpty() ? "" : "." + extensions.first();
 
         return QUrl::fromLocalFile(m_settings.General.getLastSelectedDir()
@@ -1085,6 +1095,23 @@ QSharedPointer<Editor> MainWindow::currentEditorSharedPtr()
     return tabW->editorSharedPtr(tabW->currentIndex());
 }
 
+void MainWindow::addExtensionCommands()
+{
+    const auto extensions = Extensions::ExtensionsLoader::loadedExtensions();
+
+    // Commands declared in the manifests are available before their extension is started
+    for (const QSharedPointer<Extensions::Extension> &extension : extensions) {
+        for (const Extensions::Extension::Command &command : extension->commands()) {
+            QAction *action = addExtensionMenuItem(extension->id(), command.title);
+            const QString extensionId = extension->id();
+            const QString commandId = command.id;
+            connect(action, &QAction::triggered, this, [extensionId, commandId]() {
+                Extensions::ExtensionsLoader::invokeCommand(extensionId, commandId);
+            });
+        }
+    }
+}
+
 QAction * MainWindow::addExtensionMenuItem(QString extensionId, QString text)
 {
     QMap<QString, QSharedPointer<Extensions::Extension>> extensions = Extensions::ExtensionsLoader::loadedExtensions();
@@ -1158,7 +1185,7 @@ void MainWindow::on_actionCut_triggered()
 void MainWindow::on_currentEditorChanged(EditorTabWidget *tabWidget, int tab)
 {
     if (tab != -1) {
-        Editor *editor = tabWidget->editor(tab);
+        Editor *editor = tabWidget->materializeEditor(tab);
         refreshEditorUiInfo(editor);
         editor->requestDocumentInfo();
     }
@@ -1166,7 +1193,7 @@ void MainWindow::on_currentEditorChanged(EditorTabWidget *tabWidget, int tab)
 
 void MainWindow::on_editorAdded(EditorTabWidget *tabWidget, int tab)
 {
-    Editor *editor = tabWidget->editor(tab);
+    Editor *editor = tabWidget->materializeEditor(tab);
 
     // If the tab is not newly opened but only transferred (e.g. with "Move to other View") it may
     // have a banner attached to it. We need to disconnect previous signals to prevent
@@ -1219,12 +1246,14 @@ void MainWindow::refreshEditorUiCursorInfo(QMap<QString, QVariant> data)
     m_sbDocumentInfoLabel->setText(msg);
 }
 
-void MainWindow::on_currentLanguageChanged(QString /*id*/, QString /*name*/)
+void MainWindow::on_currentLanguageChanged(QString id, QString /*name*/)
 {
     Editor *editor = dynamic_cast<Editor *>(sender());
     if (!editor)
         return;
 
+    Extensions::ExtensionsLoader::activate(Extensions::ActivationEvents::languageEvent(id));
+
     if (currentEditor() == editor) {
         refreshEditorUiInfo(editor);
     }
@@ -1281,7 +1310,7 @@ void MainWindow::searchDockItemInteracted(const DocResult& doc, const MatchResul
         if (pos.first == -1 || pos.second == -1)
             return;
 
-        Editor *editor = m_topEditorContainer->tabWidget(pos.first)->editor(pos.second);
+        Editor *editor = m_topEditorContainer->tabWidget(pos.first)->materializeEditor(pos.second);
 
         if (result) {
             editor->setSelection(result->lineNumber-1, result->positionInLine, //selection start
@@ -1560,7 +1589,7 @@ void MainWindow::on_actionClose_All_triggered()
 
 void MainWindow::on_fileOnDiskChanged(EditorTabWidget *tabWidget, int tab, bool removed)
 {
-    Editor *editor = tabWidget->editor(tab);
+    Editor *editor = tabWidget->materializeEditor(tab);
 
     if (removed) {
         BannerFileRemoved *banner = new BannerFileRemoved(this);
@@ -1646,7 +1675,7 @@ void MainWindow::on_actionZoom_Out_triggered()
 void MainWindow::on_editorMouseWheel(EditorTabWidget *tabWidget, int tab, QWheelEvent *ev)
 {
     if (QApplication::keyboardModifiers() & Qt::ControlModifier) {
-        qreal curZoom = tabWidget->editor(tab)->zoomFactor();
+        qreal curZoom = tabWidget->materializeEditor(tab)->zoomFactor();
         qreal diff = ev->delta() / 120;
         diff /= 10;
 
@@ -1718,7 +1747,9 @@ void MainWindow::on_actionSave_All_triggered()
 {
     // No tab must get closed (or added) while we're iterating!!
     m_topEditorContainer->forEachEditor([&](const int /*tabWidgetId*/, const int editorId, EditorTabWidget *tabWidget, Editor *editor) {
-        if (editor->isClean()) {
+        // Tabs that were never loaded only need saving if they had unsaved changes
+        const bool isClean = editor ? editor->isClean() : tabWidget->placeholder(editorId)->isClean();
+        if (isClean) {
             return true;
         } else {
             tabWidget->setCurrentIndex(editorId);
@@ -1735,7 +1766,7 @@ void MainWindow::on_bannerRemoved(QWidget *banner)
 
 void MainWindow::on_documentSaved(EditorTabWidget *tabWidget, int tab)
 {
-    Editor *editor = tabWidget->editor(tab);
+    Editor *editor = tabWidget->materializeEditor(tab);
     editor->removeBanner("filechanged");
     editor->removeBanner("fileremoved");
 
@@ -1746,7 +1777,7 @@ void MainWindow::on_documentSaved(EditorTabWidget *tabWidget, int tab)
 
 void MainWindow::on_documentReloaded(EditorTabWidget *tabWidget, int tab)
 {
-    Editor *editor = tabWidget->editor(tab);
+    Editor *editor = tabWidget->materializeEditor(tab);
     editor->removeBanner("filechanged");
     editor->removeBanner("fileremoved");
 
@@ -1758,7 +1789,7 @@ void MainWindow::on_documentReloaded(EditorTabWidget *tabWidget, int tab)
 
 void MainWindow::on_documentLoaded(EditorTabWidget *tabWidget, int tab, bool wasAlreadyOpened, bool updateRecentDocs)
 {
-    Editor *editor = tabWidget->editor(tab);
+    Editor *editor = tabWidget->materializeEditor(tab);
 
     const int MAX_RECENT_ENTRIES = 10;
 
@@ -1919,7 +1950,7 @@ void MainWindow::on_actionRename_triggered()
 
 void MainWindow::on_actionWord_wrap_toggled(bool on)
 {
-    m_topEditorContainer->forEachEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
         editor->setLineWrap(on);
         return true;
     });
@@ -2452,6 +2483,13 @@ void MainWindow::on_actionInstall_Extension_triggered()
     }
 }
 
+void MainWindow::on_actionExtension_Diagnostics_triggered()
+{
+    Extensions::ExtensionDiagnostics *diagnostics = new Extensions::ExtensionDiagnostics(this);
+    diagnostics->setAttribute(Qt::WA_DeleteOnClose);
+    diagnostics->show();
+}
+
 void MainWindow::showExtensionsMenu(bool show)
 {
     ui->menu_Extensions->menuAction()->setVisible(show);
@@ -2507,7 +2545,7 @@ void MainWindow::on_actionFull_Screen_toggled(bool on)
 
 void MainWindow::on_actionToggle_Smart_Indent_toggled(bool on)
 {
-    m_topEditorContainer->forEachEditor([&](const int, const int, EditorTabWidget *, Editor *editor) {
+    m_topEditorContainer->forEachLoadedEditor([&](const int, const int, EditorTabWidget *, Editor *editor) {
         editor->setSmartIndent(on);
         return true;
     });
@@ -2535,7 +2573,7 @@ void MainWindow::on_actionLoad_Session_triggered()
 
     m_settings.General.setLastSelectedSessionDir(QFileInfo(filePath).dir().absolutePath());
 
-    Sessions::loadSession(m_docEngine, m_topEditorContainer, filePath);
+    Sessions::loadSession(m_docEngine, m_topEditorContainer, filePath, m_settings.General.getLazySessionRestore());
 }
 
 void MainWindow::on_actionSave_Session_triggered()
@@ -6,6 +6,7 @@
 #include <QDir>
 #include <QLocalSocket>
 #include <QRegularExpression>
+#include <QSharedPointer>
 
 #if defined(Q_OS_WIN)
 #include <QLibrary>
@@ -40,17 +41,19 @@ SingleApplication::SingleApplication(int &argc, char **argv) :
 {
 }
 
-QLocalSocket * SingleApplication::alreadyRunningInstance()
+LocalCommunication * SingleApplication::alreadyRunningInstance()
 {
     QLocalSocket *socket = new QLocalSocket(this);
     socket->connectToServer(socketNameForUser());
     if (socket->waitForConnected(2000))
     {
-        LocalCommunication::send("NEW_CLIENT", socket);
-        QString reply = LocalCommunication::receive(socket);
+        // The event loop isn't running yet: wait for the reply
+        LocalCommunication *communication = new LocalCommunication(socket, socket);
+        communication->send("NEW_CLIENT");
+        QString reply = communication->waitFor(2000);
 
         if (reply == "HELLO") {
-            return socket;
+            return communication;
         }
     }
 
@@ -72,25 +75,36 @@ void SingleApplication::newConnection()
 {
     while (m_localServer->hasPendingConnections()) {
         QLocalSocket *conn = m_localServer->nextPendingConnection();
-        connect(conn, &QLocalSocket::readyRead, this, [=]() {
-            QString message = LocalCommunication::receive(conn);
+        connect(conn, &QLocalSocket::disconnected, conn, &QObject::deleteLater);
 
-            if (message == "NEW_CLIENT")
-            {
-                LocalCommunication::send("HELLO", conn);
-            }
-            else if (message == "ARGS")
-            {
-                LocalCommunication::send("OK", conn);
-                QByteArray ar = LocalCommunication::receiveRaw(conn);
-
-                QDataStream args(&ar, QIODevice::ReadOnly);
-                QStringList argList;
-                args >> argList;
-
-                if (!argList.isEmpty()) {
-                    QString workingDir = argList.takeFirst();
-                    emit receivedArguments(workingDir, argList);
+        LocalCommunication *communication = new LocalCommunication(conn, conn);
+        QSharedPointer<bool> expectingArgs(new bool(false));
+
+        connect(communication, &LocalCommunication::messageReceived, this, [=]() {
+            while (communication->hasPendingMessages()) {
+                QByteArray message = communication->nextRaw();
+
+                if (*expectingArgs)
+                {
+                    *expectingArgs = false;
+
+                    QDataStream args(&message, QIODevice::ReadOnly);
+                    QStringList argList;
+                    args >> argList;
+
+                    if (!argList.isEmpty()) {
+                        QString workingDir = argList.takeFirst();
+                        emit receivedArguments(workingDir, argList);
+                    }
+                }
+                else if (message == "NEW_CLIENT")
+                {
+                    communication->send("HELLO");
+                }
+                else if (message == "ARGS")
+                {
+                    communication->send("OK");
+                    *expectingArgs = true;
                 }
             }
         });
@@ -133,10 +147,10 @@ QString SingleApplication::socketNameForUser()
     return socketName;
 }
 
-bool SingleApplication::sendCommandLineArguments(QLocalSocket *socket)
+bool SingleApplication::sendCommandLineArguments(LocalCommunication *communication)
 {
-    LocalCommunication::send("ARGS", socket);
-    if (LocalCommunication::receive(socket) == "OK") {
+    communication->send("ARGS");
+    if (communication->waitFor(5000) == "OK") {
         QStringList data = QApplication::arguments();
         data.prepend(QDir::currentPath());
 
@@ -144,12 +158,12 @@ bool SingleApplication::sendCommandLineArguments(QLocalSocket *socket)
         QDataStream args(&ar, QIODevice::WriteOnly);
         args << data;
 
-        LocalCommunication::sendRaw(ar, socket);
+        communication->sendRaw(ar);
 
         // Ensure that all the bytes get written:
         // after sendCommandLineArguments() returns, the
         // application will probably exit.
-        return socket->waitForBytesWritten(5000);
+        return communication->waitForBytesWritten(5000);
     }
     return false;
 }
@@ -157,10 +171,10 @@ bool SingleApplication::sendCommandLineArguments(QLocalSocket *socket)
 bool SingleApplication::attachToOtherInstance()
 {
     // See if there are other instances open, and send them the arguments.
-    QLocalSocket *sck = alreadyRunningInstance();
-    if (sck != nullptr) {
-        bool ret = sendCommandLineArguments(sck);
-        sck->disconnectFromServer();
+    LocalCommunication *communication = alreadyRunningInstance();
+    if (communication != nullptr) {
+        bool ret = sendCommandLineArguments(communication);
+        communication->socket()->disconnectFromServer();
         return ret;
     }
 
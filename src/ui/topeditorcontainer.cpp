@@ -156,7 +156,7 @@ std::vector<Editor*> TopEditorContainer::getOpenEditors()
     for (int i = 0; i < count(); i++) {
         EditorTabWidget *tabW = tabWidget(i);
         for (int j = 0; j < tabW->count(); j++) {
-            editors.push_back(tabW->editor(j));
+            editors.push_back(tabW->materializeEditor(j));
         }
     }
 
@@ -202,6 +202,19 @@ void TopEditorContainer::forEachEditor(bool backwardIndexes,
     }
 }
 
+void TopEditorContainer::forEachLoadedEditor(std::function<bool (const int, const int, EditorTabWidget *, Editor *)> callback)
+{
+    for (int i = 0; i < count(); i++) {
+        EditorTabWidget *tabW = tabWidget(i);
+        for (int j = 0; j < tabW->count(); j++) {
+            if (tabW->isPlaceholder(j))
+                continue;
+            bool ret = callback(i, j, tabW, tabW->editor(j));
+            if (ret == false) return;
+        }
+    }
+}
+
 QPromise<void> TopEditorContainer::forEachEditorAsync(bool backwardIndices,
                                                     std::function<void (const int tabWidgetId, const int editorId, EditorTabWidget *tabWidget, Editor *editor, std::function<void()> goOn, std::function<void()> stop)> callback)
 {
@@ -222,7 +235,7 @@ QPromise<void> TopEditorContainer::forEachEditorAsync(bool backwardIndices,
                     }
 
                     EditorTabWidget *tabW = this->tabWidget(i);
-                    callback(i, j, tabW, tabW->editor(j), iteration(i, j-1), [resolve](){ resolve(); });
+                    callback(i, j, tabW, tabW->materializeEditor(j), iteration(i, j-1), [resolve](){ resolve(); });
                 };
             };
 
@@ -241,7 +254,7 @@ QPromise<void> TopEditorContainer::forEachEditorAsync(bool backwardIndices,
                     }
 
                     EditorTabWidget *tabW = this->tabWidget(i);
-                    callback(i, j, tabW, tabW->editor(j), iteration(i, j+1), [resolve](){ resolve(); });
+                    callback(i, j, tabW, tabW->materializeEditor(j), iteration(i, j+1), [resolve](){ resolve(); });
                 };
             };
 
@@ -269,7 +282,7 @@ QPromise<void> TopEditorContainer::forEachEditorConcurrent(std::function<void (c
         for (const auto idx : indices) {
             int i = idx.first;
             int j = idx.second;
-            callback(i, j, tabWidget(i), tabWidget(i)->editor(j), [cnt, resolve](){
+            callback(i, j, tabWidget(i), tabWidget(i)->materializeEditor(j), [cnt, resolve](){
                 (*cnt)--;
                 if (*cnt == 0) {
                     resolve();
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui svg widgets printsupport network webenginewidgets webchannel websockets
+QT       += core gui svg widgets printsupport network webenginewidgets webchannel websockets concurrent
 
 CONFIG += c++14
 
@@ -89,30 +89,51 @@ SOURCES += main.cpp\
     Extensions/extension.cpp \
     frmlinenumberchooser.cpp \
     Extensions/extensionsserver.cpp \
+    Extensions/extensionsconnections.cpp \
     Extensions/Stubs/stub.cpp \
+    Extensions/Stubs/dispatchtable.cpp \
     Extensions/runtimesupport.cpp \
     Extensions/Stubs/windowstub.cpp \
     Extensions/Stubs/notepadqqstub.cpp \
     Extensions/Stubs/editorstub.cpp \
     Extensions/extensionsloader.cpp \
+    Extensions/extensionhostsupervisor.cpp \
+    Extensions/restartpolicy.cpp \
+    Extensions/eventsubscriptions.cpp \
+    Extensions/activationevents.cpp \
+    Extensions/manifestcache.cpp \
+    Extensions/extensiondiagnostics.cpp \
     globals.cpp \
     Extensions/Stubs/menuitemstub.cpp \
     Extensions/installextension.cpp \
+    Extensions/extensionpackage.cpp \
+    Extensions/extensioninstaller.cpp \
     keygrabber.cpp \
     Sessions/sessions.cpp \
     Sessions/persistentcache.cpp \
+    Sessions/sessionsnapshot.cpp \
+    Sessions/sessionstore.cpp \
+    Sessions/blobstore.cpp \
+    Sessions/editjournal.cpp \
     nqqsettings.cpp \  
     nqqrun.cpp \
     Search/filesearcher.cpp \
     Search/filereplacer.cpp \
     Search/searchobjects.cpp \
     Search/searchinstance.cpp \
+    Search/documentsearcher.cpp \
+    Search/directorywalker.cpp \
+    Search/searchresultcache.cpp \
+    Search/searchindex.cpp \
+    Search/searchengine.cpp \
     stats.cpp \
-    Sessions/backupservice.cpp
+    Sessions/backupservice.cpp \
+    Sessions/backupwriter.cpp
 
 HEADERS  += include/mainwindow.h \
     include/topeditorcontainer.h \
     include/editortabwidget.h \
+    include/editorplaceholder.h \
     include/docengine.h \
     include/frmabout.h \
     include/notepadqq.h \
@@ -137,26 +158,47 @@ HEADERS  += include/mainwindow.h \
     include/Extensions/extension.h \
     include/frmlinenumberchooser.h \
     include/Extensions/extensionsserver.h \
+    include/Extensions/extensionsconnections.h \
     include/Extensions/Stubs/stub.h \
+    include/Extensions/Stubs/dispatchtable.h \
     include/Extensions/runtimesupport.h \
+    include/Extensions/stubregistry.h \
     include/Extensions/Stubs/windowstub.h \
     include/Extensions/Stubs/notepadqqstub.h \
     include/Extensions/Stubs/editorstub.h \
     include/Extensions/extensionsloader.h \
+    include/Extensions/extensionhostsupervisor.h \
+    include/Extensions/restartpolicy.h \
+    include/Extensions/eventsubscriptions.h \
+    include/Extensions/activationevents.h \
+    include/Extensions/manifestcache.h \
+    include/Extensions/extensiondiagnostics.h \
     include/globals.h \
     include/Extensions/Stubs/menuitemstub.h \
     include/Extensions/installextension.h \
+    include/Extensions/extensionpackage.h \
+    include/Extensions/extensioninstaller.h \
     include/keygrabber.h \
     include/Sessions/sessions.h \
     include/Sessions/persistentcache.h \
+    include/Sessions/sessionsnapshot.h \
+    include/Sessions/sessionstore.h \
+    include/Sessions/blobstore.h \
+    include/Sessions/editjournal.h \
     include/nqqsettings.h \
     include/nqqrun.h \
     include/Search/filesearcher.h \
     include/Search/searchobjects.h \
     include/Search/filereplacer.h \
     include/Search/searchinstance.h \
+    include/Search/documentsearcher.h \
+    include/Search/directorywalker.h \
+    include/Search/searchresultcache.h \
+    include/Search/searchindex.h \
+    include/Search/searchengine.h \
     include/stats.h \
-    include/Sessions/backupservice.h
+    include/Sessions/backupservice.h \
+    include/Sessions/backupwriter.h
 
 FORMS    += mainwindow.ui \
     frmabout.ui \